@@ -0,0 +1,213 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <osgComputeAlgo/Primitives>
+#include <osgCuda/Buffer>
+#include "Bench.h"
+
+namespace Bench
+{
+    enum AlgoKind
+    {
+        ALGO_REDUCE,
+        ALGO_SCAN,
+        ALGO_SORT,
+        ALGO_COMPACT,
+        ALGO_HISTOGRAM
+    };
+
+    //------------------------------------------------------------------------------
+    static bool isSelected( unsigned int value )
+    {
+        return (value & 0x3) == 0;
+    }
+
+    /** Runs a primitive of osgComputeAlgo on numElements floats or the
+    corresponding std:: algorithm on a std::vector as reference.
+    */
+    class AlgoCase : public Case
+    {
+    public:
+        AlgoCase( const std::string& name, AlgoKind kind, unsigned int numElements, bool reference )
+            : Case( name, numElements ), _kind(kind), _reference(reference) {}
+
+        virtual bool setUp()
+        {
+            unsigned int numElements = getNumOps();
+            _values.resize( numElements );
+            _flags.resize( numElements );
+            srand( 0 );
+            for( unsigned int i=0; i<numElements; ++i )
+            {
+                _values[i] = static_cast<float>( rand() ) / RAND_MAX;
+                _flags[i] = isSelected( i )? 1 : 0;
+            }
+            _scratch.resize( numElements );
+
+            if( _reference )
+                return true;
+
+            _input = createBuffer( "ALGO_INPUT", numElements );
+            _output = createBuffer( "ALGO_OUTPUT", numElements );
+            _flagBuffer = createBuffer( "ALGO_FLAGS", numElements );
+            if( !_input.valid() || !_output.valid() || !_flagBuffer.valid() )
+                return false;
+
+            memcpy( _flagBuffer->map( osgCompute::MAP_HOST_TARGET ), &_flags.front(), numElements * sizeof(unsigned int) );
+            return resetInput();
+        }
+
+        virtual void run()
+        {
+            // Sorting works in place, so the input is restored before each run
+            if( _kind == ALGO_SORT )
+            {
+                if( _reference )
+                    _scratch = _values;
+                else
+                    resetInput();
+            }
+
+            if( _reference )
+                runReference();
+            else
+                runPrimitive();
+        }
+
+        virtual void tearDown()
+        {
+            _input = NULL;
+            _output = NULL;
+            _flagBuffer = NULL;
+            _values.clear();
+            _flags.clear();
+            _scratch.clear();
+        }
+
+    private:
+        //------------------------------------------------------------------------------
+        osgCuda::Buffer* createBuffer( const std::string& name, unsigned int numElements )
+        {
+            osg::ref_ptr<osgCuda::Buffer> buffer = new osgCuda::Buffer;
+            buffer->setName( name );
+            buffer->setElementSize( sizeof(float) );
+            buffer->setDimension( 0, numElements );
+            if( buffer->map( osgCompute::MAP_HOST_TARGET ) == NULL )
+                return NULL;
+
+            return buffer.release();
+        }
+
+        //------------------------------------------------------------------------------
+        bool resetInput()
+        {
+            void* ptr = _input->map( osgCompute::MAP_HOST_TARGET );
+            if( ptr == NULL )
+                return false;
+
+            memcpy( ptr, &_values.front(), _values.size() * sizeof(float) );
+            return true;
+        }
+
+        //------------------------------------------------------------------------------
+        void runPrimitive()
+        {
+            double result = 0.0;
+            unsigned int numSelected = 0;
+            switch( _kind )
+            {
+            case ALGO_REDUCE:       osgComputeAlgo::reduce( *_input, osgComputeAlgo::TYPE_FLOAT, osgComputeAlgo::OP_SUM, result ); break;
+            case ALGO_SCAN:         osgComputeAlgo::inclusiveScan( *_input, *_output, osgComputeAlgo::TYPE_FLOAT ); break;
+            case ALGO_SORT:         osgComputeAlgo::sortByKey( *_input, NULL, osgComputeAlgo::TYPE_FLOAT ); break;
+            case ALGO_COMPACT:      osgComputeAlgo::compact( *_input, *_flagBuffer, *_output, numSelected ); break;
+            case ALGO_HISTOGRAM:    osgComputeAlgo::histogram( *_input, osgComputeAlgo::TYPE_FLOAT, 0.0, 1.0, *_flagBuffer ); break;
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        void runReference()
+        {
+            switch( _kind )
+            {
+            case ALGO_REDUCE:
+                _result = std::accumulate( _values.begin(), _values.end(), 0.0f );
+                break;
+            case ALGO_SCAN:
+                std::partial_sum( _values.begin(), _values.end(), _scratch.begin() );
+                break;
+            case ALGO_SORT:
+                std::sort( _scratch.begin(), _scratch.end() );
+                break;
+            case ALGO_COMPACT:
+                {
+                    std::vector<float>::iterator dst = _scratch.begin();
+                    for( unsigned int i=0; i<_values.size(); ++i )
+                        if( _flags[i] != 0 )
+                            *dst++ = _values[i];
+                }
+                break;
+            case ALGO_HISTOGRAM:
+                {
+                    std::fill( _flags.begin(), _flags.end(), 0 );
+                    for( unsigned int i=0; i<_values.size(); ++i )
+                        _flags[ std::min( static_cast<size_t>( _values[i] * _flags.size() ), _flags.size()-1 ) ]++;
+                }
+                break;
+            }
+        }
+
+        AlgoKind                        _kind;
+        bool                            _reference;
+        float                           _result;
+        std::vector<float>              _values;
+        std::vector<float>              _scratch;
+        std::vector<unsigned int>       _flags;
+        osg::ref_ptr<osgCuda::Buffer>   _input;
+        osg::ref_ptr<osgCuda::Buffer>   _output;
+        osg::ref_ptr<osgCuda::Buffer>   _flagBuffer;
+    };
+
+    //------------------------------------------------------------------------------
+    static void addAlgoCases( Suite& suite, const std::string& sizeName, unsigned int numElements )
+    {
+        suite.add( new AlgoCase( "algo/reduce/" + sizeName, ALGO_REDUCE, numElements, false ) );
+        suite.add( new AlgoCase( "algo/std_accumulate/" + sizeName, ALGO_REDUCE, numElements, true ) );
+        suite.add( new AlgoCase( "algo/inclusive_scan/" + sizeName, ALGO_SCAN, numElements, false ) );
+        suite.add( new AlgoCase( "algo/std_partial_sum/" + sizeName, ALGO_SCAN, numElements, true ) );
+        suite.add( new AlgoCase( "algo/radix_sort/" + sizeName, ALGO_SORT, numElements, false ) );
+        suite.add( new AlgoCase( "algo/std_sort/" + sizeName, ALGO_SORT, numElements, true ) );
+        suite.add( new AlgoCase( "algo/compact/" + sizeName, ALGO_COMPACT, numElements, false ) );
+        suite.add( new AlgoCase( "algo/std_compact/" + sizeName, ALGO_COMPACT, numElements, true ) );
+        suite.add( new AlgoCase( "algo/histogram/" + sizeName, ALGO_HISTOGRAM, numElements, false ) );
+        suite.add( new AlgoCase( "algo/std_histogram/" + sizeName, ALGO_HISTOGRAM, numElements, true ) );
+    }
+
+    //------------------------------------------------------------------------------
+    void addAlgoCases( Suite& suite )
+    {
+        addAlgoCases( suite, "1M", 1 << 20 );
+        addAlgoCases( suite, "16M", 1 << 24 );
+
+        // Memory sizes are limited to 32 bit, i.e. 1G floats cannot be
+        // allocated. The largest cases use 256M floats (1 GB per buffer).
+        if( getenv( "OSGCOMPUTE_BENCH_LARGE" ) != NULL )
+            addAlgoCases( suite, "256M", 1 << 28 );
+    }
+}
@@ -0,0 +1,171 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <osg/Notify>
+#include <osg/Timer>
+#include "Bench.h"
+
+namespace Bench
+{
+    //------------------------------------------------------------------------------
+    Suite::Suite()
+        : _minTime(0.25)
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    void Suite::add( Case* benchCase )
+    {
+        if( benchCase != NULL )
+            _cases.push_back( benchCase );
+    }
+
+    //------------------------------------------------------------------------------
+    ResultList Suite::run( const std::string& filter )
+    {
+        ResultList results;
+        for( CaseList::iterator itr = _cases.begin(); itr != _cases.end(); ++itr )
+        {
+            Case& curCase = *(*itr);
+            if( !filter.empty() && curCase.getName().find( filter ) == std::string::npos )
+                continue;
+
+            Result result;
+            result.name = curCase.getName();
+            result.iterations = 0;
+            result.opsPerIteration = curCase.getNumOps();
+            result.totalMs = 0.0;
+            result.nsPerOp = 0.0;
+            result.skipped = false;
+
+            if( !curCase.setUp() )
+            {
+                result.skipped = true;
+                results.push_back( result );
+                osg::notify(osg::NOTICE) << result.name << ": skipped" << std::endl;
+                continue;
+            }
+
+            // warm up caches and first-time allocations
+            curCase.run();
+
+            osg::Timer_t start = osg::Timer::instance()->tick();
+            double elapsed = 0.0;
+            while( elapsed < _minTime )
+            {
+                curCase.run();
+                result.iterations++;
+                elapsed = osg::Timer::instance()->delta_s( start, osg::Timer::instance()->tick() );
+            }
+            curCase.tearDown();
+
+            result.totalMs = elapsed * 1000.0;
+            result.nsPerOp = (elapsed * 1e9) / (double(result.iterations) * double(result.opsPerIteration));
+            results.push_back( result );
+
+            osg::notify(osg::NOTICE)
+                << std::left << std::setw(48) << result.name << std::right
+                << std::setw(14) << std::fixed << std::setprecision(2) << result.nsPerOp << " ns/op"
+                << std::setw(10) << result.iterations << " iterations" << std::endl;
+        }
+
+        return results;
+    }
+
+    //------------------------------------------------------------------------------
+    void writeJSON( std::ostream& os, const ResultList& results )
+    {
+        os << "{\n\"results\": [\n";
+        for( ResultList::const_iterator itr = results.begin(); itr != results.end(); ++itr )
+        {
+            os << "{ \"name\": \"" << (*itr).name << "\""
+               << ", \"skipped\": " << ((*itr).skipped ? "true" : "false")
+               << ", \"iterations\": " << (*itr).iterations
+               << ", \"ops_per_iteration\": " << (*itr).opsPerIteration
+               << ", \"total_ms\": " << std::fixed << std::setprecision(3) << (*itr).totalMs
+               << ", \"ns_per_op\": " << std::fixed << std::setprecision(3) << (*itr).nsPerOp
+               << " }";
+            if( itr + 1 != results.end() )
+                os << ",";
+            os << "\n";
+        }
+        os << "]\n}\n";
+    }
+
+    //------------------------------------------------------------------------------
+    bool readBaseline( const std::string& filename, BaselineMap& baseline )
+    {
+        std::ifstream file( filename.c_str() );
+        if( !file.is_open() )
+        {
+            osg::notify(osg::WARN) << __FUNCTION__ << ": cannot open baseline \"" << filename << "\"." << std::endl;
+            return false;
+        }
+
+        const std::string nameKey = "\"name\": \"";
+        const std::string nsKey = "\"ns_per_op\": ";
+        const std::string skippedKey = "\"skipped\": true";
+
+        std::string line;
+        while( std::getline( file, line ) )
+        {
+            std::string::size_type namePos = line.find( nameKey );
+            std::string::size_type nsPos = line.find( nsKey );
+            if( namePos == std::string::npos || nsPos == std::string::npos || line.find( skippedKey ) != std::string::npos )
+                continue;
+
+            namePos += nameKey.size();
+            std::string::size_type nameEnd = line.find( '"', namePos );
+            if( nameEnd == std::string::npos )
+                continue;
+
+            baseline[ line.substr( namePos, nameEnd - namePos ) ] = atof( line.c_str() + nsPos + nsKey.size() );
+        }
+
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int compare( std::ostream& os, const ResultList& results, const BaselineMap& baseline, double threshold )
+    {
+        unsigned int regressions = 0;
+        for( ResultList::const_iterator itr = results.begin(); itr != results.end(); ++itr )
+        {
+            if( (*itr).skipped )
+                continue;
+
+            BaselineMap::const_iterator baseItr = baseline.find( (*itr).name );
+            if( baseItr == baseline.end() || baseItr->second <= 0.0 )
+            {
+                os << std::left << std::setw(48) << (*itr).name << " no baseline" << std::endl;
+                continue;
+            }
+
+            double change = ((*itr).nsPerOp - baseItr->second) / baseItr->second;
+            bool regressed = change > threshold;
+            if( regressed )
+                regressions++;
+
+            os << std::left << std::setw(48) << (*itr).name << std::right
+               << std::setw(8) << std::fixed << std::setprecision(1) << (change * 100.0) << "%"
+               << (regressed ? "  REGRESSION" : "") << std::endl;
+        }
+
+        return regressions;
+    }
+}
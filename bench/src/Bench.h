@@ -0,0 +1,122 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#ifndef OSGCOMPUTE_BENCH
+#define OSGCOMPUTE_BENCH 1
+
+#include <map>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <osg/Referenced>
+#include <osg/ref_ptr>
+
+namespace Bench
+{
+    //! Base class of a single benchmark case.
+    /** A case is set up once, then run() is called repeatedly until the
+    minimum measurement time is reached. Each call to run() processes
+    getNumOps() items, e.g. the number of nodes of a graph. Results are
+    reported as nanoseconds per item.
+    */
+    class Case : public osg::Referenced
+    {
+    public:
+        Case( const std::string& name, unsigned int numOps = 1 )
+            : _name(name), _numOps(numOps) {}
+
+        const std::string& getName() const { return _name; }
+        unsigned int getNumOps() const { return _numOps; }
+
+        /** Returns false if the case cannot run in the current
+        environment, e.g. if no compute device is available.
+        */
+        virtual bool setUp() { return true; }
+        virtual void run() = 0;
+        virtual void tearDown() {}
+
+    protected:
+        virtual ~Case() {}
+
+        std::string     _name;
+        unsigned int    _numOps;
+    };
+
+    struct Result
+    {
+        std::string     name;
+        unsigned int    iterations;
+        unsigned int    opsPerIteration;
+        double          totalMs;
+        double          nsPerOp;
+        bool            skipped;
+    };
+
+    typedef std::vector< osg::ref_ptr<Case> >       CaseList;
+    typedef std::vector< Result >                   ResultList;
+    typedef std::map< std::string, double >         BaselineMap;
+
+    //! Collection of benchmark cases.
+    class Suite
+    {
+    public:
+        Suite();
+
+        void add( Case* benchCase );
+        const CaseList& getCases() const { return _cases; }
+
+        /** Minimum time in seconds spent in run() per case.
+        */
+        void setMinTime( double seconds ) { _minTime = seconds; }
+
+        /** Runs all cases which contain filter in their name.
+        */
+        ResultList run( const std::string& filter );
+
+    private:
+        CaseList    _cases;
+        double      _minTime;
+    };
+
+    /** Writes the results as a JSON document. Each result is written
+    on a separate line so that readBaseline() can parse the file without
+    a full JSON parser.
+    */
+    void writeJSON( std::ostream& os, const ResultList& results );
+
+    /** Reads a file written by writeJSON().
+    */
+    bool readBaseline( const std::string& filename, BaselineMap& baseline );
+
+    /** Prints a comparison against the baseline and returns the number of
+    cases which are slower than the baseline by more than threshold
+    (e.g. 0.1 for 10%).
+    */
+    unsigned int compare( std::ostream& os, const ResultList& results, const BaselineMap& baseline, double threshold );
+
+    // Case factories of the individual benchmark modules
+    void addMemoryCases( Suite& suite );
+    void addComputationCases( Suite& suite );
+    void addVisitorCases( Suite& suite );
+    void addObserverCases( Suite& suite );
+    void addSerializerCases( Suite& suite );
+    void addPipelineCases( Suite& suite );
+    void addStartupCases( Suite& suite );
+    void addAlgoCases( Suite& suite );
+    void addFilterCases( Suite& suite );
+    void addTracerCases( Suite& suite );
+}
+
+#endif //OSGCOMPUTE_BENCH
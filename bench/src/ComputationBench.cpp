@@ -0,0 +1,145 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <sstream>
+#include <osgCompute/Program>
+#include <osgCuda/Buffer>
+#include <osgCuda/Computation>
+#include "Bench.h"
+
+namespace Bench
+{
+    /** Program which accepts every resource. Used to include the cost of
+    acceptResource()/removeResource() in the computation benchmarks.
+    */
+    class NullProgram : public osgCompute::Program
+    {
+    public:
+        virtual void launch() {}
+        virtual void acceptResource( osgCompute::Resource& resource ) { _numAccepted++; }
+        virtual void removeResource( const osgCompute::Resource& resource ) { _numAccepted--; }
+
+        NullProgram() : _numAccepted(0) {}
+
+    private:
+        unsigned int _numAccepted;
+    };
+
+    //------------------------------------------------------------------------------
+    static void createResources( osgCompute::ResourceList& resources, unsigned int numResources )
+    {
+        resources.clear();
+        for( unsigned int r=0; r<numResources; ++r )
+        {
+            std::stringstream identifier;
+            identifier << "RESOURCE_" << r;
+
+            osg::ref_ptr<osgCuda::Buffer> buffer = new osgCuda::Buffer;
+            buffer->addIdentifier( identifier.str() );
+            resources.push_back( buffer.get() );
+        }
+    }
+
+    /** Adds numResources uniquely identified resources to a fresh computation.
+    */
+    class AddResourceCase : public Case
+    {
+    public:
+        AddResourceCase( const std::string& name, unsigned int numResources )
+            : Case( name, numResources ) {}
+
+        virtual bool setUp()
+        {
+            createResources( _resources, getNumOps() );
+            return true;
+        }
+
+        virtual void run()
+        {
+            osg::ref_ptr<osgCompute::Computation> computation = new osgCuda::Computation;
+            computation->addProgram( *new NullProgram );
+            for( osgCompute::ResourceListItr itr = _resources.begin(); itr != _resources.end(); ++itr )
+                computation->addResource( *(*itr) );
+        }
+
+        virtual void tearDown()
+        {
+            _resources.clear();
+        }
+
+    private:
+        osgCompute::ResourceList _resources;
+    };
+
+    /** Exchanges every resource of a computation with a resource of the same
+    identifier. Two resource sets are swapped alternately.
+    */
+    class ExchangeResourceCase : public Case
+    {
+    public:
+        ExchangeResourceCase( const std::string& name, unsigned int numResources )
+            : Case( name, numResources ), _flip(false) {}
+
+        virtual bool setUp()
+        {
+            createResources( _resourcesA, getNumOps() );
+            createResources( _resourcesB, getNumOps() );
+
+            _computation = new osgCuda::Computation;
+            _computation->addProgram( *new NullProgram );
+            for( osgCompute::ResourceListItr itr = _resourcesA.begin(); itr != _resourcesA.end(); ++itr )
+                _computation->addResource( *(*itr) );
+
+            _flip = true;
+            return true;
+        }
+
+        virtual void run()
+        {
+            osgCompute::ResourceList& resources = _flip ? _resourcesB : _resourcesA;
+            for( osgCompute::ResourceListItr itr = resources.begin(); itr != resources.end(); ++itr )
+                _computation->exchangeResource( *(*itr) );
+
+            _flip = !_flip;
+        }
+
+        virtual void tearDown()
+        {
+            _computation = NULL;
+            _resourcesA.clear();
+            _resourcesB.clear();
+        }
+
+    private:
+        osg::ref_ptr<osgCompute::Computation>   _computation;
+        osgCompute::ResourceList                _resourcesA;
+        osgCompute::ResourceList                _resourcesB;
+        bool                                    _flip;
+    };
+
+    //------------------------------------------------------------------------------
+    void addComputationCases( Suite& suite )
+    {
+        const unsigned int counts[] = { 100, 1000, 5000 };
+        for( unsigned int c=0; c<3; ++c )
+        {
+            std::stringstream suffix;
+            suffix << "/" << counts[c];
+
+            suite.add( new AddResourceCase( "computation/add_resource" + suffix.str(), counts[c] ) );
+            suite.add( new ExchangeResourceCase( "computation/exchange_resource" + suffix.str(), counts[c] ) );
+        }
+    }
+}
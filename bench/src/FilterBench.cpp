@@ -0,0 +1,143 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <cstdlib>
+#include <osgComputeAlgo/ImageFilter>
+#include <osgCuda/Buffer>
+#include "Bench.h"
+
+namespace Bench
+{
+    enum FilterKind
+    {
+        FILTER_COPY,
+        FILTER_GAUSSIAN,
+        FILTER_SOBEL,
+        FILTER_DILATE,
+        FILTER_SWIZZLE,
+        FILTER_BLUR_SOBEL,
+        FILTER_BLUR_SOBEL_SEPARATE
+    };
+
+    /** Filters an RGBA8 image with osgComputeAlgo::FilterChain. The
+    *_separate case applies the filters of a chain one after another
+    through a full-size intermediate image as reference.
+    */
+    class FilterCase : public Case
+    {
+    public:
+        FilterCase( const std::string& name, FilterKind kind, unsigned int width, unsigned int height )
+            : Case( name, width * height ), _kind(kind), _width(width), _height(height) {}
+
+        virtual bool setUp()
+        {
+            _input = createImage( "FILTER_INPUT" );
+            _output = createImage( "FILTER_OUTPUT" );
+            _intermediate = createImage( "FILTER_INTERMEDIATE" );
+            if( !_input.valid() || !_output.valid() || !_intermediate.valid() )
+                return false;
+
+            unsigned char* pixels = static_cast<unsigned char*>( _input->map( osgCompute::MAP_HOST_TARGET ) );
+            srand( 0 );
+            for( unsigned int i=0; i<_input->getAllElementsSize(); ++i )
+                pixels[i] = static_cast<unsigned char>( rand() & 0xFF );
+
+            _chain = new osgComputeAlgo::FilterChain;
+            _second = new osgComputeAlgo::FilterChain;
+            switch( _kind )
+            {
+            case FILTER_COPY:       break;
+            case FILTER_GAUSSIAN:   _chain->addFilter( new osgComputeAlgo::GaussianBlurFilter( 1.0f ) ); break;
+            case FILTER_SOBEL:      _chain->addFilter( new osgComputeAlgo::SobelFilter ); break;
+            case FILTER_DILATE:     _chain->addFilter( new osgComputeAlgo::MorphologyFilter( osgComputeAlgo::MorphologyFilter::DILATE, 1, 1 ) ); break;
+            case FILTER_SWIZZLE:    _chain->addFilter( new osgComputeAlgo::ChannelSwizzleFilter( 2, 1, 0, 3 ) ); break;
+            case FILTER_BLUR_SOBEL:
+                _chain->addFilter( new osgComputeAlgo::GaussianBlurFilter( 1.0f ) );
+                _chain->addFilter( new osgComputeAlgo::SobelFilter );
+                break;
+            case FILTER_BLUR_SOBEL_SEPARATE:
+                _chain->addFilter( new osgComputeAlgo::GaussianBlurFilter( 1.0f ) );
+                _second->addFilter( new osgComputeAlgo::SobelFilter );
+                break;
+            }
+            return true;
+        }
+
+        virtual void run()
+        {
+            if( _kind == FILTER_BLUR_SOBEL_SEPARATE )
+            {
+                _chain->apply( *_input, *_intermediate );
+                _second->apply( *_intermediate, *_output );
+            }
+            else
+            {
+                _chain->apply( *_input, *_output );
+            }
+        }
+
+        virtual void tearDown()
+        {
+            _chain = NULL;
+            _second = NULL;
+            _input = NULL;
+            _output = NULL;
+            _intermediate = NULL;
+        }
+
+    private:
+        //------------------------------------------------------------------------------
+        osgCuda::Buffer* createImage( const std::string& name )
+        {
+            osg::ref_ptr<osgCuda::Buffer> buffer = new osgCuda::Buffer;
+            buffer->setName( name );
+            buffer->setElementSize( 4 );
+            buffer->setDimension( 0, _width );
+            buffer->setDimension( 1, _height );
+            if( buffer->map( osgCompute::MAP_HOST_TARGET ) == NULL )
+                return NULL;
+
+            return buffer.release();
+        }
+
+        FilterKind                                      _kind;
+        unsigned int                                    _width;
+        unsigned int                                    _height;
+        osg::ref_ptr<osgComputeAlgo::FilterChain>       _chain;
+        osg::ref_ptr<osgComputeAlgo::FilterChain>       _second;
+        osg::ref_ptr<osgCuda::Buffer>                   _input;
+        osg::ref_ptr<osgCuda::Buffer>                   _output;
+        osg::ref_ptr<osgCuda::Buffer>                   _intermediate;
+    };
+
+    //------------------------------------------------------------------------------
+    static void addFilterCases( Suite& suite, const std::string& sizeName, unsigned int width, unsigned int height )
+    {
+        suite.add( new FilterCase( "filter/copy/" + sizeName, FILTER_COPY, width, height ) );
+        suite.add( new FilterCase( "filter/gaussian/" + sizeName, FILTER_GAUSSIAN, width, height ) );
+        suite.add( new FilterCase( "filter/sobel/" + sizeName, FILTER_SOBEL, width, height ) );
+        suite.add( new FilterCase( "filter/dilate/" + sizeName, FILTER_DILATE, width, height ) );
+        suite.add( new FilterCase( "filter/swizzle/" + sizeName, FILTER_SWIZZLE, width, height ) );
+        suite.add( new FilterCase( "filter/blur_sobel/" + sizeName, FILTER_BLUR_SOBEL, width, height ) );
+        suite.add( new FilterCase( "filter/blur_sobel_separate/" + sizeName, FILTER_BLUR_SOBEL_SEPARATE, width, height ) );
+    }
+
+    //------------------------------------------------------------------------------
+    void addFilterCases( Suite& suite )
+    {
+        addFilterCases( suite, "1080p", 1920, 1080 );
+        addFilterCases( suite, "8K", 7680, 4320 );
+    }
+}
@@ -0,0 +1,173 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <cstring>
+#include <sstream>
+#include <vector>
+#include <cuda_runtime.h>
+#include <osgCompute/ByteSwap>
+#include <osgCuda/Buffer>
+#include "Bench.h"
+
+namespace Bench
+{
+    //------------------------------------------------------------------------------
+    static bool deviceAvailable()
+    {
+        int numDevices = 0;
+        if( cudaGetDeviceCount( &numDevices ) != cudaSuccess )
+            return false;
+
+        return numDevices > 0;
+    }
+
+    /** Maps a buffer alternately with two mappings. If both mappings are
+    on the host no synchronization happens and the case measures the
+    bookkeeping overhead of map(). A host/device pair measures the full
+    synchronization cost of a state transition.
+    */
+    class MapTransitionCase : public Case
+    {
+    public:
+        MapTransitionCase( const std::string& name, unsigned int numElements, unsigned int first, unsigned int second )
+            : Case( name ), _numElements(numElements), _first(first), _second(second) {}
+
+        virtual bool setUp()
+        {
+            bool needsDevice = ((_first | _second) & (osgCompute::MAP_DEVICE | osgCompute::MAP_DEVICE_ARRAY)) != 0;
+            if( needsDevice && !deviceAvailable() )
+                return false;
+
+            _buffer = new osgCuda::Buffer;
+            _buffer->setName( getName() );
+            _buffer->setElementSize( sizeof(float) );
+            _buffer->setDimension( 0, _numElements );
+            return _buffer->map( _first ) != NULL && _buffer->map( _second ) != NULL;
+        }
+
+        virtual void run()
+        {
+            _buffer->map( _first );
+            _buffer->map( _second );
+        }
+
+        virtual void tearDown()
+        {
+            _buffer = NULL;
+        }
+
+    private:
+        osg::ref_ptr<osgCuda::Buffer>   _buffer;
+        unsigned int                    _numElements;
+        unsigned int                    _first;
+        unsigned int                    _second;
+    };
+
+    /** Allocation and release of a memory object.
+    */
+    class AllocCase : public Case
+    {
+    public:
+        AllocCase( const std::string& name, unsigned int numElements )
+            : Case( name ), _numElements(numElements) {}
+
+        virtual bool setUp()
+        {
+            _buffer = new osgCuda::Buffer;
+            _buffer->setElementSize( sizeof(float) );
+            _buffer->setDimension( 0, _numElements );
+            return true;
+        }
+
+        virtual void run()
+        {
+            _buffer->map( osgCompute::MAP_HOST_TARGET );
+            _buffer->releaseObjects();
+        }
+
+        virtual void tearDown()
+        {
+            _buffer = NULL;
+        }
+
+    private:
+        osg::ref_ptr<osgCuda::Buffer>   _buffer;
+        unsigned int                    _numElements;
+    };
+
+    /** Byte order conversion of numWords words. A word size of 0
+    measures a plain memcpy() as reference.
+    */
+    class ByteSwapCase : public Case
+    {
+    public:
+        ByteSwapCase( const std::string& name, unsigned int numWords, unsigned int wordSize )
+            : Case( name, numWords ), _wordSize(wordSize) {}
+
+        virtual bool setUp()
+        {
+            unsigned int byteSize = getNumOps() * ((_wordSize == 0)? 4 : _wordSize);
+            _src.assign( byteSize, 0x5A );
+            _dst.resize( byteSize );
+            return true;
+        }
+
+        virtual void run()
+        {
+            if( _wordSize == 0 )
+                memcpy( &_dst.front(), &_src.front(), _src.size() );
+            else
+                osgCompute::copySwapped( &_src.front(), &_dst.front(), static_cast<unsigned int>( _src.size() ), _wordSize );
+        }
+
+        virtual void tearDown()
+        {
+            _src.clear();
+            _dst.clear();
+        }
+
+    private:
+        unsigned int        _wordSize;
+        std::vector<char>   _src;
+        std::vector<char>   _dst;
+    };
+
+    //------------------------------------------------------------------------------
+    void addMemoryCases( Suite& suite )
+    {
+        const unsigned int sizes[] = { 1024, 1024*1024 };
+        for( unsigned int s=0; s<2; ++s )
+        {
+            std::stringstream suffix;
+            suffix << "/" << sizes[s];
+
+            suite.add( new MapTransitionCase( "memory/map_host_source_host_target" + suffix.str(), sizes[s],
+                osgCompute::MAP_HOST_SOURCE, osgCompute::MAP_HOST_TARGET ) );
+            suite.add( new MapTransitionCase( "memory/map_host_target_device_source" + suffix.str(), sizes[s],
+                osgCompute::MAP_HOST_TARGET, osgCompute::MAP_DEVICE_SOURCE ) );
+            suite.add( new MapTransitionCase( "memory/map_device_target_host_source" + suffix.str(), sizes[s],
+                osgCompute::MAP_DEVICE_TARGET, osgCompute::MAP_HOST_SOURCE ) );
+            suite.add( new MapTransitionCase( "memory/map_device_source_device_target" + suffix.str(), sizes[s],
+                osgCompute::MAP_DEVICE_SOURCE, osgCompute::MAP_DEVICE_TARGET ) );
+            suite.add( new AllocCase( "memory/alloc_release_host" + suffix.str(), sizes[s] ) );
+        }
+
+        const unsigned int numWords = 16*1024*1024;
+        suite.add( new ByteSwapCase( "memory/memcpy/16M", numWords, 0 ) );
+        suite.add( new ByteSwapCase( "memory/byteswap_16/16M", numWords, 2 ) );
+        suite.add( new ByteSwapCase( "memory/byteswap_32/16M", numWords, 4 ) );
+        suite.add( new ByteSwapCase( "memory/byteswap_64/16M", numWords, 8 ) );
+    }
+}
@@ -0,0 +1,101 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <sstream>
+#include <osgCompute/Resource>
+#include <osgCuda/Buffer>
+#include "Bench.h"
+
+namespace Bench
+{
+    /** Creates and deletes resources while numLive other resources are
+    observed. Each resource registers with the ResourceObserver in its
+    constructor and unregisters on deletion.
+    */
+    class ObserverChurnCase : public Case
+    {
+    public:
+        ObserverChurnCase( const std::string& name, unsigned int numLive, unsigned int numChurn )
+            : Case( name, numChurn ), _numLive(numLive) {}
+
+        virtual bool setUp()
+        {
+            for( unsigned int r=0; r<_numLive; ++r )
+                _live.push_back( new osgCuda::Buffer );
+            return true;
+        }
+
+        virtual void run()
+        {
+            osgCompute::ResourceList churn;
+            churn.reserve( getNumOps() );
+            for( unsigned int r=0; r<getNumOps(); ++r )
+                churn.push_back( new osgCuda::Buffer );
+        }
+
+        virtual void tearDown()
+        {
+            _live.clear();
+        }
+
+    private:
+        osgCompute::ResourceList    _live;
+        unsigned int                _numLive;
+    };
+
+    /** Queries all resources of a class as done by the stats handler.
+    */
+    class ObserverQueryCase : public Case
+    {
+    public:
+        ObserverQueryCase( const std::string& name, unsigned int numLive )
+            : Case( name, numLive ) {}
+
+        virtual bool setUp()
+        {
+            for( unsigned int r=0; r<getNumOps(); ++r )
+                _live.push_back( new osgCuda::Buffer );
+            return true;
+        }
+
+        virtual void run()
+        {
+            osgCompute::ResourceClassList resources = osgCompute::ResourceObserver::instance()->getResources( "osgCuda::Buffer" );
+        }
+
+        virtual void tearDown()
+        {
+            _live.clear();
+        }
+
+    private:
+        osgCompute::ResourceList    _live;
+    };
+
+    //------------------------------------------------------------------------------
+    void addObserverCases( Suite& suite )
+    {
+        const unsigned int counts[] = { 0, 1000, 10000 };
+        for( unsigned int c=0; c<3; ++c )
+        {
+            std::stringstream suffix;
+            suffix << "/" << counts[c];
+
+            suite.add( new ObserverChurnCase( "observer/churn_live" + suffix.str(), counts[c], 1000 ) );
+            if( counts[c] != 0 )
+                suite.add( new ObserverQueryCase( "observer/query" + suffix.str(), counts[c] ) );
+        }
+    }
+}
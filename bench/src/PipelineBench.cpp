@@ -0,0 +1,331 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <math.h>
+#include <cstdlib>
+#include <sstream>
+#include <osg/Math>
+#include <osg/Vec4>
+#include <osgCompute/Program>
+#include <osgCuda/Buffer>
+#include <osgCuda/Computation>
+#include "Bench.h"
+
+// The host programs mirror the kernels of the osgParticleDemo,
+// osgTraceDemo and osgRTTDemo examples so that the pipelines
+// can be measured on machines without a compute device.
+namespace Bench
+{
+    /** Reseeds particles which left the bounding box (see PtclKernels.cu).
+    */
+    class HostPtclEmitter : public osgCompute::Program
+    {
+    public:
+        HostPtclEmitter() : _seedIdx(0) {}
+
+        virtual void launch()
+        {
+            if( !_ptcls.valid() || !_seeds.valid() )
+                return;
+
+            osg::Vec4f* ptcls = static_cast<osg::Vec4f*>( _ptcls->map( osgCompute::MAP_HOST ) );
+            const float* seeds = static_cast<const float*>( _seeds->map( osgCompute::MAP_HOST_SOURCE ) );
+            unsigned int numPtcls = _ptcls->getNumElements();
+            unsigned int seedCount = _seeds->getNumElements();
+            const osg::Vec3f bbmin(-1.f,-1.f,-1.f), bbmax(1.f,1.f,1.f);
+
+            for( unsigned int p=0; p<numPtcls; ++p )
+            {
+                const osg::Vec4f& cur = ptcls[p];
+                if( cur.x() < bbmin.x() || cur.y() < bbmin.y() || cur.z() < bbmin.z() ||
+                    cur.x() > bbmax.x() || cur.y() > bbmax.y() || cur.z() > bbmax.z() )
+                {
+                    unsigned int idx1 = (_seedIdx + p) % seedCount;
+                    unsigned int idx2 = (idx1 + p) % seedCount;
+                    unsigned int idx3 = (idx2 + p) % seedCount;
+                    ptcls[p].set(
+                        bbmin.x() + seeds[idx1] * (bbmax.x()-bbmin.x()),
+                        bbmin.y() + seeds[idx3] * (bbmax.y()-bbmin.y()),
+                        bbmin.z() + seeds[idx2] * (bbmax.z()-bbmin.z()),
+                        1.f );
+                }
+            }
+            _seedIdx = (_seedIdx + 1) % seedCount;
+        }
+
+        virtual void acceptResource( osgCompute::Resource& resource )
+        {
+            if( resource.isIdentifiedBy("PTCL_BUFFER") )
+                _ptcls = dynamic_cast<osgCompute::Memory*>( &resource );
+            if( resource.isIdentifiedBy("PTCL_SEEDS") )
+                _seeds = dynamic_cast<osgCompute::Memory*>( &resource );
+        }
+
+    private:
+        osg::ref_ptr<osgCompute::Memory>    _ptcls;
+        osg::ref_ptr<osgCompute::Memory>    _seeds;
+        unsigned int                        _seedIdx;
+    };
+
+    /** Euler step of the particle demo.
+    */
+    class HostPtclMover : public osgCompute::Program
+    {
+    public:
+        virtual void launch()
+        {
+            if( !_ptcls.valid() )
+                return;
+
+            osg::Vec4f* ptcls = static_cast<osg::Vec4f*>( _ptcls->map( osgCompute::MAP_HOST_TARGET ) );
+            unsigned int numPtcls = _ptcls->getNumElements();
+            for( unsigned int p=0; p<numPtcls; ++p )
+                ptcls[p].z() += 0.009f;
+        }
+
+        virtual void acceptResource( osgCompute::Resource& resource )
+        {
+            if( resource.isIdentifiedBy("PTCL_BUFFER") )
+                _ptcls = dynamic_cast<osgCompute::Memory*>( &resource );
+        }
+
+    private:
+        osg::ref_ptr<osgCompute::Memory>    _ptcls;
+    };
+
+    /** Runge-Kutta integration in a vortex field (see PtclTracer.cu).
+    */
+    class HostPtclTracer : public osgCompute::Program
+    {
+    public:
+        virtual void launch()
+        {
+            if( !_ptcls.valid() )
+                return;
+
+            osg::Vec4f* ptcls = static_cast<osg::Vec4f*>( _ptcls->map( osgCompute::MAP_HOST_TARGET ) );
+            unsigned int numPtcls = _ptcls->getNumElements();
+            const float etime = 0.009f;
+            const float halfETime = etime * 0.5f;
+
+            for( unsigned int p=0; p<numPtcls; ++p )
+            {
+                osg::Vec4f pos = ptcls[p];
+                osg::Vec4f k0 = vortexField( pos );
+                osg::Vec4f k1 = vortexField( pos + k0 * halfETime );
+                osg::Vec4f k2 = vortexField( pos + k1 * halfETime );
+                osg::Vec4f k3 = vortexField( pos + k2 * etime );
+
+                pos = pos + (k0 + k1 * 2.f + k2 * 2.f + k3) * (etime * (1.f/6.f));
+                pos.w() = 1.f;
+                ptcls[p] = pos;
+            }
+        }
+
+        virtual void acceptResource( osgCompute::Resource& resource )
+        {
+            if( resource.isIdentifiedBy("PTCL_BUFFER") )
+                _ptcls = dynamic_cast<osgCompute::Memory*>( &resource );
+        }
+
+    private:
+        static inline osg::Vec4f vortexField( const osg::Vec4f& pos )
+        {
+            const float gam = 0.003f;
+            const float strength = 10.0f;
+            float sqrad = pos.x()*pos.x() + pos.z()*pos.z();
+            if( sqrad == 0.f )
+                return osg::Vec4f(0.f,0.f,0.f,0.f);
+
+            return osg::Vec4f(
+                (-osg::PI * gam * pos.z()) / sqrad,
+                0.f,
+                (osg::PI * gam * pos.x()) / sqrad,
+                0.f ) * strength;
+        }
+
+        osg::ref_ptr<osgCompute::Memory>    _ptcls;
+    };
+
+    /** Sobel filter on RGBA8 images with wrap around borders (see osgRTTDemo TexFilter.cu).
+    */
+    class HostSobelFilter : public osgCompute::Program
+    {
+    public:
+        virtual void launch()
+        {
+            if( !_src.valid() || !_trg.valid() )
+                return;
+
+            const unsigned char* src = static_cast<const unsigned char*>( _src->map( osgCompute::MAP_HOST_SOURCE ) );
+            unsigned char* trg = static_cast<unsigned char*>( _trg->map( osgCompute::MAP_HOST_TARGET ) );
+            int width = _src->getDimension(0);
+            int height = _src->getDimension(1);
+
+            static const float wx[9] = { 1, 0, -1, 2, 0, -2, 1, 0, -1 };
+            static const float wy[9] = { 1, 2, 1, 0, 0, 0, -1, -2, -1 };
+
+            for( int y=0; y<height; ++y )
+            {
+                int yPrev = (y-1 < 0)? height-1 : y-1;
+                int yNext = (y+1 >= height)? 0 : y+1;
+                for( int x=0; x<width; ++x )
+                {
+                    int xPrev = (x-1 < 0)? width-1 : x-1;
+                    int xNext = (x+1 >= width)? 0 : x+1;
+
+                    int idx[9] = {
+                        yPrev*width + xPrev, yPrev*width + x, yPrev*width + xNext,
+                        y*width + xPrev,     y*width + x,     y*width + xNext,
+                        yNext*width + xPrev, yNext*width + x, yNext*width + xNext };
+
+                    float gx[3] = {0,0,0}, gy[3] = {0,0,0};
+                    for( unsigned int p=0; p<9; ++p )
+                    {
+                        const unsigned char* texel = &src[ idx[p]*4 ];
+                        for( unsigned int c=0; c<3; ++c )
+                        {
+                            gx[c] += wx[p] * texel[c];
+                            gy[c] += wy[p] * texel[c];
+                        }
+                    }
+
+                    unsigned char* out = &trg[ idx[4]*4 ];
+                    for( unsigned int c=0; c<3; ++c )
+                        out[c] = static_cast<unsigned char>( osg::clampTo( sqrtf( gx[c]*gx[c] + gy[c]*gy[c] ), 0.f, 255.f ) );
+                    out[3] = 255;
+                }
+            }
+        }
+
+        virtual void acceptResource( osgCompute::Resource& resource )
+        {
+            if( resource.isIdentifiedBy("SRC_BUFFER") )
+                _src = dynamic_cast<osgCompute::Memory*>( &resource );
+            if( resource.isIdentifiedBy("TRG_BUFFER") )
+                _trg = dynamic_cast<osgCompute::Memory*>( &resource );
+        }
+
+    private:
+        osg::ref_ptr<osgCompute::Memory>    _src;
+        osg::ref_ptr<osgCompute::Memory>    _trg;
+    };
+
+    //------------------------------------------------------------------------------
+    static osgCuda::Buffer* createBuffer( const std::string& identifier, unsigned int elementSize, unsigned int dimX, unsigned int dimY = 0 )
+    {
+        osgCuda::Buffer* buffer = new osgCuda::Buffer;
+        buffer->setName( identifier );
+        buffer->addIdentifier( identifier );
+        buffer->setElementSize( elementSize );
+        buffer->setDimension( 0, dimX );
+        if( dimY != 0 )
+            buffer->setDimension( 1, dimY );
+        return buffer;
+    }
+
+    /** Launches all programs of a computation once per iteration in
+    the same way as the computation does during the update traversal.
+    */
+    class PipelineCase : public Case
+    {
+    public:
+        enum Type
+        {
+            PARTICLE,
+            TRACE,
+            SOBEL
+        };
+
+        PipelineCase( const std::string& name, Type type, unsigned int numOps )
+            : Case( name, numOps ), _type(type) {}
+
+        virtual bool setUp()
+        {
+            _computation = new osgCuda::Computation;
+
+            switch( _type )
+            {
+            case PARTICLE:
+                {
+                    osg::ref_ptr<osgCuda::Buffer> seeds = createBuffer( "PTCL_SEEDS", sizeof(float), getNumOps() );
+                    float* seedPtr = static_cast<float*>( seeds->map( osgCompute::MAP_HOST_TARGET ) );
+                    for( unsigned int s=0; s<getNumOps(); ++s )
+                        seedPtr[s] = float(rand()) / float(RAND_MAX);
+
+                    _computation->addProgram( *new HostPtclEmitter );
+                    _computation->addProgram( *new HostPtclMover );
+                    _computation->addResource( *seeds );
+                    _computation->addResource( *createBuffer( "PTCL_BUFFER", sizeof(osg::Vec4f), getNumOps() ) );
+                }
+                break;
+            case TRACE:
+                {
+                    osg::ref_ptr<osgCuda::Buffer> ptcls = createBuffer( "PTCL_BUFFER", sizeof(osg::Vec4f), getNumOps() );
+                    osg::Vec4f* ptclPtr = static_cast<osg::Vec4f*>( ptcls->map( osgCompute::MAP_HOST_TARGET ) );
+                    for( unsigned int p=0; p<getNumOps(); ++p )
+                        ptclPtr[p].set( float(rand()) / float(RAND_MAX), 0.f, float(rand()) / float(RAND_MAX), 1.f );
+
+                    _computation->addProgram( *new HostPtclTracer );
+                    _computation->addResource( *ptcls );
+                }
+                break;
+            case SOBEL:
+                {
+                    unsigned int dim = static_cast<unsigned int>( sqrt( double(getNumOps()) ) );
+                    osg::ref_ptr<osgCuda::Buffer> src = createBuffer( "SRC_BUFFER", 4, dim, dim );
+                    unsigned char* srcPtr = static_cast<unsigned char*>( src->map( osgCompute::MAP_HOST_TARGET ) );
+                    for( unsigned int b=0; b<dim*dim*4; ++b )
+                        srcPtr[b] = static_cast<unsigned char>( rand() & 0xFF );
+
+                    _computation->addProgram( *new HostSobelFilter );
+                    _computation->addResource( *src );
+                    _computation->addResource( *createBuffer( "TRG_BUFFER", 4, dim, dim ) );
+                }
+                break;
+            }
+
+            return true;
+        }
+
+        virtual void run()
+        {
+            osgCompute::ProgramList& programs = _computation->getPrograms();
+            for( osgCompute::ProgramListItr itr = programs.begin(); itr != programs.end(); ++itr )
+                if( (*itr)->isEnabled() )
+                    (*itr)->launch();
+        }
+
+        virtual void tearDown()
+        {
+            _computation = NULL;
+        }
+
+    private:
+        Type                                    _type;
+        osg::ref_ptr<osgCompute::Computation>   _computation;
+    };
+
+    //------------------------------------------------------------------------------
+    void addPipelineCases( Suite& suite )
+    {
+        suite.add( new PipelineCase( "pipeline/particle_host/65536", PipelineCase::PARTICLE, 65536 ) );
+        suite.add( new PipelineCase( "pipeline/particle_host/1048576", PipelineCase::PARTICLE, 1048576 ) );
+        suite.add( new PipelineCase( "pipeline/trace_host/65536", PipelineCase::TRACE, 65536 ) );
+        suite.add( new PipelineCase( "pipeline/trace_host/1048576", PipelineCase::TRACE, 1048576 ) );
+        suite.add( new PipelineCase( "pipeline/sobel_host/512x512", PipelineCase::SOBEL, 512*512 ) );
+        suite.add( new PipelineCase( "pipeline/sobel_host/2048x2048", PipelineCase::SOBEL, 2048*2048 ) );
+    }
+}
@@ -0,0 +1,99 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <sstream>
+#include <osg/Image>
+#include <osgDB/Registry>
+#include <osgDB/ReaderWriter>
+#include <osgCompute/Serializer>
+#include <osgCuda/Buffer>
+#include <osgCuda/Computation>
+#include "Bench.h"
+
+namespace Bench
+{
+    /** Writes a computation with numResources buffers into a memory stream
+    and reads it back with the osgDB serializers of the given extension.
+    */
+    class RoundTripCase : public Case
+    {
+    public:
+        RoundTripCase( const std::string& name, const std::string& extension, unsigned int numResources, unsigned int numElements )
+            : Case( name, numResources ), _extension(extension), _numElements(numElements) {}
+
+        virtual bool setUp()
+        {
+            _rw = osgDB::Registry::instance()->getReaderWriterForExtension( _extension );
+            if( !_rw.valid() )
+                return false;
+
+            _options = new osgDB::ReaderWriter::Options( "WriteImageHint=IncludeData" );
+            osgCompute::addSerializerDomains( *_options );
+
+            _computation = new osgCuda::Computation;
+            for( unsigned int r=0; r<getNumOps(); ++r )
+            {
+                std::stringstream identifier;
+                identifier << "RESOURCE_" << r;
+
+                osg::ref_ptr<osg::Image> image = new osg::Image;
+                image->allocateImage( _numElements, 1, 1, GL_RGBA, GL_FLOAT );
+
+                osg::ref_ptr<osgCuda::Buffer> buffer = new osgCuda::Buffer;
+                buffer->setName( identifier.str() );
+                buffer->addIdentifier( identifier.str() );
+                buffer->setElementSize( 4*sizeof(float) );
+                buffer->setDimension( 0, _numElements );
+                buffer->setImage( image.get() );
+                _computation->addResource( *buffer );
+            }
+
+            return true;
+        }
+
+        virtual void run()
+        {
+            std::stringstream stream;
+            osgDB::ReaderWriter::WriteResult wr = _rw->writeNode( *_computation, stream, _options.get() );
+            if( !wr.success() )
+                return;
+
+            osgDB::ReaderWriter::ReadResult rr = _rw->readNode( stream, _options.get() );
+            osg::ref_ptr<osg::Node> node = rr.takeNode();
+        }
+
+        virtual void tearDown()
+        {
+            _computation = NULL;
+            _options = NULL;
+            _rw = NULL;
+        }
+
+    private:
+        std::string                                     _extension;
+        unsigned int                                    _numElements;
+        osg::ref_ptr<osgDB::ReaderWriter>               _rw;
+        osg::ref_ptr<osgDB::ReaderWriter::Options>      _options;
+        osg::ref_ptr<osgCompute::Computation>           _computation;
+    };
+
+    //------------------------------------------------------------------------------
+    void addSerializerCases( Suite& suite )
+    {
+        suite.add( new RoundTripCase( "serializer/osgb_round_trip/100x1024", "osgb", 100, 1024 ) );
+        suite.add( new RoundTripCase( "serializer/osgb_round_trip/4x1048576", "osgb", 4, 1024*1024 ) );
+        suite.add( new RoundTripCase( "serializer/osgt_round_trip/100x1024", "osgt", 100, 1024 ) );
+    }
+}
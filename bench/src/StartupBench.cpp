@@ -0,0 +1,173 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <cstdio>
+#include <sstream>
+#include <osg/Notify>
+#include <osg/Image>
+#include <osgDB/Registry>
+#include <osgDB/ReaderWriter>
+#include <osgCompute/Program>
+#include <osgCompute/Serializer>
+#include <osgCuda/Buffer>
+#include <osgCuda/Computation>
+#include "Bench.h"
+
+namespace Bench
+{
+    /** Resolves numPrograms program libraries with numThreads loader threads.
+    The libraries do not exist, so each uncached lookup scans the complete
+    osgDB library path. This is the dominating cost of opening scenes with
+    many programs. Cold runs clear the program library cache first.
+    */
+    class ProgramLookupCase : public Case
+    {
+    public:
+        ProgramLookupCase( const std::string& name, unsigned int numPrograms, unsigned int numThreads, bool cold )
+            : Case( name, numPrograms ), _numThreads(numThreads), _cold(cold) {}
+
+        virtual bool setUp()
+        {
+            for( unsigned int p=0; p<getNumOps(); ++p )
+            {
+                std::stringstream libraryName;
+                libraryName << "osgcompute_bench_program_" << p;
+                _libraryNames.push_back( libraryName.str() );
+            }
+
+            // Suppress the warnings about missing libraries
+            _notifyLevel = osg::getNotifyLevel();
+            osg::setNotifyLevel( osg::FATAL );
+            return true;
+        }
+
+        virtual void run()
+        {
+            if( _cold )
+                osgCompute::Program::clearProgramCache();
+
+            osgCompute::ProgramList programs;
+            osgCompute::Program::loadPrograms( _libraryNames, programs, _numThreads );
+        }
+
+        virtual void tearDown()
+        {
+            osg::setNotifyLevel( _notifyLevel );
+            osgCompute::Program::clearProgramCache();
+            _libraryNames.clear();
+        }
+
+    private:
+        unsigned int                _numThreads;
+        bool                        _cold;
+        std::vector<std::string>    _libraryNames;
+        osg::NotifySeverity         _notifyLevel;
+    };
+
+    /** Opens a computation with numResources buffers whose payloads are
+    stored in an external data file (see option "MemoryDataFile"). With
+    prefetch enabled the payloads are read concurrently during the load.
+    Otherwise they are read on the first mapping of each buffer, which is
+    forced after the load.
+    */
+    class SceneLoadCase : public Case
+    {
+    public:
+        SceneLoadCase( const std::string& name, unsigned int numResources, unsigned int numElements, bool prefetch )
+            : Case( name, numResources ), _numElements(numElements), _prefetch(prefetch) {}
+
+        virtual bool setUp()
+        {
+            _rw = osgDB::Registry::instance()->getReaderWriterForExtension( "osgb" );
+            if( !_rw.valid() )
+                return false;
+
+            _sceneFile = "osgcompute_bench_startup.osgb";
+            _dataFile = "osgcompute_bench_startup.dat";
+            remove( _dataFile.c_str() );
+
+            osg::ref_ptr<osgCompute::Computation> computation = new osgCuda::Computation;
+            for( unsigned int r=0; r<getNumOps(); ++r )
+            {
+                std::stringstream identifier;
+                identifier << "RESOURCE_" << r;
+
+                osg::ref_ptr<osg::Image> image = new osg::Image;
+                image->allocateImage( _numElements, 1, 1, GL_RGBA, GL_FLOAT );
+
+                osg::ref_ptr<osgCuda::Buffer> buffer = new osgCuda::Buffer;
+                buffer->setName( identifier.str() );
+                buffer->addIdentifier( identifier.str() );
+                buffer->setElementSize( 4*sizeof(float) );
+                buffer->setDimension( 0, _numElements );
+                buffer->setImage( image.get() );
+                computation->addResource( *buffer );
+            }
+
+            osg::ref_ptr<osgDB::ReaderWriter::Options> writeOptions = 
+                new osgDB::ReaderWriter::Options( "MemoryDataFile=" + _dataFile );
+            osgCompute::addSerializerDomains( *writeOptions );
+            osgDB::ReaderWriter::WriteResult wr = _rw->writeNode( *computation, _sceneFile, writeOptions.get() );
+            if( !wr.success() )
+                return false;
+
+            _readOptions = new osgDB::ReaderWriter::Options( _prefetch? "PrefetchMemoryData" : "" );
+            return true;
+        }
+
+        virtual void run()
+        {
+            osgDB::ReaderWriter::ReadResult rr = _rw->readNode( _sceneFile, _readOptions.get() );
+            osg::ref_ptr<osgCompute::Computation> computation = dynamic_cast<osgCompute::Computation*>( rr.getNode() );
+            if( !computation.valid() )
+                return;
+
+            // The scene is ready when all payloads are on the host
+            osgCompute::ResourceHandleList& resources = computation->getResources();
+            for( osgCompute::ResourceHandleListItr itr = resources.begin(); itr != resources.end(); ++itr )
+            {
+                osgCompute::Memory* memory = dynamic_cast<osgCompute::Memory*>( (*itr)._resource.get() );
+                if( memory != NULL && memory->map( osgCompute::MAP_HOST_SOURCE ) != NULL )
+                    memory->unmap();
+            }
+        }
+
+        virtual void tearDown()
+        {
+            remove( _sceneFile.c_str() );
+            remove( _dataFile.c_str() );
+            _readOptions = NULL;
+            _rw = NULL;
+        }
+
+    private:
+        unsigned int                                    _numElements;
+        bool                                            _prefetch;
+        std::string                                     _sceneFile;
+        std::string                                     _dataFile;
+        osg::ref_ptr<osgDB::ReaderWriter>               _rw;
+        osg::ref_ptr<osgDB::ReaderWriter::Options>      _readOptions;
+    };
+
+    //------------------------------------------------------------------------------
+    void addStartupCases( Suite& suite )
+    {
+        suite.add( new ProgramLookupCase( "startup/program_lookup/32/1_thread", 32, 1, true ) );
+        suite.add( new ProgramLookupCase( "startup/program_lookup/32/all_threads", 32, 0, true ) );
+        suite.add( new ProgramLookupCase( "startup/program_lookup/32/cached", 32, 1, false ) );
+        suite.add( new SceneLoadCase( "startup/osgb_load/64x65536/lazy", 64, 65536, false ) );
+        suite.add( new SceneLoadCase( "startup/osgb_load/64x65536/prefetch", 64, 65536, true ) );
+    }
+}
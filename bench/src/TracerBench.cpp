@@ -0,0 +1,90 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <cstdlib>
+#include <osgCompute/Program>
+#include <osgCuda/Buffer>
+#include "Bench.h"
+
+namespace Bench
+{
+    /** Traces numPtcls particles by one step with the host path of the
+    osgcuda_ptcltracer program. The program traces on the host because the
+    particle buffer is mapped on the host before each launch. Results are
+    nanoseconds per particle step, i.e. 1e9/result particle steps per second.
+    */
+    class HostTracerCase : public Case
+    {
+    public:
+        HostTracerCase( const std::string& name, unsigned int numPtcls )
+            : Case( name, numPtcls ) {}
+
+        virtual bool setUp()
+        {
+            if( !osgCompute::Program::existsProgram( "osgcuda_ptcltracer" ) )
+                return false;
+
+            _tracer = osgCompute::Program::loadProgram( "osgcuda_ptcltracer" );
+            if( !_tracer.valid() )
+                return false;
+
+            _ptcls = new osgCuda::Buffer;
+            _ptcls->setName( "PTCL_BUFFER" );
+            _ptcls->addIdentifier( "PTCL_BUFFER" );
+            _ptcls->setElementSize( 4*sizeof(float) );
+            _ptcls->setDimension( 0, getNumOps() );
+
+            float* ptcls = static_cast<float*>( _ptcls->map( osgCompute::MAP_HOST_TARGET ) );
+            if( ptcls == NULL )
+                return false;
+
+            srand( 0 );
+            for( unsigned int p=0; p<getNumOps(); ++p )
+            {
+                ptcls[4*p]   = 0.1f + static_cast<float>( rand() ) / RAND_MAX;
+                ptcls[4*p+1] = static_cast<float>( rand() ) / RAND_MAX;
+                ptcls[4*p+2] = 0.1f + static_cast<float>( rand() ) / RAND_MAX;
+                ptcls[4*p+3] = 1.0f;
+            }
+
+            _tracer->acceptResource( *_ptcls );
+            return true;
+        }
+
+        virtual void run()
+        {
+            _ptcls->map( osgCompute::MAP_HOST_TARGET );
+            _tracer->launch();
+        }
+
+        virtual void tearDown()
+        {
+            _tracer = NULL;
+            _ptcls = NULL;
+        }
+
+    private:
+        osg::ref_ptr<osgCompute::Program>   _tracer;
+        osg::ref_ptr<osgCuda::Buffer>       _ptcls;
+    };
+
+    //------------------------------------------------------------------------------
+    void addTracerCases( Suite& suite )
+    {
+        suite.add( new HostTracerCase( "ptcltracer/host/64K", 1 << 16 ) );
+        suite.add( new HostTracerCase( "ptcltracer/host/1M", 1 << 20 ) );
+        suite.add( new HostTracerCase( "ptcltracer/host/16M", 1 << 24 ) );
+    }
+}
@@ -0,0 +1,127 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <sstream>
+#include <osg/Geode>
+#include <osg/Group>
+#include <osgCompute/Visitor>
+#include <osgCuda/Buffer>
+#include <osgCuda/Computation>
+#include "Bench.h"
+
+namespace Bench
+{
+    /** Builds a synthetic scene of numNodes nodes with a branching factor
+    of 8. Every 64th inner node is a computation owning a single resource,
+    all other inner nodes are groups and leaves are empty geodes.
+    */
+    static osg::Node* createGraph( unsigned int numNodes )
+    {
+        const unsigned int branching = 8;
+
+        std::vector< osg::ref_ptr<osg::Group> > parents;
+        osg::ref_ptr<osg::Group> root = new osgCuda::Computation;
+        parents.push_back( root );
+
+        unsigned int created = 1;
+        unsigned int parentIdx = 0;
+        while( created < numNodes )
+        {
+            osg::Group* parent = parents[parentIdx].get();
+            for( unsigned int b=0; b<branching && created < numNodes; ++b, ++created )
+            {
+                // the lower levels consist of leaves only
+                if( created * branching >= numNodes )
+                {
+                    parent->addChild( new osg::Geode );
+                    continue;
+                }
+
+                osg::ref_ptr<osg::Group> child;
+                if( created % 64 == 0 )
+                {
+                    osg::ref_ptr<osgCompute::Computation> computation = new osgCuda::Computation;
+                    std::stringstream identifier;
+                    identifier << "RESOURCE_" << created;
+                    osg::ref_ptr<osgCuda::Buffer> buffer = new osgCuda::Buffer;
+                    buffer->addIdentifier( identifier.str() );
+                    computation->addResource( *buffer );
+                    child = computation;
+                }
+                else
+                {
+                    child = new osg::Group;
+                }
+
+                parent->addChild( child );
+                parents.push_back( child );
+            }
+            parentIdx++;
+            if( parentIdx >= parents.size() )
+                break;
+        }
+
+        return root.release();
+    }
+
+    /** Runs a resource visitor with the given mode over a synthetic graph.
+    */
+    class ResourceVisitorCase : public Case
+    {
+    public:
+        ResourceVisitorCase( const std::string& name, unsigned int numNodes, unsigned int mode )
+            : Case( name, numNodes ), _mode(mode) {}
+
+        virtual bool setUp()
+        {
+            _graph = createGraph( getNumOps() );
+            _visitor = new osgCompute::ResourceVisitor;
+            _visitor->setMode( _mode );
+            return true;
+        }
+
+        virtual void run()
+        {
+            _graph->accept( *_visitor );
+        }
+
+        virtual void tearDown()
+        {
+            _visitor = NULL;
+            _graph = NULL;
+        }
+
+    private:
+        osg::ref_ptr<osg::Node>                     _graph;
+        osg::ref_ptr<osgCompute::ResourceVisitor>   _visitor;
+        unsigned int                                _mode;
+    };
+
+    //------------------------------------------------------------------------------
+    void addVisitorCases( Suite& suite )
+    {
+        const unsigned int counts[] = { 10000, 100000, 1000000 };
+        for( unsigned int c=0; c<3; ++c )
+        {
+            std::stringstream suffix;
+            suffix << "/" << counts[c];
+
+            suite.add( new ResourceVisitorCase( "visitor/collect" + suffix.str(), counts[c],
+                osgCompute::ResourceVisitor::COLLECT | osgCompute::ResourceVisitor::RESET ) );
+            suite.add( new ResourceVisitorCase( "visitor/collect_distribute" + suffix.str(), counts[c],
+                osgCompute::ResourceVisitor::COLLECT | osgCompute::ResourceVisitor::DISTRIBUTE | osgCompute::ResourceVisitor::RESET ) );
+        }
+    }
+}
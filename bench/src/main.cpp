@@ -0,0 +1,115 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <osg/ArgumentParser>
+#include <osg/ApplicationUsage>
+#include <osg/Notify>
+#include "Bench.h"
+
+//------------------------------------------------------------------------------
+int main( int argc, char** argv )
+{
+    osg::ArgumentParser arguments( &argc, argv );
+    osg::ApplicationUsage* usage = arguments.getApplicationUsage();
+    usage->setApplicationName( arguments.getApplicationName() );
+    usage->setDescription( "Runs the osgCompute benchmark suite on the host." );
+    usage->setCommandLineUsage( arguments.getApplicationName() + " [options]" );
+    usage->addCommandLineOption( "--filter <string>", "Only run cases whose name contains <string>." );
+    usage->addCommandLineOption( "--list", "List all cases and exit." );
+    usage->addCommandLineOption( "--min-time <seconds>", "Minimum measurement time per case (default 0.25)." );
+    usage->addCommandLineOption( "--json <file>", "Write the results as JSON to <file>." );
+    usage->addCommandLineOption( "--baseline <file>", "Compare the results against a JSON file of a previous run." );
+    usage->addCommandLineOption( "--threshold <fraction>", "Slowdown which counts as regression (default 0.1)." );
+
+    if( arguments.read("-h") || arguments.read("--help") )
+    {
+        usage->write( std::cout );
+        return 0;
+    }
+
+    Bench::Suite suite;
+    Bench::addMemoryCases( suite );
+    Bench::addComputationCases( suite );
+    Bench::addVisitorCases( suite );
+    Bench::addObserverCases( suite );
+    Bench::addSerializerCases( suite );
+    Bench::addPipelineCases( suite );
+    Bench::addStartupCases( suite );
+    Bench::addAlgoCases( suite );
+    Bench::addFilterCases( suite );
+    Bench::addTracerCases( suite );
+
+    if( arguments.read("--list") )
+    {
+        for( Bench::CaseList::const_iterator itr = suite.getCases().begin(); itr != suite.getCases().end(); ++itr )
+            std::cout << (*itr)->getName() << std::endl;
+        return 0;
+    }
+
+    std::string filter;
+    while( arguments.read("--filter", filter) ) {}
+
+    double minTime = 0.25;
+    while( arguments.read("--min-time", minTime) ) {}
+    suite.setMinTime( minTime );
+
+    std::string jsonFile;
+    while( arguments.read("--json", jsonFile) ) {}
+
+    std::string baselineFile;
+    while( arguments.read("--baseline", baselineFile) ) {}
+
+    double threshold = 0.1;
+    while( arguments.read("--threshold", threshold) ) {}
+
+    arguments.reportRemainingOptionsAsUnrecognized();
+    if( arguments.errors() )
+    {
+        arguments.writeErrorMessages( std::cout );
+        return 1;
+    }
+
+    Bench::ResultList results = suite.run( filter );
+
+    if( !jsonFile.empty() )
+    {
+        std::ofstream file( jsonFile.c_str() );
+        if( !file.is_open() )
+        {
+            osg::notify(osg::FATAL) << "cannot write results to \"" << jsonFile << "\"." << std::endl;
+            return 1;
+        }
+        Bench::writeJSON( file, results );
+    }
+
+    if( !baselineFile.empty() )
+    {
+        Bench::BaselineMap baseline;
+        if( !Bench::readBaseline( baselineFile, baseline ) )
+            return 1;
+
+        std::cout << std::endl << "Comparison against " << baselineFile << ":" << std::endl;
+        unsigned int regressions = Bench::compare( std::cout, results, baseline, threshold );
+        if( regressions != 0 )
+        {
+            std::cout << regressions << " case(s) regressed by more than " << threshold * 100.0 << "%." << std::endl;
+            return 2;
+        }
+    }
+
+    return 0;
+}
@@ -48,10 +48,12 @@ inline unsigned int swapBytes( unsigned int value )
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //-------------------------------------------------------------------------
 __global__ 
-void kernelSwapEndianness( unsigned int* bytes ) 
+void kernelSwapEndianness( unsigned int numElements, unsigned int* bytes ) 
 {
     // compute thread dimension
     unsigned int trgIdx = thIdx();
+    if( trgIdx >= numElements )
+        return;
 
     // swap endianess within buffer
     bytes[trgIdx] = swapBytes( bytes[trgIdx] );
@@ -64,11 +66,12 @@ void kernelSwapEndianness( unsigned int* bytes )
 extern "C"
 void swapEndianness( unsigned int numElements, void* bytes )
 {
-    dim3 blocks( numElements, 1, 1 );
-    dim3 threads( 1, 1, 1 );
+    // a block of a single thread leaves most of a multiprocessor idle
+    dim3 threads( 256, 1, 1 );
+    dim3 blocks( (numElements + threads.x - 1) / threads.x, 1, 1 );
 
     // call kernel
-    kernelSwapEndianness<<< blocks, threads >>>( reinterpret_cast<unsigned int*>(bytes) );
+    kernelSwapEndianness<<< blocks, threads >>>( numElements, reinterpret_cast<unsigned int*>(bytes) );
 }
 
 
@@ -13,6 +13,9 @@
 * The full license is in LICENSE file included with this distribution.
 */
 
+#include <cuda_runtime.h>
+#include <osgCompute/Philox>
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // DEVICE FUNCTIONS //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -33,20 +36,14 @@ float4 operator+(float4 a, float4 b)
 
 //------------------------------------------------------------------------------
 inline __device__
-float4 seed( float* seeds, unsigned int seedCount, unsigned int seedIdx, unsigned int ptclIdx, float3 bbmin, float3 bbmax )
+float4 seed( const osgCompute::RandomState& state, unsigned int ptclIdx, float3 bbmin, float3 bbmax )
 {
-    // random seed idx
-    unsigned int idx1 = (seedIdx + ptclIdx) % seedCount;
-    unsigned int idx2 = (idx1 + ptclIdx) % seedCount;
-    unsigned int idx3 = (idx2 + ptclIdx) % seedCount;
-
-    // seeds are within the range [0,1]
-    float intFac1 = seeds[idx1];
-    float intFac2 = seeds[idx2];
-    float intFac3 = seeds[idx3];
+    // random values are within the range [0,1)
+    float intFac[4];
+    osgCompute::randomUniform4( state, ptclIdx, intFac );
 
-    return make_float4(lerp(bbmin.x,bbmax.x,intFac1), lerp(bbmin.y,bbmax.y,intFac3),
-        lerp(bbmin.z,bbmax.z,intFac2), 1);
+    return make_float4(lerp(bbmin.x,bbmax.x,intFac[0]), lerp(bbmin.y,bbmax.y,intFac[2]),
+        lerp(bbmin.z,bbmax.z,intFac[1]), 1);
 }
 
 //------------------------------------------------------------------------------
@@ -68,37 +65,76 @@ unsigned int thIdx()
 __global__
 void emitKernel( unsigned int numPtcls,
                    float4* ptcls, 
-                   float* seeds, 
-                   unsigned int seedIdx, 
+                   float4* live,
+                   unsigned int* counter,
+                   osgCompute::RandomState state, 
+                   unsigned int numEmit,
                    float3 bbmin, 
                    float3 bbmax )
 {
-    // Receive particle pos
+    // counter[0] is the number of living particles and
+    // counter[1] the append position within the live buffer
     unsigned int ptclIdx = thIdx();
-    if( ptclIdx < numPtcls )
+    unsigned int numLive = counter[0];
+    if( ptclIdx < numLive )
     {
         float4 curPtcl = ptcls[ptclIdx];
 
-        // Reseed Particles if they
-        // have moved out of the bounding box
-        if( curPtcl.x < bbmin.x ||
-            curPtcl.y < bbmin.y ||
-            curPtcl.z < bbmin.z ||
-            curPtcl.x > bbmax.x ||
-            curPtcl.y > bbmax.y ||
-            curPtcl.z > bbmax.z )
-            ptcls[ptclIdx] = seed( seeds, numPtcls, seedIdx, ptclIdx, bbmin, bbmax );
+        // Keep particles which have not 
+        // moved out of the bounding box
+        if( curPtcl.x >= bbmin.x &&
+            curPtcl.y >= bbmin.y &&
+            curPtcl.z >= bbmin.z &&
+            curPtcl.x <= bbmax.x &&
+            curPtcl.y <= bbmax.y &&
+            curPtcl.z <= bbmax.z )
+            live[ atomicAdd( &counter[1], 1 ) ] = curPtcl;
+    }
+    else if( ptclIdx < numLive + numEmit && ptclIdx < numPtcls )
+    {
+        // Append new particles
+        live[ atomicAdd( &counter[1], 1 ) ] = seed( state, ptclIdx, bbmin, bbmax );
+    }
+}
+
+//------------------------------------------------------------------------------
+__global__
+void scatterKernel( unsigned int numPtcls,
+                    float4* ptcls,
+                    float4* live,
+                    unsigned int* counter,
+                    float3 bbmin )
+{
+    unsigned int ptclIdx = thIdx();
+    if( ptclIdx < counter[1] )
+    {
+        ptcls[ptclIdx] = live[ptclIdx];
+    }
+    else if( ptclIdx < counter[0] && ptclIdx < numPtcls )
+    {
+        // Hide slots of particles which have died during this frame. The 
+        // draw count is updated with a delay and might still cover them.
+        ptcls[ptclIdx] = make_float4( bbmin.x, bbmin.y, bbmin.z, 0 );
     }
 }
 
+//------------------------------------------------------------------------------
+__global__
+void swapCounterKernel( unsigned int* counter )
+{
+    counter[0] = counter[1];
+    counter[1] = 0;
+}
+
 //------------------------------------------------------------------------------
 __global__
 void moveKernel( unsigned int numPtcls,
                  float4* ptcls, 
+                 unsigned int* counter,
                  float etime )
 {
     unsigned int ptclIdx = thIdx();
-    if( ptclIdx < numPtcls )
+    if( ptclIdx < numPtcls && ptclIdx < counter[0] )
     {
         // perform a euler step
         ptcls[ptclIdx] = ptcls[ptclIdx] + make_float4(0,0,etime,0);
@@ -113,27 +149,43 @@ void moveKernel( unsigned int numPtcls,
 extern "C" __host__
 void emit(unsigned int numPtcls, 
             void* ptcls, 
-            void* seeds,  
-            unsigned int seedIdx, 
+            void* live,
+            void* counter,
+            osgCompute::RandomState state,  
+            unsigned int numEmit,
             float3 bbmin, 
             float3 bbmax )
 {
     dim3 blocks( (numPtcls / 128)+1, 1, 1 );
     dim3 threads( 128, 1, 1 );
 
+    // Compact living particles and append 
+    // new ones into the live buffer
     emitKernel<<< blocks, threads >>>(
         numPtcls,
         (float4*)ptcls,
-        (float*)seeds,
-        seedIdx,
+        (float4*)live,
+        (unsigned int*)counter,
+        state,
+        numEmit,
         bbmin,
         bbmax );
+
+    scatterKernel<<< blocks, threads >>>(
+        numPtcls,
+        (float4*)ptcls,
+        (float4*)live,
+        (unsigned int*)counter,
+        bbmin );
+
+    swapCounterKernel<<< 1, 1 >>>( (unsigned int*)counter );
 }
 
 //------------------------------------------------------------------------------
 extern "C" __host__
 void move( unsigned int numPtcls, 
            void* ptcls, 
+           void* counter,
            float etime )
 {
     dim3 blocks( (numPtcls / 128)+1, 1, 1 );
@@ -142,5 +194,91 @@ void move( unsigned int numPtcls,
     moveKernel<<< blocks, threads >>>( 
         numPtcls,
         (float4*)ptcls,
+        (unsigned int*)counter,
         etime );
-}
\ No newline at end of file
+}
+
+//------------------------------------------------------------------------------
+extern "C" __host__
+void copyPtcls( unsigned int numPtcls, 
+                void* dst, 
+                void* src )
+{
+    cudaMemcpyAsync( dst, src, numPtcls * sizeof(float4), cudaMemcpyDeviceToDevice );
+}
+
+//------------------------------------------------------------------------------
+struct CountReadback
+{
+    unsigned int*   _hostCount;
+    cudaEvent_t     _copied;
+    bool            _pending;
+};
+
+//------------------------------------------------------------------------------
+extern "C" __host__
+void* createCountReadback()
+{
+    CountReadback* readback = new CountReadback;
+    readback->_pending = false;
+
+    // Page-locked memory is required for asynchronous copies
+    if( cudaSuccess != cudaMallocHost( (void**)&readback->_hostCount, sizeof(unsigned int) ) )
+    {
+        delete readback;
+        return NULL;
+    }
+
+    if( cudaSuccess != cudaEventCreateWithFlags( &readback->_copied, cudaEventDisableTiming ) )
+    {
+        cudaFreeHost( readback->_hostCount );
+        delete readback;
+        return NULL;
+    }
+
+    return readback;
+}
+
+//------------------------------------------------------------------------------
+extern "C" __host__
+void destroyCountReadback( void* handle )
+{
+    CountReadback* readback = (CountReadback*)handle;
+    if( readback == NULL )
+        return;
+
+    cudaEventSynchronize( readback->_copied );
+    cudaEventDestroy( readback->_copied );
+    cudaFreeHost( readback->_hostCount );
+    delete readback;
+}
+
+//------------------------------------------------------------------------------
+extern "C" __host__
+void requestCount( void* handle, void* counter )
+{
+    CountReadback* readback = (CountReadback*)handle;
+    if( readback == NULL || readback->_pending )
+        return;
+
+    cudaMemcpyAsync( readback->_hostCount, counter, sizeof(unsigned int), cudaMemcpyDeviceToHost );
+    cudaEventRecord( readback->_copied );
+    readback->_pending = true;
+}
+
+//------------------------------------------------------------------------------
+extern "C" __host__
+bool queryCount( void* handle, unsigned int* count )
+{
+    CountReadback* readback = (CountReadback*)handle;
+    if( readback == NULL || !readback->_pending )
+        return false;
+
+    // Do not wait for the copy
+    if( cudaSuccess != cudaEventQuery( readback->_copied ) )
+        return false;
+
+    *count = *readback->_hostCount;
+    readback->_pending = false;
+    return true;
+}
\ No newline at end of file
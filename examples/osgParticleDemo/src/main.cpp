@@ -12,6 +12,8 @@
 *
 * The full license is in LICENSE file included with this distribution.
 */
+#include <cmath>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <osg/ArgumentParser>
@@ -25,28 +27,58 @@
 #include <osgViewer/Viewer>
 #include <osgViewer/ViewerEventHandlers>
 #include <osgCompute/Program>
+#include <osgCompute/Random>
 #include <osgCuda/Buffer>
 #include <osgCuda/Geometry>
 #include <osgCuda/Computation>
+#include <osgCuda/ComputeThread>
+#include <osgCudaUtil/PingPongBuffer>
+#include <osgCudaUtil/PingPongSwitch>
 #include <osgCudaStats/Stats>
 #include <osgCudaInit/Init>
 
 //////////////////
 // COMPUTATIONS //
 //////////////////
+// The programs run on a compute thread. They take the simulation time
+// from an update callback instead of reading the frame stamp which the
+// viewer advances while they are running.
+class PtclProgram : public osgCompute::Program
+{
+public:
+    PtclProgram() : _time(0.0) {}
+
+    void setTime( double time ) { _time = time; }
+
+protected:
+    double                              _time;
+};
+
+class PtclTime : public osgCompute::ProgramCallback
+{
+public:
+    virtual void operator()( osgCompute::Program& program, osg::NodeVisitor& nv )
+    {
+        PtclProgram* ptclProgram = dynamic_cast<PtclProgram*>( &program );
+        if( ptclProgram != NULL && nv.getFrameStamp() != NULL )
+            ptclProgram->setTime( nv.getFrameStamp()->getSimulationTime() );
+    }
+};
+
 extern "C" void move( 
                      unsigned int numPtcls, 
                      void* ptcls, 
+                     void* counter,
                      float etime );
 
-class MovePtcls : public osgCompute::Program 
+class MovePtcls : public PtclProgram 
 {
 public:
-    MovePtcls( osg::FrameStamp& fs ) : _fs(&fs) {}
+    MovePtcls() : _lastTime(0.0), _firstFrame(true) {}
 
     virtual void launch()
     {
-        if( !_ptcls.valid() )
+        if( !_ptcls.valid() || !_counter.valid() )
             return;
 
         if( !_timer.valid() )
@@ -55,20 +87,21 @@ public:
             _timer->setName( "MovePtcls");
         }
 
-        float time = (float)_fs->getSimulationTime();
         if( _firstFrame )
         {
-            _lastTime = time;
+            _lastTime = _time;
             _firstFrame = false;
         }
-        float elapsedtime = static_cast<float>(time - _lastTime);
-        _lastTime = time;
+        float elapsedtime = static_cast<float>(_time - _lastTime);
+        _lastTime = _time;
 
         _timer->start();
 
+        // Only living particles are moved
         move( 
             _ptcls->getNumElements(), 
             _ptcls->map( osgCompute::MAP_DEVICE_TARGET ), 
+            _counter->map( osgCompute::MAP_DEVICE_SOURCE ),
             elapsedtime  );
 
         _timer->stop();
@@ -78,45 +111,74 @@ public:
     {
         if( resource.isIdentifiedBy("PARTICLE BUFFER" ) )
             _ptcls = dynamic_cast<osgCompute::Memory*>( &resource );
+        if( resource.isIdentifiedBy("PARTICLE COUNT" ) )
+            _counter = dynamic_cast<osgCompute::Memory*>( &resource );
     }
 
 private:
     osg::ref_ptr<osgCuda::Timer>        _timer;
     double                              _lastTime;
     bool						        _firstFrame;
-    osg::ref_ptr<osg::FrameStamp>       _fs;
     osg::ref_ptr<osgCompute::Memory>    _ptcls;
+    osg::ref_ptr<osgCompute::Memory>    _counter;
 };
 
 
 extern "C" void emit(
                      unsigned int numPtcls, 
                      void* ptcls, 
-                     void* seeds,  
-                     unsigned int seedIdx, 
+                     void* live,
+                     void* counter,
+                     osgCompute::RandomState state,  
+                     unsigned int numEmit,
                      osg::Vec3f bbmin, 
                      osg::Vec3f bbmax );
 
-class EmitPtcls : public osgCompute::Program 
+extern "C" void* createCountReadback();
+extern "C" void destroyCountReadback( void* readback );
+extern "C" void requestCount( void* readback, void* counter );
+extern "C" bool queryCount( void* readback, unsigned int* count );
+
+// Removes particles which have left the bounding box and appends new 
+// ones. The particle buffer stays compacted, i.e. the living particles 
+// are stored at its front. Their number is counted on the device.
+class EmitPtcls : public PtclProgram 
 {
 public:
-    EmitPtcls( osg::Vec3f min, osg::Vec3f max ) : _min(min), _max(max) {}
+    EmitPtcls( osg::Vec3f min, osg::Vec3f max ) 
+        : _min(min), _max(max), _readback(NULL), _numLive(0) {}
+
+    // Called by the hand over callback while no launch is running
+    unsigned int getNumLive() const { return _numLive; }
 
     virtual void launch()
     {
-        if( !_ptcls.valid() )
+        if( !_ptcls.valid() || !_counter.valid() )
             return;
 
-        if( !_seeds.valid() )
+        if( !_live.valid() )
+        {
+            _live = new osgCuda::Buffer;
+            _live->setElementSize( sizeof(osg::Vec4f) );
+            _live->setName( "LivePtcls" );
+            _live->setDimension(0,_ptcls->getNumElements());
+        }
+
+        if( _readback == NULL )
+        {
+            _readback = createCountReadback();
+
+            // Draw all particles if the count cannot be read back. 
+            // Dead particles are hidden by the vertex shader anyway.
+            if( _readback == NULL )
+                _numLive = _ptcls->getNumElements();
+        }
+
+        if( !_random.valid() )
         {
-            _seeds = new osgCuda::Buffer;
-            _seeds->setElementSize( sizeof(float) );
-            _seeds->setName( "Seeds" );
-            _seeds->setDimension(0,_ptcls->getNumElements());
-
-            float* seedsData = (float*)_seeds->map(osgCompute::MAP_HOST_TARGET);
-            for( unsigned int s=0; s<_ptcls->getNumElements(); ++s )
-                seedsData[s] = ( float(rand()) / RAND_MAX );
+            _random = new osgCompute::Random;
+            _random->setName( "EmitRandom" );
+            _random->setSeed( (unsigned int)(rand()) );
         }
 
         if( !_timer.valid() )
@@ -127,14 +189,29 @@ public:
 
         _timer->start();
 
+        // Draw the living particles only. The count of a previous frame
+        // is used as waiting for the current one would stall the device.
+        unsigned int numLive = 0;
+        if( queryCount( _readback, &numLive ) )
+            _numLive = numLive;
+
+        // Vary the emission rate over time
+        float rate = 0.5f + 0.5f * sinf( (float)_time );
+        unsigned int numEmit = (unsigned int)( rate * (float)(_ptcls->getNumElements() / 128) );
+
+        void* counter = _counter->map( osgCompute::MAP_DEVICE );
         emit(
             _ptcls->getNumElements(),
             _ptcls->map( osgCompute::MAP_DEVICE_TARGET ),
-            _seeds->map( osgCompute::MAP_DEVICE_SOURCE ),
-            (unsigned int)(rand()),
+            _live->map( osgCompute::MAP_DEVICE_TARGET ),
+            counter,
+            _random->nextState(),
+            numEmit,
             _min,
             _max  );
 
+        requestCount( _readback, counter );
+
         _timer->stop();
     }
 
@@ -142,60 +219,119 @@ public:
     {
         if( resource.isIdentifiedBy("PARTICLE BUFFER" ) )
             _ptcls = dynamic_cast<osgCompute::Memory*>( &resource );
+        if( resource.isIdentifiedBy("PARTICLE COUNT" ) )
+            _counter = dynamic_cast<osgCompute::Memory*>( &resource );
+    }
+
+protected:
+    virtual ~EmitPtcls() 
+    { 
+        destroyCountReadback( _readback ); 
     }
 
 private:
     osg::Vec3f                                        _max;
     osg::Vec3f                                        _min;
+    void*                                             _readback;
+    unsigned int                                      _numLive;
 
     osg::ref_ptr<osgCuda::Timer>                      _timer;
     osg::ref_ptr<osgCompute::Memory>                  _ptcls;
-    osg::ref_ptr<osgCompute::Memory>                  _seeds;
+    osg::ref_ptr<osgCompute::Memory>                  _counter;
+    osg::ref_ptr<osgCompute::Random>                  _random;
+    osg::ref_ptr<osgCompute::Memory>                  _live;
 };
 
 
+extern "C" void copyPtcls( 
+                          unsigned int numPtcls, 
+                          void* dst, 
+                          void* src );
 
-////////////////////////
-// PARTICLE OPERATION //
-////////////////////////
-class PtclOperation : public osg::Operation
+// Copies the particles into the back buffer of the display geometries. 
+// The buffer is shared with OpenGL, so it is mapped by the hand over 
+// callback on the main thread and not by the compute thread.
+class DisplayPtcls : public osgCompute::Program 
 {
 public:
-    PtclOperation( osg::FrameStamp& fs, osg::ref_ptr<osgCompute::Memory> ptcls, osg::Vec3f bbmin, osg::Vec3f bbmax ) 
-    { 
-        setKeep( true ); 
+    DisplayPtcls( osgCompute::MapHandOverCallback& handOver ) : _handOver(&handOver) {}
 
-        _move = new MovePtcls( fs );
-        _move->acceptResource( *ptcls );
+    virtual void launch()
+    {
+        if( !_ptcls.valid() || !_display.valid() )
+            return;
+
+        void* display = _handOver->getMappedPtr( *_display );
+        if( display == NULL )
+            return;
 
-        _emit = new EmitPtcls(bbmin,bbmax); 
-        _emit->acceptResource( *ptcls );
+        copyPtcls(
+            _ptcls->getNumElements(),
+            display,
+            _ptcls->map( osgCompute::MAP_DEVICE_SOURCE ) );
     }
 
-    virtual void operator() (osg::Object*)
+    virtual void acceptResource( osgCompute::Resource& resource )
     {
-        if( osgCompute::GLMemory::getContext() == NULL || osgCompute::GLMemory::getContext()->getState() == NULL )
-            return;
-
-        _emit->launch();
-        _move->launch();
+        if( resource.isIdentifiedBy("PARTICLE BUFFER" ) )
+            _ptcls = dynamic_cast<osgCompute::Memory*>( &resource );
+        if( resource.isIdentifiedBy("PARTICLE DISPLAY" ) )
+            _display = dynamic_cast<osgCompute::Memory*>( &resource );
     }
 
+private:
+    osg::ref_ptr<osgCompute::MapHandOverCallback>     _handOver;
+    osg::ref_ptr<osgCompute::Memory>                  _ptcls;
+    osg::ref_ptr<osgCompute::Memory>                  _display;
+};
+
+
+
+///////////////
+// HAND OVER //
+///////////////
+// Called at the fence of the last launch. The back buffer which the 
+// launch has written becomes the rendered front buffer and the other 
+// buffer is mapped for the next launch.
+class PtclHandOver : public osgCompute::MapHandOverCallback
+{
 public:
-    osg::ref_ptr<osgCompute::Program> _emit;
-    osg::ref_ptr<osgCompute::Program> _move;
+    PtclHandOver( osgCuda::PingPongBuffer& display, osg::DrawArrays& drawPtcls ) 
+        : _display(&display), _drawPtcls(&drawPtcls) 
+    {
+        addMemory( display, osgCompute::MAP_DEVICE_TARGET, 1 );
+    }
+
+    void setEmit( EmitPtcls* emit ) { _emit = emit; }
+
+    virtual void handOver( osgCompute::Computation& computation )
+    {
+        _display->swap();
+        if( _emit.valid() )
+            _drawPtcls->setCount( _emit->getNumLive() );
+    }
+
+private:
+    osg::ref_ptr<osgCuda::PingPongBuffer>             _display;
+    osg::ref_ptr<osg::DrawArrays>                     _drawPtcls;
+    osg::observer_ptr<EmitPtcls>                      _emit;
 };
 
 //------------------------------------------------------------------------------
-osg::ref_ptr<osg::Node> setupScene( osg::ref_ptr<osg::Geometry> geom, osg::Vec3f bbmin, osg::Vec3f bbmax )
+osg::ref_ptr<osg::Node> setupScene( osg::ref_ptr<osgCuda::PingPongBuffer> display, osg::Vec3f bbmin, osg::Vec3f bbmax )
 {
     osg::ref_ptr<osg::Group> scene = new osg::Group;
 
     //////////////////////////////
     // CREATE PARTICLE GEOMETRY //
     //////////////////////////////
-    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
-    geode->addDrawable( geom.get() );
+    // Renders the front buffer of the display geometries
+    osg::ref_ptr<osg::Switch> ptclSwitch = osgCuda::PingPongSwitch::createPingPongGeodeSwitch( display.get() );
+    if( !ptclSwitch.valid() )
+        return scene;
+
+    osg::ref_ptr<osg::Group> ptclGroup = new osg::Group;
+    ptclGroup->addChild( ptclSwitch.get() );
 
     osg::ref_ptr<osg::Program> computation = new osg::Program;
 
@@ -211,7 +347,8 @@ osg::ref_ptr<osg::Node> setupScene( osg::ref_ptr<osg::Geometry> geom, osg::Vec3f
         "   float distAlpha = (dist+1.0)/2.0;                                                   \n"
         "   gl_PointSize = pixelsize.y - distAlpha * (pixelsize.y - pixelsize.x);               \n"
         "                                                                                       \n"
-        "   gl_Position = projPos;                                                              \n"
+        "   // dead particles (w == 0) are moved out of the clip volume                         \n"
+        "   gl_Position = (gl_Vertex.w == 0.0)? vec4(2.0,2.0,2.0,1.0) : projPos;                \n"
         "}                                                                                      \n";
     computation->addShader( new osg::Shader(osg::Shader::VERTEX, vtxShader ) );
 
@@ -243,14 +380,13 @@ osg::ref_ptr<osg::Node> setupScene( osg::ref_ptr<osg::Geometry> geom, osg::Vec3f
         "}                                                                                      \n";
 
     computation->addShader( new osg::Shader( osg::Shader::FRAGMENT, frgShader ) );
-    geode->getOrCreateStateSet()->setAttribute(computation);
-    geode->getOrCreateStateSet()->setMode(GL_VERTEX_PROGRAM_POINT_SIZE, osg::StateAttribute::ON);
-    geode->getOrCreateStateSet()->setTextureAttributeAndModes(0, new osg::PointSprite, osg::StateAttribute::ON);
-    geode->getOrCreateStateSet()->setAttribute( new osg::AlphaFunc( osg::AlphaFunc::GREATER, 0.1f) );
-    geode->getOrCreateStateSet()->setMode( GL_ALPHA_TEST, GL_TRUE );
-    geode->getOrCreateStateSet()->addUniform( new osg::Uniform( "pixelsize", osg::Vec2(1.0f,50.0f) ) ); 
-    geode->setCullingActive( false );
-    scene->addChild( geode );
+    ptclGroup->getOrCreateStateSet()->setAttribute(computation);
+    ptclGroup->getOrCreateStateSet()->setMode(GL_VERTEX_PROGRAM_POINT_SIZE, osg::StateAttribute::ON);
+    ptclGroup->getOrCreateStateSet()->setTextureAttributeAndModes(0, new osg::PointSprite, osg::StateAttribute::ON);
+    ptclGroup->getOrCreateStateSet()->setAttribute( new osg::AlphaFunc( osg::AlphaFunc::GREATER, 0.1f) );
+    ptclGroup->getOrCreateStateSet()->setMode( GL_ALPHA_TEST, GL_TRUE );
+    ptclGroup->getOrCreateStateSet()->addUniform( new osg::Uniform( "pixelsize", osg::Vec2(1.0f,50.0f) ) ); 
+    scene->addChild( ptclGroup );
 
     /////////////////////////
     // CREATE BOUNDING BOX //
@@ -287,14 +423,48 @@ int main(int argc, char *argv[])
     // PARTICLE BUFFER //
     /////////////////////
     unsigned int numPtcls = 64000;
-    osg::ref_ptr<osgCuda::Geometry> geom = new osgCuda::Geometry;
-    geom->setName("Particles");
-    geom->addIdentifier( "PARTICLE BUFFER" );
-    osg::Vec4Array* coords = new osg::Vec4Array(numPtcls);
-    for( unsigned int v=0; v<coords->size(); ++v )
-        (*coords)[v].set(-1,-1,-1,0);
-    geom->setVertexArray(coords);
-    geom->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::POINTS,0,coords->size()));
+    osg::ref_ptr<osgCuda::Buffer> ptcls = new osgCuda::Buffer;
+    ptcls->setName("Particles");
+    ptcls->addIdentifier( "PARTICLE BUFFER" );
+    ptcls->setElementSize( sizeof(osg::Vec4f) );
+    ptcls->setDimension( 0, numPtcls );
+    osg::Vec4f* ptclData = static_cast<osg::Vec4f*>( ptcls->map( osgCompute::MAP_HOST_TARGET ) );
+    for( unsigned int v=0; v<numPtcls; ++v )
+        ptclData[v].set(-1,-1,-1,0);
+
+    // No particle is alive at the beginning
+    osg::ref_ptr<osg::DrawArrays> drawPtcls = new osg::DrawArrays(osg::PrimitiveSet::POINTS,0,0);
+    // The count of living particles changes during the update traversal
+    drawPtcls->setDataVariance( osg::Object::DYNAMIC );
+
+    // The particles are rendered from one geometry while the
+    // compute thread writes them into the other one
+    osg::ref_ptr<osgCuda::PingPongBuffer> display = new osgCuda::PingPongBuffer;
+    display->setName("Particle Display");
+    display->addIdentifier( "PARTICLE DISPLAY" );
+    for( unsigned int g=0; g<2; ++g )
+    {
+        osg::ref_ptr<osgCuda::Geometry> geom = new osgCuda::Geometry;
+        geom->setName("Particles");
+        // Particles are moved by the programs. So compute
+        // the bound from the mapped vertices for culling.
+        geom->setUseComputedBound( true );
+        osg::Vec4Array* coords = new osg::Vec4Array(numPtcls);
+        for( unsigned int v=0; v<coords->size(); ++v )
+            (*coords)[v].set(-1,-1,-1,0);
+        geom->setVertexArray(coords);
+        geom->setDataVariance( osg::Object::DYNAMIC );
+        geom->addPrimitiveSet(drawPtcls.get());
+        display->appendBuffer( *geom->getMemory() );
+    }
+
+    // Number of living particles
+    osg::ref_ptr<osgCuda::Buffer> counter = new osgCuda::Buffer;
+    counter->setName("Particle Count");
+    counter->addIdentifier( "PARTICLE COUNT" );
+    counter->setElementSize( sizeof(unsigned int) );
+    counter->setDimension( 0, 2 );
+    memset( counter->map( osgCompute::MAP_HOST_TARGET ), 0x0, 2*sizeof(unsigned int) );
 
     /////////////////
     // SETUP SCENE //
@@ -302,15 +472,38 @@ int main(int argc, char *argv[])
     osg::Vec3f bbmin = osg::Vec3f(0,0,0);
     osg::Vec3f bbmax = osg::Vec3f(4,4,4);
 
-    // In this example we use an osg::Operation to update the
-    // particle geometry during the Update Traversal.
-    viewer.addUpdateOperation( 
-        new PtclOperation(*viewer.getFrameStamp(),geom->getMemory(),bbmin,bbmax) );
-    viewer.setSceneData( 
-        setupScene(geom,bbmin,bbmax) );
+    // In this example the particles are updated on a compute thread. 
+    // The launch of a frame runs while the frame is culled and drawn.
+    osg::ref_ptr<PtclHandOver> handOver = new PtclHandOver( *display, *drawPtcls );
+    osg::ref_ptr<osgCuda::ComputeThread> computeThread = new osgCuda::ComputeThread;
+
+    osg::ref_ptr<EmitPtcls> emitPtcls = new EmitPtcls( bbmin, bbmax );
+    emitPtcls->setUpdateCallback( new PtclTime );
+    handOver->setEmit( emitPtcls.get() );
+    osg::ref_ptr<MovePtcls> movePtcls = new MovePtcls;
+    movePtcls->setUpdateCallback( new PtclTime );
+    osg::ref_ptr<DisplayPtcls> displayPtcls = new DisplayPtcls( *handOver );
+
+    osg::ref_ptr<osgCuda::Computation> computation = new osgCuda::Computation;
+    computation->setName( "Particle Simulation" );
+    computation->setComputeThread( computeThread.get() );
+    computation->setHandOverCallback( handOver.get() );
+    computation->addProgram( *emitPtcls );
+    computation->addProgram( *movePtcls );
+    computation->addProgram( *displayPtcls );
+    computation->addResource( *ptcls );
+    computation->addResource( *counter );
+    computation->addResource( *display );
+    computation->addChild( setupScene(display,bbmin,bbmax) );
+    viewer.setSceneData( computation.get() );
 
     ///////////////
     // RUN SCENE //
     ///////////////
-    return viewer.run();
+    int result = viewer.run();
+
+    // Release the mapping of the display geometries
+    computeThread->stop();
+    handOver->unmapAll();
+    return result;
 }
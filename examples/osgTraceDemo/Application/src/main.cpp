@@ -33,6 +33,7 @@
 #include <osgViewer/Viewer>
 #include <osgViewer/ViewerEventHandlers>
 #include <osgCuda/Computation>
+#include <osgCuda/FixedStepComputation>
 #include <osgCuda/Buffer>
 #include <osgCuda/Geometry>
 #include <osgCudaStats/Stats>
@@ -53,6 +54,9 @@ osg::ref_ptr<osg::Node> setupScene( unsigned int numParticles, osg::Vec3f bbmin,
     // it as the particle buffer.
     ptclGeom->setName("Particles");
     ptclGeom->addIdentifier("PTCL_BUFFER");
+    // Particles are moved by the programs. So compute
+    // the bound from the mapped vertices for culling.
+    ptclGeom->setUseComputedBound( true );
 
     osg::Vec4Array* coords = new osg::Vec4Array(numParticles);
     for( unsigned int v=0; v<coords->size(); ++v )
@@ -71,7 +75,6 @@ osg::ref_ptr<osg::Node> setupScene( unsigned int numParticles, osg::Vec3f bbmin,
     geode->getOrCreateStateSet()->setAttribute( new osg::AlphaFunc( osg::AlphaFunc::GREATER, 0.1f) );
     geode->getOrCreateStateSet()->setMode( GL_ALPHA_TEST, GL_TRUE );
     geode->getOrCreateStateSet()->addUniform( new osg::Uniform( "pixelsize", osg::Vec2(1.0f,50.0f) ) );
-    geode->setCullingActive( false );
 
     ////////////
     // SHADER //
@@ -148,7 +151,10 @@ osg::ref_ptr<osgCompute::Computation> setupComputation()
     osgCompute::Program* ptclEmitter = osgCompute::Program::loadProgram("osgcuda_ptclemitter");
     if( ptclEmitter )  computationEmitter->addProgram( *ptclEmitter );
 
-    osg::ref_ptr<osgCompute::Computation> computationTracer = new osgCuda::Computation;
+    // Trace the particles in fixed steps independent of the frame rate
+    // One step per frame at 60 Hz keeps the speed of the former per-frame launch
+    osg::ref_ptr<osgCuda::FixedStepComputation> computationTracer = new osgCuda::FixedStepComputation;
+    computationTracer->setStepSize( 1.0 / 60.0 );
     computationTracer->setName( "trace particles computation" );
     computationTracer->setComputeOrder( order );
     osgCompute::Program* ptclTracer = osgCompute::Program::loadProgram("osgcuda_ptcltracer");
@@ -21,6 +21,7 @@
 #include <osg/ref_ptr>
 #include <osgCompute/Program>
 #include <osgCompute/Memory>
+#include <osgCompute/Random>
 #include <osgCuda/Buffer>
 #include <osgCuda/Geometry>
 #include <osgCudaUtil/Timer>
@@ -29,8 +30,7 @@
 extern "C"
 void emit( unsigned int numPtcls,
           void* ptcls,
-          void* seeds,
-          unsigned int seedIdx,
+          osgCompute::RandomState state,
           osg::Vec3f bbmin,
           osg::Vec3f bbmax );
 
@@ -46,7 +46,7 @@ namespace PtclDemo
     protected:
         osg::ref_ptr<osgCuda::Timer>                      _timer;
         osg::ref_ptr<osgCompute::Memory>                  _ptcls;
-        osg::ref_ptr<osgCompute::Memory>                  _seeds;
+        osg::ref_ptr<osgCompute::Random>                  _random;
     };
 
     //------------------------------------------------------------------------------
@@ -55,21 +55,11 @@ namespace PtclDemo
         if( !_ptcls.valid() )
             return;
 
-        if( !_seeds.valid() || !_ptcls.valid() )
+        if( !_random.valid() )
         {
-            osg::Image* seedValues = new osg::Image();
-            seedValues->allocateImage(_ptcls->getNumElements(),1,1,GL_LUMINANCE,GL_FLOAT);
-
-            float* seeds = (float*)seedValues->data();
-            for( unsigned int s=0; s<_ptcls->getNumElements(); ++s )
-                seeds[s] = ( float(rand()) / RAND_MAX );
-
-            osg::ref_ptr<osgCuda::Buffer> seedBuffer = new osgCuda::Buffer;
-            seedBuffer->setName("SEED BUFFER");
-            seedBuffer->setElementSize( sizeof(float) );
-            seedBuffer->setDimension(0,_ptcls->getNumElements());
-            seedBuffer->setImage( seedValues );
-            _seeds = seedBuffer;
+            _random = new osgCompute::Random;
+            _random->setName( "PtclEmitterRandom" );
+            _random->setSeed( (unsigned int)(rand()) );
         }
 
         if( !_timer.valid() )
@@ -84,8 +74,7 @@ namespace PtclDemo
         emit(
             _ptcls->getNumElements(),
             _ptcls->map( osgCompute::MAP_DEVICE_TARGET ),
-            _seeds->map( osgCompute::MAP_DEVICE_SOURCE ),
-            (unsigned int)(rand()),
+            _random->nextState(),
             osg::Vec3f(-1.f,-1.f,-1.f),
             osg::Vec3f(1.f,1.f,1.f) );
 
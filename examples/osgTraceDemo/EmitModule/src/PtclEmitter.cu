@@ -13,6 +13,8 @@
 * The full license is in LICENSE file included with this distribution.
 */
 
+#include <osgCompute/Philox>
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // DEVICE FUNCTIONS //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -25,20 +27,14 @@ float lerp(float a, float b, float t)
 
 //------------------------------------------------------------------------------
 inline __device__ 
-float4 reseed( float* seeds, unsigned int seedCount, unsigned int seedIdx, unsigned int ptclIdx, float3 bbmin, float3 bbmax )
+float4 reseed( const osgCompute::RandomState& state, unsigned int ptclIdx, float3 bbmin, float3 bbmax )
 {
-    // random seed idx
-    unsigned int idx1 = (seedIdx + ptclIdx) % seedCount;
-    unsigned int idx2 = (idx1 + ptclIdx) % seedCount;
-    unsigned int idx3 = (idx2 + ptclIdx) % seedCount;
-
-    // seeds are within the range [0,1]
-    float intFac1 = seeds[idx1];
-    float intFac2 = seeds[idx2];
-    float intFac3 = seeds[idx3];
+    // random values are within the range [0,1)
+    float intFac[4];
+    osgCompute::randomUniform4( state, ptclIdx, intFac );
 
-    return make_float4(lerp(bbmin.x,bbmax.x,intFac1), lerp(bbmin.y,bbmax.y,intFac3),
-        lerp(bbmin.z,bbmax.z,intFac2), 1);
+    return make_float4(lerp(bbmin.x,bbmax.x,intFac[0]), lerp(bbmin.y,bbmax.y,intFac[2]),
+        lerp(bbmin.z,bbmax.z,intFac[1]), 1);
 }
 
 //------------------------------------------------------------------------------
@@ -58,7 +54,7 @@ unsigned int thIdx()
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //------------------------------------------------------------------------------
 __global__
-void emitKernel(  unsigned int numPtcls, float4* ptcls, float* seeds, unsigned int seedIdx, float3 bbmin, float3 bbmax )
+void emitKernel(  unsigned int numPtcls, float4* ptcls, osgCompute::RandomState state, float3 bbmin, float3 bbmax )
 {
     unsigned int ptclIdx = thIdx();
     if( ptclIdx < numPtcls )
@@ -71,7 +67,7 @@ void emitKernel(  unsigned int numPtcls, float4* ptcls, float* seeds, unsigned i
             curPtcl.x > bbmax.x ||
             curPtcl.y > bbmax.y ||
             curPtcl.z > bbmax.z )
-            ptcls[ptclIdx] = reseed( seeds, numPtcls, seedIdx, ptclIdx, bbmin, bbmax );
+            ptcls[ptclIdx] = reseed( state, ptclIdx, bbmin, bbmax );
     }
 }
 
@@ -83,8 +79,7 @@ void emitKernel(  unsigned int numPtcls, float4* ptcls, float* seeds, unsigned i
 extern "C" __host__
 void emit(unsigned int numPtcls, 
             void* ptcls, 
-            void* seeds, 
-            unsigned int seedIdx, 
+            osgCompute::RandomState state, 
             float3 bbmin, 
             float3 bbmax )
 {
@@ -94,8 +89,7 @@ void emit(unsigned int numPtcls,
     emitKernel<<< blocks, threads >>>(
         numPtcls,
         reinterpret_cast<float4*>(ptcls),
-        reinterpret_cast<float*>(seeds),
-        seedIdx,
+        state,
         bbmin,
         bbmax);
 }
@@ -14,6 +14,7 @@
 */
 
 #include <vector_types.h>
+#include <cuda_runtime.h>
 #include <math.h>
 #include <cstdlib>
 #include <osg/Notify>
@@ -21,28 +22,69 @@
 #include <osgCompute/Program>
 #include <osgCompute/Memory>
 #include <osgCudaUtil/Timer>
+#include "PtclTracerHost.h"
 
 //------------------------------------------------------------------------------
 extern "C"
-void trace( unsigned int numPtcls, void* ptcls, float etime );
+void trace( unsigned int numPtcls, void* ptcls, float etime, unsigned int numSteps );
 
 namespace PtclDemo
 {
+    // Integration time of the flow field per second of simulation time. 
+    // A single launch() traces one step of 1/60 seconds.
+    static const double s_traceSpeed = 0.009 * 60.0;
+
+    //------------------------------------------------------------------------------
+    static bool deviceAvailable()
+    {
+        int numDevices = 0;
+        if( cudaGetDeviceCount( &numDevices ) != cudaSuccess )
+            return false;
+
+        return numDevices > 0;
+    }
+
+    /** Traces the particles on the device. Without a CUDA device, or if
+    the particle buffer has last been mapped on the host, the particles
+    are traced on the host instead.
+    */
     class PtclTracer : public osgCompute::Program 
     {
     public:
+        PtclTracer() : osgCompute::Program(), _useDevice(deviceAvailable()), _hostReported(false) {}
+
         virtual void launch();
+        virtual void launchSteps( unsigned int numSteps, double stepSize );
         virtual void acceptResource( osgCompute::Resource& resource );
 
     private:
+        void traceSteps( unsigned int numSteps, float etime );
+
+
         osg::ref_ptr<osgCuda::Timer>        _timer;
         osg::ref_ptr<osgCompute::Memory>    _ptcls;
+        bool                                _useDevice;
+        bool                                _hostReported;
     };
 
     //------------------------------------------------------------------------------  
     void PtclTracer::launch()
     {
-        if( !_ptcls.valid() )
+        traceSteps( 1, static_cast<float>( s_traceSpeed / 60.0 ) );
+    }
+
+    //------------------------------------------------------------------------------  
+    void PtclTracer::launchSteps( unsigned int numSteps, double stepSize )
+    {
+        // All steps are traced within a single kernel launch. Each 
+        // step advances the particles by the distance of stepSize seconds.
+        traceSteps( numSteps, static_cast<float>( s_traceSpeed * stepSize ) );
+    }
+
+    //------------------------------------------------------------------------------  
+    void PtclTracer::traceSteps( unsigned int numSteps, float etime )
+    {
+        if( !_ptcls.valid() || numSteps == 0 )
             return;
 
         if( !_timer.valid() )
@@ -51,12 +93,30 @@ namespace PtclDemo
             _timer->setName( "PtclTracer");
         }
 
+        if( !_useDevice || (_ptcls->getMapping() & osgCompute::MAP_HOST) )
+        {
+            // Avoid a synchronization with the device if the particles
+            // are already on the host
+            if( !_hostReported )
+            {
+                osg::notify(osg::INFO) << "PtclTracer::traceSteps(): tracing particles on the host using "
+                    << getHostTraceISA() << " instructions." << std::endl;
+                _hostReported = true;
+            }
+
+            float* ptcls = static_cast<float*>( _ptcls->map( osgCompute::MAP_HOST_TARGET ) );
+            if( ptcls != NULL )
+                traceHost( _ptcls->getNumElements(), ptcls, etime, numSteps );
+            return;
+        }
+
         _timer->start();
 
         trace( 
             _ptcls->getNumElements(), 
             _ptcls->map( osgCompute::MAP_DEVICE_TARGET ), 
-            0.009f );
+            etime,
+            numSteps );
 
         _timer->stop();
     }
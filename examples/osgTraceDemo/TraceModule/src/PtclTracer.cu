@@ -67,22 +67,26 @@ inline float4 vortexField( float4 pos )
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //------------------------------------------------------------------------------
 __global__
-void traceKernel( unsigned int numPtcls, float4* ptcls, float etime )
+void traceKernel( unsigned int numPtcls, float4* ptcls, float etime, unsigned int numSteps )
 {
     unsigned int ptclIdx = thIdx();
     if( ptclIdx < numPtcls )
     {
+        // The position stays in a register for all steps
         float4 ptclPos = ptcls[ptclIdx];
-
-        // 4th order Runge-Kutta 
         float halfETime = etime * 0.5f;
-        float4 k0 = vortexField( ptclPos );
-        float4 k1 = vortexField( ptclPos + (halfETime * k0) );
-        float4 k2 = vortexField( ptclPos + (halfETime * k1) );
-        float4 k3 = vortexField( ptclPos + (etime * k2) );
 
-        // Advance
-        ptclPos = ptclPos + etime*(1.0f/6.0f)* ( k0 + (2.0f*k1) + (2.0f*k2) + k3 );
+        for( unsigned int s=0; s<numSteps; ++s )
+        {
+            // 4th order Runge-Kutta 
+            float4 k0 = vortexField( ptclPos );
+            float4 k1 = vortexField( ptclPos + (halfETime * k0) );
+            float4 k2 = vortexField( ptclPos + (halfETime * k1) );
+            float4 k3 = vortexField( ptclPos + (etime * k2) );
+
+            // Advance
+            ptclPos = ptclPos + etime*(1.0f/6.0f)* ( k0 + (2.0f*k1) + (2.0f*k2) + k3 );
+        }
         ptclPos.w = 1.0f;
         
         // Forward-Euler
@@ -98,10 +102,10 @@ void traceKernel( unsigned int numPtcls, float4* ptcls, float etime )
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //------------------------------------------------------------------------------
 extern "C" __host__
-void trace( unsigned int numPtcls,  void* ptcls, float etime )
+void trace( unsigned int numPtcls,  void* ptcls, float etime, unsigned int numSteps )
 {
     dim3 blocks( (numPtcls/128)+1, 1, 1 );
     dim3 threads( 128, 1, 1 );
 
-    traceKernel<<< blocks, threads >>>( numPtcls, (float4*) ptcls, etime );
+    traceKernel<<< blocks, threads >>>( numPtcls, (float4*) ptcls, etime, numSteps );
 }
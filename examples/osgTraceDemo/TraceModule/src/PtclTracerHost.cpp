@@ -0,0 +1,287 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <osg/Math>
+#include <osgCompute/TaskGroup>
+#include "PtclTracerHost.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   include <immintrin.h>
+#   define PTCL_X86_SIMD 1
+#   define PTCL_TARGET_AVX2     __attribute__((target("avx2,fma")))
+#   define PTCL_TARGET_AVX512   __attribute__((target("avx512f")))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#   include <intrin.h>
+#   include <immintrin.h>
+#   define PTCL_X86_SIMD 1
+#   define PTCL_TARGET_AVX2
+#   define PTCL_TARGET_AVX512
+#endif
+
+// Must match PtclTracer.cu
+#define GAM 0.003f
+#define VEL_STRENGTH  10.0f 
+#define PI_F 3.141592654f
+
+namespace PtclDemo
+{
+    // Particles which are transposed and traced at once
+    static const unsigned int TILE_SIZE = 256;
+    // Particles per task
+    static const unsigned int TASK_SIZE = 64 * TILE_SIZE;
+
+    enum HostISA
+    {
+        ISA_SCALAR,
+        ISA_AVX2,
+        ISA_AVX512
+    };
+
+    typedef void (*TraceTileFunc)( float* x, float* z, unsigned int count, float etime );
+
+    //------------------------------------------------------------------------------
+    static HostISA detectISA()
+    {
+#if defined(PTCL_X86_SIMD) && defined(__GNUC__)
+        __builtin_cpu_init();
+        if( __builtin_cpu_supports("avx512f") )
+            return ISA_AVX512;
+        if( __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") )
+            return ISA_AVX2;
+#elif defined(PTCL_X86_SIMD)
+        int info[4];
+        __cpuid( info, 0 );
+        if( info[0] < 7 )
+            return ISA_SCALAR;
+
+        // The OS must save the AVX (and AVX-512) registers
+        __cpuid( info, 1 );
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool fma = (info[2] & (1 << 12)) != 0;
+        if( !osxsave )
+            return ISA_SCALAR;
+
+        unsigned long long xcr0 = _xgetbv( 0 );
+        __cpuidex( info, 7, 0 );
+        if( (info[1] & (1 << 16)) && (xcr0 & 0xE6) == 0xE6 )
+            return ISA_AVX512;
+        if( (info[1] & (1 << 5)) && fma && (xcr0 & 0x6) == 0x6 )
+            return ISA_AVX2;
+#endif
+        return ISA_SCALAR;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // SCALAR ///////////////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    // A simple vortex field of strength GAM around straight line (0,0,z).
+    // The y-component of the velocity is always zero.
+    static inline void vortexField( float x, float z, float& vx, float& vz )
+    {
+        float sqrad = x*x + z*z;
+        vx = VEL_STRENGTH * (-PI_F * GAM * z) / sqrad;
+        vz = VEL_STRENGTH * (PI_F * GAM * x) / sqrad;
+    }
+
+    //------------------------------------------------------------------------------
+    static void traceTileScalar( float* x, float* z, unsigned int count, float etime )
+    {
+        float halfETime = etime * 0.5f;
+        for( unsigned int p=0; p<count; ++p )
+        {
+            float k0x, k0z, k1x, k1z, k2x, k2z, k3x, k3z;
+            vortexField( x[p], z[p], k0x, k0z );
+            vortexField( x[p] + halfETime*k0x, z[p] + halfETime*k0z, k1x, k1z );
+            vortexField( x[p] + halfETime*k1x, z[p] + halfETime*k1z, k2x, k2z );
+            vortexField( x[p] + etime*k2x, z[p] + etime*k2z, k3x, k3z );
+
+            x[p] = x[p] + etime*(1.0f/6.0f) * ( k0x + 2.0f*k1x + 2.0f*k2x + k3x );
+            z[p] = z[p] + etime*(1.0f/6.0f) * ( k0z + 2.0f*k1z + 2.0f*k2z + k3z );
+        }
+    }
+
+#ifdef PTCL_X86_SIMD
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // AVX2 /////////////////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    PTCL_TARGET_AVX2 static inline void vortexField8( __m256 x, __m256 z, __m256& vx, __m256& vz )
+    {
+        const __m256 strength = _mm256_set1_ps( VEL_STRENGTH * PI_F * GAM );
+        __m256 sqrad = _mm256_fmadd_ps( x, x, _mm256_mul_ps( z, z ) );
+        __m256 scale = _mm256_div_ps( strength, sqrad );
+        vx = _mm256_sub_ps( _mm256_setzero_ps(), _mm256_mul_ps( scale, z ) );
+        vz = _mm256_mul_ps( scale, x );
+    }
+
+    //------------------------------------------------------------------------------
+    PTCL_TARGET_AVX2 static void traceTileAVX2( float* x, float* z, unsigned int count, float etime )
+    {
+        const __m256 e = _mm256_set1_ps( etime );
+        const __m256 h = _mm256_set1_ps( etime * 0.5f );
+        const __m256 sixth = _mm256_set1_ps( etime * (1.0f/6.0f) );
+        const __m256 two = _mm256_set1_ps( 2.0f );
+
+        unsigned int p = 0;
+        for( ; p+8<=count; p+=8 )
+        {
+            __m256 px = _mm256_loadu_ps( &x[p] );
+            __m256 pz = _mm256_loadu_ps( &z[p] );
+
+            __m256 k0x, k0z, k1x, k1z, k2x, k2z, k3x, k3z;
+            vortexField8( px, pz, k0x, k0z );
+            vortexField8( _mm256_fmadd_ps( h, k0x, px ), _mm256_fmadd_ps( h, k0z, pz ), k1x, k1z );
+            vortexField8( _mm256_fmadd_ps( h, k1x, px ), _mm256_fmadd_ps( h, k1z, pz ), k2x, k2z );
+            vortexField8( _mm256_fmadd_ps( e, k2x, px ), _mm256_fmadd_ps( e, k2z, pz ), k3x, k3z );
+
+            __m256 sx = _mm256_add_ps( _mm256_add_ps( k0x, k3x ), _mm256_mul_ps( two, _mm256_add_ps( k1x, k2x ) ) );
+            __m256 sz = _mm256_add_ps( _mm256_add_ps( k0z, k3z ), _mm256_mul_ps( two, _mm256_add_ps( k1z, k2z ) ) );
+            _mm256_storeu_ps( &x[p], _mm256_fmadd_ps( sixth, sx, px ) );
+            _mm256_storeu_ps( &z[p], _mm256_fmadd_ps( sixth, sz, pz ) );
+        }
+
+        traceTileScalar( &x[p], &z[p], count - p, etime );
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // AVX-512 //////////////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    PTCL_TARGET_AVX512 static inline void vortexField16( __m512 x, __m512 z, __m512& vx, __m512& vz )
+    {
+        const __m512 strength = _mm512_set1_ps( VEL_STRENGTH * PI_F * GAM );
+        __m512 sqrad = _mm512_fmadd_ps( x, x, _mm512_mul_ps( z, z ) );
+        __m512 scale = _mm512_div_ps( strength, sqrad );
+        vx = _mm512_sub_ps( _mm512_setzero_ps(), _mm512_mul_ps( scale, z ) );
+        vz = _mm512_mul_ps( scale, x );
+    }
+
+    //------------------------------------------------------------------------------
+    PTCL_TARGET_AVX512 static void traceTileAVX512( float* x, float* z, unsigned int count, float etime )
+    {
+        const __m512 e = _mm512_set1_ps( etime );
+        const __m512 h = _mm512_set1_ps( etime * 0.5f );
+        const __m512 sixth = _mm512_set1_ps( etime * (1.0f/6.0f) );
+        const __m512 two = _mm512_set1_ps( 2.0f );
+
+        unsigned int p = 0;
+        for( ; p+16<=count; p+=16 )
+        {
+            __m512 px = _mm512_loadu_ps( &x[p] );
+            __m512 pz = _mm512_loadu_ps( &z[p] );
+
+            __m512 k0x, k0z, k1x, k1z, k2x, k2z, k3x, k3z;
+            vortexField16( px, pz, k0x, k0z );
+            vortexField16( _mm512_fmadd_ps( h, k0x, px ), _mm512_fmadd_ps( h, k0z, pz ), k1x, k1z );
+            vortexField16( _mm512_fmadd_ps( h, k1x, px ), _mm512_fmadd_ps( h, k1z, pz ), k2x, k2z );
+            vortexField16( _mm512_fmadd_ps( e, k2x, px ), _mm512_fmadd_ps( e, k2z, pz ), k3x, k3z );
+
+            __m512 sx = _mm512_add_ps( _mm512_add_ps( k0x, k3x ), _mm512_mul_ps( two, _mm512_add_ps( k1x, k2x ) ) );
+            __m512 sz = _mm512_add_ps( _mm512_add_ps( k0z, k3z ), _mm512_mul_ps( two, _mm512_add_ps( k1z, k2z ) ) );
+            _mm512_storeu_ps( &x[p], _mm512_fmadd_ps( sixth, sx, px ) );
+            _mm512_storeu_ps( &z[p], _mm512_fmadd_ps( sixth, sz, pz ) );
+        }
+
+        traceTileScalar( &x[p], &z[p], count - p, etime );
+    }
+#endif
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // TRACE TASK ///////////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    class TraceTask : public osgCompute::Task
+    {
+    public:
+        TraceTask( float* ptcls, unsigned int numPtcls, float etime, unsigned int numSteps, TraceTileFunc traceTile )
+            : _ptcls(ptcls), _numPtcls(numPtcls), _etime(etime), _numSteps(numSteps), _traceTile(traceTile) {}
+
+        //------------------------------------------------------------------------------
+        virtual void run()
+        {
+            // SoA view of a single tile. The y-coordinate is not changed by
+            // the vortex field and stays in place.
+            float x[TILE_SIZE];
+            float z[TILE_SIZE];
+
+            for( unsigned int first=0; first<_numPtcls; first+=TILE_SIZE )
+            {
+                unsigned int count = osg::minimum( TILE_SIZE, _numPtcls - first );
+                float* tile = &_ptcls[4*first];
+
+                for( unsigned int p=0; p<count; ++p )
+                {
+                    x[p] = tile[4*p];
+                    z[p] = tile[4*p+2];
+                }
+
+                for( unsigned int s=0; s<_numSteps; ++s )
+                    (*_traceTile)( x, z, count, _etime );
+
+                for( unsigned int p=0; p<count; ++p )
+                {
+                    tile[4*p]   = x[p];
+                    tile[4*p+2] = z[p];
+                    tile[4*p+3] = 1.0f;
+                }
+            }
+        }
+
+    protected:
+        virtual ~TraceTask() {}
+
+        float*          _ptcls;
+        unsigned int    _numPtcls;
+        float           _etime;
+        unsigned int    _numSteps;
+        TraceTileFunc   _traceTile;
+    };
+
+    //------------------------------------------------------------------------------
+    static HostISA getISA()
+    {
+        static HostISA s_isa = detectISA();
+        return s_isa;
+    }
+
+    //------------------------------------------------------------------------------
+    const char* getHostTraceISA()
+    {
+        switch( getISA() )
+        {
+        case ISA_AVX512:    return "avx512";
+        case ISA_AVX2:      return "avx2";
+        default:            return "scalar";
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    void traceHost( unsigned int numPtcls, float* ptcls, float etime, unsigned int numSteps )
+    {
+        TraceTileFunc traceTile = &traceTileScalar;
+#ifdef PTCL_X86_SIMD
+        if( getISA() == ISA_AVX512 )
+            traceTile = &traceTileAVX512;
+        else if( getISA() == ISA_AVX2 )
+            traceTile = &traceTileAVX2;
+#endif
+
+        osgCompute::TaskGroup group;
+        for( unsigned int first=0; first<numPtcls; first+=TASK_SIZE )
+            group.addTask( new TraceTask( &ptcls[4*first], osg::minimum( TASK_SIZE, numPtcls - first ), etime, numSteps, traceTile ) );
+
+        group.run();
+    }
+}
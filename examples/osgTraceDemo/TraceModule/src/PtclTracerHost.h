@@ -0,0 +1,31 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#ifndef PTCLDEMO_PTCLTRACERHOST_H
+#define PTCLDEMO_PTCLTRACERHOST_H 1
+
+namespace PtclDemo
+{
+    // Host version of traceKernel. ptcls points to numPtcls float4 particle
+    // positions (AoS). Particles are traced in tiles which are transposed to
+    // SoA so that the RK4 integration runs on full SIMD registers. All
+    // numSteps steps are traced before a tile is transposed back.
+    void traceHost( unsigned int numPtcls, float* ptcls, float etime, unsigned int numSteps = 1 );
+
+    // Returns the name of the instruction set used by traceHost(), e.g. "avx2".
+    const char* getHostTraceISA();
+}
+
+#endif //PTCLDEMO_PTCLTRACERHOST_H
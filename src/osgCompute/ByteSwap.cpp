@@ -0,0 +1,138 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <cstring>
+#include <osgCompute/ByteSwap>
+#include "CpuFeatures.h"
+
+namespace osgCompute
+{
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // SCALAR ///////////////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    // Words are copied through a local array so that src and dst may alias
+    // and may be unaligned
+    static void copySwappedScalar( const unsigned char* src, unsigned char* dst, unsigned int size, unsigned int wordSize )
+    {
+        unsigned char word[8];
+        for( unsigned int w=0; w<size; w+=wordSize )
+        {
+            for( unsigned int b=0; b<wordSize; ++b )
+                word[b] = src[w + wordSize-1 - b];
+            memcpy( &dst[w], word, wordSize );
+        }
+    }
+
+#ifdef OSGCOMPUTE_X86_SIMD
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // SHUFFLES /////////////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // Byte indices which reverse each word of a 16 byte lane
+    static const char SWAP_MASK_2[16] = { 1,0, 3,2, 5,4, 7,6, 9,8, 11,10, 13,12, 15,14 };
+    static const char SWAP_MASK_4[16] = { 3,2,1,0, 7,6,5,4, 11,10,9,8, 15,14,13,12 };
+    static const char SWAP_MASK_8[16] = { 7,6,5,4,3,2,1,0, 15,14,13,12,11,10,9,8 };
+
+    //------------------------------------------------------------------------------
+    static const char* getSwapMask( unsigned int wordSize )
+    {
+        return (wordSize == 2)? SWAP_MASK_2 : ((wordSize == 4)? SWAP_MASK_4 : SWAP_MASK_8);
+    }
+
+    //------------------------------------------------------------------------------
+    // Returns the number of converted bytes
+    OSGCOMPUTE_TARGET_SSSE3
+    static unsigned int copySwappedSSSE3( const unsigned char* src, unsigned char* dst, unsigned int size, unsigned int wordSize )
+    {
+        const __m128i mask = _mm_loadu_si128( reinterpret_cast<const __m128i*>( getSwapMask( wordSize ) ) );
+
+        unsigned int i = 0;
+        for( ; i+64<=size; i+=64 )
+        {
+            __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( &src[i] ) );
+            __m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>( &src[i+16] ) );
+            __m128i c = _mm_loadu_si128( reinterpret_cast<const __m128i*>( &src[i+32] ) );
+            __m128i d = _mm_loadu_si128( reinterpret_cast<const __m128i*>( &src[i+48] ) );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( &dst[i] ), _mm_shuffle_epi8( a, mask ) );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( &dst[i+16] ), _mm_shuffle_epi8( b, mask ) );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( &dst[i+32] ), _mm_shuffle_epi8( c, mask ) );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( &dst[i+48] ), _mm_shuffle_epi8( d, mask ) );
+        }
+        for( ; i+16<=size; i+=16 )
+        {
+            __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( &src[i] ) );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( &dst[i] ), _mm_shuffle_epi8( a, mask ) );
+        }
+
+        return i;
+    }
+
+    //------------------------------------------------------------------------------
+    // Returns the number of converted bytes
+    OSGCOMPUTE_TARGET_AVX2
+    static unsigned int copySwappedAVX2( const unsigned char* src, unsigned char* dst, unsigned int size, unsigned int wordSize )
+    {
+        // vpshufb shuffles within each 128 bit lane
+        const __m128i laneMask = _mm_loadu_si128( reinterpret_cast<const __m128i*>( getSwapMask( wordSize ) ) );
+        const __m256i mask = _mm256_broadcastsi128_si256( laneMask );
+
+        unsigned int i = 0;
+        for( ; i+128<=size; i+=128 )
+        {
+            __m256i a = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( &src[i] ) );
+            __m256i b = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( &src[i+32] ) );
+            __m256i c = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( &src[i+64] ) );
+            __m256i d = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( &src[i+96] ) );
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( &dst[i] ), _mm256_shuffle_epi8( a, mask ) );
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( &dst[i+32] ), _mm256_shuffle_epi8( b, mask ) );
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( &dst[i+64] ), _mm256_shuffle_epi8( c, mask ) );
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( &dst[i+96] ), _mm256_shuffle_epi8( d, mask ) );
+        }
+        for( ; i+32<=size; i+=32 )
+        {
+            __m256i a = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( &src[i] ) );
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( &dst[i] ), _mm256_shuffle_epi8( a, mask ) );
+        }
+
+        return i;
+    }
+#endif
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    bool copySwapped( const void* src, void* dst, unsigned int size, unsigned int wordSize )
+    {
+        if( (wordSize != 2 && wordSize != 4 && wordSize != 8) || (size % wordSize) != 0 )
+            return false;
+
+        const unsigned char* in = static_cast<const unsigned char*>( src );
+        unsigned char* out = static_cast<unsigned char*>( dst );
+
+        // Vectors hold whole words, so the remainder starts at a word boundary
+        unsigned int done = 0;
+#ifdef OSGCOMPUTE_X86_SIMD
+        switch( getCpuISA() )
+        {
+        case CPU_ISA_AVX2:      done = copySwappedAVX2( in, out, size, wordSize ); break;
+        case CPU_ISA_SSSE3:     done = copySwappedSSSE3( in, out, size, wordSize ); break;
+        default:                break;
+        }
+#endif
+        copySwappedScalar( &in[done], &out[done], size - done, wordSize );
+        return true;
+    }
+}
@@ -23,6 +23,91 @@ namespace osgCompute
     /////////////////////////////////////////////////////////////////////////////////////////////////
     // PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
     /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    void MapHandOverCallback::operator()( Computation& computation )
+    {
+        unmapAll();
+        handOver( computation );
+
+        for( std::vector<MappedMemory>::iterator itr = _mappedMemories.begin(); itr != _mappedMemories.end(); ++itr )
+        {
+            if( !(*itr)._memory.valid() )
+                continue;
+
+            (*itr)._ptr = (*itr)._memory->map( (*itr)._mapping, 0, (*itr)._hint );
+            if( (*itr)._ptr == NULL )
+            {
+                osg::notify(osg::WARN)
+                    << __FUNCTION__ << ": cannot map memory \"" << (*itr)._memory->getName() << "\"."
+                    << std::endl;
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    void MapHandOverCallback::addMemory( Memory& memory, unsigned int mapping, unsigned int hint )
+    {
+        for( std::vector<MappedMemory>::iterator itr = _mappedMemories.begin(); itr != _mappedMemories.end(); ++itr )
+        {
+            if( (*itr)._memory == &memory && (*itr)._hint == hint )
+            {
+                (*itr)._mapping = mapping;
+                return;
+            }
+        }
+
+        MappedMemory entry;
+        entry._memory = &memory;
+        entry._mapping = mapping;
+        entry._hint = hint;
+        entry._ptr = NULL;
+        _mappedMemories.push_back( entry );
+    }
+
+    //------------------------------------------------------------------------------
+    void MapHandOverCallback::removeMemory( Memory& memory )
+    {
+        std::vector<MappedMemory>::iterator itr = _mappedMemories.begin();
+        while( itr != _mappedMemories.end() )
+        {
+            if( (*itr)._memory == &memory )
+            {
+                if( (*itr)._ptr != NULL )
+                    memory.unmap( (*itr)._hint );
+
+                itr = _mappedMemories.erase( itr );
+            }
+            else
+            {
+                ++itr;
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    void* MapHandOverCallback::getMappedPtr( const Memory& memory ) const
+    {
+        for( std::vector<MappedMemory>::const_iterator itr = _mappedMemories.begin(); itr != _mappedMemories.end(); ++itr )
+        {
+            if( (*itr)._memory == &memory )
+                return (*itr)._ptr;
+        }
+
+        return NULL;
+    }
+
+    //------------------------------------------------------------------------------
+    void MapHandOverCallback::unmapAll()
+    {
+        for( std::vector<MappedMemory>::iterator itr = _mappedMemories.begin(); itr != _mappedMemories.end(); ++itr )
+        {
+            if( (*itr)._ptr != NULL && (*itr)._memory.valid() )
+                (*itr)._memory->unmap( (*itr)._hint );
+
+            (*itr)._ptr = NULL;
+        }
+    }
+
     //------------------------------------------------------------------------------
     GLMemoryTargetCallback::GLMemoryTargetCallback()
     {
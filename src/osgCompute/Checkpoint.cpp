@@ -0,0 +1,497 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <map>
+#include <vector>
+#include <osg/Math>
+#include <osg/Notify>
+#include <OpenThreads/Thread>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Condition>
+#include <OpenThreads/ScopedLock>
+#include <osgCompute/Memory>
+#include <osgCompute/Checkpoint>
+
+namespace osgCompute
+{
+    static const char         s_checkpointMagic[8] = { 'O','S','G','C','C','K','P','T' };
+    static const unsigned int s_checkpointVersion = 1;
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // CHECKPOINT WRITER ////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    struct CheckpointEntry
+    {
+        std::string                 _key;
+        unsigned int                _elementSize;
+        std::vector<unsigned int>   _dimensions;
+        osg::ref_ptr<CheckpointStage> _stage;
+    };
+
+    //------------------------------------------------------------------------------
+    class HostCheckpointStage : public CheckpointStage
+    {
+    public:
+        HostCheckpointStage( const char* data, unsigned int byteSize ) : _data( data, data + byteSize ) {}
+
+        virtual const char* data() { return _data.empty()? NULL : &_data.front(); }
+        virtual unsigned int getByteSize() const { return static_cast<unsigned int>( _data.size() ); }
+
+    protected:
+        virtual ~HostCheckpointStage() {}
+
+        std::vector<char>           _data;
+    };
+
+    struct CheckpointJob
+    {
+        std::string                 _filename;
+        std::list<CheckpointEntry>  _entries;
+    };
+
+    class CheckpointWriter : public osg::Referenced, public OpenThreads::Thread
+    {
+    public:
+        CheckpointWriter() : _done(false), _busy(false), _numFailed(0), _chunkSize(8*1024*1024) {}
+
+        //------------------------------------------------------------------------------
+        void push( CheckpointJob* job )
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+            _jobs.push_back( job );
+            _busy = true;
+            _jobAvailable.signal();
+        }
+
+        //------------------------------------------------------------------------------
+        void wait()
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+            while( _busy )
+                _jobDone.wait( &_mutex );
+        }
+
+        //------------------------------------------------------------------------------
+        bool isBusy()
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+            return _busy;
+        }
+
+        //------------------------------------------------------------------------------
+        void finish()
+        {
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+                _done = true;
+                _jobAvailable.signal();
+            }
+            join();
+        }
+
+        //------------------------------------------------------------------------------
+        unsigned int getNumFailed()
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+            return _numFailed;
+        }
+
+        //------------------------------------------------------------------------------
+        void setChunkSize( unsigned int chunkSize )
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+            _chunkSize = chunkSize;
+        }
+
+        //------------------------------------------------------------------------------
+        virtual void run()
+        {
+            while( true )
+            {
+                CheckpointJob* job = NULL;
+                unsigned int chunkSize = 0;
+                {
+                    OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+                    while( _jobs.empty() && !_done )
+                        _jobAvailable.wait( &_mutex );
+
+                    if( _jobs.empty() )
+                        return;
+
+                    job = _jobs.front();
+                    chunkSize = _chunkSize;
+                }
+
+                bool success = write( *job, chunkSize );
+                delete job;
+
+                {
+                    OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+                    _jobs.pop_front();
+                    if( !success )
+                        _numFailed++;
+                    if( _jobs.empty() )
+                    {
+                        _busy = false;
+                        _jobDone.broadcast();
+                    }
+                }
+            }
+        }
+
+    protected:
+        virtual ~CheckpointWriter() {}
+
+        //------------------------------------------------------------------------------
+        static bool write( const CheckpointJob& job, unsigned int chunkSize )
+        {
+            // Write to a temporary file first so that a previous checkpoint
+            // stays intact until the new one is complete
+            std::string tmpFilename = job._filename + ".tmp";
+            std::ofstream file( tmpFilename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+            if( !file.is_open() )
+            {
+                osg::notify(osg::WARN)
+                    << "osgCompute::CheckpointVisitor: cannot open \"" << tmpFilename << "\" for writing."
+                    << std::endl;
+                return false;
+            }
+
+            unsigned int numEntries = static_cast<unsigned int>( job._entries.size() );
+            file.write( s_checkpointMagic, sizeof(s_checkpointMagic) );
+            file.write( reinterpret_cast<const char*>(&s_checkpointVersion), sizeof(unsigned int) );
+            file.write( reinterpret_cast<const char*>(&numEntries), sizeof(unsigned int) );
+
+            for( std::list<CheckpointEntry>::const_iterator itr = job._entries.begin(); itr != job._entries.end(); ++itr )
+            {
+                const CheckpointEntry& entry = (*itr);
+                unsigned int keyLength = static_cast<unsigned int>( entry._key.size() );
+                unsigned int numDimensions = static_cast<unsigned int>( entry._dimensions.size() );
+                unsigned int byteSize = entry._stage->getByteSize();
+
+                // Waits for the copy into the stage
+                const char* data = (byteSize != 0)? entry._stage->data() : NULL;
+                if( byteSize != 0 && data == NULL )
+                {
+                    osg::notify(osg::WARN)
+                        << "osgCompute::CheckpointVisitor: cannot stage \"" << entry._key << "\"."
+                        << std::endl;
+                    file.setstate( std::ios::failbit );
+                    break;
+                }
+
+                file.write( reinterpret_cast<const char*>(&keyLength), sizeof(unsigned int) );
+                file.write( entry._key.c_str(), keyLength );
+                file.write( reinterpret_cast<const char*>(&entry._elementSize), sizeof(unsigned int) );
+                file.write( reinterpret_cast<const char*>(&numDimensions), sizeof(unsigned int) );
+                if( numDimensions != 0 )
+                    file.write( reinterpret_cast<const char*>(&entry._dimensions.front()), numDimensions * sizeof(unsigned int) );
+                file.write( reinterpret_cast<const char*>(&byteSize), sizeof(unsigned int) );
+
+                for( unsigned int offset = 0; offset < byteSize && file.good(); offset += chunkSize )
+                {
+                    unsigned int curSize = osg::minimum( chunkSize, byteSize - offset );
+                    file.write( &data[offset], curSize );
+                }
+            }
+
+            bool success = file.good();
+            file.close();
+
+            if( success )
+            {
+                std::remove( job._filename.c_str() );
+                success = ( 0 == std::rename( tmpFilename.c_str(), job._filename.c_str() ) );
+            }
+
+            if( !success )
+            {
+                osg::notify(osg::WARN)
+                    << "osgCompute::CheckpointVisitor: writing of checkpoint \"" << job._filename << "\" failed."
+                    << std::endl;
+                std::remove( tmpFilename.c_str() );
+            }
+
+            return success;
+        }
+
+        OpenThreads::Mutex          _mutex;
+        OpenThreads::Condition      _jobAvailable;
+        OpenThreads::Condition      _jobDone;
+        std::list<CheckpointJob*>   _jobs;
+        bool                        _done;
+        bool                        _busy;
+        unsigned int                _numFailed;
+        unsigned int                _chunkSize;
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // STATIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    std::string CheckpointVisitor::getCheckpointKey( const Memory& memory )
+    {
+        if( !memory.getIdentifiers().empty() )
+            return *memory.getIdentifiers().begin();
+
+        return memory.getName();
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    CheckpointVisitor::CheckpointVisitor()
+        : ResourceVisitor(),
+          _chunkSize(8*1024*1024)
+    {
+        setMode( COLLECT );
+    }
+
+    //------------------------------------------------------------------------------
+    bool CheckpointVisitor::checkpoint( const std::string& filename )
+    {
+        // Limit the host memory occupied by staging buffers to a
+        // single checkpoint without stalling the frame
+        if( isWriting() )
+        {
+            osg::notify(osg::INFO)
+                << "osgCompute::CheckpointVisitor::checkpoint(): previous checkpoint is still written. \""
+                << filename << "\" is skipped."
+                << std::endl;
+            return false;
+        }
+
+        CheckpointJob* job = new CheckpointJob;
+        job->_filename = filename;
+
+        std::set<std::string> keys;
+        ResourceSet& resources = getResources();
+        for( ResourceSetItr itr = resources.begin(); itr != resources.end(); ++itr )
+        {
+            Memory* memory = dynamic_cast<Memory*>( (*itr).get() );
+            if( memory == NULL || memory->objectsReleased() )
+                continue;
+
+            std::string key = getCheckpointKey( *memory );
+            if( key.empty() || !keys.insert( key ).second )
+            {
+                osg::notify(osg::WARN)
+                    << "osgCompute::CheckpointVisitor::checkpoint(): memory \"" << memory->getName()
+                    << "\" has no unique identifier and is skipped."
+                    << std::endl;
+                continue;
+            }
+
+            osg::ref_ptr<CheckpointStage> memoryStage = stage( *memory );
+            if( !memoryStage.valid() )
+            {
+                osg::notify(osg::WARN)
+                    << "osgCompute::CheckpointVisitor::checkpoint(): cannot map memory \"" << key
+                    << "\". Memory is skipped."
+                    << std::endl;
+                continue;
+            }
+
+            job->_entries.push_back( CheckpointEntry() );
+            CheckpointEntry& entry = job->_entries.back();
+            entry._key = key;
+            entry._elementSize = memory->getElementSize();
+            for( unsigned int d=0; d<memory->getNumDimensions(); ++d )
+                entry._dimensions.push_back( memory->getDimension(d) );
+            entry._stage = memoryStage;
+        }
+
+        if( job->_entries.empty() )
+        {
+            delete job;
+            return false;
+        }
+
+        if( !_writer.valid() )
+        {
+            _writer = new CheckpointWriter;
+            _writer->setChunkSize( _chunkSize );
+            _writer->start();
+        }
+
+        _writer->push( job );
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    bool CheckpointVisitor::restore( const std::string& filename )
+    {
+        // Do not read a file which is currently written
+        wait();
+
+        std::ifstream file( filename.c_str(), std::ios::in | std::ios::binary );
+        if( !file.is_open() )
+        {
+            osg::notify(osg::WARN)
+                << "osgCompute::CheckpointVisitor::restore(): cannot open \"" << filename << "\"."
+                << std::endl;
+            return false;
+        }
+
+        char magic[8];
+        unsigned int version = 0;
+        unsigned int numEntries = 0;
+        file.read( magic, sizeof(magic) );
+        file.read( reinterpret_cast<char*>(&version), sizeof(unsigned int) );
+        file.read( reinterpret_cast<char*>(&numEntries), sizeof(unsigned int) );
+        if( !file.good() || 0 != memcmp( magic, s_checkpointMagic, sizeof(magic) ) || version != s_checkpointVersion )
+        {
+            osg::notify(osg::WARN)
+                << "osgCompute::CheckpointVisitor::restore(): \"" << filename << "\" is not a valid checkpoint."
+                << std::endl;
+            return false;
+        }
+
+        std::map<std::string,Memory*> memories;
+        ResourceSet& resources = getResources();
+        for( ResourceSetItr itr = resources.begin(); itr != resources.end(); ++itr )
+        {
+            Memory* memory = dynamic_cast<Memory*>( (*itr).get() );
+            if( memory != NULL )
+                memories[getCheckpointKey( *memory )] = memory;
+        }
+
+        for( unsigned int e=0; e<numEntries; ++e )
+        {
+            unsigned int keyLength = 0;
+            file.read( reinterpret_cast<char*>(&keyLength), sizeof(unsigned int) );
+            std::string key( keyLength, ' ' );
+            if( keyLength != 0 )
+                file.read( &key[0], keyLength );
+
+            unsigned int elementSize = 0;
+            unsigned int numDimensions = 0;
+            file.read( reinterpret_cast<char*>(&elementSize), sizeof(unsigned int) );
+            file.read( reinterpret_cast<char*>(&numDimensions), sizeof(unsigned int) );
+            std::vector<unsigned int> dimensions( numDimensions );
+            if( numDimensions != 0 )
+                file.read( reinterpret_cast<char*>(&dimensions.front()), numDimensions * sizeof(unsigned int) );
+
+            unsigned int byteSize = 0;
+            file.read( reinterpret_cast<char*>(&byteSize), sizeof(unsigned int) );
+            if( !file.good() )
+            {
+                osg::notify(osg::WARN)
+                    << "osgCompute::CheckpointVisitor::restore(): \"" << filename << "\" is truncated."
+                    << std::endl;
+                return false;
+            }
+
+            char* data = NULL;
+            std::map<std::string,Memory*>::iterator memItr = memories.find( key );
+            if( memItr != memories.end() )
+            {
+                Memory* memory = memItr->second;
+                if( memory->getElementSize() == elementSize && memory->getAllElementsSize() == byteSize )
+                    data = static_cast<char*>( memory->map( MAP_HOST_TARGET ) );
+            }
+
+            if( data == NULL )
+            {
+                osg::notify(osg::WARN)
+                    << "osgCompute::CheckpointVisitor::restore(): no matching memory for \"" << key
+                    << "\" found. Entry is skipped."
+                    << std::endl;
+                file.seekg( byteSize, std::ios::cur );
+                continue;
+            }
+
+            for( unsigned int offset = 0; offset < byteSize && file.good(); offset += _chunkSize )
+            {
+                unsigned int curSize = osg::minimum( _chunkSize, byteSize - offset );
+                file.read( &data[offset], curSize );
+            }
+            memItr->second->unmap();
+
+            if( !file.good() )
+            {
+                osg::notify(osg::WARN)
+                    << "osgCompute::CheckpointVisitor::restore(): \"" << filename << "\" is truncated."
+                    << std::endl;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    bool CheckpointVisitor::isWriting() const
+    {
+        return _writer.valid() && _writer->isBusy();
+    }
+
+    //------------------------------------------------------------------------------
+    void CheckpointVisitor::wait()
+    {
+        if( _writer.valid() )
+            _writer->wait();
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int CheckpointVisitor::getNumFailedCheckpoints() const
+    {
+        return _writer.valid()? _writer->getNumFailed() : 0;
+    }
+
+    //------------------------------------------------------------------------------
+    void CheckpointVisitor::setChunkSize( unsigned int chunkSize )
+    {
+        _chunkSize = (chunkSize == 0)? 1 : chunkSize;
+        if( _writer.valid() )
+            _writer->setChunkSize( _chunkSize );
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int CheckpointVisitor::getChunkSize() const
+    {
+        return _chunkSize;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PROTECTED FUNCTIONS //////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    CheckpointVisitor::~CheckpointVisitor()
+    {
+        if( _writer.valid() )
+        {
+            _writer->wait();
+            _writer->finish();
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    CheckpointStage* CheckpointVisitor::stage( Memory& memory )
+    {
+        const char* data = static_cast<const char*>( memory.map( MAP_HOST_SOURCE ) );
+        if( data == NULL )
+            return NULL;
+
+        CheckpointStage* hostStage = new HostCheckpointStage( data, memory.getAllElementsSize() );
+        memory.unmap();
+        return hostStage;
+    }
+}
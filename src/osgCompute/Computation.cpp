@@ -14,7 +14,12 @@
 */
 
 #include <sstream>
+#include <cmath>
+#include <climits>
+#include <OpenThreads/Atomic>
 #include <osg/NodeVisitor>
+#include <osg/FrameStamp>
+#include <osg/Timer>
 #include <osg/OperationThread>
 #include <osgDB/Registry>
 #include <osgUtil/CullVisitor>
@@ -23,10 +28,30 @@
 #include <osgUtil/GLObjectsVisitor>
 #include <osgCompute/Visitor>
 #include <osgCompute/Memory>
+#include <osgCompute/TaskGroup>
 #include <osgCompute/Computation>
 
 namespace osgCompute
 {
+    // Number of created computations which is used to select the automatic launch phase
+    static OpenThreads::Atomic s_numComputations;
+
+    //------------------------------------------------------------------------------
+    class MaterializeTask : public Task
+    {
+    public:
+        MaterializeTask( Memory& memory ) : _memory(&memory), _success(false) {}
+
+        virtual void run() { _success = _memory->materialize(); }
+
+        osg::ref_ptr<Memory>    _memory;
+        bool                    _success;
+
+    protected:
+        virtual ~MaterializeTask() {}
+    };
+
+
     class LIBRARY_EXPORT ComputationBin : public osgUtil::RenderStage 
     {
     public:
@@ -56,6 +81,7 @@ namespace osgCompute
         virtual void drawLeafs( osg::RenderInfo& renderInfo, osgUtil::RenderLeaf*& previous );
 
         Computation* _computation; 
+        bool         _launchFrame;
 
     private:
         // copy constructor and operator should not be called
@@ -128,9 +154,19 @@ namespace osgCompute
             rbitr->second->draw(renderInfo,previous);
         }
 
-        if( _computation->getLaunchCallback() ) 
-            (*_computation->getLaunchCallback())( *_computation ); 
-        else launch();  
+        if( _launchFrame )
+        {
+            LaunchScheduler* scheduler = _computation->getLaunchScheduler();
+            bool hostTiming = scheduler != NULL && scheduler->getHostTiming();
+            osg::Timer_t start = hostTiming? osg::Timer::instance()->tick() : 0;
+
+            if( _computation->getLaunchCallback() ) 
+                (*_computation->getLaunchCallback())( *_computation ); 
+            else launch();  
+
+            if( hostTiming )
+                scheduler->reportCost( *_computation, osg::Timer::instance()->delta_m( start, osg::Timer::instance()->tick() ) );
+        }
 
         // don't forget to decrement dynamic object count
         renderInfo.getState()->decrementDynamicObjectCount();
@@ -164,6 +200,7 @@ namespace osgCompute
     {
         // COMPUTATION 
         _computation = &computation;
+        _launchFrame = computation.isLaunchFrame();
 
         // OBJECT 
         setName( _computation->getName() );
@@ -199,6 +236,7 @@ namespace osgCompute
     {
         _stageDrawnThisFrame = false;
         _computation = NULL;
+        _launchFrame = false;
         osgUtil::RenderStage::reset();
     }
 
@@ -214,7 +252,7 @@ namespace osgCompute
         {
             if( (*itr)->isEnabled() )
             {
-                (*itr)->launch();
+                _computation->launchProgram( *(*itr) );
             }
         }
     }
@@ -258,12 +296,29 @@ namespace osgCompute
         :   osg::Group()
     { 
         _launchCallback = NULL;
+        _resultCache = NULL;
+        _launchScheduler = NULL;
+        _computeThread = NULL;
+        _computeFence = 0;
+        _handOverCallback = NULL;
         _enabled = true;
 
         // setup computation order
         _computeOrder = UPDATE_BEFORECHILDREN;
+        _computeOrderNum = 0;
         if( (_computeOrder & OSGCOMPUTE_UPDATE) == OSGCOMPUTE_UPDATE )
             setNumChildrenRequiringUpdateTraversal( 1 );
+
+        // setup launch rate
+        _launchInterval = 1;
+        _launchFrequency = 0.0;
+        _launchPhase = -1.0;
+        _autoLaunchPhase = fmod( static_cast<double>( ++s_numComputations ) * 0.6180339887498949, 1.0 );
+        _launchFrame = true;
+        _launchDue = true;
+        _hasLaunchFrameNumber = false;
+        _launchFrameNumber = 0;
+        _lastLaunchSlot = LLONG_MIN;
     }
 
     //------------------------------------------------------------------------------
@@ -272,6 +327,7 @@ namespace osgCompute
         if( nv.validNodeMask(*this) ) 
         {  
             nv.pushOntoNodePath(this);
+            updateLaunchFrame( nv.getFrameStamp() );
 
             osgUtil::CullVisitor* cv = dynamic_cast<osgUtil::CullVisitor*>( &nv );
             if( cv != NULL )
@@ -285,10 +341,17 @@ namespace osgCompute
             }
             else if( nv.getVisitorType() == osg::NodeVisitor::UPDATE_VISITOR )
             {
+                if( SyncDiagnostics::isEnabled() && nv.getFrameStamp() )
+                    SyncDiagnostics::instance()->beginFrame( nv.getFrameStamp()->getFrameNumber() );
 
-                if( _enabled && (_computeOrder & UPDATE_BEFORECHILDREN) == UPDATE_BEFORECHILDREN )
-                    launch();
+                // A compute thread runs the programs concurrently. So the launch is
+                // queued after the callbacks and the callbacks wait for the last launch.
+                bool launch = _enabled && _launchFrame;
+                bool threaded = _computeThread.valid() && (_computeOrder & OSGCOMPUTE_UPDATE) == OSGCOMPUTE_UPDATE;
+                if( launch && !threaded && (_computeOrder & UPDATE_BEFORECHILDREN) == UPDATE_BEFORECHILDREN )
+                    launchUpdate();
 
+                sync();
                 if( getUpdateCallback() )
                 {
                     (*getUpdateCallback()).run( this, &nv );
@@ -299,11 +362,12 @@ namespace osgCompute
                     nv.apply( *this );
                 }
 
-                if( _enabled && (_computeOrder & UPDATE_AFTERCHILDREN) == UPDATE_AFTERCHILDREN )
-                    launch();
+                if( launch && (threaded || (_computeOrder & UPDATE_AFTERCHILDREN) == UPDATE_AFTERCHILDREN) )
+                    launchUpdate();
             }
             else if( nv.getVisitorType() == osg::NodeVisitor::EVENT_VISITOR )
             {
+                sync();
                 if( getEventCallback() )
                 {
                     (*getEventCallback()).run( this, &nv );
@@ -326,6 +390,9 @@ namespace osgCompute
     //------------------------------------------------------------------------------
     void Computation::addProgram( Program& program )
     {
+        // The compute thread iterates the programs
+        sync();
+
         Resource* curResource = NULL;
         for( ResourceHandleListItr itr = _resources.begin(); itr != _resources.end(); ++itr )
         {
@@ -350,6 +417,8 @@ namespace osgCompute
     //------------------------------------------------------------------------------
     void Computation::removeProgram( Program& program )
     {
+        sync();
+
         for( ProgramListItr itr = _programs.begin(); itr != _programs.end(); ++itr )
         {
             if( (*itr) == &program )
@@ -370,6 +439,8 @@ namespace osgCompute
     //------------------------------------------------------------------------------
     void Computation::removeProgram( const std::string& programIdentifier )
     {
+        sync();
+
         ProgramListItr itr = _programs.begin();
         while( itr != _programs.end() )
         {
@@ -396,6 +467,8 @@ namespace osgCompute
     //------------------------------------------------------------------------------
     void Computation::removePrograms()
     {
+        sync();
+
         ProgramListItr itr;
         while( !_programs.empty() )
         {
@@ -512,6 +585,9 @@ namespace osgCompute
         if( hasResource(resource) )
             return;
 
+        // The compute thread iterates the resources
+        sync();
+
         for( ProgramListItr itr = _programs.begin(); itr != _programs.end(); ++itr )
             (*itr)->acceptResource( resource );
 
@@ -524,8 +600,11 @@ namespace osgCompute
     //------------------------------------------------------------------------------
     void Computation::exchangeResource( Resource& newResource, bool serialize /*= true */ )
     {
+        sync();
+
         IdentifierSet& ids = newResource.getIdentifiers();
-        for( ResourceHandleListItr itr = _resources.begin(); itr != _resources.end(); ++itr )
+        ResourceHandleListItr itr = _resources.begin();
+        while( itr != _resources.end() )
         {
             bool exchange = false;
             for( IdentifierSetItr idItr = ids.begin(); idItr != ids.end(); ++idItr )
@@ -547,6 +626,10 @@ namespace osgCompute
                 // Remove resource from list
                 itr = _resources.erase( itr );
             }
+            else
+            {
+                ++itr;
+            }
         }
 
         // Add new resource
@@ -560,6 +643,8 @@ namespace osgCompute
     //------------------------------------------------------------------------------
     void osgCompute::Computation::removeResource( const std::string& handle )
     {
+        sync();
+
         Resource* curResource = NULL;
 
         ResourceHandleListItr itr = _resources.begin();
@@ -587,6 +672,8 @@ namespace osgCompute
     //------------------------------------------------------------------------------
     void Computation::removeResource( Resource& resource )
     {
+        sync();
+
 		for( ResourceHandleListItr itr = _resources.begin();
 			itr != _resources.end();
 			++itr )
@@ -606,6 +693,8 @@ namespace osgCompute
     //------------------------------------------------------------------------------
     void Computation::removeResources()
     {
+        sync();
+
         ResourceHandleListItr itr = _resources.begin();
         while( itr != _resources.end() )
         {
@@ -633,6 +722,59 @@ namespace osgCompute
         return _resources;
     }
 
+    //------------------------------------------------------------------------------
+    unsigned int Computation::prefetchResources( const std::string& identifier )
+    {
+        unsigned int numLoaded = 0;
+        TaskGroup group;
+        for( ResourceHandleListItr itr = _resources.begin(); itr != _resources.end(); ++itr )
+        {
+            if( !(*itr)._resource.valid() )
+                continue;
+            if( !identifier.empty() && !(*itr)._resource->isIdentifiedBy(identifier) )
+                continue;
+
+            Memory* memory = dynamic_cast<Memory*>( (*itr)._resource.get() );
+            if( memory == NULL || memory->isMaterialized() )
+                continue;
+
+            // Interoperability memory may require a graphics context
+            // and is therefore loaded on the calling thread
+            if( dynamic_cast<GLMemory*>( memory ) != NULL )
+            {
+                if( memory->materialize() )
+                    numLoaded++;
+            }
+            else
+            {
+                group.addTask( new MaterializeTask( *memory ) );
+            }
+        }
+
+        // Payloads of different memory objects are read concurrently
+        group.run();
+
+        const TaskList& tasks = group.getTasks();
+        for( TaskListCnstItr itr = tasks.begin(); itr != tasks.end(); ++itr )
+            if( static_cast<MaterializeTask*>( (*itr).get() )->_success )
+                numLoaded++;
+
+        return numLoaded;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int Computation::getResourceAccess( const Resource& resource ) const
+    {
+        unsigned int access = ACCESS_NONE;
+        for( ProgramListCnstItr itr = _programs.begin(); itr != _programs.end(); ++itr )
+        {
+            if( (*itr)->isEnabled() )
+                access |= (*itr)->getResourceAccess( resource );
+        }
+
+        return access;
+    }
+
 	//------------------------------------------------------------------------------
 	bool Computation::isResourceSerialized( Resource& resource ) const
 	{
@@ -656,6 +798,7 @@ namespace osgCompute
         if( lc == _launchCallback )
             return;
 
+        sync();
         _launchCallback = lc; 
     }
 
@@ -671,6 +814,25 @@ namespace osgCompute
         return _launchCallback; 
     }
 
+    //------------------------------------------------------------------------------
+    void Computation::setResultCache( ResultCache* cache )
+    {
+        sync();
+        _resultCache = cache;
+    }
+
+    //------------------------------------------------------------------------------
+    ResultCache* Computation::getResultCache()
+    {
+        return _resultCache.get();
+    }
+
+    //------------------------------------------------------------------------------
+    const ResultCache* Computation::getResultCache() const
+    {
+        return _resultCache.get();
+    }
+
     //------------------------------------------------------------------------------
     void Computation::setComputeOrder( Computation::ComputeOrder co, int orderNum/* = 0 */)
     {
@@ -692,6 +854,61 @@ namespace osgCompute
         return _computeOrder;
     }
 
+    //------------------------------------------------------------------------------
+    void Computation::setLaunchInterval( unsigned int interval )
+    {
+        _launchInterval = (interval == 0)? 1 : interval;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int Computation::getLaunchInterval() const
+    {
+        return _launchInterval;
+    }
+
+    //------------------------------------------------------------------------------
+    void Computation::setLaunchFrequency( double frequency )
+    {
+        _launchFrequency = (frequency < 0.0)? 0.0 : frequency;
+        _lastLaunchSlot = LLONG_MIN;
+    }
+
+    //------------------------------------------------------------------------------
+    double Computation::getLaunchFrequency() const
+    {
+        return _launchFrequency;
+    }
+
+    //------------------------------------------------------------------------------
+    void Computation::setLaunchPhase( double phase )
+    {
+        _launchPhase = (phase < 0.0)? -1.0 : fmod( phase, 1.0 );
+    }
+
+    //------------------------------------------------------------------------------
+    double Computation::getLaunchPhase() const
+    {
+        return _launchPhase;
+    }
+
+    //------------------------------------------------------------------------------
+    bool Computation::isLaunchFrame() const
+    {
+        return _launchFrame;
+    }
+
+    //------------------------------------------------------------------------------
+    LaunchScheduler* Computation::getLaunchScheduler()
+    {
+        return _launchScheduler.get();
+    }
+
+    //------------------------------------------------------------------------------
+    const LaunchScheduler* Computation::getLaunchScheduler() const
+    {
+        return _launchScheduler.get();
+    }
+
     //------------------------------------------------------------------------------
     void Computation::enable() 
     { 
@@ -710,9 +927,59 @@ namespace osgCompute
         return _enabled;
     }
 
+    //------------------------------------------------------------------------------
+    void Computation::setComputeThread( ComputeThread* computeThread )
+    {
+        if( computeThread == _computeThread.get() )
+            return;
+
+        sync();
+        _computeThread = computeThread;
+    }
+
+    //------------------------------------------------------------------------------
+    ComputeThread* Computation::getComputeThread()
+    {
+        return _computeThread.get();
+    }
+
+    //------------------------------------------------------------------------------
+    const ComputeThread* Computation::getComputeThread() const
+    {
+        return _computeThread.get();
+    }
+
+    //------------------------------------------------------------------------------
+    void Computation::setHandOverCallback( HandOverCallback* hc )
+    {
+        _handOverCallback = hc;
+    }
+
+    //------------------------------------------------------------------------------
+    HandOverCallback* Computation::getHandOverCallback()
+    {
+        return _handOverCallback.get();
+    }
+
+    //------------------------------------------------------------------------------
+    const HandOverCallback* Computation::getHandOverCallback() const
+    {
+        return _handOverCallback.get();
+    }
+
+    //------------------------------------------------------------------------------
+    void Computation::sync() const
+    {
+        if( _computeThread.valid() )
+            _computeThread->wait( _computeFence );
+    }
+
     //------------------------------------------------------------------------------
     void Computation::releaseGLObjects( osg::State* state ) const
     {
+        // Programs must not be running while their resources are released
+        sync();
+
         if( state != NULL && GLMemory::getContext() == state->getGraphicsContext() )
         {
             // Make context the current context
@@ -802,23 +1069,164 @@ namespace osgCompute
         // Check if graphics context exist
         // or return otherwise
         if( NULL != GLMemory::getContext() && GLMemory::getContext()->isRealized() )
-        {       
-            // Launch programs
-            if( _launchCallback.valid() ) 
-            {
-                (*_launchCallback)( *this ); 
-            }
-            else
+            launchPrograms();
+    }
+
+    //------------------------------------------------------------------------------
+    void Computation::launchUpdate()
+    {
+        if( !_computeThread.valid() )
+        {
+            launch();
+            return;
+        }
+
+        if( NULL == GLMemory::getContext() || !GLMemory::getContext()->isRealized() )
+            return;
+
+        // Frame fence: the launch of the last frame must have finished
+        // before its results are handed over and the next launch is queued
+        _computeThread->wait( _computeFence );
+        if( _handOverCallback.valid() )
+            (*_handOverCallback)( *this );
+
+        _computeFence = _computeThread->submit( *this );
+    }
+
+    //------------------------------------------------------------------------------
+    void Computation::launchPrograms()
+    {
+        bool hostTiming = _launchScheduler.valid() && _launchScheduler->getHostTiming();
+        osg::Timer_t start = hostTiming? osg::Timer::instance()->tick() : 0;
+
+        // Launch programs
+        if( _launchCallback.valid() ) 
+        {
+            (*_launchCallback)( *this ); 
+        }
+        else
+        {
+            for( ProgramListItr itr = _programs.begin(); itr != _programs.end(); ++itr )
             {
-                for( ProgramListItr itr = _programs.begin(); itr != _programs.end(); ++itr )
+                if( (*itr)->isEnabled() )
                 {
-                    if( (*itr)->isEnabled() )
-                    {
-                        (*itr)->launch();
-                    }
+                    launchProgram( *(*itr) );
                 }
             }
         }
+
+        if( hostTiming )
+            _launchScheduler->reportCost( *this, osg::Timer::instance()->delta_m( start, osg::Timer::instance()->tick() ) );
+    }
+
+    //------------------------------------------------------------------------------
+    void Computation::updateLaunchFrame( const osg::FrameStamp* frameStamp )
+    {
+        if( frameStamp == NULL )
+        {
+            _launchFrame = true;
+            return;
+        }
+
+        if( _launchScheduler.valid() )
+            _launchFrame = _launchScheduler->isAdmitted( *this, *frameStamp );
+        else
+            _launchFrame = isLaunchDue( *frameStamp );
+    }
+
+    //------------------------------------------------------------------------------
+    bool Computation::isLaunchDue( const osg::FrameStamp& frameStamp )
+    {
+        // The node is traversed several times per frame
+        if( _hasLaunchFrameNumber && frameStamp.getFrameNumber() == _launchFrameNumber )
+            return _launchDue;
+
+        _hasLaunchFrameNumber = true;
+        _launchFrameNumber = frameStamp.getFrameNumber();
+
+        double phase = (_launchPhase < 0.0)? _autoLaunchPhase : _launchPhase;
+        if( _launchFrequency > 0.0 )
+        {
+            // Launch whenever the simulation time enters the next period
+            long long slot = static_cast<long long>( floor( frameStamp.getSimulationTime() * _launchFrequency - phase ) );
+            _launchDue = (slot != _lastLaunchSlot);
+            _lastLaunchSlot = slot;
+        }
+        else if( _launchInterval > 1 )
+        {
+            unsigned int offset = static_cast<unsigned int>( phase * _launchInterval ) % _launchInterval;
+            _launchDue = (_launchFrameNumber % _launchInterval) == offset;
+        }
+        else
+        {
+            _launchDue = true;
+        }
+
+        return _launchDue;
+    }
+
+    //------------------------------------------------------------------------------
+    void Computation::launchProgram( Program& program )
+    {
+        if( !program.isIncremental() && !_resultCache.valid() )
+        {
+            launchTraced( program );
+            return;
+        }
+
+        ResourceList resources;
+        for( ResourceHandleListCnstItr itr = _resources.begin(); itr != _resources.end(); ++itr )
+            resources.push_back( (*itr)._resource );
+
+        // Skip programs whose inputs have not changed
+        unsigned long long parameterHash = getParameterHash();
+        if( program.isIncremental() && program.isUpToDate( resources, parameterHash ) )
+            return;
+
+        // Restore the outputs of an earlier launch with the same inputs
+        unsigned long long key = _resultCache.valid()? _resultCache->computeKey( program, resources, parameterHash ) : 0;
+        if( key == 0 || !_resultCache->restore( key, program, resources ) )
+        {
+            launchTraced( program );
+            if( key != 0 )
+                _resultCache->store( key, program, resources );
+        }
+
+        if( program.isIncremental() )
+            program.storeContentVersions( resources, parameterHash );
+    }
+
+    //------------------------------------------------------------------------------
+    void Computation::runProgram( Program& program )
+    {
+        program.launch();
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned long long Computation::getParameterHash() const
+    {
+        return 0;
+    }
+
+    //------------------------------------------------------------------------------
+    void Computation::launchTraced( Program& program )
+    {
+        if( !SyncDiagnostics::isEnabled() )
+        {
+            runProgram( program );
+            return;
+        }
+
+        // Attribute all mappings during the launch to this program
+        std::string label = program.getName();
+        if( label.empty() )
+            label = program.getLibraryName();
+        if( label.empty() )
+            label = program.className();
+
+        SyncDiagnostics::instance()->setCurrentProgram( label );
+        runProgram( program );
+        SyncDiagnostics::instance()->setCurrentProgram( std::string() );
     }
 
     //------------------------------------------------------------------------------
@@ -0,0 +1,142 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <OpenThreads/ScopedLock>
+#include <osgCompute/Computation>
+#include <osgCompute/ComputeThread>
+
+namespace osgCompute
+{
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    ComputeThread::ComputeThread()
+        :   osg::Referenced(),
+            OpenThreads::Thread(),
+            _numSubmitted(0),
+            _numFinished(0),
+            _done(false),
+            _started(false)
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int ComputeThread::submit( Computation& computation )
+    {
+        unsigned int fence = 0;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+            _done = false;
+            _launches.push_back( &computation );
+            fence = ++_numSubmitted;
+            _launchAvailable.signal();
+        }
+
+        if( !_started )
+        {
+            _started = true;
+            start();
+        }
+
+        return fence;
+    }
+
+    //------------------------------------------------------------------------------
+    void ComputeThread::wait( unsigned int fence )
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        while( _numFinished < fence )
+            _launchFinished.wait( &_mutex );
+    }
+
+    //------------------------------------------------------------------------------
+    bool ComputeThread::isFinished( unsigned int fence ) const
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        return _numFinished >= fence;
+    }
+
+    //------------------------------------------------------------------------------
+    void ComputeThread::waitForAll()
+    {
+        unsigned int fence = 0;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+            fence = _numSubmitted;
+        }
+
+        wait( fence );
+    }
+
+    //------------------------------------------------------------------------------
+    void ComputeThread::stop()
+    {
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+            _done = true;
+            _launchAvailable.signal();
+        }
+
+        if( _started )
+        {
+            join();
+            _started = false;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    void ComputeThread::run()
+    {
+        beginThread();
+
+        while( true )
+        {
+            osg::ref_ptr<Computation> computation;
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+                while( _launches.empty() && !_done )
+                    _launchAvailable.wait( &_mutex );
+
+                // Queued launches are finished before the thread exits
+                if( _launches.empty() )
+                    break;
+
+                computation = _launches.front();
+            }
+
+            computation->launchPrograms();
+            endLaunch( *computation );
+
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+                _launches.pop_front();
+                _numFinished++;
+                _launchFinished.broadcast();
+            }
+        }
+
+        endThread();
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PROTECTED FUNCTIONS //////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    ComputeThread::~ComputeThread()
+    {
+        stop();
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef OSGCOMPUTE_CPUFEATURES_H
+#define OSGCOMPUTE_CPUFEATURES_H 1
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   include <immintrin.h>
+#   define OSGCOMPUTE_X86_SIMD 1
+#   define OSGCOMPUTE_TARGET_SSSE3  __attribute__((target("ssse3")))
+#   define OSGCOMPUTE_TARGET_AVX2   __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#   include <intrin.h>
+#   include <immintrin.h>
+#   define OSGCOMPUTE_X86_SIMD 1
+#   define OSGCOMPUTE_TARGET_SSSE3
+#   define OSGCOMPUTE_TARGET_AVX2
+#endif
+
+namespace osgCompute
+{
+    // Instruction sets of the host implementations. Each
+    // set includes the ones listed before.
+    enum CpuISA
+    {
+        CPU_ISA_SCALAR,
+        CPU_ISA_SSSE3,
+        CPU_ISA_AVX2
+    };
+
+    //------------------------------------------------------------------------------
+    inline CpuISA detectCpuISA()
+    {
+#if defined(OSGCOMPUTE_X86_SIMD) && defined(__GNUC__)
+        __builtin_cpu_init();
+        if( __builtin_cpu_supports("avx2") )
+            return CPU_ISA_AVX2;
+        if( __builtin_cpu_supports("ssse3") )
+            return CPU_ISA_SSSE3;
+#elif defined(OSGCOMPUTE_X86_SIMD)
+        int info[4];
+        __cpuid( info, 0 );
+        int maxLeaf = info[0];
+
+        __cpuid( info, 1 );
+        bool ssse3 = (info[2] & (1 << 9)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        if( maxLeaf >= 7 && osxsave && (_xgetbv( 0 ) & 0x6) == 0x6 )
+        {
+            __cpuidex( info, 7, 0 );
+            if( info[1] & (1 << 5) )
+                return CPU_ISA_AVX2;
+        }
+        if( ssse3 )
+            return CPU_ISA_SSSE3;
+#endif
+        return CPU_ISA_SCALAR;
+    }
+
+    //------------------------------------------------------------------------------
+    inline CpuISA getCpuISA()
+    {
+        // Local statics are initialized once even if worker threads
+        // of a TaskGroup call this function concurrently
+        static const CpuISA isa = detectCpuISA();
+        return isa;
+    }
+}
+
+#endif //OSGCOMPUTE_CPUFEATURES_H
@@ -0,0 +1,358 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <algorithm>
+#include <osg/FrameStamp>
+#include <OpenThreads/ScopedLock>
+#include <osgCompute/Computation>
+#include <osgCompute/LaunchScheduler>
+
+namespace osgCompute
+{
+    // Weight of a new measurement in the average costs
+    static const double s_costWeight = 0.2;
+
+    //------------------------------------------------------------------------------
+    struct CandidateOrder
+    {
+        CandidateOrder( const std::vector<LaunchScheduler::Entry>& entries, unsigned int maxDeferredFrames )
+            : _entries(entries), _maxDeferredFrames(maxDeferredFrames) {}
+
+        bool operator()( unsigned int lhs, unsigned int rhs ) const
+        {
+            const LaunchScheduler::Entry& l = _entries[lhs];
+            const LaunchScheduler::Entry& r = _entries[rhs];
+
+            // Starving computations first, then by aged priority
+            bool lStarving = l._waitFrames >= _maxDeferredFrames;
+            bool rStarving = r._waitFrames >= _maxDeferredFrames;
+            if( lStarving != rStarving )
+                return lStarving;
+
+            long long lPriority = static_cast<long long>( l._priority ) + l._waitFrames;
+            long long rPriority = static_cast<long long>( r._priority ) + r._waitFrames;
+            if( lPriority != rPriority )
+                return lPriority > rPriority;
+
+            return lhs < rhs;
+        }
+
+        const std::vector<LaunchScheduler::Entry>&  _entries;
+        unsigned int                                _maxDeferredFrames;
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    LaunchScheduler::LaunchScheduler()
+        :   osg::Referenced(),
+            _budget(0.0),
+            _maxDeferredFrames(8),
+            _hostTiming(true),
+            _hasPlan(false),
+            _planFrameNumber(0),
+            _plannedCost(0.0),
+            _numDeferred(0)
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    void LaunchScheduler::addComputation( Computation& computation, int priority, bool optional )
+    {
+        if( computation._launchScheduler.valid() && computation._launchScheduler.get() != this )
+            computation._launchScheduler->removeComputation( computation );
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+
+        Entry* entry = findEntry( computation );
+        if( entry == NULL )
+        {
+            Entry newEntry;
+            newEntry._computation = &computation;
+            newEntry._averageCost = 0.0;
+            newEntry._hasCost = false;
+            newEntry._waitFrames = 0;
+            newEntry._pending = false;
+            newEntry._admitted = false;
+            _entries.push_back( newEntry );
+            entry = &_entries.back();
+        }
+
+        entry->_priority = priority;
+        entry->_optional = optional;
+        computation._launchScheduler = this;
+    }
+
+    //------------------------------------------------------------------------------
+    void LaunchScheduler::removeComputation( Computation& computation )
+    {
+        // Keep the scheduler alive until the lock has been released
+        osg::ref_ptr<LaunchScheduler> scheduler;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+            for( std::vector<Entry>::iterator itr = _entries.begin(); itr != _entries.end(); ++itr )
+            {
+                if( (*itr)._computation.get() == &computation )
+                {
+                    _entries.erase( itr );
+                    break;
+                }
+            }
+
+            if( computation._launchScheduler.get() == this )
+            {
+                scheduler.swap( computation._launchScheduler );
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    bool LaunchScheduler::hasComputation( const Computation& computation ) const
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        return findEntry( computation ) != NULL;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int LaunchScheduler::getNumComputations() const
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        return static_cast<unsigned int>( _entries.size() );
+    }
+
+    //------------------------------------------------------------------------------
+    void LaunchScheduler::setBudget( double milliseconds )
+    {
+        _budget = (milliseconds < 0.0)? 0.0 : milliseconds;
+    }
+
+    //------------------------------------------------------------------------------
+    double LaunchScheduler::getBudget() const
+    {
+        return _budget;
+    }
+
+    //------------------------------------------------------------------------------
+    void LaunchScheduler::setMaxDeferredFrames( unsigned int frames )
+    {
+        _maxDeferredFrames = frames;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int LaunchScheduler::getMaxDeferredFrames() const
+    {
+        return _maxDeferredFrames;
+    }
+
+    //------------------------------------------------------------------------------
+    void LaunchScheduler::setCostModel( LaunchCostModel* costModel )
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        _costModel = costModel;
+    }
+
+    //------------------------------------------------------------------------------
+    LaunchCostModel* LaunchScheduler::getCostModel()
+    {
+        return _costModel.get();
+    }
+
+    //------------------------------------------------------------------------------
+    const LaunchCostModel* LaunchScheduler::getCostModel() const
+    {
+        return _costModel.get();
+    }
+
+    //------------------------------------------------------------------------------
+    void LaunchScheduler::setHostTiming( bool hostTiming )
+    {
+        _hostTiming = hostTiming;
+    }
+
+    //------------------------------------------------------------------------------
+    bool LaunchScheduler::getHostTiming() const
+    {
+        return _hostTiming;
+    }
+
+    //------------------------------------------------------------------------------
+    void LaunchScheduler::reportCost( const Computation& computation, double milliseconds )
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+
+        Entry* entry = findEntry( computation );
+        if( entry == NULL )
+            return;
+
+        if( entry->_hasCost )
+            entry->_averageCost += s_costWeight * (milliseconds - entry->_averageCost);
+        else
+            entry->_averageCost = milliseconds;
+        entry->_hasCost = true;
+    }
+
+    //------------------------------------------------------------------------------
+    double LaunchScheduler::getEstimatedCost( const Computation& computation ) const
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+
+        const Entry* entry = findEntry( computation );
+        if( entry == NULL )
+            return 0.0;
+
+        return estimateCost( *entry );
+    }
+
+    //------------------------------------------------------------------------------
+    bool LaunchScheduler::isAdmitted( Computation& computation, const osg::FrameStamp& frameStamp )
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+
+        if( !_hasPlan || frameStamp.getFrameNumber() != _planFrameNumber )
+            plan( frameStamp );
+
+        const Entry* entry = findEntry( computation );
+        if( entry == NULL )
+            return computation.isLaunchDue( frameStamp );
+
+        return entry->_admitted;
+    }
+
+    //------------------------------------------------------------------------------
+    double LaunchScheduler::getPlannedCost() const
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        return _plannedCost;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int LaunchScheduler::getNumDeferred() const
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        return _numDeferred;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PROTECTED FUNCTIONS //////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    LaunchScheduler::~LaunchScheduler()
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    void LaunchScheduler::plan( const osg::FrameStamp& frameStamp )
+    {
+        _hasPlan = true;
+        _planFrameNumber = frameStamp.getFrameNumber();
+        _plannedCost = 0.0;
+        _numDeferred = 0;
+
+        // Remove computations which have been deleted
+        std::vector<Entry>::iterator itr = _entries.begin();
+        while( itr != _entries.end() )
+        {
+            if( !(*itr)._computation.valid() )
+                itr = _entries.erase( itr );
+            else
+                ++itr;
+        }
+
+        // Computations which must be launched are always admitted
+        std::vector<unsigned int> candidates;
+        for( unsigned int e=0; e<_entries.size(); ++e )
+        {
+            Entry& entry = _entries[e];
+            entry._admitted = false;
+
+            Computation* computation = entry._computation.get();
+            if( !computation->isEnabled() )
+                continue;
+            if( !computation->isLaunchDue( frameStamp ) && !entry._pending )
+                continue;
+
+            if( entry._optional )
+            {
+                candidates.push_back( e );
+            }
+            else
+            {
+                entry._admitted = true;
+                _plannedCost += estimateCost( entry );
+            }
+        }
+
+        // Optional computations fill the remaining budget
+        std::stable_sort( candidates.begin(), candidates.end(), CandidateOrder( _entries, _maxDeferredFrames ) );
+        for( std::vector<unsigned int>::iterator candItr = candidates.begin(); candItr != candidates.end(); ++candItr )
+        {
+            Entry& entry = _entries[*candItr];
+            double cost = estimateCost( entry );
+            bool starving = entry._waitFrames >= _maxDeferredFrames;
+
+            if( _budget <= 0.0 || starving || _plannedCost + cost <= _budget )
+            {
+                entry._admitted = true;
+                _plannedCost += cost;
+            }
+            else
+            {
+                // Carry the launch over to the next frame
+                entry._pending = true;
+                entry._waitFrames++;
+                _numDeferred++;
+            }
+        }
+
+        for( std::vector<Entry>::iterator entryItr = _entries.begin(); entryItr != _entries.end(); ++entryItr )
+        {
+            if( (*entryItr)._admitted )
+            {
+                (*entryItr)._pending = false;
+                (*entryItr)._waitFrames = 0;
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    double LaunchScheduler::estimateCost( const Entry& entry ) const
+    {
+        if( _costModel.valid() )
+            return _costModel->getCost( *entry._computation );
+
+        return entry._averageCost;
+    }
+
+    //------------------------------------------------------------------------------
+    LaunchScheduler::Entry* LaunchScheduler::findEntry( const Computation& computation )
+    {
+        for( std::vector<Entry>::iterator itr = _entries.begin(); itr != _entries.end(); ++itr )
+            if( (*itr)._computation.get() == &computation )
+                return &(*itr);
+
+        return NULL;
+    }
+
+    //------------------------------------------------------------------------------
+    const LaunchScheduler::Entry* LaunchScheduler::findEntry( const Computation& computation ) const
+    {
+        for( std::vector<Entry>::const_iterator itr = _entries.begin(); itr != _entries.end(); ++itr )
+            if( (*itr)._computation.get() == &computation )
+                return &(*itr);
+
+        return NULL;
+    }
+}
@@ -13,12 +13,20 @@
 * The full license is in LICENSE file included with this distribution.
 */
 
+#include <climits>
+#include <sstream>
+#include <fstream>
 #include <osg/Notify>
 #include <osg/RenderInfo>
 #include <osgCompute/Memory>
+#include <osgCompute/ByteSwap>
+#include <osgCompute/Serializer>
 
 namespace osgCompute
 {   
+    // Write the properties of the osgCompute wrappers by default
+    static RegisterSerializerDomainProxy s_serializerDomain( "osgCompute", OSGCOMPUTE_SERIALIZER_VERSION );
+
     /////////////////////////////////////////////////////////////////////////////////////////////////
     // PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
     /////////////////////////////////////////////////////////////////////////////////////////////////
@@ -37,6 +45,65 @@ namespace osgCompute
     {
     }
 
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    MemoryFileReference::MemoryFileReference( const std::string& fileName, unsigned long long offset, unsigned int byteSize )
+        :   osg::Referenced(),
+            _fileName(fileName),
+            _offset(offset),
+            _byteSize(byteSize)
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    const std::string& MemoryFileReference::getFileName() const
+    {
+        return _fileName;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned long long MemoryFileReference::getOffset() const
+    {
+        return _offset;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int MemoryFileReference::getByteSize() const
+    {
+        return _byteSize;
+    }
+
+    //------------------------------------------------------------------------------
+    bool MemoryFileReference::read( void* ptr, unsigned int swapWordSize /*= 0*/ ) const
+    {
+        std::ifstream file( _fileName.c_str(), std::ios::in | std::ios::binary );
+        if( !file.is_open() )
+            return false;
+
+        file.seekg( static_cast<std::streamoff>( _offset ), std::ios::beg );
+        if( swapWordSize == 0 )
+        {
+            file.read( static_cast<char*>( ptr ), _byteSize );
+            return file.good();
+        }
+
+        // Swap each chunk while it is still in the cache instead
+        // of running over the whole payload a second time
+        const unsigned int chunkSize = (1 << 18) - ((1 << 18) % swapWordSize);
+        char* data = static_cast<char*>( ptr );
+        for( unsigned int done = 0; done < _byteSize; done += chunkSize )
+        {
+            unsigned int count = (_byteSize - done < chunkSize)? _byteSize - done : chunkSize;
+            file.read( &data[done], count );
+            if( !file.good() || !swapBytes( &data[done], count, swapWordSize ) )
+                return false;
+        }
+
+        return true;
+    }
+
     /////////////////////////////////////////////////////////////////////////////////////////////////
     // PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
     /////////////////////////////////////////////////////////////////////////////////////////////////
@@ -49,7 +116,13 @@ namespace osgCompute
         _elementSize = 0;
         _allocHint = 0;
         _subloadCallback = NULL;
+        _fileReference = NULL;
+        _fileReferenceLoaded = false;
+        _dataByteOrder = osg::getCpuByteOrder();
+        _dataWordSize = 0;
         _pitch = 0;
+        _contentVersion = 0;
+        _sourceModifiedCount = 0;
     }
 
     //------------------------------------------------------------------------------
@@ -150,6 +223,106 @@ namespace osgCompute
         return _subloadCallback.get(); 
     }
 
+    //------------------------------------------------------------------------------
+    void Memory::setFileReference( MemoryFileReference* fileReference )
+    {
+        _fileReference = fileReference;
+        _fileReferenceLoaded = false;
+    }
+
+    //------------------------------------------------------------------------------
+    MemoryFileReference* Memory::getFileReference()
+    {
+        return _fileReference.get();
+    }
+
+    //------------------------------------------------------------------------------
+    const MemoryFileReference* Memory::getFileReference() const
+    {
+        return _fileReference.get();
+    }
+
+    //------------------------------------------------------------------------------
+    bool Memory::materialize()
+    {
+        if( isMaterialized() )
+            return true;
+
+        if( _fileReference->getByteSize() != getAllElementsSize() )
+        {
+            osg::notify( osg::WARN )
+                << __FUNCTION__ << ": for \"" << getName()
+                << "\": size of the file reference does not match the size of the memory."
+                << std::endl;
+            return false;
+        }
+
+        // Mark as loaded first as map() calls materialize() again
+        _fileReferenceLoaded = true;
+        void* ptr = map( MAP_HOST_TARGET );
+        if( ptr == NULL )
+        {
+            _fileReferenceLoaded = false;
+            return false;
+        }
+
+        bool success = _fileReference->read( ptr, getDataSwapWordSize() );
+        unmap();
+
+        if( !success )
+        {
+            osg::notify( osg::WARN )
+                << __FUNCTION__ << ": for \"" << getName() << "\": cannot read "
+                << _fileReference->getByteSize() << " bytes from \"" << _fileReference->getFileName() << "\"."
+                << std::endl;
+        }
+
+        return success;
+    }
+
+    //------------------------------------------------------------------------------
+    bool Memory::isMaterialized() const
+    {
+        return !_fileReference.valid() || _fileReferenceLoaded;
+    }
+
+    //------------------------------------------------------------------------------
+    void Memory::setDataByteOrder( osg::Endian byteOrder, unsigned int wordSize )
+    {
+        if( wordSize != 0 && wordSize != 2 && wordSize != 4 && wordSize != 8 )
+        {
+            osg::notify( osg::WARN )
+                << __FUNCTION__ << ": for \"" << getName() << "\": word size "
+                << wordSize << " is not supported. Use 2, 4 or 8."
+                << std::endl;
+            return;
+        }
+
+        _dataByteOrder = byteOrder;
+        _dataWordSize = wordSize;
+    }
+
+    //------------------------------------------------------------------------------
+    osg::Endian Memory::getDataByteOrder() const
+    {
+        return _dataByteOrder;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int Memory::getDataWordSize() const
+    {
+        return _dataWordSize;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int Memory::getDataSwapWordSize() const
+    {
+        if( _dataByteOrder == osg::getCpuByteOrder() )
+            return 0;
+
+        return _dataWordSize;
+    }
+
     //------------------------------------------------------------------------------
     unsigned int Memory::getMapping( unsigned int ) const
     {
@@ -204,6 +377,25 @@ namespace osgCompute
         return 0;
     }
 
+    //------------------------------------------------------------------------------
+    unsigned int Memory::getContentVersion() const
+    {
+        unsigned int modifiedCount = getSourceModifiedCount();
+        if( modifiedCount != _sourceModifiedCount )
+        {
+            _sourceModifiedCount = modifiedCount;
+            ++_contentVersion;
+        }
+
+        return _contentVersion;
+    }
+
+    //------------------------------------------------------------------------------
+    void Memory::dirtyContent()
+    {
+        ++_contentVersion;
+    }
+
     //------------------------------------------------------------------------------
     void Memory::clear()
     {
@@ -212,6 +404,10 @@ namespace osgCompute
         _elementSize = 0;
         _pitch = 0;
         _numElements = 0;
+        _fileReference = NULL;
+        _fileReferenceLoaded = false;
+        _dataByteOrder = osg::getCpuByteOrder();
+        _dataWordSize = 0;
         Resource::clear();
     }
 
@@ -253,7 +449,7 @@ namespace osgCompute
             if( getElementSize() == 0 || getNumDimensions() == 0 )
             {
                 osg::notify( osg::FATAL )  
-                    << getName() << __FUNCTION__ << ": \"" << getName() 
+                    << __FUNCTION__ << ": for \"" << getName() 
                     << "\": allocation of memory failed as dimension and element size is unknown."
                     << std::endl;
 
@@ -264,7 +460,7 @@ namespace osgCompute
             if( newObject == NULL )
             {
                 osg::notify( osg::FATAL )  
-                    << getName() <<__FUNCTION__ << ": \"" << getName() << "\": allocation of memory failed."
+                    << __FUNCTION__ << ": for \"" << getName() << "\": allocation of memory failed."
                     << std::endl;
                 return NULL;
             }
@@ -273,6 +469,11 @@ namespace osgCompute
             _object = newObject;
         }
 
+        // Load deferred contents before the memory is used for the first time.
+        // All implementations of map() receive their object here.
+        if( create && _object.valid() && !isMaterialized() )
+            materialize();
+
         return _object.get();
     }
 
@@ -284,7 +485,7 @@ namespace osgCompute
             if( getElementSize() == 0 || getNumDimensions() == 0 )
             {
                 osg::notify( osg::FATAL )  
-                    << getName() << __FUNCTION__ << ": \"" << getName() 
+                    << __FUNCTION__ << ": for \"" << getName() 
                     << "\": allocation of memory failed as dimension and element size is unknown."
                     << std::endl;
 
@@ -295,7 +496,7 @@ namespace osgCompute
             if( newObject == NULL )
             {
                 osg::notify( osg::FATAL )  
-                    << getName() << __FUNCTION__ << ": \"" << getName() << "\": allocation of memory failed."
+                    << __FUNCTION__ << ": for \"" << getName() << "\": allocation of memory failed."
                     << std::endl;
 
                 return NULL;
@@ -324,6 +525,339 @@ namespace osgCompute
     void Memory::releaseObjectsLocal()
     {
         _object = NULL;
+        // Contents need to be loaded again
+        _fileReferenceLoaded = false;
+        ++_contentVersion;
+    }
+
+    //------------------------------------------------------------------------------
+    void Memory::traceMapping( unsigned int mapping, unsigned int offset, unsigned int pendingSync, bool setup ) const
+    {
+        // Device array targets include the device target flag
+        if( setup || (mapping & (MAP_HOST_TARGET|MAP_DEVICE_TARGET)) )
+            ++_contentVersion;
+
+        if( !SyncDiagnostics::isEnabled() )
+            return;
+
+        SyncDiagnostics::instance()->recordMapping( *this, mapping, offset, pendingSync, setup );
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int Memory::getSourceModifiedCount() const
+    {
+        return 0;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // STATIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    bool SyncDiagnostics::s_enabled = false;
+    osg::ref_ptr<SyncDiagnostics> SyncDiagnostics::s_instance = NULL;
+
+    //------------------------------------------------------------------------------
+    SyncDiagnostics* SyncDiagnostics::instance()
+    {
+        if( !s_instance.valid() )
+            s_instance = new SyncDiagnostics;
+
+        return s_instance.get();
+    }
+
+    //------------------------------------------------------------------------------
+    void SyncDiagnostics::enable()
+    {
+        // Create the instance before compute threads use it
+        instance();
+        s_enabled = true;
+    }
+
+    //------------------------------------------------------------------------------
+    void SyncDiagnostics::disable()
+    {
+        s_enabled = false;
+    }
+
+    //------------------------------------------------------------------------------
+    bool SyncDiagnostics::isEnabled()
+    {
+        return s_enabled;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    void SyncDiagnostics::beginFrame( unsigned int frameNumber )
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        if( frameNumber == _frameNumber )
+            return;
+
+        analyze();
+        _frameNumber = frameNumber;
+    }
+
+    //------------------------------------------------------------------------------
+    void SyncDiagnostics::setCurrentProgram( const std::string& programName )
+    {
+        // CurrentThread() returns NULL for threads which have not been
+        // started by OpenThreads, e.g. the main thread
+        const OpenThreads::Thread* thread = OpenThreads::Thread::CurrentThread();
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        if( programName.empty() )
+            _currentPrograms.erase( thread );
+        else
+            _currentPrograms[thread] = programName;
+    }
+
+    //------------------------------------------------------------------------------
+    void SyncDiagnostics::recordMapping( const Memory& memory, unsigned int mapping, unsigned int offset, unsigned int pendingSync, bool setup )
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+
+        MemoryTrace& trace = _traces[&memory];
+        if( trace._memory.get() != &memory )
+        {
+            // New memory object or a previous one has been deleted at the same address
+            trace._memory = &memory;
+            trace._records.clear();
+            trace._roundTripFrames = 0;
+            trace._setupFrames = 0;
+            trace._roundTripReported = false;
+            trace._setupReported = false;
+            trace._partialWriteReported = false;
+        }
+        trace._name = memory.getName();
+        trace._byteSize = memory.getAllElementsSize();
+
+        MapRecord record;
+        record._mapping = mapping;
+        record._offset = offset;
+        record._sync = NO_SYNC;
+        record._setup = setup;
+        ProgramNameMap::const_iterator program = _currentPrograms.find( OpenThreads::Thread::CurrentThread() );
+        if( program != _currentPrograms.end() )
+            record._program = program->second;
+
+        // Determine which copy has been triggered by this call
+        if( (mapping & MAP_DEVICE_ARRAY) == MAP_DEVICE_ARRAY )
+        {
+            if( pendingSync & SYNC_ARRAY )
+                record._sync = SYNC_ARRAY;
+        }
+        else if( mapping & MAP_DEVICE )
+        {
+            if( pendingSync & SYNC_DEVICE )
+                record._sync = SYNC_DEVICE;
+        }
+        else if( mapping & MAP_HOST )
+        {
+            if( pendingSync & SYNC_HOST )
+                record._sync = SYNC_HOST;
+        }
+
+        trace._records.push_back( record );
+    }
+
+    //------------------------------------------------------------------------------
+    void SyncDiagnostics::setFrameThreshold( unsigned int numFrames )
+    {
+        _frameThreshold = (numFrames == 0)? 1 : numFrames;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int SyncDiagnostics::getFrameThreshold() const
+    {
+        return _frameThreshold;
+    }
+
+    //------------------------------------------------------------------------------
+    void SyncDiagnostics::setLargeSyncThreshold( unsigned int byteSize )
+    {
+        _largeSyncThreshold = byteSize;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int SyncDiagnostics::getLargeSyncThreshold() const
+    {
+        return _largeSyncThreshold;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int SyncDiagnostics::getNumWarnings() const
+    {
+        return _numWarnings;
+    }
+
+    //------------------------------------------------------------------------------
+    void SyncDiagnostics::reset()
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        _traces.clear();
+        _currentPrograms.clear();
+        _numWarnings = 0;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PROTECTED FUNCTIONS //////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    SyncDiagnostics::SyncDiagnostics()
+        :   osg::Referenced(),
+            _frameNumber(UINT_MAX),
+            _frameThreshold(3),
+            _largeSyncThreshold(1024*1024),
+            _numWarnings(0)
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    void SyncDiagnostics::analyze()
+    {
+        MemoryTraceMap::iterator itr = _traces.begin();
+        while( itr != _traces.end() )
+        {
+            if( !itr->second._memory.valid() )
+            {
+                _traces.erase( itr++ );
+                continue;
+            }
+
+            analyze( itr->second );
+            itr->second._records.clear();
+            ++itr;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    void SyncDiagnostics::analyze( MemoryTrace& trace )
+    {
+        bool hostSync = false;
+        bool deviceSync = false;
+        bool setup = false;
+        bool partialWrite = false;
+        const MapRecord* largeSync = NULL;
+
+        for( std::vector<MapRecord>::const_iterator itr = trace._records.begin(); itr != trace._records.end(); ++itr )
+        {
+            if( (*itr)._sync == SYNC_HOST )
+                hostSync = true;
+            else if( (*itr)._sync != NO_SYNC )
+                deviceSync = true;
+
+            if( (*itr)._setup )
+                setup = true;
+
+            // A copy of the whole memory following a write to a sub-range of another memory space
+            if( partialWrite && (*itr)._sync != NO_SYNC && trace._byteSize >= _largeSyncThreshold && largeSync == NULL )
+                largeSync = &(*itr);
+
+            if( (*itr)._offset != 0 && ((*itr)._mapping & (MAP_HOST_TARGET|MAP_DEVICE_TARGET)) )
+                partialWrite = true;
+        }
+
+        ////////////////
+        // ROUND TRIP //
+        ////////////////
+        if( hostSync && deviceSync )
+        {
+            trace._roundTripFrames++;
+            if( trace._roundTripFrames >= _frameThreshold && !trace._roundTripReported )
+            {
+                std::stringstream msg;
+                msg << "memory is copied between host and device in each of the last "
+                    << trace._roundTripFrames << " frames (" << trace._byteSize << " bytes per copy).";
+                warn( trace, msg.str() );
+                trace._roundTripReported = true;
+            }
+        }
+        else
+        {
+            trace._roundTripFrames = 0;
+            trace._roundTripReported = false;
+        }
+
+        ////////////////////////
+        // REDUNDANT SETUP    //
+        ////////////////////////
+        if( setup )
+        {
+            trace._setupFrames++;
+            if( trace._setupFrames >= _frameThreshold && !trace._setupReported )
+            {
+                std::stringstream msg;
+                msg << "memory is set up from its source data in each of the last "
+                    << trace._setupFrames << " frames. Is the image dirtied every frame?";
+                warn( trace, msg.str() );
+                trace._setupReported = true;
+            }
+        }
+        else
+        {
+            trace._setupFrames = 0;
+            trace._setupReported = false;
+        }
+
+        ////////////////////////
+        // LARGE SYNC         //
+        ////////////////////////
+        if( largeSync != NULL && !trace._partialWriteReported )
+        {
+            std::stringstream msg;
+            msg << "a write with an offset is followed by a synchronization of all "
+                << trace._byteSize << " bytes";
+            if( !largeSync->_program.empty() )
+                msg << " in program \"" << largeSync->_program << "\"";
+            msg << ".";
+            warn( trace, msg.str() );
+            trace._partialWriteReported = true;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    static const char* mappingToString( unsigned int mapping )
+    {
+        switch( mapping )
+        {
+        case UNMAP: return "UNMAP";
+        case MAP_HOST: return "MAP_HOST";
+        case MAP_HOST_SOURCE: return "MAP_HOST_SOURCE";
+        case MAP_HOST_TARGET: return "MAP_HOST_TARGET";
+        case MAP_DEVICE: return "MAP_DEVICE";
+        case MAP_DEVICE_SOURCE: return "MAP_DEVICE_SOURCE";
+        case MAP_DEVICE_TARGET: return "MAP_DEVICE_TARGET";
+        case MAP_DEVICE_ARRAY: return "MAP_DEVICE_ARRAY";
+        case MAP_DEVICE_ARRAY_TARGET: return "MAP_DEVICE_ARRAY_TARGET";
+        default: return "MAP_UNKNOWN";
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    void SyncDiagnostics::warn( const MemoryTrace& trace, const std::string& message )
+    {
+        _numWarnings++;
+
+        osg::notify(osg::WARN)
+            << "osgCompute::SyncDiagnostics: \"" << trace._name << "\": " << message << std::endl
+            << "    mapping sequence of frame " << _frameNumber << ":" << std::endl;
+
+        for( std::vector<MapRecord>::const_iterator itr = trace._records.begin(); itr != trace._records.end(); ++itr )
+        {
+            osg::notify(osg::WARN) << "        " << mappingToString( (*itr)._mapping );
+            if( (*itr)._offset != 0 )
+                osg::notify(osg::WARN) << " offset=" << (*itr)._offset;
+            if( (*itr)._sync == SYNC_HOST )
+                osg::notify(osg::WARN) << " (copy to host)";
+            else if( (*itr)._sync == SYNC_DEVICE )
+                osg::notify(osg::WARN) << " (copy to device)";
+            else if( (*itr)._sync == SYNC_ARRAY )
+                osg::notify(osg::WARN) << " (copy to array)";
+            if( (*itr)._setup )
+                osg::notify(osg::WARN) << " (setup)";
+            osg::notify(osg::WARN) << " by " << ((*itr)._program.empty()? std::string("<no program>") : (*itr)._program) << std::endl;
+        }
     }
 
     /////////////////////////////////////////////////////////////////////////////////////////////////
@@ -13,20 +13,304 @@
 * The full license is in LICENSE file included with this distribution.
 */
 
+#include <cstdlib>
+#include <map>
+#include <fstream>
+#include <sys/stat.h>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
 #include <osgDB/Registry>
+#include <osgDB/DynamicLibrary>
 #include <osgDB/FileUtils>
+#include <osgDB/FileNameUtils>
+#include <osgCompute/TaskGroup>
+#include <osgCompute/Memory>
 #include <osgCompute/Program>
 
 namespace osgCompute
 {   
+    enum ProgramLoadStatus
+    {
+        PROGRAM_RESOLVED,
+        PROGRAM_NOT_FOUND,
+        PROGRAM_NOT_LOADED,
+        PROGRAM_NO_CREATE_FUNCTION
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PROGRAM LIBRARY CACHE ////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    struct ProgramLibraryEntry
+    {
+        ProgramLibraryEntry() : _fromManifest(false), _createProgramFunc(NULL), _hasStamp(false), _stamp(0) {}
+
+        std::string                             _fullPath;      // empty if the library does not exist
+        bool                                    _fromManifest;
+        OSGCOMPUTE_CREATE_PROGRAM_FUNCTION_PTR  _createProgramFunc;
+        bool                                    _hasStamp;
+        unsigned long long                      _stamp;
+    };
+
+    typedef std::map<std::string,ProgramLibraryEntry>   ProgramLibraryMap;
+
+    //------------------------------------------------------------------------------
+    static OpenThreads::Mutex& getProgramLibraryMutex()
+    {
+        static OpenThreads::Mutex s_mutex;
+        return s_mutex;
+    }
+
+    //------------------------------------------------------------------------------
+    static ProgramLibraryMap& getProgramLibraries()
+    {
+        static ProgramLibraryMap s_libraries;
+        return s_libraries;
+    }
+
+    //------------------------------------------------------------------------------
+    // Opens a library by its full path. osgDB::DynamicLibrary::loadLibrary() and
+    // osgDB::Registry::loadLibrary() search the library file path again
+    // before they open the library.
+    class ProgramLibrary : public osgDB::DynamicLibrary
+    {
+    public:
+        static osgDB::DynamicLibrary* load( const std::string& fullPath )
+        {
+            HANDLE handle = getLibraryHandle( fullPath );
+            if( handle == NULL )
+                return NULL;
+
+            return new ProgramLibrary( fullPath, handle );
+        }
+
+    protected:
+        ProgramLibrary( const std::string& name, HANDLE handle ) : osgDB::DynamicLibrary( name, handle ) {}
+        virtual ~ProgramLibrary() {}
+    };
+
+    typedef std::map< std::string, osg::ref_ptr<osgDB::DynamicLibrary> >   LoadedLibraryMap;
+
+    //------------------------------------------------------------------------------
+    static LoadedLibraryMap& getLoadedLibraries()
+    {
+        // Libraries stay loaded until the program exits as programs 
+        // created by them may still exist.
+        static LoadedLibraryMap s_loadedLibraries;
+        return s_loadedLibraries;
+    }
+
+    //------------------------------------------------------------------------------
+    static osgDB::DynamicLibrary* loadProgramLibrary( const std::string& fullPath )
+    {
+        if( fullPath.empty() )
+            return NULL;
+
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock( getProgramLibraryMutex() );
+            LoadedLibraryMap::iterator itr = getLoadedLibraries().find( fullPath );
+            if( itr != getLoadedLibraries().end() )
+                return itr->second.get();
+        }
+
+        // Open the library without holding the lock
+        osg::ref_ptr<osgDB::DynamicLibrary> library = ProgramLibrary::load( fullPath );
+        if( !library.valid() )
+            return NULL;
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( getProgramLibraryMutex() );
+        osg::ref_ptr<osgDB::DynamicLibrary>& loadedLibrary = getLoadedLibraries()[fullPath];
+        if( !loadedLibrary.valid() )
+            loadedLibrary = library;
+
+        return loadedLibrary.get();
+    }
+
+    //------------------------------------------------------------------------------
+    static bool parseProgramManifest( const std::string& filename, ProgramLibraryMap& libraries )
+    {
+        std::ifstream file( filename.c_str() );
+        if( !file.is_open() )
+            return false;
+
+        // Each line maps a program name to the absolute path of its library:
+        // <libraryName> <fullPath>. Lines starting with '#' are ignored.
+        std::string line;
+        while( std::getline( file, line ) )
+        {
+            std::string::size_type nameBegin = line.find_first_not_of( " \t\r" );
+            if( nameBegin == std::string::npos || line[nameBegin] == '#' )
+                continue;
+
+            std::string::size_type nameEnd = line.find_first_of( " \t", nameBegin );
+            if( nameEnd == std::string::npos )
+                continue;
+
+            std::string::size_type pathBegin = line.find_first_not_of( " \t", nameEnd );
+            std::string::size_type pathEnd = line.find_last_not_of( " \t\r" );
+            if( pathBegin == std::string::npos )
+                continue;
+
+            ProgramLibraryEntry& entry = libraries[ line.substr( nameBegin, nameEnd - nameBegin ) ];
+            entry._fullPath = line.substr( pathBegin, pathEnd - pathBegin + 1 );
+            entry._fromManifest = true;
+            entry._createProgramFunc = NULL;
+        }
+
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    static void checkManifestVariable()
+    {
+        // Called with the library mutex locked
+        static bool s_manifestChecked = false;
+        if( s_manifestChecked )
+            return;
+
+        s_manifestChecked = true;
+        const char* manifest = getenv( "OSGCOMPUTE_PROGRAM_MANIFEST" );
+        if( manifest != NULL && !parseProgramManifest( manifest, getProgramLibraries() ) )
+        {
+            osg::notify(osg::WARN)
+                << "osgCompute::Program: cannot read program manifest \"" << manifest << "\"."
+                << std::endl;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    static std::string findProgramLibrary( const std::string& libraryName, bool rescan = false )
+    {
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock( getProgramLibraryMutex() );
+            checkManifestVariable();
+
+            ProgramLibraryMap::iterator itr = getProgramLibraries().find( libraryName );
+            if( itr != getProgramLibraries().end() && !rescan )
+                return itr->second._fullPath;
+        }
+
+        // Scan the library path without holding the lock
+        std::string curLibraryName = osgDB::Registry::instance()->createLibraryNameForNodeKit( libraryName );
+        std::string fullPath = osgDB::findLibraryFile( curLibraryName );
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( getProgramLibraryMutex() );
+        ProgramLibraryEntry& entry = getProgramLibraries()[libraryName];
+        entry._fullPath = fullPath;
+        entry._fromManifest = false;
+        entry._hasStamp = false;
+        return fullPath;
+    }
+
+    //------------------------------------------------------------------------------
+    static ProgramLoadStatus resolveProgram( const std::string& libraryName, OSGCOMPUTE_CREATE_PROGRAM_FUNCTION_PTR& createProgramFunc )
+    {
+        createProgramFunc = NULL;
+        bool fromManifest = false;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock( getProgramLibraryMutex() );
+            checkManifestVariable();
+
+            ProgramLibraryMap::iterator itr = getProgramLibraries().find( libraryName );
+            if( itr != getProgramLibraries().end() )
+            {
+                createProgramFunc = itr->second._createProgramFunc;
+                fromManifest = itr->second._fromManifest;
+            }
+        }
+        if( createProgramFunc != NULL )
+            return PROGRAM_RESOLVED;
+
+        // The path is resolved already, so the library is opened directly
+        std::string fullPath = findProgramLibrary( libraryName );
+        osgDB::DynamicLibrary* programLibrary = loadProgramLibrary( fullPath );
+        if( programLibrary == NULL && fromManifest )
+        {
+            // Outdated manifest entry
+            fullPath = findProgramLibrary( libraryName, true );
+            programLibrary = loadProgramLibrary( fullPath );
+        }
+        if( programLibrary == NULL )
+            return PROGRAM_NOT_LOADED;
+
+        createProgramFunc = 
+            (OSGCOMPUTE_CREATE_PROGRAM_FUNCTION_PTR) programLibrary->getProcAddress( OSGCOMPUTE_CREATE_PROGRAM_FUNCTION_STR );
+        if( createProgramFunc == NULL )
+            return PROGRAM_NO_CREATE_FUNCTION;
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( getProgramLibraryMutex() );
+        getProgramLibraries()[libraryName]._createProgramFunc = createProgramFunc;
+        return PROGRAM_RESOLVED;
+    }
+
+    //------------------------------------------------------------------------------
+    static Program* createProgram( const std::string& libraryName, ProgramLoadStatus status, OSGCOMPUTE_CREATE_PROGRAM_FUNCTION_PTR createProgramFunc )
+    {
+        switch( status )
+        {
+        case PROGRAM_NOT_FOUND:
+            osg::notify(osg::WARN)
+                <<" Program::loadPrograms(): cannot find module library "
+                << libraryName << "." << std::endl;
+            return NULL;
+        case PROGRAM_NOT_LOADED:
+            osg::notify(osg::WARN)
+                <<" Program::loadProgram(): cannot find dynamic library "
+                << libraryName <<"."<<std::endl;
+            return NULL;
+        case PROGRAM_NO_CREATE_FUNCTION:
+            osg::notify(osg::WARN)
+                <<__FUNCTION__ << ": cannot get pointer to function \""<< OSGCOMPUTE_CREATE_PROGRAM_FUNCTION_STR<<"\" within program library "
+                << libraryName << "." << std::endl;
+            return NULL;
+        default:
+            break;
+        }
+
+        Program* loadedProgram = (*createProgramFunc)();
+        if( loadedProgram && loadedProgram->getLibraryName().empty() )
+        {
+            loadedProgram->setLibraryName( libraryName );
+            loadedProgram->addIdentifier( libraryName );
+        }
+
+        return loadedProgram;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PROGRAM LOAD TASK ////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    class ProgramLoadTask : public Task
+    {
+    public:
+        ProgramLoadTask( const std::string& libraryName )
+            : _libraryName(libraryName), _status(PROGRAM_NOT_FOUND), _createProgramFunc(NULL) {}
+
+        //------------------------------------------------------------------------------
+        virtual void run()
+        {
+            // Only the library lookup and the dynamic linking run concurrently.
+            // Programs are created on the calling thread of loadPrograms().
+            if( !Program::existsProgram( _libraryName ) )
+                _status = PROGRAM_NOT_FOUND;
+            else
+                _status = resolveProgram( _libraryName, _createProgramFunc );
+        }
+
+        std::string                             _libraryName;
+        ProgramLoadStatus                       _status;
+        OSGCOMPUTE_CREATE_PROGRAM_FUNCTION_PTR  _createProgramFunc;
+
+    protected:
+        virtual ~ProgramLoadTask() {}
+    };
+
 	/////////////////////////////////////////////////////////////////////////////////////////////////
 	// STATIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
 	/////////////////////////////////////////////////////////////////////////////////////////////////
 	//------------------------------------------------------------------------------
 	bool Program::existsProgram( const std::string& libraryName )
 	{
-		std::string curLibraryName = osgDB::Registry::instance()->createLibraryNameForNodeKit( libraryName );
-		std::string fullPath = osgDB::findLibraryFile( curLibraryName );
+		std::string fullPath = findProgramLibrary( libraryName );
 		if( fullPath.empty() )
 			return false;
 
@@ -34,48 +318,113 @@ namespace osgCompute
 	}
 
 	//------------------------------------------------------------------------------
-	Program* Program::loadProgram( const std::string& libraryName )
+	bool Program::loadProgramManifest( const std::string& filename )
 	{
-		std::string curLibraryName = osgDB::Registry::instance()->createLibraryNameForNodeKit( libraryName );
-		
-		if( osgDB::Registry::instance()->loadLibrary( curLibraryName ) ==  osgDB::Registry::NOT_LOADED )
+		ProgramLibraryMap libraries;
+		if( !parseProgramManifest( filename, libraries ) )
 		{
 			osg::notify(osg::WARN)
-				<<" Program::loadProgram(): cannot find dynamic library "
-				<< libraryName <<"."<<std::endl;
+				<<__FUNCTION__ << ": cannot read program manifest \"" << filename << "\"." << std::endl;
 
-			return NULL;
+			return false;
 		}
 
-		osg::ref_ptr<osgDB::DynamicLibrary> programLibrary = osgDB::Registry::instance()->getLibrary( curLibraryName );
-		if( !programLibrary.valid() )
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock( getProgramLibraryMutex() );
+		for( ProgramLibraryMap::iterator itr = libraries.begin(); itr != libraries.end(); ++itr )
+			getProgramLibraries()[itr->first] = itr->second;
+
+		return true;
+	}
+
+	//------------------------------------------------------------------------------
+	bool Program::writeProgramManifest( const std::string& filename, const std::vector<std::string>& libraryNames )
+	{
+		std::ofstream file( filename.c_str(), std::ios::out | std::ios::trunc );
+		if( !file.is_open() )
 		{
 			osg::notify(osg::WARN)
-				<<__FUNCTION__ << ": cannot find dynamic library "
-				<< libraryName << " after load." << std::endl;
+				<<__FUNCTION__ << ": cannot create program manifest \"" << filename << "\"." << std::endl;
 
-			return NULL;
+			return false;
 		}
 
-		OSGCOMPUTE_CREATE_PROGRAM_FUNCTION_PTR createProgramFunc = 
-            (OSGCOMPUTE_CREATE_PROGRAM_FUNCTION_PTR) programLibrary->getProcAddress( OSGCOMPUTE_CREATE_PROGRAM_FUNCTION_STR );
-		if( createProgramFunc == NULL )
+		file << "# osgCompute program manifest: <library name> <absolute path>" << std::endl;
+		for( std::vector<std::string>::const_iterator itr = libraryNames.begin(); itr != libraryNames.end(); ++itr )
 		{
-			osg::notify(osg::WARN)
-				<<__FUNCTION__ << ": cannot get pointer to function \""<< OSGCOMPUTE_CREATE_PROGRAM_FUNCTION_STR<<"\" within program library "
-				<< libraryName << "." << std::endl;
+			std::string fullPath = findProgramLibrary( *itr, true );
+			if( fullPath.empty() )
+			{
+				osg::notify(osg::WARN)
+					<<__FUNCTION__ << ": cannot find program library " << *itr << "." << std::endl;
+
+				continue;
+			}
 
-			return NULL;
+			file << *itr << " " << osgDB::getRealPath( fullPath ) << std::endl;
 		}
 
-		Program* loadedProgram = (*createProgramFunc)();
-		if( loadedProgram && loadedProgram->getLibraryName().empty() )
-        {
-			loadedProgram->setLibraryName( libraryName );
-            loadedProgram->addIdentifier( libraryName );
-        }
+		return file.good();
+	}
+
+	//------------------------------------------------------------------------------
+	void Program::clearProgramCache()
+	{
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock( getProgramLibraryMutex() );
+		getProgramLibraries().clear();
+	}
+
+	//------------------------------------------------------------------------------
+	unsigned long long Program::getLibraryStamp( const std::string& libraryName )
+	{
+		if( libraryName.empty() )
+			return 0;
 
-		return loadedProgram;
+		{
+			OpenThreads::ScopedLock<OpenThreads::Mutex> lock( getProgramLibraryMutex() );
+			ProgramLibraryMap::iterator itr = getProgramLibraries().find( libraryName );
+			if( itr != getProgramLibraries().end() && itr->second._hasStamp )
+				return itr->second._stamp;
+		}
+
+		std::string fullPath = findProgramLibrary( libraryName );
+		unsigned long long stamp = 0;
+		struct stat fileStat;
+		if( !fullPath.empty() && stat( fullPath.c_str(), &fileStat ) == 0 )
+			stamp = (static_cast<unsigned long long>( fileStat.st_mtime ) << 32) ^ static_cast<unsigned long long>( fileStat.st_size );
+
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock( getProgramLibraryMutex() );
+		ProgramLibraryEntry& entry = getProgramLibraries()[libraryName];
+		entry._hasStamp = true;
+		entry._stamp = stamp;
+		return stamp;
+	}
+
+	//------------------------------------------------------------------------------
+	Program* Program::loadProgram( const std::string& libraryName )
+	{
+		OSGCOMPUTE_CREATE_PROGRAM_FUNCTION_PTR createProgramFunc = NULL;
+		ProgramLoadStatus status = resolveProgram( libraryName, createProgramFunc );
+		return createProgram( libraryName, status, createProgramFunc );
+	}
+
+	//------------------------------------------------------------------------------
+	void Program::loadPrograms( const std::vector<std::string>& libraryNames, ProgramList& programs, unsigned int numThreads )
+	{
+		TaskGroup group;
+		group.setNumThreads( numThreads );
+		for( std::vector<std::string>::const_iterator itr = libraryNames.begin(); itr != libraryNames.end(); ++itr )
+			group.addTask( new ProgramLoadTask( *itr ) );
+
+		group.run();
+
+		// Join in the order of the library names
+		programs.clear();
+		const TaskList& tasks = group.getTasks();
+		for( TaskListCnstItr itr = tasks.begin(); itr != tasks.end(); ++itr )
+		{
+			ProgramLoadTask* task = static_cast<ProgramLoadTask*>( (*itr).get() );
+			programs.push_back( createProgram( task->_libraryName, task->_status, task->_createProgramFunc ) );
+		}
 	}
 
     /////////////////////////////////////////////////////////////////////////////////////////////////
@@ -85,6 +434,9 @@ namespace osgCompute
     Program::Program() : osgCompute::Resource()
     {
         _enabled = true;
+        _incremental = false;
+        _launchParameterHash = 0;
+        _version = 0;
     }
 
     //------------------------------------------------------------------------------
@@ -92,6 +444,13 @@ namespace osgCompute
     {
     }
 
+    //------------------------------------------------------------------------------
+    void Program::launchSteps( unsigned int numSteps, double /*stepSize*/ )
+    {
+        for( unsigned int s=0; s<numSteps; ++s )
+            launch();
+    }
+
     //------------------------------------------------------------------------------
     void Program::setUpdateCallback( ProgramCallback* uc ) 
     { 
@@ -176,6 +535,102 @@ namespace osgCompute
     { 
     }
 
+    //------------------------------------------------------------------------------
+    void Program::setResourceAccess( const std::string& identifier, unsigned int access )
+    {
+        if( access == ACCESS_NONE )
+            _resourceAccess.erase( identifier );
+        else
+            _resourceAccess[identifier] = access;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int Program::getResourceAccess( const std::string& identifier ) const
+    {
+        std::map<std::string,unsigned int>::const_iterator itr = _resourceAccess.find( identifier );
+        if( itr == _resourceAccess.end() )
+            return ACCESS_NONE;
+
+        return itr->second;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int Program::getResourceAccess( const Resource& resource ) const
+    {
+        unsigned int access = ACCESS_NONE;
+        const IdentifierSet& ids = resource.getIdentifiers();
+        for( IdentifierSetCnstItr itr = ids.begin(); itr != ids.end(); ++itr )
+            access |= getResourceAccess( *itr );
+
+        return access;
+    }
+
+    //------------------------------------------------------------------------------
+    void Program::setIncremental( bool incremental )
+    {
+        _incremental = incremental;
+        _contentVersions.clear();
+    }
+
+    //------------------------------------------------------------------------------
+    bool Program::isIncremental() const
+    {
+        return _incremental;
+    }
+
+    //------------------------------------------------------------------------------
+    bool Program::isUpToDate( const ResourceList& resources, unsigned long long parameterHash /*= 0*/ ) const
+    {
+        if( !_incremental || _contentVersions.empty() || parameterHash != _launchParameterHash )
+            return false;
+
+        bool hasInputs = false;
+        for( ResourceListCnstItr itr = resources.begin(); itr != resources.end(); ++itr )
+        {
+            const Memory* memory = dynamic_cast<const Memory*>( (*itr).get() );
+            if( memory == NULL )
+                continue;
+
+            unsigned int access = getResourceAccess( *memory );
+            if( access == ACCESS_NONE )
+                continue;
+
+            if( access == ACCESS_READ )
+                hasInputs = true;
+
+            std::map<const Resource*,ContentVersion>::const_iterator version = _contentVersions.find( memory );
+            if( version == _contentVersions.end() || 
+                version->second._resource.get() != memory ||
+                version->second._version != memory->getContentVersion() )
+                return false;
+        }
+
+        return hasInputs;
+    }
+
+    //------------------------------------------------------------------------------
+    void Program::storeContentVersions( const ResourceList& resources, unsigned long long parameterHash /*= 0*/ )
+    {
+        _launchParameterHash = parameterHash;
+        _contentVersions.clear();
+        for( ResourceListCnstItr itr = resources.begin(); itr != resources.end(); ++itr )
+        {
+            const Memory* memory = dynamic_cast<const Memory*>( (*itr).get() );
+            if( memory != NULL && getResourceAccess( *memory ) != ACCESS_NONE )
+            {
+                ContentVersion& version = _contentVersions[memory];
+                version._resource = memory;
+                version._version = memory->getContentVersion();
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned long long Program::getParameterHash() const
+    {
+        return 0;
+    }
+
     //------------------------------------------------------------------------------
     void Program::enable() 
     { 
@@ -211,4 +666,16 @@ namespace osgCompute
 	{
 		_libraryName = libraryName;
 	}
+
+    //------------------------------------------------------------------------------
+    void Program::setVersion( unsigned int version )
+    {
+        _version = version;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int Program::getVersion() const
+    {
+        return _version;
+    }
 }
@@ -0,0 +1,363 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <cstring>
+#include <osgCompute/Memory>
+#include <osgCompute/Random>
+#include "CpuFeatures.h"
+
+#if defined(OSGCOMPUTE_X86_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#   define RANDOM_SSE2 1
+#endif
+
+namespace osgCompute
+{
+    // Philox4x32 constants
+    static const unsigned int PHILOX_M0 = 0xD2511F53u;
+    static const unsigned int PHILOX_M1 = 0xCD9E8D57u;
+    static const unsigned int PHILOX_W0 = 0x9E3779B9u;
+    static const unsigned int PHILOX_W1 = 0xBB67AE85u;
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // SCALAR ///////////////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    template<bool UNIFORM>
+    static void generateScalar( const RandomState& state, unsigned int first, unsigned int numElements, void* out )
+    {
+        for( unsigned int e=0; e<numElements; ++e )
+        {
+            unsigned int bits[4];
+            randomUInt4( state, first + e, bits );
+
+            if( UNIFORM )
+            {
+                float* values = &static_cast<float*>( out )[4*e];
+                for( unsigned int v=0; v<4; ++v )
+                    values[v] = randomToUniform( bits[v] );
+            }
+            else
+            {
+                memcpy( &static_cast<unsigned int*>( out )[4*e], bits, sizeof(bits) );
+            }
+        }
+    }
+
+#ifdef RANDOM_SSE2
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // SSE2 /////////////////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    // 32x32 bit products of all four lanes. pmuludq multiplies the even lanes only.
+    static inline __m128i mulHiLoSSE2( __m128i a, __m128i m, __m128i& hi )
+    {
+        const __m128i lowMask = _mm_set_epi32( 0, -1, 0, -1 );
+        __m128i even = _mm_mul_epu32( a, m );
+        __m128i odd = _mm_mul_epu32( _mm_srli_epi64( a, 32 ), m );
+        hi = _mm_or_si128( _mm_srli_epi64( even, 32 ), _mm_andnot_si128( lowMask, odd ) );
+        return _mm_or_si128( _mm_and_si128( even, lowMask ), _mm_slli_epi64( odd, 32 ) );
+    }
+
+    //------------------------------------------------------------------------------
+    template<bool UNIFORM>
+    static inline void storeSSE2( __m128i bits, void* out )
+    {
+        if( UNIFORM )
+            _mm_storeu_ps( static_cast<float*>( out ),
+                _mm_mul_ps( _mm_cvtepi32_ps( _mm_srli_epi32( bits, 8 ) ), _mm_set1_ps( 1.0f / 16777216.0f ) ) );
+        else
+            _mm_storeu_si128( static_cast<__m128i*>( out ), bits );
+    }
+
+    //------------------------------------------------------------------------------
+    // Computes four elements at once, one per lane. Returns the
+    // number of computed elements.
+    template<bool UNIFORM>
+    static unsigned int generateSSE2( const RandomState& state, unsigned int first, unsigned int numElements, void* out )
+    {
+        const __m128i m0 = _mm_set1_epi32( static_cast<int>( PHILOX_M0 ) );
+        const __m128i m1 = _mm_set1_epi32( static_cast<int>( PHILOX_M1 ) );
+        const __m128i lanes = _mm_set_epi32( 3, 2, 1, 0 );
+        char* dst = static_cast<char*>( out );
+
+        unsigned int e = 0;
+        for( ; e+4<=numElements; e+=4 )
+        {
+            __m128i c0 = _mm_add_epi32( _mm_set1_epi32( static_cast<int>( first + e ) ), lanes );
+            __m128i c1 = _mm_set1_epi32( static_cast<int>( state._stream ) );
+            __m128i c2 = _mm_set1_epi32( static_cast<int>( state._counter ) );
+            __m128i c3 = _mm_setzero_si128();
+
+            unsigned int key0 = state._seed[0];
+            unsigned int key1 = state._seed[1];
+            for( unsigned int r=0; r<10; ++r )
+            {
+                __m128i hi0, hi1;
+                __m128i lo0 = mulHiLoSSE2( c0, m0, hi0 );
+                __m128i lo1 = mulHiLoSSE2( c2, m1, hi1 );
+
+                c0 = _mm_xor_si128( _mm_xor_si128( hi1, c1 ), _mm_set1_epi32( static_cast<int>( key0 ) ) );
+                c1 = lo1;
+                c2 = _mm_xor_si128( _mm_xor_si128( hi0, c3 ), _mm_set1_epi32( static_cast<int>( key1 ) ) );
+                c3 = lo0;
+
+                key0 += PHILOX_W0;
+                key1 += PHILOX_W1;
+            }
+
+            // Transpose so that the four values of an element are stored together
+            __m128i t0 = _mm_unpacklo_epi32( c0, c1 );
+            __m128i t1 = _mm_unpacklo_epi32( c2, c3 );
+            __m128i t2 = _mm_unpackhi_epi32( c0, c1 );
+            __m128i t3 = _mm_unpackhi_epi32( c2, c3 );
+
+            char* cur = &dst[16*e];
+            storeSSE2<UNIFORM>( _mm_unpacklo_epi64( t0, t1 ), cur );
+            storeSSE2<UNIFORM>( _mm_unpackhi_epi64( t0, t1 ), cur + 16 );
+            storeSSE2<UNIFORM>( _mm_unpacklo_epi64( t2, t3 ), cur + 32 );
+            storeSSE2<UNIFORM>( _mm_unpackhi_epi64( t2, t3 ), cur + 48 );
+        }
+
+        return e;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // AVX2 /////////////////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    OSGCOMPUTE_TARGET_AVX2
+    static inline __m256i mulHiLoAVX2( __m256i a, __m256i m, __m256i& hi )
+    {
+        const __m256i lowMask = _mm256_set_epi32( 0, -1, 0, -1, 0, -1, 0, -1 );
+        __m256i even = _mm256_mul_epu32( a, m );
+        __m256i odd = _mm256_mul_epu32( _mm256_srli_epi64( a, 32 ), m );
+        hi = _mm256_or_si256( _mm256_srli_epi64( even, 32 ), _mm256_andnot_si256( lowMask, odd ) );
+        return _mm256_or_si256( _mm256_and_si256( even, lowMask ), _mm256_slli_epi64( odd, 32 ) );
+    }
+
+    //------------------------------------------------------------------------------
+    template<bool UNIFORM>
+    OSGCOMPUTE_TARGET_AVX2
+    static inline void storeAVX2( __m256i bits, void* out )
+    {
+        if( UNIFORM )
+            _mm256_storeu_ps( static_cast<float*>( out ),
+                _mm256_mul_ps( _mm256_cvtepi32_ps( _mm256_srli_epi32( bits, 8 ) ), _mm256_set1_ps( 1.0f / 16777216.0f ) ) );
+        else
+            _mm256_storeu_si256( static_cast<__m256i*>( out ), bits );
+    }
+
+    //------------------------------------------------------------------------------
+    // Computes eight elements at once. Returns the number of computed elements.
+    template<bool UNIFORM>
+    OSGCOMPUTE_TARGET_AVX2
+    static unsigned int generateAVX2( const RandomState& state, unsigned int first, unsigned int numElements, void* out )
+    {
+        const __m256i m0 = _mm256_set1_epi32( static_cast<int>( PHILOX_M0 ) );
+        const __m256i m1 = _mm256_set1_epi32( static_cast<int>( PHILOX_M1 ) );
+        const __m256i lanes = _mm256_set_epi32( 7, 6, 5, 4, 3, 2, 1, 0 );
+        char* dst = static_cast<char*>( out );
+
+        unsigned int e = 0;
+        for( ; e+8<=numElements; e+=8 )
+        {
+            __m256i c0 = _mm256_add_epi32( _mm256_set1_epi32( static_cast<int>( first + e ) ), lanes );
+            __m256i c1 = _mm256_set1_epi32( static_cast<int>( state._stream ) );
+            __m256i c2 = _mm256_set1_epi32( static_cast<int>( state._counter ) );
+            __m256i c3 = _mm256_setzero_si256();
+
+            unsigned int key0 = state._seed[0];
+            unsigned int key1 = state._seed[1];
+            for( unsigned int r=0; r<10; ++r )
+            {
+                __m256i hi0, hi1;
+                __m256i lo0 = mulHiLoAVX2( c0, m0, hi0 );
+                __m256i lo1 = mulHiLoAVX2( c2, m1, hi1 );
+
+                c0 = _mm256_xor_si256( _mm256_xor_si256( hi1, c1 ), _mm256_set1_epi32( static_cast<int>( key0 ) ) );
+                c1 = lo1;
+                c2 = _mm256_xor_si256( _mm256_xor_si256( hi0, c3 ), _mm256_set1_epi32( static_cast<int>( key1 ) ) );
+                c3 = lo0;
+
+                key0 += PHILOX_W0;
+                key1 += PHILOX_W1;
+            }
+
+            // Unpacking works within 128 bit halves. The lower halves
+            // hold elements 0-3 and the upper halves elements 4-7.
+            __m256i t0 = _mm256_unpacklo_epi32( c0, c1 );
+            __m256i t1 = _mm256_unpacklo_epi32( c2, c3 );
+            __m256i t2 = _mm256_unpackhi_epi32( c0, c1 );
+            __m256i t3 = _mm256_unpackhi_epi32( c2, c3 );
+            __m256i e0 = _mm256_unpacklo_epi64( t0, t1 );
+            __m256i e1 = _mm256_unpackhi_epi64( t0, t1 );
+            __m256i e2 = _mm256_unpacklo_epi64( t2, t3 );
+            __m256i e3 = _mm256_unpackhi_epi64( t2, t3 );
+
+            char* cur = &dst[16*e];
+            storeAVX2<UNIFORM>( _mm256_permute2x128_si256( e0, e1, 0x20 ), cur );
+            storeAVX2<UNIFORM>( _mm256_permute2x128_si256( e2, e3, 0x20 ), cur + 32 );
+            storeAVX2<UNIFORM>( _mm256_permute2x128_si256( e0, e1, 0x31 ), cur + 64 );
+            storeAVX2<UNIFORM>( _mm256_permute2x128_si256( e2, e3, 0x31 ), cur + 96 );
+        }
+
+        return e;
+    }
+#endif
+
+    //------------------------------------------------------------------------------
+    template<bool UNIFORM>
+    static void generateValues( const RandomState& state, void* out, unsigned int numValues )
+    {
+        unsigned int numElements = numValues / 4;
+        unsigned int valueSize = UNIFORM? sizeof(float) : sizeof(unsigned int);
+        char* dst = static_cast<char*>( out );
+
+        unsigned int done = 0;
+#ifdef RANDOM_SSE2
+        if( getCpuISA() == CPU_ISA_AVX2 )
+            done = generateAVX2<UNIFORM>( state, 0, numElements, dst );
+        done += generateSSE2<UNIFORM>( state, done, numElements - done, &dst[4*valueSize*done] );
+#endif
+        generateScalar<UNIFORM>( state, done, numElements - done, &dst[4*valueSize*done] );
+
+        // Values of the last, incomplete element
+        unsigned int remainder = numValues - 4*numElements;
+        if( remainder > 0 )
+        {
+            char last[4*sizeof(unsigned int)];
+            generateScalar<UNIFORM>( state, numElements, 1, last );
+            memcpy( &dst[4*valueSize*numElements], last, remainder * valueSize );
+        }
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    Random::Random()
+        : Resource()
+    {
+        clearLocal();
+        ResourceObserver::instance()->observeResource( *this );
+    }
+
+    //------------------------------------------------------------------------------
+    void Random::setSeed( unsigned int seed, unsigned int seedHigh /*= 0*/ )
+    {
+        _state._seed[0] = seed;
+        _state._seed[1] = seedHigh;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int Random::getSeed() const
+    {
+        return _state._seed[0];
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int Random::getSeedHigh() const
+    {
+        return _state._seed[1];
+    }
+
+    //------------------------------------------------------------------------------
+    void Random::setStream( unsigned int stream )
+    {
+        _state._stream = stream;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int Random::getStream() const
+    {
+        return _state._stream;
+    }
+
+    //------------------------------------------------------------------------------
+    void Random::setCounter( unsigned int counter )
+    {
+        _state._counter = counter;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int Random::getCounter() const
+    {
+        return _state._counter;
+    }
+
+    //------------------------------------------------------------------------------
+    const RandomState& Random::getState() const
+    {
+        return _state;
+    }
+
+    //------------------------------------------------------------------------------
+    RandomState Random::nextState()
+    {
+        RandomState state = _state;
+        _state._counter++;
+        return state;
+    }
+
+    //------------------------------------------------------------------------------
+    void Random::generate( unsigned int* values, unsigned int numValues )
+    {
+        if( values == NULL || numValues == 0 )
+            return;
+
+        generateValues<false>( nextState(), values, numValues );
+    }
+
+    //------------------------------------------------------------------------------
+    void Random::generateUniform( float* values, unsigned int numValues )
+    {
+        if( values == NULL || numValues == 0 )
+            return;
+
+        generateValues<true>( nextState(), values, numValues );
+    }
+
+    //------------------------------------------------------------------------------
+    bool Random::generateUniform( Memory& memory )
+    {
+        unsigned int numValues = memory.getAllElementsSize() / sizeof(float);
+        float* values = static_cast<float*>( memory.map( MAP_HOST_TARGET ) );
+        if( values == NULL )
+            return false;
+
+        generateUniform( values, numValues );
+        memory.unmap();
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    void Random::clear()
+    {
+        clearLocal();
+        Resource::clear();
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PROTECTED FUNCTIONS //////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    void Random::clearLocal()
+    {
+        _state._seed[0] = 0;
+        _state._seed[1] = 0;
+        _state._stream = 0;
+        _state._counter = 0;
+    }
+}
@@ -0,0 +1,568 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <osg/Notify>
+#include <OpenThreads/ScopedLock>
+#include <osgCompute/ResultCache>
+
+namespace osgCompute
+{
+    static const char         s_resultMagic[8] = { 'O','S','G','C','R','E','S','\0' };
+    static const unsigned int s_resultVersion = 2;
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // STATIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    static void collectOutputs( const Program& program, const ResourceList& resources, std::vector<Memory*>& outputs )
+    {
+        for( ResourceListCnstItr itr = resources.begin(); itr != resources.end(); ++itr )
+        {
+            Memory* memory = dynamic_cast<Memory*>( (*itr).get() );
+            if( memory != NULL && (program.getResourceAccess( *memory ) & ACCESS_WRITE) )
+                outputs.push_back( memory );
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    static void appendField( std::ostringstream& signature, const std::string& field )
+    {
+        // Length prefixed so that fields cannot run into each other
+        signature << field.size() << ":" << field << ";";
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned long long ResultCache::hash( const void* data, unsigned int byteSize, unsigned long long seed /*= 0*/ )
+    {
+        // MurmurHash64A by Austin Appleby which processes 8 bytes per step
+        const unsigned long long m = 0xc6a4a7935bd1e995ULL;
+        const int r = 47;
+
+        unsigned long long h = seed ^ (static_cast<unsigned long long>(byteSize) * m);
+
+        const unsigned char* bytes = static_cast<const unsigned char*>( data );
+        const unsigned char* end = bytes + (byteSize & ~7u);
+        for( ; bytes != end; bytes += 8 )
+        {
+            unsigned long long k;
+            memcpy( &k, bytes, sizeof(k) );
+
+            k *= m;
+            k ^= k >> r;
+            k *= m;
+
+            h ^= k;
+            h *= m;
+        }
+
+        switch( byteSize & 7 )
+        {
+        case 7: h ^= static_cast<unsigned long long>( bytes[6] ) << 48;
+        case 6: h ^= static_cast<unsigned long long>( bytes[5] ) << 40;
+        case 5: h ^= static_cast<unsigned long long>( bytes[4] ) << 32;
+        case 4: h ^= static_cast<unsigned long long>( bytes[3] ) << 24;
+        case 3: h ^= static_cast<unsigned long long>( bytes[2] ) << 16;
+        case 2: h ^= static_cast<unsigned long long>( bytes[1] ) << 8;
+        case 1: h ^= static_cast<unsigned long long>( bytes[0] );
+            h *= m;
+        };
+
+        h ^= h >> r;
+        h *= m;
+        h ^= h >> r;
+        return h;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    ResultCache::ResultCache()
+        : osg::Referenced(),
+          _byteSize(0),
+          _maxByteSize(64 * 1024 * 1024),
+          _numHits(0),
+          _numMisses(0)
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned long long ResultCache::computeKey( const Program& program, const ResourceList& resources, unsigned long long parameterHash /*= 0*/ )
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+
+        // The signature identifies the launch. It is stored with
+        // the outputs and compared when they are restored.
+        std::ostringstream signature;
+        appendField( signature, program.className() );
+        appendField( signature, program.getName() );
+        appendField( signature, program.getLibraryName() );
+        signature << std::hex
+                  << program.getVersion() << ";"
+                  << Program::getLibraryStamp( program.getLibraryName() ) << ";"
+                  << parameterHash << ";"
+                  << program.getParameterHash() << ";";
+
+        bool hasOutputs = false;
+        for( ResourceListCnstItr itr = resources.begin(); itr != resources.end(); ++itr )
+        {
+            Memory* memory = dynamic_cast<Memory*>( (*itr).get() );
+            if( memory == NULL )
+                continue;
+
+            unsigned int access = program.getResourceAccess( *memory );
+            if( access & ACCESS_WRITE )
+                hasOutputs = true;
+            if( !(access & ACCESS_READ) )
+                continue;
+
+            unsigned long long inputHash = 0;
+            if( !hashInput( *memory, inputHash ) )
+                return 0;
+
+            signature << inputHash << ";";
+        }
+
+        if( !hasOutputs )
+            return 0;
+
+        std::string fullSignature = signature.str();
+        unsigned long long key = hash( fullSignature.c_str(), static_cast<unsigned int>( fullSignature.size() ) );
+
+        // 0 is reserved for programs which cannot be cached
+        key = (key == 0)? 1 : key;
+        _pendingSignatures[key] = fullSignature;
+        return key;
+    }
+
+    //------------------------------------------------------------------------------
+    bool ResultCache::restore( unsigned long long key, const Program& program, const ResourceList& resources )
+    {
+        if( key == 0 )
+            return false;
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+
+        SignatureMap::iterator pending = _pendingSignatures.find( key );
+        if( pending == _pendingSignatures.end() )
+        {
+            _numMisses++;
+            return false;
+        }
+
+        ResultEntry loaded;
+        const ResultEntry* entry = NULL;
+
+        ResultEntryMap::iterator found = _entryMap.find( key );
+        if( found != _entryMap.end() )
+        {
+            // Move to the front of the least recently used list
+            _entries.splice( _entries.begin(), _entries, found->second );
+            entry = &_entries.front();
+        }
+        else if( !_directory.empty() && read( key, loaded ) )
+        {
+            entry = &loaded;
+        }
+
+        std::vector<Memory*> outputs;
+        collectOutputs( program, resources, outputs );
+
+        bool matches = (entry != NULL && entry->_signature == pending->second && entry->_outputs.size() == outputs.size());
+        for( unsigned int o=0; matches && o<outputs.size(); ++o )
+            if( outputs[o]->getAllElementsSize() != entry->_outputs[o].size() )
+                matches = false;
+
+        if( !matches )
+        {
+            _numMisses++;
+            return false;
+        }
+
+        for( unsigned int o=0; o<outputs.size(); ++o )
+        {
+            if( entry->_outputs[o].empty() )
+                continue;
+
+            char* data = static_cast<char*>( outputs[o]->map( MAP_HOST_TARGET ) );
+            if( data == NULL )
+            {
+                osg::notify(osg::WARN)
+                    << "osgCompute::ResultCache::restore(): cannot map memory \"" << outputs[o]->getName() << "\"."
+                    << std::endl;
+                _numMisses++;
+                return false;
+            }
+
+            memcpy( data, &entry->_outputs[o].front(), entry->_outputs[o].size() );
+            outputs[o]->unmap();
+        }
+
+        if( entry == &loaded )
+            insert( loaded );
+
+        // A miss keeps the signature for store()
+        _pendingSignatures.erase( pending );
+        _numHits++;
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    void ResultCache::store( unsigned long long key, const Program& program, const ResourceList& resources )
+    {
+        if( key == 0 )
+            return;
+
+        ResultEntry entry;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+            SignatureMap::iterator pending = _pendingSignatures.find( key );
+            if( pending == _pendingSignatures.end() )
+                return;
+
+            entry._signature.swap( pending->second );
+            _pendingSignatures.erase( pending );
+        }
+
+        std::vector<Memory*> outputs;
+        collectOutputs( program, resources, outputs );
+
+        entry._key = key;
+        entry._byteSize = 0;
+        entry._outputs.resize( outputs.size() );
+        for( unsigned int o=0; o<outputs.size(); ++o )
+        {
+            unsigned int byteSize = outputs[o]->getAllElementsSize();
+            if( byteSize == 0 )
+                continue;
+
+            const char* data = static_cast<const char*>( outputs[o]->map( MAP_HOST_SOURCE ) );
+            if( data == NULL )
+                return;
+
+            entry._outputs[o].assign( data, data + byteSize );
+            entry._byteSize += byteSize;
+            outputs[o]->unmap();
+        }
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        insert( entry );
+    }
+
+    //------------------------------------------------------------------------------
+    void ResultCache::setMaxByteSize( unsigned int byteSize )
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        _maxByteSize = byteSize;
+        evict();
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int ResultCache::getMaxByteSize() const
+    {
+        return _maxByteSize;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int ResultCache::getByteSize() const
+    {
+        return _byteSize;
+    }
+
+    //------------------------------------------------------------------------------
+    void ResultCache::setDiskCacheDirectory( const std::string& directory )
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        _directory = directory;
+    }
+
+    //------------------------------------------------------------------------------
+    const std::string& ResultCache::getDiskCacheDirectory() const
+    {
+        return _directory;
+    }
+
+    //------------------------------------------------------------------------------
+    bool ResultCache::flush()
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        if( _directory.empty() )
+            return false;
+
+        bool success = true;
+        for( ResultEntryList::const_iterator itr = _entries.begin(); itr != _entries.end(); ++itr )
+            if( !write( *itr ) )
+                success = false;
+
+        return success;
+    }
+
+    //------------------------------------------------------------------------------
+    void ResultCache::clear()
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        _entries.clear();
+        _entryMap.clear();
+        _inputHashes.clear();
+        _pendingSignatures.clear();
+        _byteSize = 0;
+        _numHits = 0;
+        _numMisses = 0;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int ResultCache::getNumHits() const
+    {
+        return _numHits;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int ResultCache::getNumMisses() const
+    {
+        return _numMisses;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PROTECTED FUNCTIONS //////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    bool ResultCache::hashInput( Memory& memory, unsigned long long& inputHash )
+    {
+        // Contents are hashed again only if they have changed. An entry
+        // whose memory has been deleted does not match a new memory object
+        // at the same address.
+        InputHashMap::iterator found = _inputHashes.find( &memory );
+        if( found == _inputHashes.end() )
+            pruneInputHashes();
+
+        InputHash& cached = _inputHashes[&memory];
+        if( cached._memory.get() == &memory && cached._version == memory.getContentVersion() )
+        {
+            inputHash = cached._hash;
+            return true;
+        }
+
+        const char* data = static_cast<const char*>( memory.map( MAP_HOST_SOURCE ) );
+        if( data == NULL )
+        {
+            _inputHashes.erase( &memory );
+            return false;
+        }
+
+        inputHash = hash( data, memory.getAllElementsSize() );
+        memory.unmap();
+
+        // The version is read after map() as a setup from
+        // the source data increases it
+        cached._memory = &memory;
+        cached._version = memory.getContentVersion();
+        cached._hash = inputHash;
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    void ResultCache::pruneInputHashes()
+    {
+        // Remove the hashes of deleted memory objects
+        for( InputHashMap::iterator itr = _inputHashes.begin(); itr != _inputHashes.end(); )
+        {
+            if( !itr->second._memory.valid() )
+                _inputHashes.erase( itr++ );
+            else
+                ++itr;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    void ResultCache::insert( ResultEntry& entry )
+    {
+        ResultEntryMap::iterator found = _entryMap.find( entry._key );
+        if( found != _entryMap.end() )
+        {
+            _byteSize -= found->second->_byteSize;
+            _entries.erase( found->second );
+            _entryMap.erase( found );
+        }
+
+        if( entry._byteSize > _maxByteSize )
+        {
+            if( !_directory.empty() )
+                write( entry );
+            return;
+        }
+
+        // The outputs are moved into the list
+        _entries.push_front( ResultEntry() );
+        ResultEntry& front = _entries.front();
+        front._key = entry._key;
+        front._signature.swap( entry._signature );
+        front._byteSize = entry._byteSize;
+        front._outputs.swap( entry._outputs );
+
+        _entryMap[front._key] = _entries.begin();
+        _byteSize += front._byteSize;
+        evict();
+    }
+
+    //------------------------------------------------------------------------------
+    void ResultCache::evict()
+    {
+        while( _byteSize > _maxByteSize && !_entries.empty() )
+        {
+            const ResultEntry& last = _entries.back();
+            if( !_directory.empty() )
+                write( last );
+
+            _byteSize -= last._byteSize;
+            _entryMap.erase( last._key );
+            _entries.pop_back();
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    std::string ResultCache::getFilename( unsigned long long key ) const
+    {
+        std::ostringstream filename;
+        filename << _directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".osgcres";
+        return filename.str();
+    }
+
+    //------------------------------------------------------------------------------
+    bool ResultCache::write( const ResultEntry& entry ) const
+    {
+        std::string filename = getFilename( entry._key );
+
+        // Equal signatures store equal results. A file of another
+        // launch with the same key is replaced.
+        bool replace = false;
+        {
+            std::ifstream existing( filename.c_str(), std::ios::in | std::ios::binary );
+            std::string signature;
+            if( existing.is_open() && readSignature( existing, signature ) && signature == entry._signature )
+                return true;
+
+            replace = existing.is_open();
+        }
+
+        // Write to a temporary file first so that readers
+        // never see an incomplete result
+        std::string tmpFilename = filename + ".tmp";
+        std::ofstream file( tmpFilename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+        if( !file.is_open() )
+        {
+            osg::notify(osg::WARN)
+                << "osgCompute::ResultCache: cannot open \"" << tmpFilename << "\" for writing."
+                << std::endl;
+            return false;
+        }
+
+        unsigned int signatureSize = static_cast<unsigned int>( entry._signature.size() );
+        unsigned int numOutputs = static_cast<unsigned int>( entry._outputs.size() );
+        file.write( s_resultMagic, sizeof(s_resultMagic) );
+        file.write( reinterpret_cast<const char*>(&s_resultVersion), sizeof(unsigned int) );
+        file.write( reinterpret_cast<const char*>(&signatureSize), sizeof(unsigned int) );
+        file.write( entry._signature.data(), signatureSize );
+        file.write( reinterpret_cast<const char*>(&numOutputs), sizeof(unsigned int) );
+        for( unsigned int o=0; o<numOutputs; ++o )
+        {
+            unsigned int byteSize = static_cast<unsigned int>( entry._outputs[o].size() );
+            file.write( reinterpret_cast<const char*>(&byteSize), sizeof(unsigned int) );
+            if( byteSize != 0 )
+                file.write( &entry._outputs[o].front(), byteSize );
+        }
+
+        bool success = file.good();
+        file.close();
+
+        // rename() does not replace files on all platforms
+        if( success && replace )
+            std::remove( filename.c_str() );
+        if( success )
+            success = ( 0 == std::rename( tmpFilename.c_str(), filename.c_str() ) );
+
+        if( !success )
+        {
+            std::remove( tmpFilename.c_str() );
+            osg::notify(osg::WARN)
+                << "osgCompute::ResultCache: writing of \"" << filename << "\" failed."
+                << std::endl;
+        }
+
+        return success;
+    }
+
+    //------------------------------------------------------------------------------
+    bool ResultCache::read( unsigned long long key, ResultEntry& entry ) const
+    {
+        std::ifstream file( getFilename( key ).c_str(), std::ios::in | std::ios::binary );
+        if( !file.is_open() )
+            return false;
+
+        if( !readSignature( file, entry._signature ) )
+            return false;
+
+        unsigned int numOutputs = 0;
+        file.read( reinterpret_cast<char*>(&numOutputs), sizeof(unsigned int) );
+        if( !file.good() )
+            return false;
+
+        entry._key = key;
+        entry._byteSize = 0;
+        entry._outputs.clear();
+        for( unsigned int o=0; o<numOutputs && file.good(); ++o )
+        {
+            unsigned int byteSize = 0;
+            file.read( reinterpret_cast<char*>(&byteSize), sizeof(unsigned int) );
+            if( !file.good() )
+                return false;
+
+            entry._outputs.push_back( std::vector<char>() );
+            entry._outputs.back().resize( byteSize );
+            if( byteSize != 0 )
+                file.read( &entry._outputs.back().front(), byteSize );
+
+            entry._byteSize += byteSize;
+        }
+
+        return file.good();
+    }
+
+    //------------------------------------------------------------------------------
+    bool ResultCache::readSignature( std::istream& file, std::string& signature ) const
+    {
+        char magic[8];
+        unsigned int version = 0;
+        unsigned int signatureSize = 0;
+        file.read( magic, sizeof(magic) );
+        file.read( reinterpret_cast<char*>(&version), sizeof(unsigned int) );
+        file.read( reinterpret_cast<char*>(&signatureSize), sizeof(unsigned int) );
+        if( !file.good() || memcmp( magic, s_resultMagic, sizeof(magic) ) != 0 || version != s_resultVersion )
+            return false;
+
+        // A corrupt size must not allocate huge strings
+        if( signatureSize > 64 * 1024 )
+            return false;
+
+        signature.resize( signatureSize );
+        if( signatureSize != 0 )
+            file.read( &signature[0], signatureSize );
+
+        return file.good();
+    }
+}
@@ -0,0 +1,136 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <map>
+#include <sstream>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <osgDB/Options>
+#include <osgDB/Registry>
+#include <osgCompute/Serializer>
+
+namespace osgCompute
+{
+    typedef std::map<std::string,int>   DomainVersionMap;
+
+    // Constant initialized as domains are registered during the static
+    // initialization of other translation units
+    static const char s_customDomainsOption[] = "CustomDomains=";
+
+    //------------------------------------------------------------------------------
+    static OpenThreads::Mutex& getDomainMutex()
+    {
+        static OpenThreads::Mutex s_mutex;
+        return s_mutex;
+    }
+
+    //------------------------------------------------------------------------------
+    static DomainVersionMap& getDomainVersions()
+    {
+        static DomainVersionMap s_domainVersions;
+        return s_domainVersions;
+    }
+
+    //------------------------------------------------------------------------------
+    static bool listsDomain( const std::string& customDomains, const std::string& domain )
+    {
+        // Entries are separated by ';' and have the form <domain>:<version>
+        std::istringstream iss( customDomains );
+        std::string entry;
+        while( std::getline( iss, entry, ';' ) )
+        {
+            if( entry.substr( 0, entry.find( ':' ) ) == domain )
+                return true;
+        }
+
+        return false;
+    }
+
+    //------------------------------------------------------------------------------
+    static void mergeDomains( osgDB::Options& options )
+    {
+        // Called with the domain mutex locked
+        const std::string optionName( s_customDomainsOption );
+        std::string otherOptions;
+        std::string customDomains;
+
+        std::istringstream iss( options.getOptionString() );
+        std::string opt;
+        while( iss >> opt )
+        {
+            if( opt.compare( 0, optionName.size(), optionName ) == 0 )
+            {
+                customDomains = opt.substr( optionName.size() );
+            }
+            else
+            {
+                if( !otherOptions.empty() )
+                    otherOptions += " ";
+                otherOptions += opt;
+            }
+        }
+
+        for( DomainVersionMap::const_iterator itr = getDomainVersions().begin(); itr != getDomainVersions().end(); ++itr )
+        {
+            if( listsDomain( customDomains, itr->first ) )
+                continue;
+
+            std::stringstream entry;
+            entry << itr->first << ":" << itr->second;
+            if( !customDomains.empty() )
+                customDomains += ";";
+            customDomains += entry.str();
+        }
+
+        if( customDomains.empty() )
+            return;
+
+        if( !otherOptions.empty() )
+            otherOptions += " ";
+        options.setOptionString( otherOptions + optionName + customDomains );
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    void registerSerializerDomain( const std::string& domain, int version )
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( getDomainMutex() );
+        getDomainVersions()[domain] = version;
+
+        // Default options of osgDB::writeNodeFile() and osgDB::writeObjectFile()
+        osgDB::Registry* registry = osgDB::Registry::instance();
+        if( registry->getOptions() == NULL )
+            registry->setOptions( new osgDB::Options );
+
+        mergeDomains( *registry->getOptions() );
+    }
+
+    //------------------------------------------------------------------------------
+    void addSerializerDomains( osgDB::Options& options )
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( getDomainMutex() );
+        mergeDomains( options );
+    }
+
+    //------------------------------------------------------------------------------
+    int getSerializerDomainVersion( const std::string& domain )
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( getDomainMutex() );
+        DomainVersionMap::const_iterator itr = getDomainVersions().find( domain );
+        return (itr != getDomainVersions().end())? itr->second : 0;
+    }
+}
@@ -0,0 +1,239 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <list>
+#include <OpenThreads/Thread>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Condition>
+#include <OpenThreads/ScopedLock>
+#include <osgCompute/TaskGroup>
+
+namespace osgCompute
+{
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // TASK POOL ////////////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // Worker threads which are shared by all task groups. Threads are created on
+    // demand and kept alive until the program exits, so that frequent calls of
+    // TaskGroup::run() do not pay for the creation of threads.
+    class TaskPool
+    {
+    public:
+        TaskPool() : _done(false) {}
+        ~TaskPool();
+
+        void run( const TaskList& tasks, unsigned int numThreads );
+
+    private:
+        struct Job
+        {
+            const TaskList*     _tasks;
+            unsigned int        _nextTask;
+            unsigned int        _numFinished;
+            unsigned int        _numWorkers;
+            unsigned int        _maxWorkers;
+        };
+
+        class Worker : public OpenThreads::Thread
+        {
+        public:
+            Worker( TaskPool& pool ) : _pool(pool) {}
+            virtual void run() { _pool.work(); }
+
+        private:
+            TaskPool&           _pool;
+        };
+
+        void work();
+        void runTasks( Job& job );
+        Job* nextJob();
+
+        OpenThreads::Mutex      _mutex;
+        OpenThreads::Condition  _jobAvailable;
+        OpenThreads::Condition  _taskFinished;
+        std::list<Job*>         _jobs;
+        std::vector<Worker*>    _workers;
+        bool                    _done;
+    };
+
+    static TaskPool s_taskPool;
+
+    //------------------------------------------------------------------------------
+    TaskPool::~TaskPool()
+    {
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+            _done = true;
+            _jobAvailable.broadcast();
+        }
+
+        for( std::vector<Worker*>::iterator itr = _workers.begin(); itr != _workers.end(); ++itr )
+        {
+            (*itr)->join();
+            delete (*itr);
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    void TaskPool::run( const TaskList& tasks, unsigned int numThreads )
+    {
+        Job job;
+        job._tasks = &tasks;
+        job._nextTask = 0;
+        job._numFinished = 0;
+        job._numWorkers = 0;
+        // The calling thread is one of the workers
+        job._maxWorkers = numThreads - 1;
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        while( _workers.size() < job._maxWorkers )
+        {
+            Worker* worker = new Worker( *this );
+            if( worker->start() != 0 )
+            {
+                delete worker;
+                break;
+            }
+            _workers.push_back( worker );
+        }
+
+        _jobs.push_back( &job );
+        _jobAvailable.broadcast();
+
+        // The calling thread executes all tasks which have not been taken
+        // by a worker. So nested runs do not wait for each other.
+        runTasks( job );
+        while( job._numFinished < tasks.size() )
+            _taskFinished.wait( &_mutex );
+
+        _jobs.remove( &job );
+    }
+
+    //------------------------------------------------------------------------------
+    void TaskPool::work()
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        while( true )
+        {
+            Job* job = NULL;
+            while( !_done && (job = nextJob()) == NULL )
+                _jobAvailable.wait( &_mutex );
+
+            if( _done )
+                return;
+
+            job->_numWorkers++;
+            runTasks( *job );
+            job->_numWorkers--;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    void TaskPool::runTasks( Job& job )
+    {
+        // Called with the mutex locked. The job is removed by TaskPool::run()
+        // as soon as its last task has finished and the mutex is released.
+        const TaskList& tasks = *job._tasks;
+        while( job._nextTask < tasks.size() )
+        {
+            unsigned int taskIdx = job._nextTask++;
+
+            _mutex.unlock();
+            if( tasks[taskIdx].valid() )
+                tasks[taskIdx]->run();
+            _mutex.lock();
+
+            if( ++job._numFinished == tasks.size() )
+                _taskFinished.broadcast();
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    TaskPool::Job* TaskPool::nextJob()
+    {
+        for( std::list<Job*>::iterator itr = _jobs.begin(); itr != _jobs.end(); ++itr )
+        {
+            Job* job = (*itr);
+            if( job->_nextTask < job->_tasks->size() && job->_numWorkers < job->_maxWorkers )
+                return job;
+        }
+
+        return NULL;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    TaskGroup::TaskGroup()
+        : _numThreads(0)
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    TaskGroup::~TaskGroup()
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    void TaskGroup::addTask( Task* task )
+    {
+        if( task != NULL )
+            _tasks.push_back( task );
+    }
+
+    //------------------------------------------------------------------------------
+    const TaskList& TaskGroup::getTasks() const
+    {
+        return _tasks;
+    }
+
+    //------------------------------------------------------------------------------
+    void TaskGroup::clear()
+    {
+        _tasks.clear();
+    }
+
+    //------------------------------------------------------------------------------
+    void TaskGroup::setNumThreads( unsigned int numThreads )
+    {
+        _numThreads = numThreads;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int TaskGroup::getNumThreads() const
+    {
+        return _numThreads;
+    }
+
+    //------------------------------------------------------------------------------
+    void TaskGroup::run()
+    {
+        unsigned int numThreads = _numThreads;
+        if( numThreads == 0 )
+            numThreads = static_cast<unsigned int>( OpenThreads::GetNumberOfProcessors() );
+        if( numThreads > _tasks.size() )
+            numThreads = static_cast<unsigned int>( _tasks.size() );
+
+        if( numThreads <= 1 )
+        {
+            for( TaskListItr itr = _tasks.begin(); itr != _tasks.end(); ++itr )
+                (*itr)->run();
+            return;
+        }
+
+        s_taskPool.run( _tasks, numThreads );
+    }
+}
@@ -1,3 +1,8 @@
+#include <algorithm>
+#include <map>
+#include <set>
+#include <osg/Math>
+#include <osg/Notify>
 #include <osg/Node>
 #include <osg/Geode>
 #include <osg/Group>
@@ -241,4 +246,465 @@ namespace osgCompute
     {
         _collectedResources.clear();
     }
-} 
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // COMPUTE ORDER VISITOR ////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // Computations of the update traversal are launched first,
+    // followed by pre render and post render computations
+    enum ComputePhase
+    {
+        PHASE_UPDATE        = 0,
+        PHASE_PRERENDER     = 1,
+        PHASE_POSTRENDER    = 2,
+    };
+
+    typedef std::vector< std::set<unsigned int> >   DependencyGraph;
+
+    //------------------------------------------------------------------------------
+    static unsigned int getComputePhase( const Computation& computation )
+    {
+        if( (computation.getComputeOrder() & OSGCOMPUTE_UPDATE) == OSGCOMPUTE_UPDATE )
+            return PHASE_UPDATE;
+        if( (computation.getComputeOrder() & OSGCOMPUTE_POSTRENDER) == OSGCOMPUTE_POSTRENDER )
+            return PHASE_POSTRENDER;
+
+        return PHASE_PRERENDER;
+    }
+
+    //------------------------------------------------------------------------------
+    static std::string getLabel( const osg::Object& object )
+    {
+        if( !object.getName().empty() )
+            return object.getName();
+
+        const Resource* resource = dynamic_cast<const Resource*>( &object );
+        if( resource != NULL && !resource->getIdentifiers().empty() )
+            return *resource->getIdentifiers().begin();
+
+        return object.className();
+    }
+
+    //------------------------------------------------------------------------------
+    static bool dependsOn( const DependencyGraph& successors, unsigned int from, unsigned int to )
+    {
+        std::vector<bool> visited( successors.size(), false );
+        std::vector<unsigned int> stack( 1, from );
+        visited[from] = true;
+        while( !stack.empty() )
+        {
+            unsigned int cur = stack.back();
+            stack.pop_back();
+            if( cur == to )
+                return true;
+
+            for( std::set<unsigned int>::const_iterator itr = successors[cur].begin(); itr != successors[cur].end(); ++itr )
+            {
+                if( !visited[*itr] )
+                {
+                    visited[*itr] = true;
+                    stack.push_back( *itr );
+                }
+            }
+        }
+
+        return false;
+    }
+
+    //------------------------------------------------------------------------------
+    static void findComponents( const DependencyGraph& successors, unsigned int node, int& counter,
+        std::vector<int>& index, std::vector<int>& lowLink, std::vector<unsigned int>& stack,
+        std::vector<bool>& onStack, std::vector<int>& component, int& numComponents )
+    {
+        // Tarjan's algorithm
+        index[node] = lowLink[node] = counter++;
+        stack.push_back( node );
+        onStack[node] = true;
+
+        for( std::set<unsigned int>::const_iterator itr = successors[node].begin(); itr != successors[node].end(); ++itr )
+        {
+            if( index[*itr] < 0 )
+            {
+                findComponents( successors, *itr, counter, index, lowLink, stack, onStack, component, numComponents );
+                lowLink[node] = osg::minimum( lowLink[node], lowLink[*itr] );
+            }
+            else if( onStack[*itr] )
+            {
+                lowLink[node] = osg::minimum( lowLink[node], index[*itr] );
+            }
+        }
+
+        if( lowLink[node] == index[node] )
+        {
+            unsigned int member;
+            do
+            {
+                member = stack.back();
+                stack.pop_back();
+                onStack[member] = false;
+                component[member] = numComponents;
+            }
+            while( member != node );
+
+            numComponents++;
+        }
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    ComputeOrderVisitor::ComputeOrderVisitor()
+        : osg::NodeVisitor(osg::NodeVisitor::NODE_VISITOR,osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
+    {
+        _launchCounter = 0;
+        _traversing = false;
+        _reorder = true;
+    }
+
+    //------------------------------------------------------------------------------
+    void ComputeOrderVisitor::apply( osg::Node& node )
+    {
+        bool root = !_traversing;
+        if( root )
+        {
+            reset();
+            _traversing = true;
+        }
+
+        Computation* computation = dynamic_cast<Computation*>( &node );
+        unsigned int entryIdx = static_cast<unsigned int>( _entries.size() );
+        bool added = (computation != NULL) && addComputation( *computation );
+
+        osg::NodeVisitor::traverse( node );
+
+        // Programs of UPDATE_AFTERCHILDREN are launched after the subgraph
+        if( added && (computation->getComputeOrder() & Computation::UPDATE_AFTERCHILDREN) == Computation::UPDATE_AFTERCHILDREN )
+            _entries[entryIdx]._launchIdx = _launchCounter++;
+
+        if( root )
+        {
+            _traversing = false;
+            order();
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    void ComputeOrderVisitor::setReorder( bool reorder )
+    {
+        _reorder = reorder;
+    }
+
+    //------------------------------------------------------------------------------
+    bool ComputeOrderVisitor::getReorder() const
+    {
+        return _reorder;
+    }
+
+    //------------------------------------------------------------------------------
+    const std::vector< osg::ref_ptr<Computation> >& ComputeOrderVisitor::getOrderedComputations() const
+    {
+        return _ordered;
+    }
+
+    //------------------------------------------------------------------------------
+    const ComputeOrderConflictList& ComputeOrderVisitor::getConflicts() const
+    {
+        return _conflicts;
+    }
+
+    //------------------------------------------------------------------------------
+    void ComputeOrderVisitor::reset()
+    {
+        _entries.clear();
+        _ordered.clear();
+        _conflicts.clear();
+        _launchCounter = 0;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PROTECTED FUNCTIONS //////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    bool ComputeOrderVisitor::addComputation( Computation& computation )
+    {
+        if( !computation.isEnabled() )
+            return false;
+
+        // Computations with multiple parents are ordered once
+        for( std::vector<ComputationEntry>::iterator itr = _entries.begin(); itr != _entries.end(); ++itr )
+            if( (*itr)._computation == &computation )
+                return false;
+
+        ComputationEntry entry;
+        entry._computation = &computation;
+        entry._phase = getComputePhase( computation );
+        entry._launchIdx = _launchCounter++;
+        _entries.push_back( entry );
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    void ComputeOrderVisitor::order()
+    {
+        unsigned int numEntries = static_cast<unsigned int>( _entries.size() );
+
+        ///////////////////
+        // RESOURCE USES //
+        ///////////////////
+        typedef std::map< Resource*, std::vector< std::pair<unsigned int,unsigned int> > > ResourceUseMap;
+        ResourceUseMap uses;
+        for( unsigned int e=0; e<numEntries; ++e )
+        {
+            const ResourceHandleList& resources = _entries[e]._computation->getResources();
+            for( ResourceHandleListCnstItr itr = resources.begin(); itr != resources.end(); ++itr )
+            {
+                if( !(*itr)._resource.valid() )
+                    continue;
+
+                unsigned int access = _entries[e]._computation->getResourceAccess( *(*itr)._resource );
+                if( access != ACCESS_NONE )
+                    uses[(*itr)._resource.get()].push_back( std::make_pair( e, access ) );
+            }
+        }
+
+        //////////////////
+        // DEPENDENCIES //
+        //////////////////
+        // Edges from producers to consumers. Only edges within the same render
+        // phase can be sorted. All other edges are fixed by the launch order.
+        DependencyGraph successors( numEntries );
+        DependencyGraph sortable( numEntries );
+        std::vector<unsigned int> numSortablePredecessors( numEntries, 0 );
+        for( ResourceUseMap::iterator itr = uses.begin(); itr != uses.end(); ++itr )
+        {
+            std::vector< std::pair<unsigned int,unsigned int> >& users = itr->second;
+            for( unsigned int p=0; p<users.size(); ++p )
+            {
+                if( !(users[p].second & ACCESS_WRITE) )
+                    continue;
+
+                for( unsigned int c=0; c<users.size(); ++c )
+                {
+                    if( c == p || (users[c].second & ACCESS_WRITE) )
+                        continue;
+
+                    const ComputationEntry& producer = _entries[users[p].first];
+                    const ComputationEntry& consumer = _entries[users[c].first];
+                    if( producer._phase == consumer._phase && producer._phase != PHASE_UPDATE )
+                    {
+                        if( sortable[users[p].first].insert( users[c].first ).second )
+                            numSortablePredecessors[users[c].first]++;
+                    }
+                    else if( consumer._phase < producer._phase ||
+                        (consumer._phase == PHASE_UPDATE && consumer._launchIdx < producer._launchIdx) )
+                    {
+                        std::vector<unsigned int> conflicting;
+                        conflicting.push_back( users[p].first );
+                        conflicting.push_back( users[c].first );
+                        addConflict( ComputeOrderConflict::LATE_CONSUMER, conflicting, itr->first );
+                        continue;
+                    }
+
+                    successors[users[p].first].insert( users[c].first );
+                }
+            }
+        }
+
+        //////////
+        // SORT //
+        //////////
+        // Update computations are launched in the order of the traversal
+        std::vector< std::pair<unsigned int,unsigned int> > updateOrder;
+        for( unsigned int e=0; e<numEntries; ++e )
+            if( _entries[e]._phase == PHASE_UPDATE )
+                updateOrder.push_back( std::make_pair( _entries[e]._launchIdx, e ) );
+
+        std::sort( updateOrder.begin(), updateOrder.end() );
+        for( unsigned int u=0; u<updateOrder.size(); ++u )
+            _ordered.push_back( _entries[updateOrder[u].second]._computation );
+
+        // Cycles are strongly connected components. Each one is reported and broken
+        // by removing its edges which point against the order of its members.
+        std::vector< std::pair<int,unsigned int> > keys( numEntries );
+        for( unsigned int e=0; e<numEntries; ++e )
+            keys[e] = std::make_pair( _entries[e]._computation->getComputeOrderNum(), _entries[e]._launchIdx );
+
+        std::vector<int> component( numEntries, -1 );
+        std::vector<int> index( numEntries, -1 );
+        std::vector<int> lowLink( numEntries, 0 );
+        std::vector<bool> onStack( numEntries, false );
+        std::vector<unsigned int> stack;
+        int counter = 0;
+        int numComponents = 0;
+        for( unsigned int e=0; e<numEntries; ++e )
+            if( index[e] < 0 )
+                findComponents( sortable, e, counter, index, lowLink, stack, onStack, component, numComponents );
+
+        std::vector<unsigned int> firstMember( numComponents, numEntries );
+        std::vector<unsigned int> numMembers( numComponents, 0 );
+        for( unsigned int e=0; e<numEntries; ++e )
+        {
+            unsigned int& first = firstMember[component[e]];
+            if( first == numEntries || keys[e] < keys[first] )
+                first = e;
+            numMembers[component[e]]++;
+        }
+
+        for( int c=0; c<numComponents; ++c )
+        {
+            if( numMembers[c] < 2 )
+                continue;
+
+            // Follow dependencies within the component until a member repeats
+            std::vector<unsigned int> path;
+            std::vector<int> pathPos( numEntries, -1 );
+            unsigned int cur = firstMember[c];
+            while( pathPos[cur] < 0 )
+            {
+                pathPos[cur] = static_cast<int>( path.size() );
+                path.push_back( cur );
+                for( std::set<unsigned int>::iterator itr = sortable[cur].begin(); itr != sortable[cur].end(); ++itr )
+                {
+                    if( component[*itr] == c )
+                    {
+                        cur = *itr;
+                        break;
+                    }
+                }
+            }
+
+            std::vector<unsigned int> cycle( path.begin() + pathPos[cur], path.end() );
+            addConflict( ComputeOrderConflict::CYCLE, cycle, NULL );
+        }
+
+        for( unsigned int e=0; e<numEntries; ++e )
+        {
+            std::set<unsigned int>::iterator itr = sortable[e].begin();
+            while( itr != sortable[e].end() )
+            {
+                if( component[*itr] == component[e] && keys[*itr] < keys[e] )
+                {
+                    numSortablePredecessors[*itr]--;
+                    sortable[e].erase( itr++ );
+                }
+                else
+                {
+                    ++itr;
+                }
+            }
+        }
+
+        // Render computations are sorted topologically. Independent computations
+        // keep their order number and traversal order.
+        typedef std::set< std::pair< std::pair<int,unsigned int>, unsigned int > > ReadyQueue;
+        for( unsigned int phase = PHASE_PRERENDER; phase <= PHASE_POSTRENDER; ++phase )
+        {
+            ReadyQueue ready;
+            std::vector<unsigned int> members;
+            for( unsigned int e=0; e<numEntries; ++e )
+            {
+                if( _entries[e]._phase != phase )
+                    continue;
+
+                members.push_back( e );
+                if( numSortablePredecessors[e] == 0 )
+                    ready.insert( std::make_pair( keys[e], e ) );
+            }
+
+            std::vector<unsigned int> phaseOrder;
+            while( !ready.empty() )
+            {
+                unsigned int next = ready.begin()->second;
+                ready.erase( ready.begin() );
+                phaseOrder.push_back( next );
+
+                for( std::set<unsigned int>::iterator itr = sortable[next].begin(); itr != sortable[next].end(); ++itr )
+                    if( --numSortablePredecessors[*itr] == 0 )
+                        ready.insert( std::make_pair( keys[*itr], *itr ) );
+            }
+
+            // Assign increasing order numbers. Each computation keeps its own order
+            // number unless it has to be raised above its predecessor in the phase.
+            int orderNum = 0;
+            for( unsigned int o=0; o<phaseOrder.size(); ++o )
+            {
+                Computation* computation = _entries[phaseOrder[o]]._computation.get();
+                orderNum = (o == 0)? computation->getComputeOrderNum() 
+                                   : osg::maximum( computation->getComputeOrderNum(), orderNum + 1 );
+
+                if( _reorder && computation->getComputeOrderNum() != orderNum )
+                    computation->setComputeOrder( computation->getComputeOrder(), orderNum );
+
+                _ordered.push_back( computation );
+            }
+
+            // Include sorted edges for the race detection
+            for( unsigned int m=0; m<members.size(); ++m )
+                successors[members[m]].insert( sortable[members[m]].begin(), sortable[members[m]].end() );
+        }
+
+        ///////////
+        // RACES //
+        ///////////
+        for( ResourceUseMap::iterator itr = uses.begin(); itr != uses.end(); ++itr )
+        {
+            std::vector< std::pair<unsigned int,unsigned int> >& users = itr->second;
+            for( unsigned int a=0; a<users.size(); ++a )
+            {
+                for( unsigned int b=a+1; b<users.size(); ++b )
+                {
+                    unsigned int first = users[a].first;
+                    unsigned int second = users[b].first;
+                    if( !(users[a].second & ACCESS_WRITE) || !(users[b].second & ACCESS_WRITE) ||
+                        _entries[first]._phase != _entries[second]._phase )
+                        continue;
+
+                    if( dependsOn( successors, first, second ) || dependsOn( successors, second, first ) )
+                        continue;
+
+                    std::vector<unsigned int> conflicting;
+                    conflicting.push_back( first );
+                    conflicting.push_back( second );
+                    addConflict( ComputeOrderConflict::RACE, conflicting, itr->first );
+                }
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    void ComputeOrderVisitor::addConflict( ComputeOrderConflict::Type type, const std::vector<unsigned int>& entries, Resource* resource )
+    {
+        ComputeOrderConflict conflict;
+        conflict._type = type;
+        conflict._resource = resource;
+        for( unsigned int e=0; e<entries.size(); ++e )
+            conflict._computations.push_back( _entries[entries[e]]._computation );
+        _conflicts.push_back( conflict );
+
+        osg::notify(osg::WARN) << "osgCompute::ComputeOrderVisitor: ";
+        switch( type )
+        {
+        case ComputeOrderConflict::CYCLE:
+            osg::notify(osg::WARN) << "computations ";
+            for( unsigned int c=0; c<conflict._computations.size(); ++c )
+                osg::notify(osg::WARN) << "\"" << getLabel( *conflict._computations[c] ) << "\" -> ";
+            osg::notify(osg::WARN) << "\"" << getLabel( *conflict._computations.front() ) << "\" depend on each other in a cycle.";
+            break;
+        case ComputeOrderConflict::RACE:
+            osg::notify(osg::WARN) 
+                << "computations \"" << getLabel( *conflict._computations[0] ) 
+                << "\" and \"" << getLabel( *conflict._computations[1] ) 
+                << "\" write \"" << getLabel( *resource ) << "\" in an undefined order.";
+            break;
+        case ComputeOrderConflict::LATE_CONSUMER:
+            osg::notify(osg::WARN) 
+                << "computation \"" << getLabel( *conflict._computations[1] ) 
+                << "\" reads \"" << getLabel( *resource ) 
+                << "\" before \"" << getLabel( *conflict._computations[0] ) 
+                << "\" writes it. It reads the contents of the previous frame.";
+            break;
+        }
+        osg::notify(osg::WARN) << std::endl;
+    }
+}
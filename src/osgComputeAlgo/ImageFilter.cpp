@@ -0,0 +1,609 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <cmath>
+#include <cstring>
+#include <osg/Math>
+#include <osg/Notify>
+#include <osgComputeAlgo/ImageFilter>
+#include "Parallel.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define OSGCOMPUTEALGO_SSE2 1
+#endif
+
+// Row kernels are compiled for AVX2 in addition to the baseline instruction
+// set where the toolchain supports function multiversioning
+#if defined(__GNUC__) && !defined(__clang__) && defined(__linux__) && defined(__x86_64__)
+#   define OSGCOMPUTEALGO_ROW_KERNEL __attribute__((noinline, target_clones("avx2","default")))
+#else
+#   define OSGCOMPUTEALGO_ROW_KERNEL
+#endif
+
+namespace osgComputeAlgo
+{
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // ROW KERNELS //////////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // Floats of a row which are combined in registers before they are stored
+    static const unsigned int ROW_BLOCK = 16;
+
+    //------------------------------------------------------------------------------
+    // out[i] = sum of weights[k] * rows[k][i]
+    OSGCOMPUTEALGO_ROW_KERNEL
+    static void convolveRows( const float* const* rows, const float* weights, unsigned int numRows, float* out, unsigned int size )
+    {
+        unsigned int b = 0;
+        for( ; b+ROW_BLOCK<=size; b+=ROW_BLOCK )
+        {
+            float acc[ROW_BLOCK];
+            for( unsigned int i=0; i<ROW_BLOCK; ++i )
+                acc[i] = weights[0] * rows[0][b+i];
+            for( unsigned int k=1; k<numRows; ++k )
+                for( unsigned int i=0; i<ROW_BLOCK; ++i )
+                    acc[i] += weights[k] * rows[k][b+i];
+            for( unsigned int i=0; i<ROW_BLOCK; ++i )
+                out[b+i] = acc[i];
+        }
+
+        for( ; b<size; ++b )
+        {
+            float acc = weights[0] * rows[0][b];
+            for( unsigned int k=1; k<numRows; ++k )
+                acc += weights[k] * rows[k][b];
+            out[b] = acc;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // out[i] = minimum or maximum of rows[k][i]. Comparisons are cheap, so
+    // whole rows are combined one after another.
+    template<bool Dilate>
+    static inline void combineRows( const float* const* rows, unsigned int numRows, float* out, unsigned int size )
+    {
+        memcpy( out, rows[0], size * sizeof(float) );
+        for( unsigned int k=1; k<numRows; ++k )
+        {
+            const float* in = rows[k];
+            if( Dilate )
+            {
+                for( unsigned int i=0; i<size; ++i )
+                    out[i] = (out[i] < in[i])? in[i] : out[i];
+            }
+            else
+            {
+                for( unsigned int i=0; i<size; ++i )
+                    out[i] = (in[i] < out[i])? in[i] : out[i];
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    OSGCOMPUTEALGO_ROW_KERNEL
+    static void erodeRows( const float* const* rows, unsigned int numRows, float* out, unsigned int size )
+    {
+        combineRows<false>( rows, numRows, out, size );
+    }
+
+    //------------------------------------------------------------------------------
+    OSGCOMPUTEALGO_ROW_KERNEL
+    static void dilateRows( const float* const* rows, unsigned int numRows, float* out, unsigned int size )
+    {
+        combineRows<true>( rows, numRows, out, size );
+    }
+
+    //------------------------------------------------------------------------------
+    // Squared gradient magnitude of the 3x3 Sobel operator. Pixels are 4
+    // floats apart, so the neighbours of in[i] are in[i-4] and in[i+4].
+    OSGCOMPUTEALGO_ROW_KERNEL
+    static void sobelRow( const float* up, const float* mid, const float* down, float* out, int size )
+    {
+        for( int i=0; i<size; ++i )
+        {
+            float gx = (up[i+4] + 2.0f*mid[i+4] + down[i+4]) - (up[i-4] + 2.0f*mid[i-4] + down[i-4]);
+            float gy = (down[i-4] + 2.0f*down[i] + down[i+4]) - (up[i-4] + 2.0f*up[i] + up[i+4]);
+            out[i] = gx*gx + gy*gy;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // sqrtf() is not vectorized by compilers which keep errno semantics
+    static void sqrtRow( float* values, unsigned int size )
+    {
+        unsigned int i = 0;
+#ifdef OSGCOMPUTEALGO_SSE2
+        for( ; i+4<=size; i+=4 )
+            _mm_storeu_ps( &values[i], _mm_sqrt_ps( _mm_loadu_ps( &values[i] ) ) );
+#endif
+        for( ; i<size; ++i )
+            values[i] = sqrtf( values[i] );
+    }
+
+    //------------------------------------------------------------------------------
+    OSGCOMPUTEALGO_ROW_KERNEL
+    static void bytesToFloats( const unsigned char* in, float* out, unsigned int size )
+    {
+        for( unsigned int i=0; i<size; ++i )
+            out[i] = static_cast<float>( static_cast<int>( in[i] ) ) * (1.0f / 255.0f);
+    }
+
+    //------------------------------------------------------------------------------
+    // Compilers do not vectorize the saturating conversion to bytes
+    static void floatsToBytes( const float* in, unsigned char* out, unsigned int size )
+    {
+        unsigned int i = 0;
+#ifdef OSGCOMPUTEALGO_SSE2
+        const __m128 scale = _mm_set1_ps( 255.0f );
+        const __m128 half = _mm_set1_ps( 0.5f );
+        for( ; i+16<=size; i+=16 )
+        {
+            // Packing saturates values outside of [0,255]
+            __m128i a = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( &in[i] ), scale ), half ) );
+            __m128i b = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( &in[i+4] ), scale ), half ) );
+            __m128i c = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( &in[i+8] ), scale ), half ) );
+            __m128i d = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( &in[i+12] ), scale ), half ) );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( &out[i] ), _mm_packus_epi16( _mm_packs_epi32( a, b ), _mm_packs_epi32( c, d ) ) );
+        }
+#endif
+        for( ; i<size; ++i )
+            out[i] = static_cast<unsigned char>( osg::clampBetween( in[i], 0.0f, 1.0f ) * 255.0f + 0.5f );
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // FILTERS //////////////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    SeparableFilter::SeparableFilter( const std::vector<float>& kernelX, const std::vector<float>& kernelY )
+        : _kernelX(kernelX), _kernelY(kernelY)
+    {
+        if( (_kernelX.size() % 2) == 0 || (_kernelY.size() % 2) == 0 )
+        {
+            osg::notify(osg::WARN)
+                << "osgComputeAlgo::SeparableFilter::SeparableFilter(): kernels must have an odd size."
+                << std::endl;
+
+            if( (_kernelX.size() % 2) == 0 ) _kernelX.push_back( 0.0f );
+            if( (_kernelY.size() % 2) == 0 ) _kernelY.push_back( 0.0f );
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int SeparableFilter::getRadiusX() const
+    {
+        return static_cast<unsigned int>( _kernelX.size() / 2 );
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int SeparableFilter::getRadiusY() const
+    {
+        return static_cast<unsigned int>( _kernelY.size() / 2 );
+    }
+
+    //------------------------------------------------------------------------------
+    void SeparableFilter::apply( const ImageRegion& src, ImageRegion& dst, std::vector<float>& scratch ) const
+    {
+        int radiusX = static_cast<int>( getRadiusX() );
+        int radiusY = static_cast<int>( getRadiusY() );
+        unsigned int rowSize = dst._width * 4;
+        scratch.resize( static_cast<size_t>( rowSize ) * src._height );
+
+        std::vector<const float*> rows( osg::maximum( _kernelX.size(), _kernelY.size() ) );
+
+        // Horizontal pass over all rows of the source. Consecutive floats
+        // are independent, so the row kernels vectorize across the row.
+        for( unsigned int r=0; r<src._height; ++r )
+        {
+            int y = src._y + static_cast<int>( r );
+            for( int k=0; k<=2*radiusX; ++k )
+                rows[k] = src.pixel( dst._x + k - radiusX, y );
+            convolveRows( &rows.front(), &_kernelX.front(), 2*radiusX+1, &scratch[ static_cast<size_t>( r ) * rowSize ], rowSize );
+        }
+
+        // Vertical pass
+        for( unsigned int r=0; r<dst._height; ++r )
+        {
+            int y = dst._y + static_cast<int>( r );
+            for( int k=0; k<=2*radiusY; ++k )
+                rows[k] = &scratch[ static_cast<size_t>( y + k - radiusY - src._y ) * rowSize ];
+            convolveRows( &rows.front(), &_kernelY.front(), 2*radiusY+1, dst.row( y ), rowSize );
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    BoxBlurFilter::BoxBlurFilter( unsigned int radiusX, unsigned int radiusY )
+        : SeparableFilter()
+    {
+        _kernelX.assign( 2*radiusX+1, 1.0f / static_cast<float>( 2*radiusX+1 ) );
+        _kernelY.assign( 2*radiusY+1, 1.0f / static_cast<float>( 2*radiusY+1 ) );
+    }
+
+    //------------------------------------------------------------------------------
+    GaussianBlurFilter::GaussianBlurFilter( float sigma )
+        : SeparableFilter()
+    {
+        int radius = (sigma > 0.0f)? static_cast<int>( ceilf( 3.0f * sigma ) ) : 0;
+
+        float sum = 0.0f;
+        _kernelX.resize( 2*radius+1 );
+        for( int k=-radius; k<=radius; ++k )
+        {
+            _kernelX[k+radius] = (radius == 0)? 1.0f : expf( -0.5f * static_cast<float>( k*k ) / (sigma*sigma) );
+            sum += _kernelX[k+radius];
+        }
+        for( unsigned int k=0; k<_kernelX.size(); ++k )
+            _kernelX[k] /= sum;
+
+        _kernelY = _kernelX;
+    }
+
+    //------------------------------------------------------------------------------
+    void SobelFilter::apply( const ImageRegion& src, ImageRegion& dst, std::vector<float>& ) const
+    {
+        unsigned int rowSize = dst._width * 4;
+        for( unsigned int r=0; r<dst._height; ++r )
+        {
+            int y = dst._y + static_cast<int>( r );
+            const float* up = src.pixel( dst._x, y-1 );
+            const float* mid = src.pixel( dst._x, y );
+            const float* down = src.pixel( dst._x, y+1 );
+            float* out = dst.row( y );
+            sobelRow( up, mid, down, out, static_cast<int>( rowSize ) );
+            sqrtRow( out, rowSize );
+
+            for( unsigned int i=3; i<rowSize; i+=4 )
+                out[i] = mid[i];
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    MorphologyFilter::MorphologyFilter( Operation operation, unsigned int radiusX, unsigned int radiusY )
+        : _operation(operation), _radiusX(radiusX), _radiusY(radiusY)
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    void MorphologyFilter::apply( const ImageRegion& src, ImageRegion& dst, std::vector<float>& scratch ) const
+    {
+        int radiusX = static_cast<int>( _radiusX );
+        int radiusY = static_cast<int>( _radiusY );
+        unsigned int rowSize = dst._width * 4;
+        scratch.resize( static_cast<size_t>( rowSize ) * src._height );
+        std::vector<const float*> rows( 2*osg::maximum( _radiusX, _radiusY )+1 );
+
+        for( unsigned int r=0; r<src._height; ++r )
+        {
+            int y = src._y + static_cast<int>( r );
+            for( int k=0; k<=2*radiusX; ++k )
+                rows[k] = src.pixel( dst._x + k - radiusX, y );
+
+            float* tmp = &scratch[ static_cast<size_t>( r ) * rowSize ];
+            if( _operation == DILATE )
+                dilateRows( &rows.front(), 2*radiusX+1, tmp, rowSize );
+            else
+                erodeRows( &rows.front(), 2*radiusX+1, tmp, rowSize );
+        }
+
+        for( unsigned int r=0; r<dst._height; ++r )
+        {
+            int y = dst._y + static_cast<int>( r );
+            for( int k=0; k<=2*radiusY; ++k )
+                rows[k] = &scratch[ static_cast<size_t>( y + k - radiusY - src._y ) * rowSize ];
+
+            if( _operation == DILATE )
+                dilateRows( &rows.front(), 2*radiusY+1, dst.row( y ), rowSize );
+            else
+                erodeRows( &rows.front(), 2*radiusY+1, dst.row( y ), rowSize );
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    ChannelSwizzleFilter::ChannelSwizzleFilter( unsigned int r, unsigned int g, unsigned int b, unsigned int a )
+    {
+        _source[0] = osg::minimum( r, 3u );
+        _source[1] = osg::minimum( g, 3u );
+        _source[2] = osg::minimum( b, 3u );
+        _source[3] = osg::minimum( a, 3u );
+    }
+
+    //------------------------------------------------------------------------------
+    void ChannelSwizzleFilter::apply( const ImageRegion& src, ImageRegion& dst, std::vector<float>& ) const
+    {
+        for( unsigned int r=0; r<dst._height; ++r )
+        {
+            int y = dst._y + static_cast<int>( r );
+            const float* in = src.pixel( dst._x, y );
+            float* out = dst.row( y );
+            for( unsigned int x=0; x<dst._width; ++x, in+=4, out+=4 )
+            {
+                out[0] = in[_source[0]];
+                out[1] = in[_source[1]];
+                out[2] = in[_source[2]];
+                out[3] = in[_source[3]];
+            }
+        }
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // TILES ////////////////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    static inline int clampCoord( int value, int size )
+    {
+        return (value < 0)? 0 : ((value >= size)? size-1 : value);
+    }
+
+    //------------------------------------------------------------------------------
+    // Converts the pixels of the image covered by the region into floats.
+    // Pixels outside of the image repeat the closest pixel of the image.
+    static void loadRegion( const char* image, unsigned int elementSize, int width, int height, ImageRegion& region )
+    {
+        int x0 = osg::maximum( region._x, 0 );
+        int x1 = osg::minimum( region._x + static_cast<int>( region._width ), width );
+        for( unsigned int r=0; r<region._height; ++r )
+        {
+            int y = region._y + static_cast<int>( r );
+            int sy = clampCoord( y, height );
+            float* out = region.pixel( x0, y );
+            unsigned int numFloats = static_cast<unsigned int>( x1 - x0 ) * 4;
+            if( elementSize == 4 )
+            {
+                const unsigned char* in = reinterpret_cast<const unsigned char*>( image ) + (static_cast<size_t>( sy ) * width + x0) * 4;
+                bytesToFloats( in, out, numFloats );
+            }
+            else
+            {
+                const float* in = reinterpret_cast<const float*>( image ) + (static_cast<size_t>( sy ) * width + x0) * 4;
+                memcpy( out, in, numFloats * sizeof(float) );
+            }
+
+            for( int x=region._x; x<x0; ++x )
+                memcpy( region.pixel( x, y ), region.pixel( x0, y ), 4 * sizeof(float) );
+            for( int x=x1; x<region._x + static_cast<int>( region._width ); ++x )
+                memcpy( region.pixel( x, y ), region.pixel( x1-1, y ), 4 * sizeof(float) );
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Restores the repeated border pixels after a filter has been applied
+    // so that the next filter sees the same border as on the whole image.
+    static void clampRegion( int width, int height, ImageRegion& region )
+    {
+        int rx0 = region._x, rx1 = region._x + static_cast<int>( region._width );
+        int ry0 = region._y, ry1 = region._y + static_cast<int>( region._height );
+        if( rx0 >= 0 && ry0 >= 0 && rx1 <= width && ry1 <= height )
+            return;
+
+        int x0 = osg::maximum( rx0, 0 ), x1 = osg::minimum( rx1, width );
+        int y0 = osg::maximum( ry0, 0 ), y1 = osg::minimum( ry1, height );
+        for( int y=y0; y<y1; ++y )
+        {
+            for( int x=rx0; x<x0; ++x )
+                memcpy( region.pixel( x, y ), region.pixel( x0, y ), 4 * sizeof(float) );
+            for( int x=x1; x<rx1; ++x )
+                memcpy( region.pixel( x, y ), region.pixel( x1-1, y ), 4 * sizeof(float) );
+        }
+
+        size_t rowBytes = static_cast<size_t>( region._width ) * 4 * sizeof(float);
+        for( int y=ry0; y<y0; ++y )
+            memcpy( region.row( y ), region.row( y0 ), rowBytes );
+        for( int y=y1; y<ry1; ++y )
+            memcpy( region.row( y ), region.row( y1-1 ), rowBytes );
+    }
+
+    //------------------------------------------------------------------------------
+    static void storeRegion( const ImageRegion& region, unsigned int elementSize, int width, char* image )
+    {
+        for( unsigned int r=0; r<region._height; ++r )
+        {
+            int y = region._y + static_cast<int>( r );
+            const float* in = region.row( y );
+            unsigned int numFloats = region._width * 4;
+            if( elementSize == 4 )
+            {
+                unsigned char* out = reinterpret_cast<unsigned char*>( image ) + (static_cast<size_t>( y ) * width + region._x) * 4;
+                floatsToBytes( in, out, numFloats );
+            }
+            else
+            {
+                float* out = reinterpret_cast<float*>( image ) + (static_cast<size_t>( y ) * width + region._x) * 4;
+                memcpy( out, in, numFloats * sizeof(float) );
+            }
+        }
+    }
+
+    // Filters all tiles of a row of tiles
+    class FilterStripBody
+    {
+    public:
+        FilterStripBody( const ImageFilterList& filters, const std::vector<int>& extX, const std::vector<int>& extY,
+                         int tileWidth, int tileHeight, int width, int height,
+                         const char* input, unsigned int inputSize, char* output, unsigned int outputSize )
+            : _filters(filters), _extX(extX), _extY(extY), _tileWidth(tileWidth), _tileHeight(tileHeight),
+              _width(width), _height(height), _input(input), _inputSize(inputSize), _output(output), _outputSize(outputSize) {}
+
+        void operator()( unsigned int strip ) const
+        {
+            size_t maxRegionSize = static_cast<size_t>( _tileWidth + 2*_extX[0] ) * (_tileHeight + 2*_extY[0]) * 4;
+            std::vector<float> front( maxRegionSize ), back( maxRegionSize ), scratch;
+
+            int ty = static_cast<int>( strip ) * _tileHeight;
+            int th = osg::minimum( _tileHeight, _height - ty );
+            for( int tx=0; tx<_width; tx+=_tileWidth )
+            {
+                int tw = osg::minimum( _tileWidth, _width - tx );
+
+                ImageRegion src = makeRegion( tx, ty, tw, th, 0, &front.front() );
+                loadRegion( _input, _inputSize, _width, _height, src );
+
+                for( unsigned int f=0; f<_filters.size(); ++f )
+                {
+                    ImageRegion dst = makeRegion( tx, ty, tw, th, f+1, (src._data == &front.front())? &back.front() : &front.front() );
+                    _filters[f]->apply( src, dst, scratch );
+                    clampRegion( _width, _height, dst );
+                    src = dst;
+                }
+
+                storeRegion( src, _outputSize, _width, _output );
+            }
+        }
+
+    private:
+        ImageRegion makeRegion( int tx, int ty, int tw, int th, unsigned int stage, float* data ) const
+        {
+            ImageRegion region;
+            region._x = tx - _extX[stage];
+            region._y = ty - _extY[stage];
+            region._width = static_cast<unsigned int>( tw + 2*_extX[stage] );
+            region._height = static_cast<unsigned int>( th + 2*_extY[stage] );
+            region._data = data;
+            return region;
+        }
+
+        const ImageFilterList&  _filters;
+        const std::vector<int>& _extX;
+        const std::vector<int>& _extY;
+        int                     _tileWidth;
+        int                     _tileHeight;
+        int                     _width;
+        int                     _height;
+        const char*             _input;
+        unsigned int            _inputSize;
+        char*                   _output;
+        unsigned int            _outputSize;
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // FILTER CHAIN /////////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    FilterChain::FilterChain()
+        : osg::Referenced(),
+          _tileWidth(256),
+          _tileHeight(32)
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    void FilterChain::addFilter( ImageFilter* filter )
+    {
+        if( filter != NULL )
+            _filters.push_back( filter );
+    }
+
+    //------------------------------------------------------------------------------
+    void FilterChain::removeFilter( ImageFilter* filter )
+    {
+        for( ImageFilterList::iterator itr = _filters.begin(); itr != _filters.end(); ++itr )
+        {
+            if( (*itr) == filter )
+            {
+                _filters.erase( itr );
+                return;
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    void FilterChain::removeFilters()
+    {
+        _filters.clear();
+    }
+
+    //------------------------------------------------------------------------------
+    ImageFilterList& FilterChain::getFilters()
+    {
+        return _filters;
+    }
+
+    //------------------------------------------------------------------------------
+    const ImageFilterList& FilterChain::getFilters() const
+    {
+        return _filters;
+    }
+
+    //------------------------------------------------------------------------------
+    void FilterChain::setTileSize( unsigned int width, unsigned int height )
+    {
+        _tileWidth = osg::maximum( width, 1u );
+        _tileHeight = osg::maximum( height, 1u );
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int FilterChain::getTileWidth() const
+    {
+        return _tileWidth;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int FilterChain::getTileHeight() const
+    {
+        return _tileHeight;
+    }
+
+    //------------------------------------------------------------------------------
+    bool FilterChain::apply( osgCompute::Memory& input, osgCompute::Memory& output ) const
+    {
+        if( &input == &output )
+        {
+            osg::notify(osg::WARN)
+                << "osgComputeAlgo::FilterChain::apply(): input and output of \"" << input.getName() << "\" must differ."
+                << std::endl;
+            return false;
+        }
+
+        unsigned int width = input.getDimension(0);
+        unsigned int height = osg::maximum( input.getDimension(1), 1u );
+        if( width == 0 || input.getNumDimensions() > 2 ||
+            output.getDimension(0) != width || osg::maximum( output.getDimension(1), 1u ) != height ||
+            (input.getElementSize() != 4 && input.getElementSize() != 16) ||
+            (output.getElementSize() != 4 && output.getElementSize() != 16) )
+        {
+            osg::notify(osg::WARN)
+                << "osgComputeAlgo::FilterChain::apply(): \"" << input.getName() << "\" and \"" << output.getName()
+                << "\" must be 2D images of the same size with RGBA8 or RGBA32F pixels."
+                << std::endl;
+            return false;
+        }
+
+        const char* in = static_cast<const char*>( input.map( osgCompute::MAP_HOST_SOURCE ) );
+        char* out = static_cast<char*>( output.map( osgCompute::MAP_HOST_TARGET ) );
+        if( in == NULL || out == NULL )
+        {
+            osg::notify(osg::WARN)
+                << "osgComputeAlgo::FilterChain::apply(): cannot map \"" << input.getName() << "\" or \"" << output.getName() << "\" on the host."
+                << std::endl;
+            input.unmap();
+            output.unmap();
+            return false;
+        }
+
+        // Tiles are extended by the radii of all following filters
+        std::vector<int> extX( _filters.size()+1, 0 ), extY( _filters.size()+1, 0 );
+        for( int f=static_cast<int>( _filters.size() )-1; f>=0; --f )
+        {
+            extX[f] = extX[f+1] + static_cast<int>( _filters[f]->getRadiusX() );
+            extY[f] = extY[f+1] + static_cast<int>( _filters[f]->getRadiusY() );
+        }
+
+        FilterStripBody body( _filters, extX, extY, static_cast<int>( _tileWidth ), static_cast<int>( _tileHeight ),
+            static_cast<int>( width ), static_cast<int>( height ), in, input.getElementSize(), out, output.getElementSize() );
+        parallelChunks( getNumChunks( height, _tileHeight ), body );
+
+        input.unmap();
+        output.unmap();
+        return true;
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef OSGCOMPUTEALGO_PARALLEL_H
+#define OSGCOMPUTEALGO_PARALLEL_H 1
+
+#include <osgCompute/TaskGroup>
+
+namespace osgComputeAlgo
+{
+    // Number of elements processed by a single task. The size is fixed so
+    // that the partitioning and thus the results of floating point
+    // reductions do not depend on the number of threads.
+    static const unsigned int CHUNK_SIZE = 1 << 16;
+
+    // Returns the number of chunks which cover numElements.
+    inline unsigned int getNumChunks( unsigned int numElements, unsigned int chunkSize = CHUNK_SIZE )
+    {
+        return (numElements + chunkSize - 1) / chunkSize;
+    }
+
+    // Returns the number of threads which are actually used.
+    unsigned int getNumWorkers();
+
+    template<class Body>
+    class ChunkTask : public osgCompute::Task
+    {
+    public:
+        ChunkTask( const Body& body, unsigned int chunk ) : _body(body), _chunk(chunk) {}
+
+        virtual void run() { _body( _chunk ); }
+
+    protected:
+        virtual ~ChunkTask() {}
+
+        const Body&     _body;
+        unsigned int    _chunk;
+    };
+
+    // Calls body(chunk) for all chunks in [0,numChunks) concurrently.
+    // Body::operator() must be const and must only write data of its chunk.
+    template<class Body>
+    void parallelChunks( unsigned int numChunks, const Body& body )
+    {
+        if( numChunks == 1 )
+        {
+            body( 0 );
+            return;
+        }
+
+        osgCompute::TaskGroup group;
+        group.setNumThreads( getNumWorkers() );
+        for( unsigned int c=0; c<numChunks; ++c )
+            group.addTask( new ChunkTask<Body>( body, c ) );
+
+        group.run();
+    }
+}
+
+#endif //OSGCOMPUTEALGO_PARALLEL_H
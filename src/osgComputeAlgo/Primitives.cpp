@@ -0,0 +1,877 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <cstring>
+#include <limits>
+#include <vector>
+#include <osg/Math>
+#include <osg/Notify>
+#include <OpenThreads/Thread>
+#include <osgComputeAlgo/Primitives>
+#include "Parallel.h"
+
+namespace osgComputeAlgo
+{
+    static unsigned int s_numThreads = 0;
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // OPERATORS ////////////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    template<typename T>
+    struct SumOp
+    {
+        static inline T identity() { return T(0); }
+        static inline T apply( T a, T b ) { return a + b; }
+    };
+
+    template<typename T>
+    struct MinOp
+    {
+        static inline T identity() { return std::numeric_limits<T>::max(); }
+        static inline T apply( T a, T b ) { return (b < a)? b : a; }
+    };
+
+    template<typename T>
+    struct MaxOp
+    {
+        // numeric_limits<T>::min() is the smallest positive value for floating point types
+        static inline T identity() { return std::numeric_limits<T>::is_integer? std::numeric_limits<T>::min() : -std::numeric_limits<T>::max(); }
+        static inline T apply( T a, T b ) { return (a < b)? b : a; }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // MAPPING //////////////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    static bool mapInputOutput( osgCompute::Memory& input, osgCompute::Memory& output, void*& inPtr, void*& outPtr )
+    {
+        if( &input == &output )
+        {
+            inPtr = outPtr = input.map( osgCompute::MAP_HOST );
+        }
+        else
+        {
+            inPtr = input.map( osgCompute::MAP_HOST_SOURCE );
+            outPtr = output.map( osgCompute::MAP_HOST_TARGET );
+        }
+
+        if( inPtr == NULL || outPtr == NULL )
+        {
+            osg::notify(osg::WARN)
+                << "osgComputeAlgo: cannot map \"" << input.getName() << "\" or \"" << output.getName() << "\" on the host."
+                << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    static void unmapInputOutput( osgCompute::Memory& input, osgCompute::Memory& output )
+    {
+        input.unmap();
+        if( &input != &output )
+            output.unmap();
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // SCAN AND REDUCE //////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    template<typename T, class Op>
+    class ReduceBody
+    {
+    public:
+        ReduceBody( const T* in, unsigned int numValues, T* partials )
+            : _in(in), _numValues(numValues), _partials(partials) {}
+
+        void operator()( unsigned int chunk ) const
+        {
+            unsigned int begin = chunk * CHUNK_SIZE;
+            unsigned int end = osg::minimum( begin + CHUNK_SIZE, _numValues );
+
+            T acc = Op::identity();
+            for( unsigned int i=begin; i<end; ++i )
+                acc = Op::apply( acc, _in[i] );
+
+            _partials[chunk] = acc;
+        }
+
+    private:
+        const T*        _in;
+        unsigned int    _numValues;
+        T*              _partials;
+    };
+
+    template<typename T, class Op>
+    class ScanBody
+    {
+    public:
+        ScanBody( const T* in, T* out, unsigned int numValues, const T* offsets, bool inclusive )
+            : _in(in), _out(out), _numValues(numValues), _offsets(offsets), _inclusive(inclusive) {}
+
+        void operator()( unsigned int chunk ) const
+        {
+            unsigned int begin = chunk * CHUNK_SIZE;
+            unsigned int end = osg::minimum( begin + CHUNK_SIZE, _numValues );
+
+            // in and out may alias, so each value is read before it is overwritten
+            T acc = _offsets[chunk];
+            if( _inclusive )
+            {
+                for( unsigned int i=begin; i<end; ++i )
+                {
+                    acc = Op::apply( acc, _in[i] );
+                    _out[i] = acc;
+                }
+            }
+            else
+            {
+                for( unsigned int i=begin; i<end; ++i )
+                {
+                    T value = _in[i];
+                    _out[i] = acc;
+                    acc = Op::apply( acc, value );
+                }
+            }
+        }
+
+    private:
+        const T*        _in;
+        T*              _out;
+        unsigned int    _numValues;
+        const T*        _offsets;
+        bool            _inclusive;
+    };
+
+    //------------------------------------------------------------------------------
+    template<typename T, class Op>
+    static T reduceValues( const T* in, unsigned int numValues )
+    {
+        unsigned int numChunks = getNumChunks( numValues );
+        if( numChunks == 0 )
+            return Op::identity();
+
+        std::vector<T> partials( numChunks );
+        parallelChunks( numChunks, ReduceBody<T,Op>( in, numValues, &partials.front() ) );
+
+        T acc = Op::identity();
+        for( unsigned int c=0; c<numChunks; ++c )
+            acc = Op::apply( acc, partials[c] );
+
+        return acc;
+    }
+
+    //------------------------------------------------------------------------------
+    template<typename T, class Op>
+    static void scanValues( const T* in, T* out, unsigned int numValues, bool inclusive )
+    {
+        unsigned int numChunks = getNumChunks( numValues );
+        if( numChunks == 0 )
+            return;
+
+        // Reduce each chunk, scan the partial results and scan
+        // each chunk again starting with its offset
+        std::vector<T> offsets( numChunks );
+        if( numChunks > 1 )
+            parallelChunks( numChunks, ReduceBody<T,Op>( in, numValues, &offsets.front() ) );
+
+        T acc = Op::identity();
+        for( unsigned int c=0; c<numChunks; ++c )
+        {
+            T partial = offsets[c];
+            offsets[c] = acc;
+            acc = Op::apply( acc, partial );
+        }
+
+        parallelChunks( numChunks, ScanBody<T,Op>( in, out, numValues, &offsets.front(), inclusive ) );
+    }
+
+    //------------------------------------------------------------------------------
+    template<typename T>
+    static void scanTyped( const void* in, void* out, unsigned int numValues, Operator op, bool inclusive )
+    {
+        switch( op )
+        {
+        case OP_MIN: scanValues< T, MinOp<T> >( (const T*)in, (T*)out, numValues, inclusive ); break;
+        case OP_MAX: scanValues< T, MaxOp<T> >( (const T*)in, (T*)out, numValues, inclusive ); break;
+        default:     scanValues< T, SumOp<T> >( (const T*)in, (T*)out, numValues, inclusive ); break;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    template<typename T>
+    static void reduceTyped( const void* in, unsigned int numValues, Operator op, void* result )
+    {
+        switch( op )
+        {
+        case OP_MIN: *(T*)result = reduceValues< T, MinOp<T> >( (const T*)in, numValues ); break;
+        case OP_MAX: *(T*)result = reduceValues< T, MaxOp<T> >( (const T*)in, numValues ); break;
+        default:     *(T*)result = reduceValues< T, SumOp<T> >( (const T*)in, numValues ); break;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    static bool scan( osgCompute::Memory& input, osgCompute::Memory& output, DataType type, Operator op, bool inclusive )
+    {
+        if( output.getAllElementsSize() < input.getAllElementsSize() )
+        {
+            osg::notify(osg::WARN)
+                << "osgComputeAlgo::scan(): \"" << output.getName() << "\" is smaller than \"" << input.getName() << "\"."
+                << std::endl;
+            return false;
+        }
+
+        void* in = NULL;
+        void* out = NULL;
+        if( !mapInputOutput( input, output, in, out ) )
+            return false;
+
+        unsigned int numValues = input.getAllElementsSize() / getTypeSize( type );
+        switch( type )
+        {
+        case TYPE_INT:    scanTyped<int>( in, out, numValues, op, inclusive ); break;
+        case TYPE_UINT:   scanTyped<unsigned int>( in, out, numValues, op, inclusive ); break;
+        case TYPE_FLOAT:  scanTyped<float>( in, out, numValues, op, inclusive ); break;
+        case TYPE_DOUBLE: scanTyped<double>( in, out, numValues, op, inclusive ); break;
+        }
+
+        unmapInputOutput( input, output );
+        return true;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // SEGMENTED REDUCE /////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    static const unsigned int SEGMENT_CHUNK_SIZE = 1024;
+
+    template<typename T, class Op>
+    class SegmentedReduceBody
+    {
+    public:
+        SegmentedReduceBody( const T* in, unsigned int numValues, const unsigned int* offsets, unsigned int numSegments, T* out )
+            : _in(in), _numValues(numValues), _offsets(offsets), _numSegments(numSegments), _out(out) {}
+
+        void operator()( unsigned int chunk ) const
+        {
+            unsigned int firstSegment = chunk * SEGMENT_CHUNK_SIZE;
+            unsigned int lastSegment = osg::minimum( firstSegment + SEGMENT_CHUNK_SIZE, _numSegments );
+
+            for( unsigned int s=firstSegment; s<lastSegment; ++s )
+            {
+                unsigned int end = (s+1 < _numSegments)? _offsets[s+1] : _numValues;
+
+                T acc = Op::identity();
+                for( unsigned int i=_offsets[s]; i<end; ++i )
+                    acc = Op::apply( acc, _in[i] );
+
+                _out[s] = acc;
+            }
+        }
+
+    private:
+        const T*                _in;
+        unsigned int            _numValues;
+        const unsigned int*     _offsets;
+        unsigned int            _numSegments;
+        T*                      _out;
+    };
+
+    //------------------------------------------------------------------------------
+    template<typename T>
+    static void segmentedReduceTyped( const void* in, unsigned int numValues, const unsigned int* offsets, unsigned int numSegments, void* out, Operator op )
+    {
+        unsigned int numChunks = getNumChunks( numSegments, SEGMENT_CHUNK_SIZE );
+        switch( op )
+        {
+        case OP_MIN: parallelChunks( numChunks, SegmentedReduceBody< T, MinOp<T> >( (const T*)in, numValues, offsets, numSegments, (T*)out ) ); break;
+        case OP_MAX: parallelChunks( numChunks, SegmentedReduceBody< T, MaxOp<T> >( (const T*)in, numValues, offsets, numSegments, (T*)out ) ); break;
+        default:     parallelChunks( numChunks, SegmentedReduceBody< T, SumOp<T> >( (const T*)in, numValues, offsets, numSegments, (T*)out ) ); break;
+        }
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // RADIX SORT ///////////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    static const unsigned int RADIX_BITS = 8;
+    static const unsigned int RADIX_SIZE = 1 << RADIX_BITS;
+
+    //------------------------------------------------------------------------------
+    // Maps keys to unsigned integers of the same order
+    static inline unsigned int toRadixKey( unsigned int bits, DataType keyType )
+    {
+        switch( keyType )
+        {
+        case TYPE_INT:   return bits ^ 0x80000000u;
+        case TYPE_FLOAT: return (bits & 0x80000000u)? ~bits : (bits ^ 0x80000000u);
+        default:         return bits;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    static inline unsigned int fromRadixKey( unsigned int key, DataType keyType )
+    {
+        switch( keyType )
+        {
+        case TYPE_INT:   return key ^ 0x80000000u;
+        case TYPE_FLOAT: return (key & 0x80000000u)? (key ^ 0x80000000u) : ~key;
+        default:         return key;
+        }
+    }
+
+    class RadixCountBody
+    {
+    public:
+        RadixCountBody( const unsigned int* keys, unsigned int numKeys, unsigned int shift, unsigned int* counts )
+            : _keys(keys), _numKeys(numKeys), _shift(shift), _counts(counts) {}
+
+        void operator()( unsigned int chunk ) const
+        {
+            unsigned int begin = chunk * CHUNK_SIZE;
+            unsigned int end = osg::minimum( begin + CHUNK_SIZE, _numKeys );
+
+            unsigned int* counts = &_counts[chunk * RADIX_SIZE];
+            memset( counts, 0, RADIX_SIZE * sizeof(unsigned int) );
+            for( unsigned int i=begin; i<end; ++i )
+                counts[ (_keys[i] >> _shift) & (RADIX_SIZE-1) ]++;
+        }
+
+    private:
+        const unsigned int*     _keys;
+        unsigned int            _numKeys;
+        unsigned int            _shift;
+        unsigned int*           _counts;
+    };
+
+    class RadixScatterBody
+    {
+    public:
+        RadixScatterBody( const unsigned int* keys, const unsigned int* indices, unsigned int numKeys, unsigned int shift,
+                          const unsigned int* offsets, unsigned int* dstKeys, unsigned int* dstIndices )
+            : _keys(keys), _indices(indices), _numKeys(numKeys), _shift(shift),
+              _offsets(offsets), _dstKeys(dstKeys), _dstIndices(dstIndices) {}
+
+        void operator()( unsigned int chunk ) const
+        {
+            unsigned int begin = chunk * CHUNK_SIZE;
+            unsigned int end = osg::minimum( begin + CHUNK_SIZE, _numKeys );
+
+            unsigned int offsets[RADIX_SIZE];
+            memcpy( offsets, &_offsets[chunk * RADIX_SIZE], RADIX_SIZE * sizeof(unsigned int) );
+            for( unsigned int i=begin; i<end; ++i )
+            {
+                unsigned int pos = offsets[ (_keys[i] >> _shift) & (RADIX_SIZE-1) ]++;
+                _dstKeys[pos] = _keys[i];
+                if( _indices != NULL )
+                    _dstIndices[pos] = _indices[i];
+            }
+        }
+
+    private:
+        const unsigned int*     _keys;
+        const unsigned int*     _indices;
+        unsigned int            _numKeys;
+        unsigned int            _shift;
+        const unsigned int*     _offsets;
+        unsigned int*           _dstKeys;
+        unsigned int*           _dstIndices;
+    };
+
+    //------------------------------------------------------------------------------
+    static void radixSort( std::vector<unsigned int>& keys, std::vector<unsigned int>* indices )
+    {
+        unsigned int numKeys = static_cast<unsigned int>( keys.size() );
+        unsigned int numChunks = getNumChunks( numKeys );
+
+        std::vector<unsigned int> tmpKeys( numKeys );
+        std::vector<unsigned int> tmpIndices( indices? numKeys : 0 );
+        std::vector<unsigned int> counts( numChunks * RADIX_SIZE );
+
+        for( unsigned int shift = 0; shift < 32; shift += RADIX_BITS )
+        {
+            parallelChunks( numChunks, RadixCountBody( &keys.front(), numKeys, shift, &counts.front() ) );
+
+            // Digit major and chunk minor order keeps the sort stable
+            unsigned int pos = 0;
+            bool skipPass = false;
+            for( unsigned int d=0; d<RADIX_SIZE && !skipPass; ++d )
+            {
+                unsigned int digitCount = 0;
+                for( unsigned int c=0; c<numChunks; ++c )
+                {
+                    unsigned int count = counts[c * RADIX_SIZE + d];
+                    counts[c * RADIX_SIZE + d] = pos;
+                    pos += count;
+                    digitCount += count;
+                }
+
+                // All keys have the same digit
+                skipPass = (digitCount == numKeys);
+            }
+            if( skipPass )
+                continue;
+
+            parallelChunks( numChunks, RadixScatterBody( &keys.front(), indices? &indices->front() : NULL, numKeys, shift,
+                &counts.front(), &tmpKeys.front(), indices? &tmpIndices.front() : NULL ) );
+
+            keys.swap( tmpKeys );
+            if( indices )
+                indices->swap( tmpIndices );
+        }
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // COMPACTION ///////////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    class CompactCountBody
+    {
+    public:
+        CompactCountBody( const unsigned int* flags, unsigned int numElements, unsigned int* counts )
+            : _flags(flags), _numElements(numElements), _counts(counts) {}
+
+        void operator()( unsigned int chunk ) const
+        {
+            unsigned int begin = chunk * CHUNK_SIZE;
+            unsigned int end = osg::minimum( begin + CHUNK_SIZE, _numElements );
+
+            unsigned int count = 0;
+            for( unsigned int i=begin; i<end; ++i )
+                count += (_flags[i] != 0)? 1 : 0;
+
+            _counts[chunk] = count;
+        }
+
+    private:
+        const unsigned int*     _flags;
+        unsigned int            _numElements;
+        unsigned int*           _counts;
+    };
+
+    template<unsigned int ElementSize>
+    struct ElementCopy
+    {
+        static inline void copy( char* dst, const char* src, unsigned int ) { memcpy( dst, src, ElementSize ); }
+    };
+
+    template<>
+    struct ElementCopy<0>
+    {
+        static inline void copy( char* dst, const char* src, unsigned int elementSize ) { memcpy( dst, src, elementSize ); }
+    };
+
+    template<unsigned int ElementSize>
+    class CompactCopyBody
+    {
+    public:
+        CompactCopyBody( const char* in, const unsigned int* flags, unsigned int numElements, unsigned int elementSize,
+                         const unsigned int* offsets, char* out )
+            : _in(in), _flags(flags), _numElements(numElements), _elementSize(elementSize), _offsets(offsets), _out(out) {}
+
+        void operator()( unsigned int chunk ) const
+        {
+            unsigned int begin = chunk * CHUNK_SIZE;
+            unsigned int end = osg::minimum( begin + CHUNK_SIZE, _numElements );
+
+            char* dst = _out + static_cast<size_t>( _offsets[chunk] ) * _elementSize;
+            for( unsigned int i=begin; i<end; ++i )
+            {
+                if( _flags[i] == 0 )
+                    continue;
+
+                ElementCopy<ElementSize>::copy( dst, _in + static_cast<size_t>( i ) * _elementSize, _elementSize );
+                dst += _elementSize;
+            }
+        }
+
+    private:
+        const char*             _in;
+        const unsigned int*     _flags;
+        unsigned int            _numElements;
+        unsigned int            _elementSize;
+        const unsigned int*     _offsets;
+        char*                   _out;
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // HISTOGRAM ////////////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    template<typename T>
+    class HistogramBody
+    {
+    public:
+        HistogramBody( const T* in, unsigned int numValues, unsigned int numSlices, double lower, double upper,
+                       unsigned int numBins, std::vector< std::vector<unsigned int> >& slices )
+            : _in(in), _numValues(numValues), _numSlices(numSlices), _lower(lower), _upper(upper),
+              _numBins(numBins), _slices(slices) {}
+
+        void operator()( unsigned int slice ) const
+        {
+            unsigned int sliceSize = (_numValues + _numSlices - 1) / _numSlices;
+            unsigned int begin = slice * sliceSize;
+            unsigned int end = osg::minimum( begin + sliceSize, _numValues );
+
+            std::vector<unsigned int>& bins = _slices[slice];
+            bins.assign( _numBins, 0 );
+
+            double scale = double(_numBins) / (_upper - _lower);
+            for( unsigned int i=begin; i<end; ++i )
+            {
+                double value = static_cast<double>( _in[i] );
+                if( !(value >= _lower && value < _upper) )
+                    continue;
+
+                unsigned int bin = static_cast<unsigned int>( (value - _lower) * scale );
+                bins[ osg::minimum( bin, _numBins-1 ) ]++;
+            }
+        }
+
+    private:
+        const T*                                    _in;
+        unsigned int                                _numValues;
+        unsigned int                                _numSlices;
+        double                                      _lower;
+        double                                      _upper;
+        unsigned int                                _numBins;
+        std::vector< std::vector<unsigned int> >&   _slices;
+    };
+
+    //------------------------------------------------------------------------------
+    template<typename T>
+    static void histogramTyped( const void* in, unsigned int numValues, double lower, double upper, unsigned int* bins, unsigned int numBins )
+    {
+        // Integer counts do not depend on the partitioning. Therefore each
+        // thread fills its own histogram of a contiguous slice of the input.
+        unsigned int numSlices = osg::minimum( getNumWorkers(), getNumChunks( numValues ) );
+        if( numSlices == 0 )
+            numSlices = 1;
+
+        std::vector< std::vector<unsigned int> > slices( numSlices );
+        parallelChunks( numSlices, HistogramBody<T>( (const T*)in, numValues, numSlices, lower, upper, numBins, slices ) );
+
+        memset( bins, 0, numBins * sizeof(unsigned int) );
+        for( unsigned int s=0; s<numSlices; ++s )
+            for( unsigned int b=0; b<numBins; ++b )
+                bins[b] += slices[s][b];
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    unsigned int getTypeSize( DataType type )
+    {
+        switch( type )
+        {
+        case TYPE_INT:    return sizeof(int);
+        case TYPE_UINT:   return sizeof(unsigned int);
+        case TYPE_FLOAT:  return sizeof(float);
+        case TYPE_DOUBLE: return sizeof(double);
+        }
+
+        return 1;
+    }
+
+    //------------------------------------------------------------------------------
+    void setNumThreads( unsigned int numThreads )
+    {
+        s_numThreads = numThreads;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int getNumThreads()
+    {
+        return s_numThreads;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int getNumWorkers()
+    {
+        if( s_numThreads != 0 )
+            return s_numThreads;
+
+        int numProcessors = OpenThreads::GetNumberOfProcessors();
+        return (numProcessors > 0)? static_cast<unsigned int>( numProcessors ) : 1;
+    }
+
+    //------------------------------------------------------------------------------
+    bool inclusiveScan( osgCompute::Memory& input, osgCompute::Memory& output, DataType type, Operator op )
+    {
+        return scan( input, output, type, op, true );
+    }
+
+    //------------------------------------------------------------------------------
+    bool exclusiveScan( osgCompute::Memory& input, osgCompute::Memory& output, DataType type, Operator op )
+    {
+        return scan( input, output, type, op, false );
+    }
+
+    //------------------------------------------------------------------------------
+    bool reduce( osgCompute::Memory& input, osgCompute::Memory& output, DataType type, Operator op )
+    {
+        if( output.getAllElementsSize() < getTypeSize( type ) )
+        {
+            osg::notify(osg::WARN)
+                << "osgComputeAlgo::reduce(): \"" << output.getName() << "\" is too small."
+                << std::endl;
+            return false;
+        }
+
+        void* in = NULL;
+        void* out = NULL;
+        if( !mapInputOutput( input, output, in, out ) )
+            return false;
+
+        double result[1];
+        unsigned int numValues = input.getAllElementsSize() / getTypeSize( type );
+        switch( type )
+        {
+        case TYPE_INT:    reduceTyped<int>( in, numValues, op, result ); break;
+        case TYPE_UINT:   reduceTyped<unsigned int>( in, numValues, op, result ); break;
+        case TYPE_FLOAT:  reduceTyped<float>( in, numValues, op, result ); break;
+        case TYPE_DOUBLE: reduceTyped<double>( in, numValues, op, result ); break;
+        }
+        memcpy( out, result, getTypeSize( type ) );
+
+        unmapInputOutput( input, output );
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    bool reduce( osgCompute::Memory& input, DataType type, Operator op, double& result )
+    {
+        const void* in = input.map( osgCompute::MAP_HOST_SOURCE );
+        if( in == NULL )
+        {
+            osg::notify(osg::WARN)
+                << "osgComputeAlgo::reduce(): cannot map \"" << input.getName() << "\" on the host."
+                << std::endl;
+            return false;
+        }
+
+        unsigned int numValues = input.getAllElementsSize() / getTypeSize( type );
+        switch( type )
+        {
+        case TYPE_INT:    { int value; reduceTyped<int>( in, numValues, op, &value ); result = value; } break;
+        case TYPE_UINT:   { unsigned int value; reduceTyped<unsigned int>( in, numValues, op, &value ); result = value; } break;
+        case TYPE_FLOAT:  { float value; reduceTyped<float>( in, numValues, op, &value ); result = value; } break;
+        case TYPE_DOUBLE: { reduceTyped<double>( in, numValues, op, &result ); } break;
+        }
+
+        input.unmap();
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    bool segmentedReduce( osgCompute::Memory& input, osgCompute::Memory& segmentOffsets, osgCompute::Memory& output, DataType type, Operator op )
+    {
+        unsigned int numValues = input.getAllElementsSize() / getTypeSize( type );
+        unsigned int numSegments = segmentOffsets.getAllElementsSize() / sizeof(unsigned int);
+        if( output.getAllElementsSize() < numSegments * getTypeSize( type ) || &output == &segmentOffsets )
+        {
+            osg::notify(osg::WARN)
+                << "osgComputeAlgo::segmentedReduce(): \"" << output.getName() << "\" cannot hold all segments."
+                << std::endl;
+            return false;
+        }
+
+        const unsigned int* offsets = static_cast<const unsigned int*>( segmentOffsets.map( osgCompute::MAP_HOST_SOURCE ) );
+        if( offsets == NULL && numSegments > 0 )
+            return false;
+
+        for( unsigned int s=0; s<numSegments; ++s )
+        {
+            if( offsets[s] > numValues || (s > 0 && offsets[s] < offsets[s-1]) )
+            {
+                osg::notify(osg::WARN)
+                    << "osgComputeAlgo::segmentedReduce(): offset " << s << " of \"" << segmentOffsets.getName() << "\" is out of range."
+                    << std::endl;
+                segmentOffsets.unmap();
+                return false;
+            }
+        }
+
+        void* in = NULL;
+        void* out = NULL;
+        if( !mapInputOutput( input, output, in, out ) )
+        {
+            segmentOffsets.unmap();
+            return false;
+        }
+
+        switch( type )
+        {
+        case TYPE_INT:    segmentedReduceTyped<int>( in, numValues, offsets, numSegments, out, op ); break;
+        case TYPE_UINT:   segmentedReduceTyped<unsigned int>( in, numValues, offsets, numSegments, out, op ); break;
+        case TYPE_FLOAT:  segmentedReduceTyped<float>( in, numValues, offsets, numSegments, out, op ); break;
+        case TYPE_DOUBLE: segmentedReduceTyped<double>( in, numValues, offsets, numSegments, out, op ); break;
+        }
+
+        unmapInputOutput( input, output );
+        segmentOffsets.unmap();
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    bool sortByKey( osgCompute::Memory& keys, osgCompute::Memory* values, DataType keyType )
+    {
+        if( keyType == TYPE_DOUBLE )
+        {
+            osg::notify(osg::WARN)
+                << "osgComputeAlgo::sortByKey(): only 32 bit keys are supported."
+                << std::endl;
+            return false;
+        }
+
+        unsigned int numKeys = keys.getAllElementsSize() / sizeof(unsigned int);
+        unsigned int valueSize = 0;
+        if( values != NULL )
+        {
+            if( values == &keys || numKeys == 0 || (values->getAllElementsSize() % numKeys) != 0 )
+            {
+                osg::notify(osg::WARN)
+                    << "osgComputeAlgo::sortByKey(): \"" << values->getName() << "\" does not hold one value per key."
+                    << std::endl;
+                return false;
+            }
+            valueSize = values->getAllElementsSize() / numKeys;
+        }
+        if( numKeys == 0 )
+            return true;
+
+        unsigned int* keyPtr = static_cast<unsigned int*>( keys.map( osgCompute::MAP_HOST ) );
+        if( keyPtr == NULL )
+            return false;
+
+        std::vector<unsigned int> radixKeys( numKeys );
+        for( unsigned int i=0; i<numKeys; ++i )
+            radixKeys[i] = toRadixKey( keyPtr[i], keyType );
+
+        std::vector<unsigned int> indices;
+        if( values != NULL )
+        {
+            indices.resize( numKeys );
+            for( unsigned int i=0; i<numKeys; ++i )
+                indices[i] = i;
+        }
+
+        radixSort( radixKeys, values? &indices : NULL );
+
+        for( unsigned int i=0; i<numKeys; ++i )
+            keyPtr[i] = fromRadixKey( radixKeys[i], keyType );
+        keys.unmap();
+
+        if( values != NULL )
+        {
+            char* valuePtr = static_cast<char*>( values->map( osgCompute::MAP_HOST ) );
+            if( valuePtr == NULL )
+                return false;
+
+            std::vector<char> sorted( static_cast<size_t>( numKeys ) * valueSize );
+            for( unsigned int i=0; i<numKeys; ++i )
+                memcpy( &sorted[ static_cast<size_t>( i ) * valueSize ], valuePtr + static_cast<size_t>( indices[i] ) * valueSize, valueSize );
+
+            memcpy( valuePtr, &sorted.front(), sorted.size() );
+            values->unmap();
+        }
+
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    bool compact( osgCompute::Memory& input, osgCompute::Memory& flags, osgCompute::Memory& output, unsigned int& numSelected )
+    {
+        numSelected = 0;
+        unsigned int numElements = input.getNumElements();
+        unsigned int elementSize = input.getElementSize();
+        if( &input == &output || &flags == &output ||
+            flags.getAllElementsSize() < numElements * sizeof(unsigned int) ||
+            output.getAllElementsSize() < input.getAllElementsSize() )
+        {
+            osg::notify(osg::WARN)
+                << "osgComputeAlgo::compact(): sizes of \"" << input.getName() << "\", \""
+                << flags.getName() << "\" and \"" << output.getName() << "\" do not match."
+                << std::endl;
+            return false;
+        }
+        if( numElements == 0 )
+            return true;
+
+        const unsigned int* flagPtr = static_cast<const unsigned int*>( flags.map( osgCompute::MAP_HOST_SOURCE ) );
+        if( flagPtr == NULL )
+            return false;
+
+        void* in = NULL;
+        void* out = NULL;
+        if( !mapInputOutput( input, output, in, out ) )
+        {
+            flags.unmap();
+            return false;
+        }
+
+        unsigned int numChunks = getNumChunks( numElements );
+        std::vector<unsigned int> offsets( numChunks );
+        parallelChunks( numChunks, CompactCountBody( flagPtr, numElements, &offsets.front() ) );
+        for( unsigned int c=0; c<numChunks; ++c )
+        {
+            unsigned int count = offsets[c];
+            offsets[c] = numSelected;
+            numSelected += count;
+        }
+
+        const char* src = static_cast<const char*>( in );
+        char* dst = static_cast<char*>( out );
+        switch( elementSize )
+        {
+        case 4:  parallelChunks( numChunks, CompactCopyBody<4>( src, flagPtr, numElements, elementSize, &offsets.front(), dst ) ); break;
+        case 8:  parallelChunks( numChunks, CompactCopyBody<8>( src, flagPtr, numElements, elementSize, &offsets.front(), dst ) ); break;
+        case 16: parallelChunks( numChunks, CompactCopyBody<16>( src, flagPtr, numElements, elementSize, &offsets.front(), dst ) ); break;
+        default: parallelChunks( numChunks, CompactCopyBody<0>( src, flagPtr, numElements, elementSize, &offsets.front(), dst ) ); break;
+        }
+
+        unmapInputOutput( input, output );
+        flags.unmap();
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    bool histogram( osgCompute::Memory& input, DataType type, double lower, double upper, osgCompute::Memory& bins )
+    {
+        unsigned int numBins = bins.getAllElementsSize() / sizeof(unsigned int);
+        if( !(upper > lower) || numBins == 0 )
+        {
+            osg::notify(osg::WARN)
+                << "osgComputeAlgo::histogram(): empty range or no bins in \"" << bins.getName() << "\"."
+                << std::endl;
+            return false;
+        }
+
+        void* in = NULL;
+        void* out = NULL;
+        if( !mapInputOutput( input, bins, in, out ) )
+            return false;
+
+        unsigned int numValues = input.getAllElementsSize() / getTypeSize( type );
+        unsigned int* binPtr = static_cast<unsigned int*>( out );
+        switch( type )
+        {
+        case TYPE_INT:    histogramTyped<int>( in, numValues, lower, upper, binPtr, numBins ); break;
+        case TYPE_UINT:   histogramTyped<unsigned int>( in, numValues, lower, upper, binPtr, numBins ); break;
+        case TYPE_FLOAT:  histogramTyped<float>( in, numValues, lower, upper, binPtr, numBins ); break;
+        case TYPE_DOUBLE: histogramTyped<double>( in, numValues, lower, upper, binPtr, numBins ); break;
+        }
+
+        unmapInputOutput( input, bins );
+        return true;
+    }
+}
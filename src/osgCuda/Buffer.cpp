@@ -103,6 +103,7 @@ namespace osgCuda
         if( !memoryPtr )
             return NULL;
         BufferObject& memory = *memoryPtr;
+        unsigned int pendingSync = memory._syncOp;
 
         /////////////////////////////
         // CHECK FOR MODIFICATIONS //
@@ -241,6 +242,8 @@ namespace osgCuda
             }
         }
 
+        traceMapping( mapping, offset, pendingSync, needsSetup );
+
         // check sync
         if( (mapping & osgCompute::MAP_DEVICE_ARRAY_TARGET) == osgCompute::MAP_DEVICE_ARRAY_TARGET )
         {
@@ -293,6 +296,7 @@ namespace osgCuda
         // during next call of map()
         memory._modifyCount = UINT_MAX;
         memory._syncOp = osgCompute::NO_SYNC;
+        dirtyContent();
 
         // clear host memory
         if( memory._hostPtr != NULL )
@@ -1259,6 +1263,7 @@ namespace osgCuda
     {
         _image = image;
         resetModifiedCounts();
+        dirtyContent();
     }
 
     //------------------------------------------------------------------------------
@@ -1391,6 +1396,12 @@ namespace osgCuda
         return new BufferObject;
     }
 
+    //------------------------------------------------------------------------------
+    unsigned int Buffer::getSourceModifiedCount() const
+    {
+        return _image.valid()? _image->getModifiedCount() : 0;
+    }
+
     //------------------------------------------------------------------------------
     void Buffer::resetModifiedCounts() const
     {
@@ -0,0 +1,170 @@
+#include <osg/Notify>
+#include <osgCompute/Memory>
+#include <osgCuda/Checkpoint>
+
+namespace osgCuda
+{
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+	// DEVICE STAGE /////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+    class DeviceCheckpointStage : public osgCompute::CheckpointStage
+    {
+    public:
+        DeviceCheckpointStage() : _hostPtr(NULL), _byteSize(0), _event(NULL), _failed(false) {}
+
+        //------------------------------------------------------------------------------
+        bool copy( const void* devPtr, unsigned int pitch, unsigned int rowSize, unsigned int numRows, cudaStream_t stream )
+        {
+            _byteSize = rowSize * numRows;
+
+            cudaError res = cudaMallocHost( &_hostPtr, _byteSize );
+            if( cudaSuccess != res )
+            {
+                osg::notify(osg::WARN)
+                    << __FUNCTION__ << ": cannot allocate page-locked memory. "
+                    << cudaGetErrorString(res)
+                    << std::endl;
+                _hostPtr = NULL;
+                return false;
+            }
+
+            res = cudaEventCreateWithFlags( &_event, cudaEventDisableTiming );
+            if( cudaSuccess != res )
+            {
+                osg::notify(osg::WARN)
+                    << __FUNCTION__ << ": cannot create event. "
+                    << cudaGetErrorString(res)
+                    << std::endl;
+                _event = NULL;
+                return false;
+            }
+
+            // The stream is a blocking stream. So the copy starts after the
+            // kernels which have been launched on the default stream.
+            res = cudaMemcpy2DAsync( _hostPtr, rowSize, devPtr, pitch, rowSize, numRows, cudaMemcpyDeviceToHost, stream );
+            if( cudaSuccess != res )
+            {
+                osg::notify(osg::WARN)
+                    << __FUNCTION__ << ": cudaMemcpy2DAsync() failed. "
+                    << cudaGetErrorString(res)
+                    << std::endl;
+                return false;
+            }
+
+            cudaEventRecord( _event, stream );
+
+            // Later work on the default stream, e.g. unmapping an OpenGL 
+            // buffer, must not overwrite the memory during the copy
+            cudaStreamWaitEvent( 0, _event, 0 );
+            return true;
+        }
+
+        //------------------------------------------------------------------------------
+        virtual const char* data()
+        {
+            if( _failed || _event == NULL )
+                return NULL;
+
+            cudaError res = cudaEventSynchronize( _event );
+            if( cudaSuccess != res )
+            {
+                osg::notify(osg::WARN)
+                    << __FUNCTION__ << ": copy to the host failed. "
+                    << cudaGetErrorString(res)
+                    << std::endl;
+                _failed = true;
+                return NULL;
+            }
+
+            return static_cast<const char*>( _hostPtr );
+        }
+
+        //------------------------------------------------------------------------------
+        virtual unsigned int getByteSize() const
+        {
+            return _byteSize;
+        }
+
+    protected:
+        //------------------------------------------------------------------------------
+        virtual ~DeviceCheckpointStage()
+        {
+            if( _event != NULL )
+            {
+                cudaEventSynchronize( _event );
+                cudaEventDestroy( _event );
+            }
+
+            if( _hostPtr != NULL )
+                cudaFreeHost( _hostPtr );
+        }
+
+        void*                       _hostPtr;
+        unsigned int                _byteSize;
+        cudaEvent_t                 _event;
+        bool                        _failed;
+    };
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+	// PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    CheckpointVisitor::CheckpointVisitor()
+        :   osgCompute::CheckpointVisitor(),
+            _stream(NULL)
+    {
+    }
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+	// PROTECTED FUNCTIONS //////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    CheckpointVisitor::~CheckpointVisitor()
+    {
+        // Stages of pending checkpoints record events on the stream
+        wait();
+
+        if( _stream != NULL )
+            cudaStreamDestroy( _stream );
+    }
+
+    //------------------------------------------------------------------------------
+    osgCompute::CheckpointStage* CheckpointVisitor::stage( osgCompute::Memory& memory )
+    {
+        unsigned int pitch = memory.getPitch();
+        unsigned int numRows = 1;
+        for( unsigned int d=1; d<memory.getNumDimensions(); ++d )
+            numRows *= memory.getDimension(d);
+
+        unsigned int rowSize = (memory.getNumDimensions() < 2)? memory.getAllElementsSize() : memory.getDimension(0) * memory.getElementSize();
+        if( pitch < rowSize || rowSize == 0 || !memory.supportsMapping( osgCompute::MAP_DEVICE_SOURCE ) )
+            return osgCompute::CheckpointVisitor::stage( memory );
+
+        if( _stream == NULL )
+        {
+            cudaError res = cudaStreamCreate( &_stream );
+            if( cudaSuccess != res )
+            {
+                osg::notify(osg::WARN)
+                    << __FUNCTION__ << ": cannot create stream. "
+                    << cudaGetErrorString(res)
+                    << std::endl;
+                _stream = NULL;
+                return osgCompute::CheckpointVisitor::stage( memory );
+            }
+        }
+
+        const void* devPtr = memory.map( osgCompute::MAP_DEVICE_SOURCE );
+        if( devPtr == NULL )
+            return osgCompute::CheckpointVisitor::stage( memory );
+
+        osg::ref_ptr<DeviceCheckpointStage> deviceStage = new DeviceCheckpointStage;
+        bool success = deviceStage->copy( devPtr, pitch, rowSize, numRows, _stream );
+        memory.unmap();
+
+        if( !success )
+            return osgCompute::CheckpointVisitor::stage( memory );
+
+        return deviceStage.release();
+    }
+}
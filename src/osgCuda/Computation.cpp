@@ -1,7 +1,11 @@
+#include <osgCompute/Serializer>
 #include <osgCuda/Computation>
 
 namespace osgCuda
 {
+    // Write the properties of the osgCuda wrappers by default
+    static osgCompute::RegisterSerializerDomainProxy s_serializerDomain( "osgCuda", OSGCUDA_SERIALIZER_VERSION );
+
     osgCuda::Computation::Computation()
     {
 
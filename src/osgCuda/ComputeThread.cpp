@@ -0,0 +1,78 @@
+#include <osg/Notify>
+#include <osgCompute/Computation>
+#include <osgCuda/ComputeThread>
+
+namespace osgCuda
+{
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+	// PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    ComputeThread::ComputeThread( int device )
+        :   osgCompute::ComputeThread(),
+            _device(device),
+            _launchEvent(NULL)
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    int ComputeThread::getDevice() const
+    {
+        return _device;
+    }
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+	// PROTECTED FUNCTIONS //////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    ComputeThread::~ComputeThread()
+    {
+        // beginThread() and endThread() must not be called
+        // after this object has been destroyed
+        stop();
+    }
+
+    //------------------------------------------------------------------------------
+    void ComputeThread::beginThread()
+    {
+        cudaError res = cudaSetDevice( _device );
+        if( cudaSuccess != res )
+        {
+            osg::notify(osg::WARN)
+                << __FUNCTION__ << ": cannot select device \"" << _device << "\". "
+                << cudaGetErrorString(res)
+                << std::endl;
+        }
+
+        res = cudaEventCreate( &_launchEvent );
+        if( cudaSuccess != res )
+        {
+            osg::notify(osg::WARN)
+                << __FUNCTION__ << ": cannot create event. "
+                << cudaGetErrorString(res)
+                << std::endl;
+            _launchEvent = NULL;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    void ComputeThread::endThread()
+    {
+        if( _launchEvent != NULL )
+        {
+            cudaEventDestroy( _launchEvent );
+            _launchEvent = NULL;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    void ComputeThread::endLaunch( osgCompute::Computation& computation )
+    {
+        if( _launchEvent == NULL )
+            return;
+
+        // Wait until the kernels of the launch have finished
+        cudaEventRecord( _launchEvent, 0 );
+        cudaEventSynchronize( _launchEvent );
+    }
+}
@@ -0,0 +1,164 @@
+#include <cmath>
+#include <osg/Notify>
+#include <osg/NodeVisitor>
+#include <osgCompute/ResultCache>
+#include <osgCuda/FixedStepComputation>
+
+namespace osgCuda
+{
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+	// PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    FixedStepComputation::FixedStepComputation()
+        :   osgCuda::Computation(),
+            _stepSize(1.0/60.0),
+            _maxSteps(4)
+    {
+        reset();
+        _numDroppedSteps = 0;
+    }
+
+    //------------------------------------------------------------------------------
+    void FixedStepComputation::accept( osg::NodeVisitor& nv )
+    {
+        if( nv.validNodeMask(*this) && nv.getFrameStamp() != NULL )
+        {
+            // Steps depend on whether the programs are launched in this frame
+            updateLaunchFrame( nv.getFrameStamp() );
+            advance( *nv.getFrameStamp() );
+        }
+
+        osgCuda::Computation::accept( nv );
+    }
+
+    //------------------------------------------------------------------------------
+    void FixedStepComputation::setStepSize( double stepSize )
+    {
+        if( stepSize <= 0.0 )
+        {
+            osg::notify(osg::WARN)
+                << getName() << " [osgCuda::FixedStepComputation::setStepSize()]: step size must be positive."
+                << std::endl;
+            return;
+        }
+
+        _stepSize = stepSize;
+    }
+
+    //------------------------------------------------------------------------------
+    double FixedStepComputation::getStepSize() const
+    {
+        return _stepSize;
+    }
+
+    //------------------------------------------------------------------------------
+    void FixedStepComputation::setMaxSteps( unsigned int maxSteps )
+    {
+        _maxSteps = (maxSteps == 0)? 1 : maxSteps;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int FixedStepComputation::getMaxSteps() const
+    {
+        return _maxSteps;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int FixedStepComputation::getNumSteps() const
+    {
+        return _numSteps;
+    }
+
+    //------------------------------------------------------------------------------
+    double FixedStepComputation::getAlpha() const
+    {
+        return _accumulator / _stepSize;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int FixedStepComputation::getNumDroppedSteps() const
+    {
+        return _numDroppedSteps;
+    }
+
+    //------------------------------------------------------------------------------
+    void FixedStepComputation::reset()
+    {
+        _accumulator = 0.0;
+        _lastTime = 0.0;
+        _frameNumber = 0;
+        _hasFrame = false;
+        _numSteps = 0;
+    }
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+	// PROTECTED FUNCTIONS //////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    FixedStepComputation::~FixedStepComputation()
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    void FixedStepComputation::advance( const osg::FrameStamp& frameStamp )
+    {
+        // The node is traversed several times per frame
+        if( _hasFrame && frameStamp.getFrameNumber() == _frameNumber )
+            return;
+
+        double time = frameStamp.getSimulationTime();
+        double elapsed = _hasFrame? time - _lastTime : 0.0;
+        if( elapsed < 0.0 )
+            elapsed = 0.0;
+
+        _hasFrame = true;
+        _frameNumber = frameStamp.getFrameNumber();
+        _lastTime = time;
+        _accumulator += elapsed;
+
+        // Keep the time of frames without a launch (see setLaunchInterval() 
+        // and setLaunchScheduler()) for the next launch
+        if( !isLaunchFrame() )
+            return;
+
+        // The last launch on a compute thread reads the number of steps
+        sync();
+
+        double steps = std::floor( _accumulator / _stepSize );
+        if( steps > static_cast<double>(_maxSteps) )
+        {
+            // Drop the time which cannot be caught up
+            _numSteps = _maxSteps;
+            _numDroppedSteps += static_cast<unsigned int>( steps ) - _maxSteps;
+            _accumulator = std::fmod( _accumulator, _stepSize );
+        }
+        else
+        {
+            _numSteps = static_cast<unsigned int>( steps );
+            _accumulator -= steps * _stepSize;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    void FixedStepComputation::launchProgram( osgCompute::Program& program )
+    {
+        if( _numSteps == 0 )
+            return;
+
+        osgCuda::Computation::launchProgram( program );
+    }
+
+    //------------------------------------------------------------------------------
+    void FixedStepComputation::runProgram( osgCompute::Program& program )
+    {
+        program.launchSteps( _numSteps, _stepSize );
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned long long FixedStepComputation::getParameterHash() const
+    {
+        unsigned long long hash = osgCompute::ResultCache::hash( &_numSteps, sizeof(_numSteps) );
+        return osgCompute::ResultCache::hash( &_stepSize, sizeof(_stepSize), hash );
+    }
+}
@@ -1,4 +1,5 @@
 #include <memory.h>
+#include <cfloat>
 #if defined(__linux)
 #include <malloc.h>
 #endif
@@ -10,10 +11,17 @@
 #include <cuda_gl_interop.h>
 #include <osg/observer_ptr>
 #include <osgCompute/Memory>
+#include <osgCompute/TaskGroup>
 #include <osgCuda/Geometry>
 
 namespace osgCuda
 {
+    // Device reduction of the vertex positions (see GeometryBound.cu)
+    void* createBoundReadback();
+    void destroyBoundReadback( void* readback );
+    bool reduceBound( void* readback, const void* vertices, unsigned int stride, unsigned int numVertices );
+    bool readBound( void* readback, float* bound );
+
     /**
     */
     class LIBRARY_EXPORT GeometryObject : public osgCompute::MemoryObject
@@ -95,6 +103,7 @@ namespace osgCuda
 
         virtual osgCompute::MemoryObject* createObject() const;
         virtual unsigned int computePitch() const;
+        virtual unsigned int getSourceModifiedCount() const;
 
         osg::observer_ptr<osgCuda::Geometry>		_geomref;
     private:
@@ -136,12 +145,55 @@ namespace osgCuda
         mutable unsigned int                        _indicesByteSize;
 
         virtual osgCompute::MemoryObject* createObject() const;
+        virtual unsigned int getSourceModifiedCount() const;
     private:
         // copy constructor and operator should not be called
         IndexedGeometryMemory( const IndexedGeometryMemory& , const osg::CopyOp& ) {}
         IndexedGeometryMemory& operator=(const IndexedGeometryMemory&) { return (*this); }
     };
 
+    /** Min/max reduction over a range of vertex positions. 
+    */
+    class BoundTask : public osgCompute::Task
+    {
+    public:
+        // Number of vertices reduced by a single task. The range
+        // is fixed so that small geometries are reduced by the
+        // calling thread only.
+        static const unsigned int NUM_VERTICES = 1 << 16;
+
+        BoundTask( const unsigned char* vertices, unsigned int stride, unsigned int numVertices )
+            : _vertices(vertices), _stride(stride), _numVertices(numVertices) {}
+
+        virtual void run()
+        {
+            float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+            float maxX = -FLT_MAX, maxY = -FLT_MAX, maxZ = -FLT_MAX;
+
+            const unsigned char* cur = _vertices;
+            for( unsigned int v=0; v<_numVertices; ++v, cur += _stride )
+            {
+                const float* pos = reinterpret_cast<const float*>( cur );
+                minX = (pos[0] < minX)? pos[0] : minX;
+                minY = (pos[1] < minY)? pos[1] : minY;
+                minZ = (pos[2] < minZ)? pos[2] : minZ;
+                maxX = (pos[0] > maxX)? pos[0] : maxX;
+                maxY = (pos[1] > maxY)? pos[1] : maxY;
+                maxZ = (pos[2] > maxZ)? pos[2] : maxZ;
+            }
+
+            _bb.set( minX, minY, minZ, maxX, maxY, maxZ );
+        }
+
+        const unsigned char*    _vertices;
+        unsigned int            _stride;
+        unsigned int            _numVertices;
+        osg::BoundingBox        _bb;
+
+    protected:
+        virtual ~BoundTask() {}
+    };
+
 
     /////////////////////////////////////////////////////////////////////////////////////////////////
     // PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
@@ -373,6 +425,7 @@ namespace osgCuda
         if( !memoryPtr )
             return NULL;
         GeometryObject& memory = *memoryPtr;
+        unsigned int pendingSync = memory._syncOp;
 
         //////////////
         // MAP DATA //
@@ -529,12 +582,21 @@ namespace osgCuda
             }
         }
 
+        traceMapping( mapping, offset, pendingSync, needsSetup );
+
         if( (mapping & osgCompute::MAP_DEVICE_TARGET) == osgCompute::MAP_DEVICE_TARGET )
             memory._syncOp |= osgCompute::SYNC_HOST;
 
         if( (mapping & osgCompute::MAP_HOST_TARGET) == osgCompute::MAP_HOST_TARGET )
             memory._syncOp |= osgCompute::SYNC_DEVICE;
 
+        // Vertices might be moved. The bound is reduced
+        // on the device when the memory is unmapped.
+        if( _geomref->getUseComputedBound() &&
+            ( (mapping & osgCompute::MAP_DEVICE_TARGET) == osgCompute::MAP_DEVICE_TARGET ||
+              (mapping & osgCompute::MAP_HOST_TARGET) == osgCompute::MAP_HOST_TARGET ) )
+            _geomref->_boundModified = true;
+
         return &static_cast<char*>(ptr)[offset];
     }
 
@@ -577,6 +639,10 @@ namespace osgCuda
             }
         }
 
+        // Reduce the bound while the vertices are mapped
+        if( memory._devPtr != NULL && _geomref->_boundModified )
+            _geomref->requestBound( memory._devPtr );
+
         // Change current context to render context
         if( memory._devPtr != NULL )
         {
@@ -663,6 +729,7 @@ namespace osgCuda
         if( !memoryPtr )
             return false;
         GeometryObject& memory = *memoryPtr;
+        dirtyContent();
 
         ////////////////////////
         // CLEAR MEMORY FIRST //
@@ -816,6 +883,24 @@ namespace osgCuda
         return getDimension(0)*getElementSize();
     }
 
+    //------------------------------------------------------------------------------
+    unsigned int GeometryMemory::getSourceModifiedCount() const
+    {
+        if( !_geomref.valid() )
+            return 0;
+
+        osg::Geometry::ArrayList arrayList;
+        _geomref->getArrayList( arrayList );
+
+        // Each count increases monotonically and so does the sum
+        unsigned int modifiedCount = 0;
+        for( unsigned int a=0; a<arrayList.size(); ++a )
+            if( arrayList[a] != NULL )
+                modifiedCount += arrayList[a]->getModifiedCount();
+
+        return modifiedCount;
+    }
+
     //------------------------------------------------------------------------------
     bool GeometryMemory::setup( unsigned int mapping )
     {
@@ -1362,6 +1447,9 @@ namespace osgCuda
         if( NULL ==  ptr )
             return NULL;
 
+        if( needsSetup || (mapping & (osgCompute::MAP_HOST_TARGET|osgCompute::MAP_DEVICE_TARGET)) )
+            dirtyContent();
+
         if( (mapping & osgCompute::MAP_DEVICE_TARGET) == osgCompute::MAP_DEVICE_TARGET )
             memory._syncIdxOp |= osgCompute::SYNC_HOST;
 
@@ -1456,6 +1544,7 @@ namespace osgCuda
         if( !memoryPtr )
             return NULL;
         IndexedGeometryObject& memory = *memoryPtr;
+        dirtyContent();
 
         ////////////////////////
         // CLEAR MEMORY FIRST //
@@ -1974,13 +2063,30 @@ namespace osgCuda
         return new IndexedGeometryObject;
     }
 
+    //------------------------------------------------------------------------------
+    unsigned int IndexedGeometryMemory::getSourceModifiedCount() const
+    {
+        if( !_geomref.valid() )
+            return 0;
+
+        unsigned int modifiedCount = GeometryMemory::getSourceModifiedCount();
+        for( unsigned int p=0; p<_geomref->getNumPrimitiveSets(); ++p )
+            modifiedCount += _geomref->getPrimitiveSet(p)->getModifiedCount();
+
+        return modifiedCount;
+    }
+
     /////////////////////////////////////////////////////////////////////////////////////////////////
     // PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
     /////////////////////////////////////////////////////////////////////////////////////////////////
     //------------------------------------------------------------------------------
     Geometry::Geometry()
         : osg::Geometry(),
-		  osgCompute::GLMemoryAdapter()
+		  osgCompute::GLMemoryAdapter(),
+          _useComputedBound(false),
+          _boundModified(false),
+          _boundRequested(false),
+          _boundReadback(NULL)
     {
 		GeometryMemory* memory = new GeometryMemory;
 		memory->_geomref = this;
@@ -2063,6 +2169,125 @@ namespace osgCuda
     //    osg::Geometry::resizeGLObjectBuffers( maxSize );
     //}
 
+    //------------------------------------------------------------------------------
+    void Geometry::setUseIndexMapping( bool enabled )
+    {
+        if( getUseIndexMapping() == enabled )
+            return;
+
+        // Exchange the memory object. Its properties are 
+        // moved to the new memory object.
+        GeometryMemory* memory = enabled? new IndexedGeometryMemory : new GeometryMemory;
+        memory->_geomref = this;
+        memory->setName( _memory->getName() );
+        memory->setIdentifiers( _memory->getIdentifiers() );
+        memory->setAllocHint( _memory->getAllocHint() );
+        memory->setSubloadCallback( _memory->getSubloadCallback() );
+
+        _memory->releaseObjects();
+        _memory = memory;
+    }
+
+    //------------------------------------------------------------------------------
+    bool Geometry::getUseIndexMapping() const
+    {
+        return dynamic_cast<const IndexedGeometryMemory*>( _memory.get() ) != NULL;
+    }
+
+    //------------------------------------------------------------------------------
+    void Geometry::setUseComputedBound( bool enabled )
+    {
+        if( _useComputedBound == enabled )
+            return;
+
+        _useComputedBound = enabled;
+        _boundModified = false;
+        _boundRequested = false;
+        _computedBound.init();
+        dirtyBound();
+    }
+
+    //------------------------------------------------------------------------------
+    bool Geometry::getUseComputedBound() const
+    {
+        return _useComputedBound;
+    }
+
+    //------------------------------------------------------------------------------
+    osg::BoundingBox Geometry::computeBound() const
+    {
+        if( !_useComputedBound )
+            return osg::Geometry::computeBound();
+
+        // Vertex data which has not been mapped so far
+        // is identical to the vertex array.
+        GeometryMemory* memory = static_cast<GeometryMemory*>( _memory.get() );
+        GeometryObject* object = dynamic_cast<GeometryObject*>( memory->object(false) );
+        if( object == NULL )
+            return osg::Geometry::computeBound();
+
+        // Take the result of the last device reduction
+        if( _boundRequested )
+        {
+            float bound[6];
+            if( readBound( _boundReadback, bound ) )
+            {
+                _computedBound.set( bound[0], bound[1], bound[2], bound[3], bound[4], bound[5] );
+            }
+            else
+            {
+                osg::notify(osg::WARN)
+                    << __FUNCTION__ <<" " << getName() << ": cannot read the bound from the device."
+                    << std::endl;
+
+                _computedBound.init();
+            }
+
+            _boundRequested = false;
+        }
+
+        // Vertices which are mapped on the device are reduced when
+        // they are unmapped. The last bound is kept until then.
+        if( !_boundModified || object->_devPtr != NULL )
+            return _computedBound.valid()? _computedBound : osg::Geometry::computeBound();
+
+        // The vertices have been changed on the host or the device 
+        // reduction has failed
+        unsigned int vertexOffset = 0;
+        unsigned int stride = 0;
+        unsigned int numVertices = 0;
+        if( !getVertexRange( vertexOffset, stride, numVertices ) )
+            return osg::Geometry::computeBound();
+
+        const unsigned char* hostPtr = static_cast<const unsigned char*>(
+            memory->map( osgCompute::MAP_HOST_SOURCE, vertexOffset ) );
+        if( hostPtr == NULL )
+        {
+            osg::notify(osg::WARN)
+                << __FUNCTION__ <<" " << getName() << ": cannot map vertices. Using bound of the vertex array."
+                << std::endl;
+
+            return osg::Geometry::computeBound();
+        }
+
+        osgCompute::TaskGroup group;
+        for( unsigned int v=0; v<numVertices; v+=BoundTask::NUM_VERTICES )
+        {
+            unsigned int count = numVertices - v;
+            if( count > BoundTask::NUM_VERTICES )
+                count = BoundTask::NUM_VERTICES;
+            group.addTask( new BoundTask( &hostPtr[v * stride], stride, count ) );
+        }
+        group.run();
+
+        _computedBound.init();
+        for( osgCompute::TaskListCnstItr itr = group.getTasks().begin(); itr != group.getTasks().end(); ++itr )
+            _computedBound.expandBy( static_cast<const BoundTask*>( (*itr).get() )->_bb );
+
+        _boundModified = false;
+        return _computedBound;
+    }
+
     //------------------------------------------------------------------------------
     void Geometry::drawImplementation( osg::RenderInfo& renderInfo ) const
     {
@@ -2073,6 +2298,68 @@ namespace osgCuda
         osg::Geometry::drawImplementation( renderInfo );
     }
 
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PRIVATE FUNCTIONS ////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    void Geometry::requestBound( const void* devPtr )
+    {
+        // The bound is read during the next cull traversal
+        dirtyBound();
+
+        unsigned int vertexOffset = 0;
+        unsigned int stride = 0;
+        unsigned int numVertices = 0;
+        if( !getVertexRange( vertexOffset, stride, numVertices ) )
+            return;
+
+        if( _boundReadback == NULL )
+            _boundReadback = createBoundReadback();
+
+        // Only the six floats of the bounding box are copied back
+        if( !reduceBound( _boundReadback, &static_cast<const unsigned char*>(devPtr)[vertexOffset], stride, numVertices ) )
+        {
+            osg::notify(osg::WARN)
+                << __FUNCTION__ <<" " << getName() << ": cannot reduce the bound on the device. Reading back the vertices instead."
+                << std::endl;
+
+            return;
+        }
+
+        _boundRequested = true;
+        _boundModified = false;
+    }
+
+    //------------------------------------------------------------------------------
+    bool Geometry::getVertexRange( unsigned int& offset, unsigned int& stride, unsigned int& numVertices ) const
+    {
+        const osg::Array* vertices = getVertexArray();
+        if( vertices == NULL || vertices->getNumElements() == 0 ||
+            vertices->getDataType() != GL_FLOAT || vertices->getDataSize() < 3 )
+            return false;
+
+        // Find the offset of the vertex positions within the memory
+        osg::VertexBufferObject* vbo = const_cast<Geometry*>(this)->getOrCreateVertexBufferObject();
+        if( !vbo )
+            return false;
+
+        offset = 0;
+        unsigned int d = 0;
+        for( ; d<vbo->getNumBufferData(); ++d )
+        {
+            if( vbo->getBufferData(d) == vertices )
+                break;
+
+            offset += vbo->getBufferData(d)->getTotalDataSize();
+        }
+        if( d == vbo->getNumBufferData() )
+            return false;
+
+        numVertices = vertices->getNumElements();
+        stride = vertices->getTotalDataSize() / numVertices;
+        return true;
+    }
+
     /////////////////////////////////////////////////////////////////////////////////////////////////
     // PROTECTED FUNCTIONS //////////////////////////////////////////////////////////////////////////
     /////////////////////////////////////////////////////////////////////////////////////////////////
@@ -2084,5 +2371,7 @@ namespace osgCuda
         // Do also call releaseObjects()
         _memory->releaseObjects();
         _memory = NULL;
+
+        destroyBoundReadback( _boundReadback );
     }
 }
@@ -0,0 +1,184 @@
+#include <cfloat>
+#include <cuda_runtime.h>
+
+// Threads per block of the reduction
+#define BOUND_THREADS 256
+// Maximum number of blocks of the first pass
+#define BOUND_BLOCKS 64
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// DEVICE FUNCTIONS //////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//------------------------------------------------------------------------------
+inline __device__
+void reduceBlock( float* sMin, float* sMax, float* bound )
+{
+    // sMin and sMax store BOUND_THREADS values for each axis
+    for( unsigned int s=blockDim.x/2; s>0; s>>=1 )
+    {
+        if( threadIdx.x < s )
+        {
+            for( unsigned int a=0; a<3; ++a )
+            {
+                sMin[a*BOUND_THREADS+threadIdx.x] = fminf( sMin[a*BOUND_THREADS+threadIdx.x], sMin[a*BOUND_THREADS+threadIdx.x+s] );
+                sMax[a*BOUND_THREADS+threadIdx.x] = fmaxf( sMax[a*BOUND_THREADS+threadIdx.x], sMax[a*BOUND_THREADS+threadIdx.x+s] );
+            }
+        }
+        __syncthreads();
+    }
+
+    if( threadIdx.x == 0 )
+    {
+        for( unsigned int a=0; a<3; ++a )
+        {
+            bound[a] = sMin[a*BOUND_THREADS];
+            bound[a+3] = sMax[a*BOUND_THREADS];
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS //////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//------------------------------------------------------------------------------
+__global__
+void boundKernel( const unsigned char* vertices, unsigned int stride, unsigned int numVertices, float* blockBounds )
+{
+    __shared__ float sMin[3*BOUND_THREADS];
+    __shared__ float sMax[3*BOUND_THREADS];
+
+    float minPos[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float maxPos[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for( unsigned int v=blockIdx.x*blockDim.x+threadIdx.x; v<numVertices; v+=gridDim.x*blockDim.x )
+    {
+        const float* pos = (const float*)( &vertices[(size_t)v * stride] );
+        for( unsigned int a=0; a<3; ++a )
+        {
+            minPos[a] = fminf( minPos[a], pos[a] );
+            maxPos[a] = fmaxf( maxPos[a], pos[a] );
+        }
+    }
+
+    for( unsigned int a=0; a<3; ++a )
+    {
+        sMin[a*BOUND_THREADS+threadIdx.x] = minPos[a];
+        sMax[a*BOUND_THREADS+threadIdx.x] = maxPos[a];
+    }
+    __syncthreads();
+
+    reduceBlock( sMin, sMax, &blockBounds[blockIdx.x * 6] );
+}
+
+//------------------------------------------------------------------------------
+__global__
+void boundBlocksKernel( const float* blockBounds, unsigned int numBlocks, float* bound )
+{
+    __shared__ float sMin[3*BOUND_THREADS];
+    __shared__ float sMax[3*BOUND_THREADS];
+
+    for( unsigned int a=0; a<3; ++a )
+    {
+        sMin[a*BOUND_THREADS+threadIdx.x] = (threadIdx.x < numBlocks)? blockBounds[threadIdx.x*6+a] : FLT_MAX;
+        sMax[a*BOUND_THREADS+threadIdx.x] = (threadIdx.x < numBlocks)? blockBounds[threadIdx.x*6+a+3] : -FLT_MAX;
+    }
+    __syncthreads();
+
+    reduceBlock( sMin, sMax, bound );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// HOST FUNCTIONS ////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace osgCuda
+{
+    struct BoundReadback
+    {
+        float*          _devBounds;
+        float*          _hostBound;
+        cudaEvent_t     _copied;
+    };
+
+    //------------------------------------------------------------------------------
+    void* createBoundReadback()
+    {
+        BoundReadback* readback = new BoundReadback;
+
+        // Block results of the first pass followed by the bound
+        if( cudaSuccess != cudaMalloc( (void**)&readback->_devBounds, (BOUND_BLOCKS+1) * 6 * sizeof(float) ) )
+        {
+            delete readback;
+            return NULL;
+        }
+
+        // Page-locked memory is required for asynchronous copies
+        if( cudaSuccess != cudaMallocHost( (void**)&readback->_hostBound, 6 * sizeof(float) ) )
+        {
+            cudaFree( readback->_devBounds );
+            delete readback;
+            return NULL;
+        }
+
+        if( cudaSuccess != cudaEventCreateWithFlags( &readback->_copied, cudaEventDisableTiming ) )
+        {
+            cudaFreeHost( readback->_hostBound );
+            cudaFree( readback->_devBounds );
+            delete readback;
+            return NULL;
+        }
+
+        return readback;
+    }
+
+    //------------------------------------------------------------------------------
+    void destroyBoundReadback( void* handle )
+    {
+        BoundReadback* readback = (BoundReadback*)handle;
+        if( readback == NULL )
+            return;
+
+        cudaEventSynchronize( readback->_copied );
+        cudaEventDestroy( readback->_copied );
+        cudaFreeHost( readback->_hostBound );
+        cudaFree( readback->_devBounds );
+        delete readback;
+    }
+
+    //------------------------------------------------------------------------------
+    bool reduceBound( void* handle, const void* vertices, unsigned int stride, unsigned int numVertices )
+    {
+        BoundReadback* readback = (BoundReadback*)handle;
+        if( readback == NULL || vertices == NULL || numVertices == 0 )
+            return false;
+
+        unsigned int numBlocks = (numVertices + BOUND_THREADS - 1) / BOUND_THREADS;
+        if( numBlocks > BOUND_BLOCKS )
+            numBlocks = BOUND_BLOCKS;
+
+        float* bound = &readback->_devBounds[BOUND_BLOCKS * 6];
+        boundKernel<<< numBlocks, BOUND_THREADS >>>( (const unsigned char*)vertices, stride, numVertices, readback->_devBounds );
+        boundBlocksKernel<<< 1, BOUND_THREADS >>>( readback->_devBounds, numBlocks, bound );
+
+        // The result is read by the cull traversal. Do not wait for it here.
+        cudaMemcpyAsync( readback->_hostBound, bound, 6 * sizeof(float), cudaMemcpyDeviceToHost );
+        cudaEventRecord( readback->_copied );
+
+        return cudaSuccess == cudaGetLastError();
+    }
+
+    //------------------------------------------------------------------------------
+    bool readBound( void* handle, float* bound )
+    {
+        BoundReadback* readback = (BoundReadback*)handle;
+        if( readback == NULL )
+            return false;
+
+        // Usually the copy has finished long before
+        if( cudaSuccess != cudaEventSynchronize( readback->_copied ) )
+            return false;
+
+        for( unsigned int b=0; b<6; ++b )
+            bound[b] = readback->_hostBound[b];
+
+        return true;
+    }
+}
@@ -72,8 +72,12 @@ namespace osgCuda
 
         virtual osgCompute::MemoryObject* createObject() const;
         virtual unsigned int computePitch() const;
+        virtual unsigned int getSourceModifiedCount() const;
 
         osg::observer_ptr<osg::Texture>	_texref; 
+        mutable osg::observer_ptr<const osg::Image> _lastImage;
+        mutable unsigned int            _lastImageModifiedCount;
+        mutable unsigned int            _imageVersion;
     private:
         // copy constructor and operator should not be called
         TextureMemory( const TextureMemory& , const osg::CopyOp& ) {}
@@ -145,7 +149,9 @@ namespace osgCuda
     /////////////////////////////////////////////////////////////////////////////////////////////////
     //------------------------------------------------------------------------------
     TextureMemory::TextureMemory()
-		: osgCompute::GLMemory()
+		: osgCompute::GLMemory(),
+          _lastImageModifiedCount(0),
+          _imageVersion(0)
     {
         // Please note that virtual functions className() and libraryName() are called
         // during observeResource() which will only develop until this class.
@@ -405,6 +411,7 @@ namespace osgCuda
         if( !memoryPtr )
             return NULL;
         TextureObject& memory = *memoryPtr;
+        unsigned int pendingSync = memory._syncOp;
 
         //////////////
         // MAP DATA //
@@ -572,6 +579,8 @@ namespace osgCuda
             }
         }
 
+        traceMapping( mapping, offset, pendingSync, needsSetup );
+
         if( (mapping & osgCompute::MAP_DEVICE_ARRAY_TARGET) == osgCompute::MAP_DEVICE_ARRAY_TARGET )
         {
             memory._syncOp |= osgCompute::SYNC_DEVICE;
@@ -659,6 +668,7 @@ namespace osgCuda
         // Reset image data during the next mapping
         memory._lastModifiedCount = UINT_MAX;
         memory._syncOp = osgCompute::NO_SYNC;
+        dirtyContent();
 
         // Reset host memory
         if( memory._hostPtr != NULL && _texref->getImage(0) == NULL )
@@ -774,6 +784,8 @@ namespace osgCuda
         // Host memory and device memory should be synchronized in next call to map
         memory._syncOp |= osgCompute::SYNC_DEVICE;
         memory._syncOp |= osgCompute::SYNC_HOST;
+        // Contents are changed by rendering
+        dirtyContent();
 
         if( memory._graphicsArray != NULL )
         {
@@ -818,6 +830,27 @@ namespace osgCuda
             return (getDimension(0)*getElementSize()); // no additional bytes required.
     }
 
+    //------------------------------------------------------------------------------
+    unsigned int TextureMemory::getSourceModifiedCount() const
+    {
+        if( !_texref.valid() )
+            return 0;
+
+        // The image might be replaced by osg::Texture::setImage() which is
+        // not virtual for all texture types. The observer detects a new image
+        // even if it is allocated at the address of a deleted one.
+        const osg::Image* image = _texref->getImage(0);
+        unsigned int modifiedCount = (image != NULL)? image->getModifiedCount() : 0;
+        if( _lastImage.get() != image || _lastImageModifiedCount != modifiedCount )
+        {
+            _lastImage = image;
+            _lastImageModifiedCount = modifiedCount;
+            ++_imageVersion;
+        }
+
+        return _imageVersion;
+    }
+
     //------------------------------------------------------------------------------
     bool TextureMemory::setup( unsigned int mapping )
     {
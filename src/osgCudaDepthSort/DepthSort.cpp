@@ -0,0 +1,108 @@
+#include <vector_types.h>
+#include <cuda_runtime.h>
+#include <osg/Notify>
+#include <osgCompute/Program>
+#include <osgCompute/Memory>
+#include <osgCuda/Buffer>
+#include <osgCudaUtil/DepthSort>
+
+//------------------------------------------------------------------------------
+extern "C"
+unsigned int depthSortScratchSize( unsigned int numIndices );
+
+extern "C"
+bool depthSort( unsigned int numIndices, unsigned int* indices,
+                const void* vertices, unsigned int stride, unsigned int numVertices,
+                float4 plane, unsigned int* scratch );
+
+namespace osgCuda
+{
+    //------------------------------------------------------------------------------
+    static bool deviceAvailable()
+    {
+        int numDevices = 0;
+        if( cudaGetDeviceCount( &numDevices ) != cudaSuccess )
+            return false;
+
+        return numDevices > 0;
+    }
+
+    /** Computes the depth keys and radix sorts the indices on the device.
+    Falls back to the host implementation of osgCuda::DepthSort without a
+    CUDA device or if the vertices have last been mapped on the host.
+    */
+    class DeviceDepthSort : public osgCuda::DepthSort
+    {
+    public:
+        DeviceDepthSort() : osgCuda::DepthSort(), _useDevice(deviceAvailable()) {}
+
+        virtual void clear() { clearLocal(); osgCuda::DepthSort::clear(); }
+
+    protected:
+        virtual ~DeviceDepthSort() { clearLocal(); }
+        void clearLocal() { _scratchBuffer = NULL; }
+
+        virtual bool sortIndices( unsigned int stride, unsigned int numVertices, unsigned int numIndices );
+
+        osg::ref_ptr<osgCuda::Buffer>       _scratchBuffer;
+        bool                                _useDevice;
+
+    private:
+        // copy constructor and operator should not be called
+        DeviceDepthSort( const DeviceDepthSort&, const osg::CopyOp& ) {}
+        DeviceDepthSort& operator=( const DeviceDepthSort& ) { return (*this); }
+    };
+
+    //------------------------------------------------------------------------------
+    bool DeviceDepthSort::sortIndices( unsigned int stride, unsigned int numVertices, unsigned int numIndices )
+    {
+        // Avoid a synchronization with the device if the vertices
+        // are already on the host
+        osgCompute::Memory* memory = _geometry->getMemory();
+        if( !_useDevice || (memory->getMapping() & osgCompute::MAP_HOST) )
+            return osgCuda::DepthSort::sortIndices( stride, numVertices, numIndices );
+
+        unsigned int scratchSize = depthSortScratchSize( numIndices );
+        if( !_scratchBuffer.valid() || _scratchBuffer->getNumElements() != scratchSize )
+        {
+            _scratchBuffer = new osgCuda::Buffer;
+            _scratchBuffer->setName( "DepthSortScratch" );
+            _scratchBuffer->setElementSize( sizeof(unsigned int) );
+            _scratchBuffer->setDimension( 0, scratchSize );
+        }
+
+        // Vertex positions are stored first
+        const void* vertexPtr = memory->map( osgCompute::MAP_DEVICE_SOURCE );
+        unsigned int* indexPtr = static_cast<unsigned int*>( memory->map( MAP_DEVICE_TARGET_INDICES ) );
+        unsigned int* scratchPtr = static_cast<unsigned int*>( _scratchBuffer->map( osgCompute::MAP_DEVICE_TARGET ) );
+        if( vertexPtr == NULL || indexPtr == NULL || scratchPtr == NULL )
+            return true;
+
+        osg::Vec4f depthPlane = getDepthPlane();
+        float4 plane;
+        plane.x = depthPlane.x();
+        plane.y = depthPlane.y();
+        plane.z = depthPlane.z();
+        plane.w = depthPlane.w();
+
+        if( !depthSort( numIndices, indexPtr, vertexPtr, stride, numVertices, plane, scratchPtr ) )
+        {
+            osg::notify(osg::WARN)
+                << __FUNCTION__ << ": cannot sort \"" << _geometry->getName()
+                << "\" on the device. Sorting on the host."
+                << std::endl;
+            _useDevice = false;
+            return osgCuda::DepthSort::sortIndices( stride, numVertices, numIndices );
+        }
+
+        _numFullSorts++;
+        return true;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Use this function to return a new depth sort program to the application
+extern "C" OSGCOMPUTE_PROGRAM_EXPORT osgCompute::Program* OSGCOMPUTE_CREATE_PROGRAM_FUNCTION()
+{
+    return new osgCuda::DeviceDepthSort;
+}
@@ -0,0 +1,218 @@
+#include <vector_types.h>
+#include <cuda_runtime.h>
+
+// Threads per block and elements per tile of the radix sort
+#define SORT_THREADS 256
+// Bits sorted per pass
+#define RADIX_BITS 4
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_MASK (RADIX_SIZE - 1)
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// DEVICE FUNCTIONS //////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//------------------------------------------------------------------------------
+inline __device__
+unsigned int floatToRadix( float value )
+{
+    // Flip the sign bit of positive and all bits of negative values so
+    // that the unsigned order of the keys matches the float order
+    unsigned int bits = (unsigned int)__float_as_int( value );
+    return (bits & 0x80000000)? ~bits : (bits | 0x80000000);
+}
+
+//------------------------------------------------------------------------------
+inline __device__
+unsigned int scanBlock( unsigned int* sScan, unsigned int value )
+{
+    // Returns the exclusive prefix sum of value over the block.
+    // The total is stored in sScan[blockDim.x-1].
+    sScan[threadIdx.x] = value;
+    __syncthreads();
+
+    for( unsigned int offset=1; offset<blockDim.x; offset<<=1 )
+    {
+        unsigned int add = (threadIdx.x >= offset)? sScan[threadIdx.x-offset] : 0;
+        __syncthreads();
+        sScan[threadIdx.x] += add;
+        __syncthreads();
+    }
+
+    return sScan[threadIdx.x] - value;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS //////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//------------------------------------------------------------------------------
+__global__
+void depthKeysKernel( unsigned int numIndices, const unsigned int* indices,
+                      const unsigned char* vertices, unsigned int stride, unsigned int numVertices,
+                      float4 plane, unsigned int* keys )
+{
+    unsigned int i = blockIdx.x * blockDim.x + threadIdx.x;
+    if( i >= numIndices )
+        return;
+
+    // Indices which address no vertex are moved to the end
+    unsigned int index = indices[i];
+    if( index >= numVertices )
+    {
+        keys[i] = 0xFFFFFFFF;
+        return;
+    }
+
+    const float* pos = (const float*)( &vertices[(size_t)index * stride] );
+    keys[i] = floatToRadix( pos[0] * plane.x + pos[1] * plane.y + pos[2] * plane.z + plane.w );
+}
+
+//------------------------------------------------------------------------------
+__global__
+void localSortKernel( unsigned int numKeys, unsigned int shift,
+                      const unsigned int* keys, const unsigned int* values,
+                      unsigned int* localKeys, unsigned int* localValues, unsigned int* counts )
+{
+    __shared__ unsigned int sScan[SORT_THREADS];
+    __shared__ unsigned int sKeys[SORT_THREADS];
+    __shared__ unsigned int sValues[SORT_THREADS];
+    __shared__ unsigned int sCounts[RADIX_SIZE];
+
+    unsigned int i = blockIdx.x * SORT_THREADS + threadIdx.x;
+    bool valid = (i < numKeys);
+    unsigned int key = valid? keys[i] : 0xFFFFFFFF;
+    unsigned int value = valid? values[i] : 0;
+
+    if( threadIdx.x < RADIX_SIZE )
+        sCounts[threadIdx.x] = 0;
+    __syncthreads();
+
+    if( valid )
+        atomicAdd( &sCounts[(key >> shift) & RADIX_MASK], 1 );
+
+    // Sort the tile by the digit with one stable split per bit. Padding
+    // keys have all bits set and stay behind the valid keys.
+    for( unsigned int b=0; b<RADIX_BITS; ++b )
+    {
+        unsigned int bit = (key >> (shift + b)) & 1;
+        unsigned int numZerosBefore = scanBlock( sScan, 1 - bit );
+        unsigned int numZeros = sScan[SORT_THREADS-1];
+        unsigned int pos = bit? numZeros + threadIdx.x - numZerosBefore : numZerosBefore;
+        __syncthreads();
+
+        sKeys[pos] = key;
+        sValues[pos] = value;
+        __syncthreads();
+
+        key = sKeys[threadIdx.x];
+        value = sValues[threadIdx.x];
+    }
+
+    if( valid )
+    {
+        localKeys[i] = key;
+        localValues[i] = value;
+    }
+
+    // Digit counts are stored digit major so that a single scan
+    // returns the global offset of each digit of each tile
+    if( threadIdx.x < RADIX_SIZE )
+        counts[threadIdx.x * gridDim.x + blockIdx.x] = sCounts[threadIdx.x];
+}
+
+//------------------------------------------------------------------------------
+__global__
+void scanCountsKernel( const unsigned int* counts, unsigned int numCounts, unsigned int* offsets )
+{
+    __shared__ unsigned int sScan[SORT_THREADS];
+
+    // Each thread scans a contiguous chunk of the counts
+    unsigned int chunk = (numCounts + blockDim.x - 1) / blockDim.x;
+    unsigned int begin = threadIdx.x * chunk;
+    unsigned int end = min( begin + chunk, numCounts );
+
+    unsigned int sum = 0;
+    for( unsigned int c=begin; c<end; ++c )
+        sum += counts[c];
+
+    unsigned int offset = scanBlock( sScan, sum );
+    for( unsigned int c=begin; c<end; ++c )
+    {
+        offsets[c] = offset;
+        offset += counts[c];
+    }
+}
+
+//------------------------------------------------------------------------------
+__global__
+void scatterKernel( unsigned int numKeys, unsigned int shift,
+                    const unsigned int* localKeys, const unsigned int* localValues,
+                    const unsigned int* counts, const unsigned int* offsets,
+                    unsigned int* keys, unsigned int* values )
+{
+    __shared__ unsigned int sDigitStart[RADIX_SIZE];
+
+    // Start of each digit within the locally sorted tile
+    if( threadIdx.x == 0 )
+    {
+        unsigned int start = 0;
+        for( unsigned int d=0; d<RADIX_SIZE; ++d )
+        {
+            sDigitStart[d] = start;
+            start += counts[d * gridDim.x + blockIdx.x];
+        }
+    }
+    __syncthreads();
+
+    unsigned int i = blockIdx.x * SORT_THREADS + threadIdx.x;
+    if( i >= numKeys )
+        return;
+
+    unsigned int key = localKeys[i];
+    unsigned int digit = (key >> shift) & RADIX_MASK;
+    unsigned int dst = offsets[digit * gridDim.x + blockIdx.x] + threadIdx.x - sDigitStart[digit];
+    keys[dst] = key;
+    values[dst] = localValues[i];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// HOST FUNCTIONS ////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//------------------------------------------------------------------------------
+extern "C" __host__
+unsigned int depthSortScratchSize( unsigned int numIndices )
+{
+    // Keys, locally sorted keys and values, digit counts and offsets
+    unsigned int numBlocks = (numIndices + SORT_THREADS - 1) / SORT_THREADS;
+    return 3 * numIndices + 2 * RADIX_SIZE * numBlocks;
+}
+
+//------------------------------------------------------------------------------
+extern "C" __host__
+bool depthSort( unsigned int numIndices, unsigned int* indices,
+                const void* vertices, unsigned int stride, unsigned int numVertices,
+                float4 plane, unsigned int* scratch )
+{
+    unsigned int numBlocks = (numIndices + SORT_THREADS - 1) / SORT_THREADS;
+    unsigned int* keys = scratch;
+    unsigned int* localKeys = &keys[numIndices];
+    unsigned int* localValues = &localKeys[numIndices];
+    unsigned int* counts = &localValues[numIndices];
+    unsigned int* offsets = &counts[RADIX_SIZE * numBlocks];
+
+    depthKeysKernel<<< numBlocks, SORT_THREADS >>>(
+        numIndices, indices, (const unsigned char*)vertices, stride, numVertices, plane, keys );
+
+    // LSD radix sort. Each pass scatters back into keys and indices
+    // so the indices are sorted in place after the last pass.
+    for( unsigned int shift=0; shift<32; shift+=RADIX_BITS )
+    {
+        localSortKernel<<< numBlocks, SORT_THREADS >>>(
+            numIndices, shift, keys, indices, localKeys, localValues, counts );
+        scanCountsKernel<<< 1, SORT_THREADS >>>(
+            counts, RADIX_SIZE * numBlocks, offsets );
+        scatterKernel<<< numBlocks, SORT_THREADS >>>(
+            numIndices, shift, localKeys, localValues, counts, offsets, keys, indices );
+    }
+
+    return (cudaGetLastError() == cudaSuccess);
+}
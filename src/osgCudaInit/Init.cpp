@@ -97,7 +97,8 @@ namespace osgCuda
     bool setupOsgCudaAndViewer( osgViewer::ViewerBase& viewer, int ctxID /*= -1*/, int device /*= 0 */ )
     {
         // You must use single threaded version since osgCompute currently
-        // does only support single threaded applications. 
+        // does only support single threaded applications. Computations 
+        // can still overlap with rendering (see osgCuda::ComputeThread).
         viewer.setThreadingModel( osgViewer::ViewerBase::SingleThreaded );
 
         // Does create a single OpenGL context
@@ -1,6 +1,7 @@
 #include <osgDB/Registry>
 #include <osgDB/Input>
 #include <osgDB/Output>
+#include <osgDB/Options>
 #include <osgCompute/Program>
 #include <osgCompute/Memory>
 #include <osgCuda/Computation>
@@ -114,6 +115,14 @@ static bool readResources( osgDB::InputStream& is, osgCuda::Computation& computa
 	}
 
 	is >> is.END_BRACKET;
+
+	// Option "PrefetchMemoryData" loads the payloads of memory objects which
+	// refer to an external data file now and not during their first mapping.
+	// The payloads are read concurrently after all resources have been added.
+	const osgDB::Options* options = is.getOptions();
+	if( options != NULL && options->getOptionString().find("PrefetchMemoryData") != std::string::npos )
+		computation.prefetchResources( "" );
+
 	return true;
 }
 
@@ -159,35 +168,33 @@ static bool readPrograms( osgDB::InputStream& is, osgCuda::Computation& computat
 	unsigned int numMods = 0;  
 	is >> numMods >> is.BEGIN_BRACKET;
 
+	std::vector<std::string> moduleLibraryNames;
 	for( unsigned int i=0; i<numMods; ++i )
 	{
 		std::string moduleLibraryName;
 		is.readWrappedString( moduleLibraryName );
-        moduleLibraryName = osgCuda::trim( moduleLibraryName );
-
-		if( !osgCompute::Program::existsProgram(moduleLibraryName) )
-		{
-			osg::notify(osg::WARN) 
-				<<" osgCuda_Computation::readPrograms(): cannot find module library "
-				<< moduleLibraryName << "." << std::endl;
+		moduleLibraryNames.push_back( osgCuda::trim( moduleLibraryName ) );
+	}
 
-			continue;
-		}
+	is >> is.END_BRACKET;
 
-		osgCompute::Program* module = osgCompute::Program::loadProgram( moduleLibraryName );
-		if( module != NULL )
-		{
-			computation.addProgram( *module );
-		}
+	// Libraries are searched and linked concurrently. Programs are
+	// added in the order of the stream.
+	osgCompute::ProgramList modules;
+	osgCompute::Program::loadPrograms( moduleLibraryNames, modules );
+	for( osgCompute::ProgramListItr modItr = modules.begin(); modItr != modules.end(); ++modItr )
+	{
+		if( (*modItr).valid() )
+			computation.addProgram( *(*modItr) );
 	}
 
-	is >> is.END_BRACKET;
 	return true;
 }
 
 
 //------------------------------------------------------------------------------
-REGISTER_OBJECT_WRAPPER(osgCuda_Computation,
+REGISTER_CUSTOM_OBJECT_WRAPPER(osgCuda,
+						osgCuda_Computation,
 						new osgCuda::Computation,
 						osgCuda::Computation,
 						"osg::Object osg::Node osg::Group osgCuda::Computation" )
@@ -195,5 +202,12 @@ REGISTER_OBJECT_WRAPPER(osgCuda_Computation,
     ADD_USER_SERIALIZER( ComputeOrder );  // _computeOrder & _computeOrderNum
 	ADD_USER_SERIALIZER( Programs );
 	ADD_USER_SERIALIZER( Resources );
+	{
+		// Older streams keep the defaults, i.e. a launch every frame
+		UPDATE_TO_VERSION_SCOPED( OSGCUDA_SERIALIZER_VERSION_LAUNCH_RATE )
+		ADD_UINT_SERIALIZER( LaunchInterval, 1 );  // _launchInterval
+		ADD_DOUBLE_SERIALIZER( LaunchFrequency, 0.0 );  // _launchFrequency
+		ADD_DOUBLE_SERIALIZER( LaunchPhase, -1.0 );  // _launchPhase
+	}
 }
 
@@ -1,7 +1,20 @@
+#include <map>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <osg/Math>
+#include <osg/Notify>
+#include <osg/observer_ptr>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <osgDB/FileUtils>
+#include <osgDB/Options>
 #include <osgDB/Registry>
 #include <osgDB/Input>
 #include <osgDB/Output>
 #include <osgCompute/Memory>
+#include <osgCompute/ByteSwap>
+#include "Util.h"
 
 //------------------------------------------------------------------------------
 static bool checkDimensions( const osgCompute::Memory& memory )
@@ -42,9 +55,270 @@ static bool readDimensions( osgDB::InputStream& is, osgCompute::Memory& memory )
 	return true;
 }
 
+// Storage of the memory contents within a stream
+enum DataStorage
+{
+	DATA_NONE = 0,		// contents are not stored
+	DATA_EMBEDDED = 1,	// raw payload within the binary stream
+	DATA_EXTERNAL = 2,	// reference to a payload in an external data file
+};
+
+// The upper bits of the storage value describe the byte order of the
+// payload: bits 8-15 hold the word size and DATA_BIG_ENDIAN is set for
+// big-endian payloads. Older streams do not set these bits.
+static const unsigned int DATA_STORAGE_MASK = 0xFF;
+static const unsigned int DATA_WORD_SIZE_SHIFT = 8;
+static const unsigned int DATA_BIG_ENDIAN = 0x10000;
+
+// Payloads which need a byte order conversion are converted in chunks
+// which fit into the cache
+static const unsigned int DATA_SWAP_CHUNK_SIZE = 1 << 18;
 
 //------------------------------------------------------------------------------
-REGISTER_OBJECT_WRAPPER(osgCompute_Memory,
+template<class Writer>
+static void writeSwapped( Writer& writer, const char* data, unsigned int byteSize, unsigned int swapWordSize )
+{
+	if( swapWordSize == 0 )
+	{
+		writer( data, byteSize );
+		return;
+	}
+
+	unsigned int chunkSize = DATA_SWAP_CHUNK_SIZE - (DATA_SWAP_CHUNK_SIZE % swapWordSize);
+	std::vector<char> chunk( chunkSize );
+	for( unsigned int done = 0; done < byteSize; done += chunkSize )
+	{
+		unsigned int count = osg::minimum( chunkSize, byteSize - done );
+		osgCompute::copySwapped( &data[done], &chunk.front(), count, swapWordSize );
+		writer( &chunk.front(), count );
+	}
+}
+
+struct StreamWriter
+{
+	StreamWriter( osgDB::OutputStream& os ) : _os(os) {}
+	void operator()( const char* data, unsigned int size ) { _os.writeCharArray( data, size ); }
+	osgDB::OutputStream& _os;
+};
+
+struct FileWriter
+{
+	FileWriter( std::ofstream& file ) : _file(file) {}
+	void operator()( const char* data, unsigned int size ) { _file.write( data, size ); }
+	std::ofstream& _file;
+};
+
+//------------------------------------------------------------------------------
+static std::string getDataFileName( const osgDB::Options* options )
+{
+	// Option "MemoryDataFile=<file>" moves the payload of all memory
+	// objects to <file>. The file is truncated at the beginning of each
+	// write session, so do not write to the data file of a scene which
+	// has been loaded lazily.
+	if( options == NULL )
+		return std::string();
+
+	const std::string optionName = "MemoryDataFile=";
+	std::istringstream iss( options->getOptionString() );
+	std::string opt;
+	while( iss >> opt )
+	{
+		if( opt.compare( 0, optionName.size(), optionName ) == 0 )
+			return opt.substr( optionName.size() );
+	}
+
+	return std::string();
+}
+
+// A data file is truncated by the first payload of each write session. The
+// writer plugin clones the options for each file it writes, so the options
+// of the stream identify the session.
+struct DataFileSession
+{
+	osg::observer_ptr<const osgDB::Options>	_options;
+	const osgDB::OutputStream*				_stream;
+};
+
+static OpenThreads::Mutex						s_dataFileMutex;
+static std::map<std::string,DataFileSession>	s_dataFileSessions;
+
+//------------------------------------------------------------------------------
+static bool beginDataFileSession( const std::string& dataFileName, const osgDB::OutputStream& os )
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock( s_dataFileMutex );
+
+	DataFileSession& session = s_dataFileSessions[dataFileName];
+	if( session._options.valid() && session._options.get() == os.getOptions() && session._stream == &os )
+		return false;
+
+	session._options = os.getOptions();
+	session._stream = &os;
+	return true;
+}
+
+//------------------------------------------------------------------------------
+static bool checkData( const osgCompute::Memory& memory )
+{
+	// Only memory which has been allocated or which refers to a file
+	// carries data which is not reproducible from the other properties
+	return !memory.objectsReleased() || memory.getFileReference() != NULL;
+}
+
+//------------------------------------------------------------------------------
+static bool writeData( osgDB::OutputStream& os, const osgCompute::Memory& memory )
+{
+	osgCompute::Memory& mutableMemory = const_cast<osgCompute::Memory&>( memory );
+	std::string dataFileName = getDataFileName( os.getOptions() );
+
+	unsigned int storage = DATA_NONE;
+	unsigned int byteSize = 0;
+	unsigned long long offset = 0;
+	const char* data = NULL;
+	unsigned int swapWordSize = memory.getDataSwapWordSize();
+	if( !dataFileName.empty() )
+	{
+		data = static_cast<const char*>( mutableMemory.map( osgCompute::MAP_HOST_SOURCE ) );
+		if( data != NULL )
+		{
+			// Remove the payloads of earlier sessions
+			std::ios::openmode mode = std::ios::out | std::ios::binary;
+			mode |= beginDataFileSession( dataFileName, os )? std::ios::trunc : std::ios::app;
+
+			std::ofstream file( dataFileName.c_str(), mode );
+			file.seekp( 0, std::ios::end );
+			offset = static_cast<unsigned long long>( file.tellp() );
+			FileWriter writer( file );
+			writeSwapped( writer, data, memory.getAllElementsSize(), swapWordSize );
+
+			if( file.good() )
+			{
+				storage = DATA_EXTERNAL;
+				byteSize = memory.getAllElementsSize();
+			}
+			else
+			{
+				osg::notify(osg::WARN)
+					<< "osgCompute_Memory: \"" << memory.getName() << "\": cannot write to \""
+					<< dataFileName << "\"."
+					<< std::endl;
+			}
+		}
+	}
+	else if( os.isBinary() )
+	{
+		// The raw payload is written in binary streams only.
+		data = static_cast<const char*>( mutableMemory.map( osgCompute::MAP_HOST_SOURCE ) );
+		if( data != NULL )
+		{
+			storage = DATA_EMBEDDED;
+			byteSize = memory.getAllElementsSize();
+		}
+	}
+
+	unsigned int storageFlags = storage;
+	if( storage != DATA_NONE && memory.getDataWordSize() != 0 )
+	{
+		storageFlags |= memory.getDataWordSize() << DATA_WORD_SIZE_SHIFT;
+		if( memory.getDataByteOrder() == osg::BigEndian )
+			storageFlags |= DATA_BIG_ENDIAN;
+	}
+
+	os << storageFlags << byteSize << os.BEGIN_BRACKET << std::endl;
+	if( storage == DATA_EMBEDDED )
+	{
+		StreamWriter writer( os );
+		writeSwapped( writer, data, byteSize, swapWordSize );
+	}
+	else if( storage == DATA_EXTERNAL )
+	{
+		os.writeWrappedString( dataFileName );
+		os << (unsigned int)(offset >> 32) << (unsigned int)(offset & 0xFFFFFFFF) << std::endl;
+	}
+	os << os.END_BRACKET << std::endl;
+
+	if( data != NULL )
+		mutableMemory.unmap();
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+static bool readData( osgDB::InputStream& is, osgCompute::Memory& memory )
+{
+	unsigned int storageFlags = DATA_NONE;
+	unsigned int byteSize = 0;
+	is >> storageFlags >> byteSize >> is.BEGIN_BRACKET;
+
+	unsigned int storage = storageFlags & DATA_STORAGE_MASK;
+	unsigned int wordSize = (storageFlags >> DATA_WORD_SIZE_SHIFT) & 0xFF;
+	if( wordSize != 0 )
+		memory.setDataByteOrder( (storageFlags & DATA_BIG_ENDIAN)? osg::BigEndian : osg::LittleEndian, wordSize );
+	unsigned int swapWordSize = memory.getDataSwapWordSize();
+
+	if( storage == DATA_EMBEDDED && byteSize != 0 )
+	{
+		// Read the payload directly into the host memory of the
+		// object. The device memory is synchronized on first use.
+		char* data = NULL;
+		if( byteSize == memory.getAllElementsSize() )
+			data = static_cast<char*>( memory.map( osgCompute::MAP_HOST_TARGET ) );
+
+		if( data != NULL )
+		{
+			if( swapWordSize == 0 )
+			{
+				is.readCharArray( data, byteSize );
+			}
+			else
+			{
+				// Convert each chunk right after it has been read
+				unsigned int chunkSize = DATA_SWAP_CHUNK_SIZE - (DATA_SWAP_CHUNK_SIZE % swapWordSize);
+				for( unsigned int done = 0; done < byteSize; done += chunkSize )
+				{
+					unsigned int count = osg::minimum( chunkSize, byteSize - done );
+					is.readCharArray( &data[done], count );
+					osgCompute::swapBytes( &data[done], count, swapWordSize );
+				}
+			}
+			memory.unmap();
+		}
+		else
+		{
+			osg::notify(osg::WARN)
+				<< "osgCompute_Memory: \"" << memory.getName() << "\": cannot restore "
+				<< byteSize << " bytes of memory data. Data is skipped."
+				<< std::endl;
+
+			std::vector<char> skip( byteSize );
+			is.readCharArray( &skip.front(), byteSize );
+		}
+	}
+	else if( storage == DATA_EXTERNAL )
+	{
+		// Only keep a reference to the payload. It is loaded
+		// during the first call to map().
+		std::string dataFileName;
+		is.readWrappedString( dataFileName );
+		dataFileName = osgCuda::trim( dataFileName );
+
+		unsigned int offsetHigh = 0, offsetLow = 0;
+		is >> offsetHigh >> offsetLow;
+		unsigned long long offset = (static_cast<unsigned long long>( offsetHigh ) << 32) | offsetLow;
+
+		std::string filePath = osgDB::findDataFile( dataFileName, is.getOptions() );
+		if( filePath.empty() )
+			filePath = dataFileName;
+
+		memory.setFileReference( new osgCompute::MemoryFileReference( filePath, offset, byteSize ) );
+	}
+
+	is >> is.END_BRACKET;
+	return true;
+}
+
+//------------------------------------------------------------------------------
+REGISTER_CUSTOM_OBJECT_WRAPPER(osgCompute,
+						osgCompute_Memory,
 						NULL,
 						osgCompute::Memory,
 						"osg::Object osgCompute::Resource osgCompute::Memory" )
@@ -54,5 +328,12 @@ REGISTER_OBJECT_WRAPPER(osgCompute_Memory,
 	ADD_UINT_SERIALIZER( AllocHint, 0 );
     ADD_UINT_SERIALIZER( SwapCount, 0 );
     ADD_UINT_SERIALIZER( SwapIdx, 0 );
+	{
+		// Streams without the osgCompute domain version do not contain the
+		// contents. readData() is not called for them and the memory keeps
+		// its default, unloaded contents.
+		UPDATE_TO_VERSION_SCOPED( OSGCOMPUTE_SERIALIZER_VERSION_MEMORY_DATA )
+		ADD_USER_SERIALIZER( Data );
+	}
 }
 
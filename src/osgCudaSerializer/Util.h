@@ -2,6 +2,15 @@
 #define OSGCUDA_SERIALIZER_UTIL_H
 
 #include <string>
+
+// Versions of the custom serializer domains at which properties have been
+// added to an existing wrapper. The properties are guarded by 
+// UPDATE_TO_VERSION_SCOPED. Streams written before a property existed do not
+// contain it and it is skipped while reading them. The libraries register the
+// current version of their domain for writers (see osgCompute/Serializer).
+#define OSGCOMPUTE_SERIALIZER_VERSION_MEMORY_DATA 1
+#define OSGCUDA_SERIALIZER_VERSION_LAUNCH_RATE 1
+
 namespace osgCuda
 {
     std::string trim( const std::string& str );
@@ -0,0 +1,365 @@
+#include <iostream>
+#include <osg/Notify>
+#include <osg/Math>
+#include <osg/View>
+#include <osgCompute/Resource>
+#include <osgCudaStats/StatsRecorder>
+
+namespace osgCuda
+{
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    StatsRecorder::StatsRecorder()
+        : _format(FORMAT_CSV),
+          _sampleInterval(0.0),
+          _lastSampleTime(0.0),
+          _refreshInterval(0),
+          _numSamples(0),
+          _flushEachSample(false),
+          _headerWritten(false),
+          _refresh(true),
+          _stream(&std::cout)
+    {
+        _memoryClasses.push_back( "osgCuda::Buffer" );
+        _memoryClasses.push_back( "osgCuda::TextureMemory" );
+        _memoryClasses.push_back( "osgCuda::GeometryMemory" );
+        _memoryClasses.push_back( "osgCuda::IndexedGeometryMemory" );
+    }
+
+    //------------------------------------------------------------------------------
+    bool StatsRecorder::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter& aa)
+    {
+        if( ea.getEventType() != osgGA::GUIEventAdapter::FRAME )
+            return false;
+
+        osg::View* view = aa.asView();
+        unsigned int frameNumber = _numSamples;
+        if( view && view->getFrameStamp() )
+            frameNumber = view->getFrameStamp()->getFrameNumber();
+
+        sample( frameNumber, ea.getTime() );
+        return false;
+    }
+
+    //------------------------------------------------------------------------------
+    bool StatsRecorder::open( const std::string& filename )
+    {
+        close();
+
+        _file.open( filename.c_str(), std::ios::out | std::ios::trunc );
+        if( !_file.is_open() )
+        {
+            osg::notify(osg::WARN)
+                << __FUNCTION__ << ": cannot open file \"" << filename << "\"."
+                << std::endl;
+
+            _stream = &std::cout;
+            return false;
+        }
+
+        _stream = &_file;
+        _headerWritten = false;
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    void StatsRecorder::setOutputStream( std::ostream& out )
+    {
+        close();
+        _stream = &out;
+        _headerWritten = false;
+    }
+
+    //------------------------------------------------------------------------------
+    void StatsRecorder::close()
+    {
+        if( _file.is_open() )
+        {
+            _file.flush();
+            _file.close();
+        }
+
+        _stream = &std::cout;
+    }
+
+    //------------------------------------------------------------------------------
+    void StatsRecorder::setFormat( Format format )
+    {
+        _format = format;
+        _headerWritten = false;
+    }
+
+    //------------------------------------------------------------------------------
+    StatsRecorder::Format StatsRecorder::getFormat() const
+    {
+        return _format;
+    }
+
+    //------------------------------------------------------------------------------
+    void StatsRecorder::setSampleInterval( double interval )
+    {
+        _sampleInterval = osg::maximum( interval, 0.0 );
+    }
+
+    //------------------------------------------------------------------------------
+    double StatsRecorder::getSampleInterval() const
+    {
+        return _sampleInterval;
+    }
+
+    //------------------------------------------------------------------------------
+    void StatsRecorder::setRefreshInterval( unsigned int numSamples )
+    {
+        _refreshInterval = numSamples;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int StatsRecorder::getRefreshInterval() const
+    {
+        return _refreshInterval;
+    }
+
+    //------------------------------------------------------------------------------
+    void StatsRecorder::setFlushEachSample( bool flush )
+    {
+        _flushEachSample = flush;
+    }
+
+    //------------------------------------------------------------------------------
+    bool StatsRecorder::getFlushEachSample() const
+    {
+        return _flushEachSample;
+    }
+
+    //------------------------------------------------------------------------------
+    void StatsRecorder::addMemoryClass( const std::string& classIdentifier )
+    {
+        for( std::vector<std::string>::iterator itr = _memoryClasses.begin(); itr != _memoryClasses.end(); ++itr )
+            if( (*itr) == classIdentifier )
+                return;
+
+        _memoryClasses.push_back( classIdentifier );
+        _refresh = true;
+    }
+
+    //------------------------------------------------------------------------------
+    void StatsRecorder::clearMemoryClasses()
+    {
+        _memoryClasses.clear();
+        _refresh = true;
+    }
+
+    //------------------------------------------------------------------------------
+    void StatsRecorder::refreshResources()
+    {
+        // Keep the capacity of the entry lists so that a
+        // refresh with a stable resource count does not reallocate
+        _memories.clear();
+        _timers.clear();
+
+        osgCompute::ResourceClassList curResources;
+        for( std::vector<std::string>::iterator classItr = _memoryClasses.begin(); classItr != _memoryClasses.end(); ++classItr )
+        {
+            curResources = osgCompute::ResourceObserver::instance()->getResources( *classItr );
+            for( osgCompute::ResourceClassListItr itr = curResources.begin(); itr != curResources.end(); ++itr )
+            {
+                osgCompute::Memory* memory = dynamic_cast<osgCompute::Memory*>( (*itr).get() );
+                if( NULL == memory )
+                    continue;
+
+                MemoryEntry entry;
+                entry.name = memory->getName();
+                if( entry.name.empty() )
+                {
+                    osgCompute::GLMemory* glMemory = dynamic_cast<osgCompute::GLMemory*>( memory );
+                    osg::Object* adapter = (glMemory != NULL)? dynamic_cast<osg::Object*>( glMemory->getAdapter() ) : NULL;
+                    if( adapter != NULL )
+                        entry.name = adapter->getName();
+                }
+                if( entry.name.empty() )
+                    entry.name = "[NoName]";
+
+                entry.memory = memory;
+                _memories.push_back( entry );
+            }
+        }
+
+        curResources = osgCompute::ResourceObserver::instance()->getResources( "osgCuda::Timer" );
+        for( osgCompute::ResourceClassListItr itr = curResources.begin(); itr != curResources.end(); ++itr )
+        {
+            osgCuda::Timer* timer = dynamic_cast<osgCuda::Timer*>( (*itr).get() );
+            if( NULL == timer )
+                continue;
+
+            TimerEntry entry;
+            entry.name = timer->getName().empty()? std::string("[NoName]") : timer->getName();
+            entry.timer = timer;
+            _timers.push_back( entry );
+        }
+
+        _refresh = false;
+    }
+
+    //------------------------------------------------------------------------------
+    bool StatsRecorder::sample( unsigned int frameNumber, double time )
+    {
+        if( _numSamples != 0 && (time - _lastSampleTime) < _sampleInterval )
+            return false;
+
+        if( _refresh || (_refreshInterval != 0 && _numSamples % _refreshInterval == 0) )
+            refreshResources();
+
+        if( !_headerWritten )
+            writeHeader();
+
+        switch( _format )
+        {
+        case FORMAT_JSON: writeJSON( frameNumber, time ); break;
+        default: writeCSV( frameNumber, time ); break;
+        }
+
+        if( _flushEachSample )
+            out().flush();
+
+        _lastSampleTime = time;
+        _numSamples++;
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int StatsRecorder::getNumSamples() const
+    {
+        return _numSamples;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PROTECTED FUNCTIONS //////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    StatsRecorder::~StatsRecorder()
+    {
+        close();
+    }
+
+    //------------------------------------------------------------------------------
+    std::ostream& StatsRecorder::out()
+    {
+        return *_stream;
+    }
+
+    //------------------------------------------------------------------------------
+    void StatsRecorder::writeHeader()
+    {
+        // JSON samples are self describing lines
+        if( _format == FORMAT_CSV )
+            out() << "frame,time,type,name,host_bytes,device_bytes,array_bytes,last_ms,ave_ms,peak_ms,calls" << std::endl;
+
+        _headerWritten = true;
+    }
+
+    //------------------------------------------------------------------------------
+    void StatsRecorder::writeCSV( unsigned int frameNumber, double time )
+    {
+        std::ostream& os = out();
+
+        for( std::vector<MemoryEntry>::iterator itr = _memories.begin(); itr != _memories.end(); ++itr )
+        {
+            // Skip deleted and released memory as the StatsHandler does
+            if( !(*itr).memory.valid() || (*itr).memory->objectsReleased() )
+                continue;
+
+            os << frameNumber << ',' << time << ",memory,";
+            writeEscaped( (*itr).name );
+            os << ',' << (*itr).memory->getAllocatedByteSize( osgCompute::MAP_HOST )
+               << ',' << (*itr).memory->getAllocatedByteSize( osgCompute::MAP_DEVICE )
+               << ',' << (*itr).memory->getAllocatedByteSize( osgCompute::MAP_DEVICE_ARRAY )
+               << ",,,,\n";
+        }
+
+        for( std::vector<TimerEntry>::iterator itr = _timers.begin(); itr != _timers.end(); ++itr )
+        {
+            if( !(*itr).timer.valid() )
+                continue;
+
+            os << frameNumber << ',' << time << ",timer,";
+            writeEscaped( (*itr).name );
+            os << ",,,,"
+               << (*itr).timer->getLastTime() << ','
+               << (*itr).timer->getAveTime() << ','
+               << (*itr).timer->getPeakTime() << ','
+               << (*itr).timer->getCalls() << '\n';
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    void StatsRecorder::writeJSON( unsigned int frameNumber, double time )
+    {
+        std::ostream& os = out();
+
+        os << "{\"frame\":" << frameNumber << ",\"time\":" << time << ",\"memory\":[";
+        bool first = true;
+        for( std::vector<MemoryEntry>::iterator itr = _memories.begin(); itr != _memories.end(); ++itr )
+        {
+            if( !(*itr).memory.valid() || (*itr).memory->objectsReleased() )
+                continue;
+
+            if( !first ) os << ',';
+            first = false;
+
+            os << "{\"name\":";
+            writeEscaped( (*itr).name );
+            os << ",\"host\":" << (*itr).memory->getAllocatedByteSize( osgCompute::MAP_HOST )
+               << ",\"device\":" << (*itr).memory->getAllocatedByteSize( osgCompute::MAP_DEVICE )
+               << ",\"array\":" << (*itr).memory->getAllocatedByteSize( osgCompute::MAP_DEVICE_ARRAY )
+               << '}';
+        }
+
+        os << "],\"timers\":[";
+        first = true;
+        for( std::vector<TimerEntry>::iterator itr = _timers.begin(); itr != _timers.end(); ++itr )
+        {
+            if( !(*itr).timer.valid() )
+                continue;
+
+            if( !first ) os << ',';
+            first = false;
+
+            os << "{\"name\":";
+            writeEscaped( (*itr).name );
+            os << ",\"last\":" << (*itr).timer->getLastTime()
+               << ",\"ave\":" << (*itr).timer->getAveTime()
+               << ",\"peak\":" << (*itr).timer->getPeakTime()
+               << ",\"calls\":" << (*itr).timer->getCalls()
+               << '}';
+        }
+        os << "]}\n";
+    }
+
+    //------------------------------------------------------------------------------
+    void StatsRecorder::writeEscaped( const std::string& str )
+    {
+        // Names are always quoted. CSV doubles embedded quotes,
+        // JSON escapes quotes, backslashes and control characters.
+        std::ostream& os = out();
+        os << '"';
+        for( std::string::const_iterator itr = str.begin(); itr != str.end(); ++itr )
+        {
+            char c = (*itr);
+            if( _format == FORMAT_CSV )
+            {
+                if( c == '"' ) os << '"';
+                os << c;
+            }
+            else
+            {
+                if( c == '"' || c == '\\' ) os << '\\' << c;
+                else if( c == '\n' ) os << "\\n";
+                else if( static_cast<unsigned char>(c) < 0x20 ) os << ' ';
+                else os << c;
+            }
+        }
+        os << '"';
+    }
+}
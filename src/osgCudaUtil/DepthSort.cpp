@@ -0,0 +1,313 @@
+#include <cstring>
+#include <osg/Notify>
+#include <osgComputeAlgo/Primitives>
+#include <osgCudaUtil/DepthSort>
+
+namespace osgCuda
+{
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    DepthSort::DepthSort()
+        : osgCompute::Program(),
+          _sortOrder(BACK_TO_FRONT),
+          _incrementalLimit(1.0f)
+    {
+        clearLocal();
+        osgCompute::ResourceObserver::instance()->observeResource( *this );
+    }
+
+    //------------------------------------------------------------------------------
+    void DepthSort::launch()
+    {
+        if( !_geometry.valid() || !_camera.valid() )
+            return;
+
+        osg::Geometry::DrawElementsList drawElementsList;
+        _geometry->getDrawElementsList( drawElementsList );
+        if( drawElementsList.size() != 1 ||
+            drawElementsList[0]->getType() != osg::PrimitiveSet::DrawElementsUIntPrimitiveType )
+        {
+            osg::notify(osg::WARN)
+                << "osgCuda::DepthSort::launch(): \"" << _geometry->getName()
+                << "\" must have a single osg::DrawElementsUInt primitive set. Program is disabled."
+                << std::endl;
+            disable();
+            return;
+        }
+
+        const osg::Array* vertices = _geometry->getVertexArray();
+        if( vertices == NULL || vertices->getNumElements() == 0 ||
+            vertices->getDataType() != GL_FLOAT || vertices->getDataSize() < 3 )
+        {
+            osg::notify(osg::WARN)
+                << "osgCuda::DepthSort::launch(): \"" << _geometry->getName()
+                << "\" has no float vertices. Program is disabled."
+                << std::endl;
+            disable();
+            return;
+        }
+
+        unsigned int numIndices = drawElementsList[0]->getNumIndices();
+        unsigned int numVertices = vertices->getNumElements();
+        unsigned int stride = vertices->getTotalDataSize() / numVertices;
+        if( numIndices < 2 )
+            return;
+
+        if( !sortIndices( stride, numVertices, numIndices ) )
+        {
+            osg::notify(osg::WARN)
+                << "osgCuda::DepthSort::launch(): \"" << _geometry->getName()
+                << "\" has indices which address no vertex. Program is disabled."
+                << std::endl;
+            disable();
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    DepthSort* DepthSort::create()
+    {
+        osg::ref_ptr<osgCompute::Program> program = osgCompute::Program::loadProgram( "osgcuda_depthsort" );
+        if( dynamic_cast<DepthSort*>( program.get() ) != NULL )
+            return static_cast<DepthSort*>( program.release() );
+
+        osg::notify(osg::INFO)
+            << "osgCuda::DepthSort::create(): cannot load \"osgcuda_depthsort\". Sorting on the host."
+            << std::endl;
+        return new DepthSort;
+    }
+
+    //------------------------------------------------------------------------------
+    void DepthSort::setGeometry( osgCuda::Geometry* geometry )
+    {
+        _geometry = geometry;
+        if( _geometry.valid() )
+            _geometry->setUseIndexMapping( true );
+    }
+
+    //------------------------------------------------------------------------------
+    osgCuda::Geometry* DepthSort::getGeometry()
+    {
+        return _geometry.get();
+    }
+
+    //------------------------------------------------------------------------------
+    const osgCuda::Geometry* DepthSort::getGeometry() const
+    {
+        return _geometry.get();
+    }
+
+    //------------------------------------------------------------------------------
+    void DepthSort::setCamera( osg::Camera* camera )
+    {
+        _camera = camera;
+    }
+
+    //------------------------------------------------------------------------------
+    osg::Camera* DepthSort::getCamera()
+    {
+        return _camera.get();
+    }
+
+    //------------------------------------------------------------------------------
+    const osg::Camera* DepthSort::getCamera() const
+    {
+        return _camera.get();
+    }
+
+    //------------------------------------------------------------------------------
+    void DepthSort::setSortOrder( SortOrder order )
+    {
+        _sortOrder = order;
+    }
+
+    //------------------------------------------------------------------------------
+    DepthSort::SortOrder DepthSort::getSortOrder() const
+    {
+        return _sortOrder;
+    }
+
+    //------------------------------------------------------------------------------
+    void DepthSort::setIncrementalLimit( float limit )
+    {
+        _incrementalLimit = (limit < 0.0f)? 0.0f : limit;
+    }
+
+    //------------------------------------------------------------------------------
+    float DepthSort::getIncrementalLimit() const
+    {
+        return _incrementalLimit;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int DepthSort::getNumFullSorts() const
+    {
+        return _numFullSorts;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int DepthSort::getNumIncrementalSorts() const
+    {
+        return _numIncrementalSorts;
+    }
+
+    //------------------------------------------------------------------------------
+    void DepthSort::clear()
+    {
+        clearLocal();
+        osgCompute::Program::clear();
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PROTECTED FUNCTIONS //////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    void DepthSort::clearLocal()
+    {
+        _geometry = NULL;
+        _camera = NULL;
+        _numFullSorts = 0;
+        _numIncrementalSorts = 0;
+        _keys.clear();
+        _keyBuffer = NULL;
+        _indexBuffer = NULL;
+    }
+
+    //------------------------------------------------------------------------------
+    bool DepthSort::sortIndices( unsigned int stride, unsigned int numVertices, unsigned int numIndices )
+    {
+        // Vertex positions are stored first
+        osgCompute::Memory* memory = _geometry->getMemory();
+        const unsigned char* vertexPtr = static_cast<const unsigned char*>( memory->map( osgCompute::MAP_HOST_SOURCE ) );
+        unsigned int* indexPtr = static_cast<unsigned int*>( memory->map( MAP_HOST_INDICES ) );
+        if( vertexPtr == NULL || indexPtr == NULL )
+            return true;
+
+        if( !computeKeys( vertexPtr, stride, numVertices, indexPtr, numIndices ) )
+            return false;
+
+        // The indices are in the order of the last frame
+        if( sortIncremental( indexPtr, numIndices ) )
+        {
+            _numIncrementalSorts++;
+        }
+        else if( sortFull( indexPtr, numIndices ) )
+        {
+            _numFullSorts++;
+        }
+
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    osg::Vec4f DepthSort::getDepthPlane() const
+    {
+        osg::Matrix modelView = _camera->getViewMatrix();
+        osg::MatrixList worldMatrices = _geometry->getWorldMatrices();
+        if( !worldMatrices.empty() )
+            modelView = worldMatrices.front() * modelView;
+
+        // Only the z coordinate in view space is required. View space
+        // looks along -z so ascending keys sort from back to front.
+        float sign = (_sortOrder == BACK_TO_FRONT)? 1.0f : -1.0f;
+        return osg::Vec4f(
+            sign * static_cast<float>( modelView(0,2) ),
+            sign * static_cast<float>( modelView(1,2) ),
+            sign * static_cast<float>( modelView(2,2) ),
+            sign * static_cast<float>( modelView(3,2) ) );
+    }
+
+    //------------------------------------------------------------------------------
+    bool DepthSort::computeKeys( const unsigned char* vertices, unsigned int stride, unsigned int numVertices,
+        const unsigned int* indices, unsigned int numIndices )
+    {
+        osg::Vec4f plane = getDepthPlane();
+
+        _keys.resize( numIndices );
+        for( unsigned int i=0; i<numIndices; ++i )
+        {
+            if( indices[i] >= numVertices )
+                return false;
+
+            const float* pos = reinterpret_cast<const float*>( &vertices[indices[i] * stride] );
+            _keys[i] = pos[0] * plane.x() + pos[1] * plane.y() + pos[2] * plane.z() + plane.w();
+        }
+
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    bool DepthSort::sortIncremental( unsigned int* indices, unsigned int numIndices )
+    {
+        // Insertion sort with an upper bound of element moves. Indices which
+        // have been moved already stay valid if the bound is exceeded.
+        double maxMoves = static_cast<double>( _incrementalLimit ) * numIndices;
+        double numMoves = 0.0;
+
+        float* keys = &_keys.front();
+        for( unsigned int i=1; i<numIndices; ++i )
+        {
+            float key = keys[i];
+            if( !(key < keys[i-1]) )
+                continue;
+
+            unsigned int index = indices[i];
+            unsigned int j = i;
+            do
+            {
+                keys[j] = keys[j-1];
+                indices[j] = indices[j-1];
+                --j;
+            }
+            while( j > 0 && key < keys[j-1] );
+
+            keys[j] = key;
+            indices[j] = index;
+
+            numMoves += static_cast<double>( i - j );
+            if( numMoves > maxMoves )
+                return false;
+        }
+
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    bool DepthSort::sortFull( unsigned int* indices, unsigned int numIndices )
+    {
+        if( !_keyBuffer.valid() || _keyBuffer->getNumElements() != numIndices )
+        {
+            _keyBuffer = new osgCuda::Buffer;
+            _keyBuffer->setName( "DepthSortKeys" );
+            _keyBuffer->setElementSize( sizeof(float) );
+            _keyBuffer->setDimension( 0, numIndices );
+
+            _indexBuffer = new osgCuda::Buffer;
+            _indexBuffer->setName( "DepthSortIndices" );
+            _indexBuffer->setElementSize( sizeof(unsigned int) );
+            _indexBuffer->setDimension( 0, numIndices );
+        }
+
+        float* keyPtr = static_cast<float*>( _keyBuffer->map( osgCompute::MAP_HOST_TARGET ) );
+        unsigned int* indexPtr = static_cast<unsigned int*>( _indexBuffer->map( osgCompute::MAP_HOST_TARGET ) );
+        if( keyPtr == NULL || indexPtr == NULL )
+            return false;
+
+        memcpy( keyPtr, &_keys.front(), numIndices * sizeof(float) );
+        memcpy( indexPtr, indices, numIndices * sizeof(unsigned int) );
+        _keyBuffer->unmap();
+        _indexBuffer->unmap();
+
+        if( !osgComputeAlgo::sortByKey( *_keyBuffer, _indexBuffer.get(), osgComputeAlgo::TYPE_FLOAT ) )
+            return false;
+
+        indexPtr = static_cast<unsigned int*>( _indexBuffer->map( osgCompute::MAP_HOST_SOURCE ) );
+        if( indexPtr == NULL )
+            return false;
+
+        memcpy( indices, indexPtr, numIndices * sizeof(unsigned int) );
+        _indexBuffer->unmap();
+        return true;
+    }
+}
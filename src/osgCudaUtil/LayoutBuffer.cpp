@@ -0,0 +1,303 @@
+#include <osg/Notify>
+#include <osgCompute/Callback>
+#include <osgCudaUtil/LayoutBuffer>
+#include "LayoutTranspose.h"
+
+namespace osgCuda
+{
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // SUBLOAD CALLBACK /////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // Attached to the source in order to detect writes. The callback which
+    // has been attached to the source before is still called.
+    class LayoutSubloadCallback : public osgCompute::SubloadCallback
+    {
+    public:
+        LayoutSubloadCallback() : _layoutBuffer(NULL) {}
+        LayoutSubloadCallback( const LayoutSubloadCallback& copy, const osg::CopyOp& copyop )
+            : osg::Object( copy, copyop ), osgCompute::SubloadCallback(), _layoutBuffer(NULL) {}
+
+        META_Object( osgCuda, LayoutSubloadCallback )
+
+        //------------------------------------------------------------------------------
+        virtual void subload( void* mappedPtr, unsigned int mapping, unsigned int offset, const osgCompute::Resource& resource ) const
+        {
+            checkWrite( mapping );
+            if( _previous.valid() )
+                _previous->subload( mappedPtr, mapping, offset, resource );
+        }
+
+        //------------------------------------------------------------------------------
+        virtual void load( void* mappedPtr, unsigned int mapping, unsigned int offset, const osgCompute::Resource& resource ) const
+        {
+            checkWrite( mapping );
+            if( _previous.valid() )
+                _previous->load( mappedPtr, mapping, offset, resource );
+        }
+
+        // The layout buffer owns the callback
+        LayoutBuffer*                                   _layoutBuffer;
+        osg::ref_ptr<osgCompute::SubloadCallback>       _previous;
+
+    protected:
+        virtual ~LayoutSubloadCallback() {}
+
+        //------------------------------------------------------------------------------
+        void checkWrite( unsigned int mapping ) const
+        {
+            if( _layoutBuffer == NULL || _layoutBuffer->_updatingSource )
+                return;
+
+            if( (mapping & osgCompute::MAP_HOST_TARGET) == osgCompute::MAP_HOST_TARGET ||
+                (mapping & osgCompute::MAP_DEVICE_TARGET) == osgCompute::MAP_DEVICE_TARGET )
+                _layoutBuffer->_viewStale = true;
+        }
+    };
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+	// PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    LayoutBuffer::LayoutBuffer()
+        : osgCuda::Buffer()
+    {
+        clearLocal();
+        osgCompute::ResourceObserver::instance()->observeResource( *this );
+    }
+
+    //------------------------------------------------------------------------------
+    bool LayoutBuffer::setSource( osgCompute::Memory& source, unsigned int numComponents, Layout layout )
+    {
+        removeSource();
+
+        unsigned int componentSize = 0;
+        unsigned int numSourceElements = 0;
+        if( numComponents != 0 && source.getElementSize() != 0 )
+        {
+            if( layout == SOA_FROM_AOS )
+            {
+                if( (source.getElementSize() % numComponents) == 0 )
+                {
+                    componentSize = source.getElementSize() / numComponents;
+                    numSourceElements = source.getNumElements();
+                }
+            }
+            else
+            {
+                componentSize = source.getElementSize();
+                if( (source.getNumElements() % numComponents) == 0 )
+                    numSourceElements = source.getNumElements() / numComponents;
+            }
+        }
+
+        if( componentSize == 0 || numSourceElements == 0 )
+        {
+            osg::notify(osg::WARN)
+                << "osgCuda::LayoutBuffer::setSource(): \"" << source.getName()
+                << "\" cannot be split into " << numComponents << " components."
+                << std::endl;
+            return false;
+        }
+
+        // AoS buffers store a structure per element whereas
+        // SoA buffers store a component per element
+        if( layout == SOA_FROM_AOS )
+        {
+            setElementSize( componentSize );
+            setDimension( 0, numSourceElements * numComponents );
+        }
+        else
+        {
+            setElementSize( componentSize * numComponents );
+            setDimension( 0, numSourceElements );
+        }
+
+        _sourceCallback = new LayoutSubloadCallback;
+        _sourceCallback->_layoutBuffer = this;
+        _sourceCallback->_previous = source.getSubloadCallback();
+        source.setSubloadCallback( _sourceCallback.get() );
+
+        _source = &source;
+        _layout = layout;
+        _numComponents = numComponents;
+        _componentSize = componentSize;
+        _numSourceElements = numSourceElements;
+        _viewStale = true;
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    void LayoutBuffer::removeSource()
+    {
+        if( _sourceCallback.valid() )
+        {
+            _sourceCallback->_layoutBuffer = NULL;
+            if( _source.valid() && _source->getSubloadCallback() == _sourceCallback.get() )
+                _source->setSubloadCallback( _sourceCallback->_previous.get() );
+        }
+
+        clearLocal();
+    }
+
+    //------------------------------------------------------------------------------
+    osgCompute::Memory* LayoutBuffer::getSource()
+    {
+        return _source.get();
+    }
+
+    //------------------------------------------------------------------------------
+    const osgCompute::Memory* LayoutBuffer::getSource() const
+    {
+        return _source.get();
+    }
+
+    //------------------------------------------------------------------------------
+    LayoutBuffer::Layout LayoutBuffer::getLayout() const
+    {
+        return _layout;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int LayoutBuffer::getNumComponents() const
+    {
+        return _numComponents;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int LayoutBuffer::getNumSourceElements() const
+    {
+        return _numSourceElements;
+    }
+
+    //------------------------------------------------------------------------------
+    void* LayoutBuffer::map( unsigned int mapping/* = osgCompute::MAP_DEVICE*/, unsigned int offset/* = 0*/, unsigned int hint/* = 0*/ )
+    {
+        if( mapping == osgCompute::UNMAP )
+        {
+            unmap( hint );
+            return NULL;
+        }
+
+        if( _viewStale && _source.valid() )
+        {
+            if( _sourceStale )
+            {
+                osg::notify(osg::WARN)
+                    << "osgCuda::LayoutBuffer::map(): \"" << getName() << "\" and its source have both been written. "
+                    << "The changes of \"" << getName() << "\" are discarded."
+                    << std::endl;
+                _sourceStale = false;
+            }
+
+            if( !refresh() )
+                return NULL;
+        }
+
+        void* ptr = osgCuda::Buffer::map( mapping, offset, hint );
+        if( ptr != NULL && _source.valid() &&
+            ( (mapping & osgCompute::MAP_HOST_TARGET) == osgCompute::MAP_HOST_TARGET ||
+              (mapping & osgCompute::MAP_DEVICE_TARGET) == osgCompute::MAP_DEVICE_TARGET ) )
+            _sourceStale = true;
+
+        return ptr;
+    }
+
+    //------------------------------------------------------------------------------
+    void LayoutBuffer::unmap( unsigned int hint/* = 0*/ )
+    {
+        osgCuda::Buffer::unmap( hint );
+        flush();
+    }
+
+    //------------------------------------------------------------------------------
+    bool LayoutBuffer::flush()
+    {
+        if( !_sourceStale || !_source.valid() )
+            return true;
+
+        const char* view = static_cast<const char*>( osgCuda::Buffer::map( osgCompute::MAP_HOST_SOURCE ) );
+        if( view == NULL )
+            return false;
+
+        _updatingSource = true;
+        char* source = static_cast<char*>( _source->map( osgCompute::MAP_HOST_TARGET ) );
+        if( source != NULL )
+        {
+            if( _layout == SOA_FROM_AOS )
+                transposeSoAToAoS( view, source, _numSourceElements, _numComponents, _componentSize );
+            else
+                transposeAoSToSoA( view, source, _numSourceElements, _numComponents, _componentSize );
+
+            _source->unmap();
+            _sourceStale = false;
+        }
+        _updatingSource = false;
+
+        osgCuda::Buffer::unmap();
+        return (source != NULL);
+    }
+
+    //------------------------------------------------------------------------------
+    void LayoutBuffer::clear()
+    {
+        removeSource();
+        osgCuda::Buffer::clear();
+    }
+
+    //------------------------------------------------------------------------------
+    void LayoutBuffer::releaseObjects()
+    {
+        // The contents are transposed again during the next map()
+        _viewStale = true;
+        _sourceStale = false;
+        osgCuda::Buffer::releaseObjects();
+    }
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+	// PROTECTED FUNCTIONS //////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    LayoutBuffer::~LayoutBuffer()
+    {
+        removeSource();
+    }
+
+    //------------------------------------------------------------------------------
+    void LayoutBuffer::clearLocal()
+    {
+        _source = NULL;
+        _sourceCallback = NULL;
+        _layout = SOA_FROM_AOS;
+        _numComponents = 0;
+        _componentSize = 0;
+        _numSourceElements = 0;
+        _viewStale = false;
+        _sourceStale = false;
+        _updatingSource = false;
+    }
+
+    //------------------------------------------------------------------------------
+    bool LayoutBuffer::refresh()
+    {
+        const char* source = static_cast<const char*>( _source->map( osgCompute::MAP_HOST_SOURCE ) );
+        if( source == NULL )
+            return false;
+
+        char* view = static_cast<char*>( osgCuda::Buffer::map( osgCompute::MAP_HOST_TARGET ) );
+        if( view == NULL )
+        {
+            _source->unmap();
+            return false;
+        }
+
+        if( _layout == SOA_FROM_AOS )
+            transposeAoSToSoA( source, view, _numSourceElements, _numComponents, _componentSize );
+        else
+            transposeSoAToAoS( source, view, _numSourceElements, _numComponents, _componentSize );
+
+        osgCuda::Buffer::unmap();
+        _source->unmap();
+        _viewStale = false;
+        return true;
+    }
+}
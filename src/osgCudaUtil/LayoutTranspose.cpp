@@ -0,0 +1,124 @@
+#include <cstring>
+#include <osg/Math>
+#include <osgCompute/TaskGroup>
+#include "LayoutTranspose.h"
+
+namespace osgCuda
+{
+    // Elements per tile. A tile of 16 float4 components per element
+    // occupies 16 KB.
+    static const unsigned int TILE_SIZE = 256;
+    // Elements per task
+    static const unsigned int TASK_SIZE = 256 * TILE_SIZE;
+
+    //------------------------------------------------------------------------------
+    // Fixed component types let the compiler vectorize the strided loops
+    template<typename T>
+    static void transposeTile( const char* src, char* dst, unsigned int first, unsigned int count,
+                               unsigned int numElements, unsigned int numComponents, bool toSoA )
+    {
+        for( unsigned int c=0; c<numComponents; ++c )
+        {
+            size_t planeOffset = static_cast<size_t>( c ) * numElements + first;
+            size_t aosOffset = static_cast<size_t>( first ) * numComponents + c;
+            if( toSoA )
+            {
+                const T* aos = reinterpret_cast<const T*>( src ) + aosOffset;
+                T* plane = reinterpret_cast<T*>( dst ) + planeOffset;
+                for( unsigned int i=0; i<count; ++i )
+                    plane[i] = aos[ static_cast<size_t>( i ) * numComponents ];
+            }
+            else
+            {
+                const T* plane = reinterpret_cast<const T*>( src ) + planeOffset;
+                T* aos = reinterpret_cast<T*>( dst ) + aosOffset;
+                for( unsigned int i=0; i<count; ++i )
+                    aos[ static_cast<size_t>( i ) * numComponents ] = plane[i];
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    static void transposeTileBytes( const char* src, char* dst, unsigned int first, unsigned int count,
+                                    unsigned int numElements, unsigned int numComponents, unsigned int componentSize, bool toSoA )
+    {
+        size_t elementSize = static_cast<size_t>( numComponents ) * componentSize;
+        for( unsigned int c=0; c<numComponents; ++c )
+        {
+            size_t planeOffset = (static_cast<size_t>( c ) * numElements + first) * componentSize;
+            size_t aosOffset = static_cast<size_t>( first ) * elementSize + static_cast<size_t>( c ) * componentSize;
+            for( unsigned int i=0; i<count; ++i )
+            {
+                if( toSoA )
+                    memcpy( &dst[planeOffset + i*componentSize], &src[aosOffset + i*elementSize], componentSize );
+                else
+                    memcpy( &dst[aosOffset + i*elementSize], &src[planeOffset + i*componentSize], componentSize );
+            }
+        }
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // TRANSPOSE TASK ///////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    class TransposeTask : public osgCompute::Task
+    {
+    public:
+        TransposeTask( const char* src, char* dst, unsigned int first, unsigned int count,
+                       unsigned int numElements, unsigned int numComponents, unsigned int componentSize, bool toSoA )
+            : _src(src), _dst(dst), _first(first), _count(count), _numElements(numElements),
+              _numComponents(numComponents), _componentSize(componentSize), _toSoA(toSoA) {}
+
+        //------------------------------------------------------------------------------
+        virtual void run()
+        {
+            unsigned int end = _first + _count;
+            for( unsigned int tile=_first; tile<end; tile+=TILE_SIZE )
+            {
+                unsigned int count = osg::minimum( TILE_SIZE, end - tile );
+                switch( _componentSize )
+                {
+                case 4: transposeTile<unsigned int>( _src, _dst, tile, count, _numElements, _numComponents, _toSoA ); break;
+                case 8: transposeTile<unsigned long long>( _src, _dst, tile, count, _numElements, _numComponents, _toSoA ); break;
+                case 2: transposeTile<unsigned short>( _src, _dst, tile, count, _numElements, _numComponents, _toSoA ); break;
+                case 1: transposeTile<unsigned char>( _src, _dst, tile, count, _numElements, _numComponents, _toSoA ); break;
+                default: transposeTileBytes( _src, _dst, tile, count, _numElements, _numComponents, _componentSize, _toSoA ); break;
+                }
+            }
+        }
+
+    protected:
+        virtual ~TransposeTask() {}
+
+        const char*     _src;
+        char*           _dst;
+        unsigned int    _first;
+        unsigned int    _count;
+        unsigned int    _numElements;
+        unsigned int    _numComponents;
+        unsigned int    _componentSize;
+        bool            _toSoA;
+    };
+
+    //------------------------------------------------------------------------------
+    static void transpose( const char* src, char* dst, unsigned int numElements, unsigned int numComponents, unsigned int componentSize, bool toSoA )
+    {
+        osgCompute::TaskGroup group;
+        for( unsigned int first=0; first<numElements; first+=TASK_SIZE )
+            group.addTask( new TransposeTask( src, dst, first, osg::minimum( TASK_SIZE, numElements - first ),
+                numElements, numComponents, componentSize, toSoA ) );
+
+        group.run();
+    }
+
+    //------------------------------------------------------------------------------
+    void transposeAoSToSoA( const char* aos, char* soa, unsigned int numElements, unsigned int numComponents, unsigned int componentSize )
+    {
+        transpose( aos, soa, numElements, numComponents, componentSize, true );
+    }
+
+    //------------------------------------------------------------------------------
+    void transposeSoAToAoS( const char* soa, char* aos, unsigned int numElements, unsigned int numComponents, unsigned int componentSize )
+    {
+        transpose( soa, aos, numElements, numComponents, componentSize, false );
+    }
+}
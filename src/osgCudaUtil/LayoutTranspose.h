@@ -0,0 +1,14 @@
+#ifndef OSGCUDA_LAYOUTTRANSPOSE_H
+#define OSGCUDA_LAYOUTTRANSPOSE_H 1
+
+namespace osgCuda
+{
+    // Converts numElements structures of numComponents components into
+    // numComponents planes of numElements components and vice versa. Each
+    // component has componentSize bytes. The arrays are transposed in tiles
+    // which fit into the L1 cache. Large arrays are split across threads.
+    void transposeAoSToSoA( const char* aos, char* soa, unsigned int numElements, unsigned int numComponents, unsigned int componentSize );
+    void transposeSoAToAoS( const char* soa, char* aos, unsigned int numElements, unsigned int numComponents, unsigned int componentSize );
+}
+
+#endif //OSGCUDA_LAYOUTTRANSPOSE_H
@@ -180,10 +180,46 @@ namespace osgCuda
 	//------------------------------------------------------------------------------
 	void PingPongBuffer::swap( unsigned int incr /*= 1 */ )
 	{
+        unsigned int prevIdx = _stackIdx;
 		_stackIdx += incr;
 		_stackIdx %= _bufferStack.size();
+        dirtyContent();
+
+        // Copy the list as callbacks may remove themselves
+        SwapCallbackList callbacks = _swapCallbacks;
+        for( SwapCallbackListItr itr = callbacks.begin(); itr != callbacks.end(); ++itr )
+            (*(*itr))( *this, prevIdx );
 	}
 
+    //------------------------------------------------------------------------------
+    void PingPongBuffer::addSwapCallback( SwapCallback& callback )
+    {
+        for( SwapCallbackListItr itr = _swapCallbacks.begin(); itr != _swapCallbacks.end(); ++itr )
+            if( (*itr).get() == &callback )
+                return;
+
+        _swapCallbacks.push_back( &callback );
+    }
+
+    //------------------------------------------------------------------------------
+    void PingPongBuffer::removeSwapCallback( SwapCallback& callback )
+    {
+        for( SwapCallbackListItr itr = _swapCallbacks.begin(); itr != _swapCallbacks.end(); ++itr )
+        {
+            if( (*itr).get() == &callback )
+            {
+                _swapCallbacks.erase( itr );
+                return;
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    SwapCallbackList& PingPongBuffer::getSwapCallbacks()
+    {
+        return _swapCallbacks;
+    }
+
     //------------------------------------------------------------------------------
     void PingPongBuffer::setSwapCount( unsigned int sc )
     {
@@ -202,6 +238,7 @@ namespace osgCuda
 	{
 		_stackIdx = idx;
 		_stackIdx %= _bufferStack.size();
+        dirtyContent();
 	}
 
 	//------------------------------------------------------------------------------
@@ -286,6 +323,7 @@ namespace osgCuda
 	void PingPongBuffer::clearLocal()
 	{
 		_bufferStack.clear();
+		_swapCallbacks.clear();
 		_stackIdx = 0;
 		_refIdx = 0;
 	} 
@@ -297,10 +335,22 @@ namespace osgCuda
         return 0;
     }
 
+    //------------------------------------------------------------------------------
+    unsigned int PingPongBuffer::getSourceModifiedCount() const
+    {
+        // Changes whenever the contents of any buffer change
+        unsigned int modifiedCount = 0;
+        for( unsigned int b=0; b<_bufferStack.size(); ++b )
+            if( _bufferStack[b].valid() )
+                modifiedCount += _bufferStack[b]->getContentVersion();
+
+        return modifiedCount;
+    }
+
     //------------------------------------------------------------------------------
     void PingPongBuffer::clear()
     {
         for( unsigned int s=0; s<_bufferStack.size(); ++s )
             _bufferStack[s]->clear();
     }
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include "SequenceCodec.h"
+
+namespace osgCuda
+{
+    //------------------------------------------------------------------------------
+    static void writeUInt( std::ostream& out, unsigned int value )
+    {
+        out.write( reinterpret_cast<const char*>(&value), sizeof(unsigned int) );
+    }
+
+    //------------------------------------------------------------------------------
+    static unsigned int readUInt( std::istream& in )
+    {
+        unsigned int value = 0;
+        in.read( reinterpret_cast<char*>(&value), sizeof(unsigned int) );
+        return value;
+    }
+
+    //------------------------------------------------------------------------------
+    static void writeVarInt( std::vector<char>& out, unsigned int value )
+    {
+        while( value >= 0x80 )
+        {
+            out.push_back( static_cast<char>( (value & 0x7F) | 0x80 ) );
+            value >>= 7;
+        }
+        out.push_back( static_cast<char>( value ) );
+    }
+
+    //------------------------------------------------------------------------------
+    static bool readVarInt( const char*& in, const char* end, unsigned int& value )
+    {
+        value = 0;
+        for( unsigned int shift = 0; shift < 35; shift += 7 )
+        {
+            if( in == end )
+                return false;
+
+            unsigned char byte = static_cast<unsigned char>( *in++ );
+            value |= static_cast<unsigned int>( byte & 0x7F ) << shift;
+            if( !(byte & 0x80) )
+                return true;
+        }
+        return false;
+    }
+
+    //------------------------------------------------------------------------------
+    bool writeSequenceHeader( std::ostream& out, const SequenceHeader& header )
+    {
+        out.write( SEQUENCE_MAGIC, sizeof(SEQUENCE_MAGIC) );
+        writeUInt( out, SEQUENCE_VERSION );
+        writeUInt( out, header._elementSize );
+        writeUInt( out, static_cast<unsigned int>( header._dimensions.size() ) );
+        for( unsigned int d=0; d<header._dimensions.size(); ++d )
+            writeUInt( out, header._dimensions[d] );
+        writeUInt( out, header._frameSize );
+
+        return out.good();
+    }
+
+    //------------------------------------------------------------------------------
+    bool readSequenceHeader( std::istream& in, SequenceHeader& header )
+    {
+        char magic[8];
+        in.read( magic, sizeof(magic) );
+        if( !in.good() || 0 != memcmp( magic, SEQUENCE_MAGIC, sizeof(magic) ) )
+            return false;
+
+        if( readUInt( in ) != SEQUENCE_VERSION )
+            return false;
+
+        header._elementSize = readUInt( in );
+        unsigned int numDimensions = readUInt( in );
+        if( !in.good() || numDimensions > 3 )
+            return false;
+
+        header._dimensions.resize( numDimensions );
+        for( unsigned int d=0; d<numDimensions; ++d )
+            header._dimensions[d] = readUInt( in );
+        header._frameSize = readUInt( in );
+
+        return in.good();
+    }
+
+    //------------------------------------------------------------------------------
+    void xorFrames( const char* cur, const char* prev, char* out, unsigned int size )
+    {
+        for( unsigned int i=0; i<size; ++i )
+            out[i] = cur[i] ^ prev[i];
+    }
+
+    //------------------------------------------------------------------------------
+    void shuffleBytes( const char* in, char* out, unsigned int size )
+    {
+        unsigned int numWords = size / 4;
+        for( unsigned int w=0; w<numWords; ++w )
+        {
+            out[w]              = in[4*w];
+            out[w + numWords]   = in[4*w+1];
+            out[w + 2*numWords] = in[4*w+2];
+            out[w + 3*numWords] = in[4*w+3];
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    void unshuffleBytes( const char* in, char* out, unsigned int size )
+    {
+        unsigned int numWords = size / 4;
+        for( unsigned int w=0; w<numWords; ++w )
+        {
+            out[4*w]   = in[w];
+            out[4*w+1] = in[w + numWords];
+            out[4*w+2] = in[w + 2*numWords];
+            out[4*w+3] = in[w + 3*numWords];
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    void compressZeroRuns( const char* in, unsigned int size, std::vector<char>& out )
+    {
+        // Short zero runs are cheaper to store as literals
+        const unsigned int minZeroRun = 4;
+
+        out.clear();
+        out.reserve( size / 2 );
+
+        unsigned int i = 0;
+        while( i < size )
+        {
+            unsigned int start = i;
+            while( i < size )
+            {
+                if( in[i] != 0 )
+                {
+                    ++i;
+                    continue;
+                }
+
+                unsigned int j = i;
+                while( j < size && in[j] == 0 )
+                    ++j;
+                if( j - i >= minZeroRun || j == size )
+                    break;
+                i = j;
+            }
+
+            writeVarInt( out, i - start );
+            out.insert( out.end(), in + start, in + i );
+
+            unsigned int zeros = 0;
+            while( i < size && in[i] == 0 )
+            {
+                ++zeros;
+                ++i;
+            }
+            writeVarInt( out, zeros );
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    bool decompressZeroRuns( const char* in, unsigned int inSize, char* out, unsigned int outSize )
+    {
+        const char* end = in + inSize;
+        unsigned int o = 0;
+        while( o < outSize )
+        {
+            unsigned int literals = 0;
+            if( !readVarInt( in, end, literals ) )
+                return false;
+            if( literals > outSize - o || literals > static_cast<unsigned int>( end - in ) )
+                return false;
+
+            memcpy( &out[o], in, literals );
+            in += literals;
+            o += literals;
+
+            unsigned int zeros = 0;
+            if( !readVarInt( in, end, zeros ) )
+                return false;
+            if( zeros > outSize - o )
+                return false;
+
+            memset( &out[o], 0, zeros );
+            o += zeros;
+        }
+
+        return in == end;
+    }
+}
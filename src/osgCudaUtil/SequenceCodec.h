@@ -0,0 +1,47 @@
+#ifndef OSGCUDA_SEQUENCECODEC_H
+#define OSGCUDA_SEQUENCECODEC_H 1
+
+#include <vector>
+#include <iosfwd>
+
+namespace osgCuda
+{
+    // File layout of a sequence:
+    //   header: magic[8] version elementSize numDimensions dimensions[numDimensions] frameSize
+    //   frames: flags storedSize payload[storedSize]
+    // All values are stored as unsigned int in host byte order.
+    static const char           SEQUENCE_MAGIC[8] = { 'O','S','G','C','S','E','Q','\0' };
+    static const unsigned int   SEQUENCE_VERSION = 1;
+
+    enum SequenceFrameFlags
+    {
+        SEQUENCE_KEYFRAME   = 0x1,  // payload is not delta encoded
+        SEQUENCE_SHUFFLED   = 0x2,  // payload bytes are grouped by their position within a 4 byte word
+        SEQUENCE_COMPRESSED = 0x4,  // payload is zero run length encoded
+    };
+
+    struct SequenceHeader
+    {
+        unsigned int                _elementSize;
+        std::vector<unsigned int>   _dimensions;
+        unsigned int                _frameSize;
+    };
+
+    bool writeSequenceHeader( std::ostream& out, const SequenceHeader& header );
+    bool readSequenceHeader( std::istream& in, SequenceHeader& header );
+
+    // XOR of two frames. Applying it twice restores the original frame.
+    void xorFrames( const char* cur, const char* prev, char* out, unsigned int size );
+
+    // Groups the bytes of each 4 byte word by their position. Neighbouring
+    // floats differ mostly in their low bytes so that the high byte planes
+    // of a delta frame become long zero runs. size must be a multiple of 4.
+    void shuffleBytes( const char* in, char* out, unsigned int size );
+    void unshuffleBytes( const char* in, char* out, unsigned int size );
+
+    // Fast codec which encodes alternating literal and zero runs.
+    void compressZeroRuns( const char* in, unsigned int size, std::vector<char>& out );
+    bool decompressZeroRuns( const char* in, unsigned int inSize, char* out, unsigned int outSize );
+}
+
+#endif //OSGCUDA_SEQUENCECODEC_H
@@ -0,0 +1,267 @@
+#include <climits>
+#include <cstring>
+#include <osg/Math>
+#include <osg/Notify>
+#include <osgCudaUtil/SequencePlayer>
+#include "SequenceCodec.h"
+
+namespace osgCuda
+{
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+	// PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    SequencePlayer::SequencePlayer()
+        : osgCompute::Resource()
+    {
+        clearLocal();
+        osgCompute::ResourceObserver::instance()->observeResource( *this );
+    }
+
+    //------------------------------------------------------------------------------
+    bool SequencePlayer::open( const std::string& filename )
+    {
+        close();
+
+        _file.open( filename.c_str(), std::ios::in | std::ios::binary );
+        if( !_file.is_open() )
+        {
+            osg::notify(osg::WARN)
+                << "osgCuda::SequencePlayer::open(): cannot open \"" << filename << "\"."
+                << std::endl;
+            return false;
+        }
+
+        SequenceHeader header;
+        if( !readSequenceHeader( _file, header ) )
+        {
+            osg::notify(osg::WARN)
+                << "osgCuda::SequencePlayer::open(): \"" << filename << "\" is not a valid sequence."
+                << std::endl;
+            close();
+            return false;
+        }
+
+        _elementSize = header._elementSize;
+        _dimensions = header._dimensions;
+        _frameSize = header._frameSize;
+
+        // Build frame index. A truncated last frame, e.g. of a
+        // recording which has not been closed, is ignored.
+        _file.seekg( 0, std::ios::end );
+        std::streamoff fileSize = _file.tellg();
+        _file.seekg( (std::streamoff)( sizeof(SEQUENCE_MAGIC) + (4 + _dimensions.size()) * sizeof(unsigned int) ), std::ios::beg );
+
+        while( _file.good() )
+        {
+            FrameEntry entry;
+            _file.read( reinterpret_cast<char*>(&entry._flags), sizeof(unsigned int) );
+            _file.read( reinterpret_cast<char*>(&entry._storedSize), sizeof(unsigned int) );
+            if( !_file.good() )
+                break;
+
+            entry._offset = _file.tellg();
+            if( entry._offset + (std::streamoff)entry._storedSize > fileSize )
+                break;
+
+            // The first frame of a sequence is always a key frame
+            if( _frames.empty() && !(entry._flags & SEQUENCE_KEYFRAME) )
+                break;
+
+            _frames.push_back( entry );
+            _file.seekg( entry._storedSize, std::ios::cur );
+        }
+        _file.clear();
+
+        _decoded.resize( _frameSize );
+        _unpacked.resize( _frameSize );
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    void SequencePlayer::close()
+    {
+        if( _file.is_open() )
+            _file.close();
+        _file.clear();
+
+        clearLocal();
+    }
+
+    //------------------------------------------------------------------------------
+    bool SequencePlayer::isOpen() const
+    {
+        return _file.is_open();
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int SequencePlayer::getNumFrames() const
+    {
+        return static_cast<unsigned int>( _frames.size() );
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int SequencePlayer::getElementSize() const
+    {
+        return _elementSize;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int SequencePlayer::getNumDimensions() const
+    {
+        return static_cast<unsigned int>( _dimensions.size() );
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int SequencePlayer::getDimension( unsigned int dimIdx ) const
+    {
+        if( dimIdx >= _dimensions.size() )
+            return 0;
+
+        return _dimensions[dimIdx];
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int SequencePlayer::getCurrentFrame() const
+    {
+        return _currentFrame;
+    }
+
+    //------------------------------------------------------------------------------
+    bool SequencePlayer::readFrame( unsigned int frameIdx, osgCompute::Memory& memory )
+    {
+        if( frameIdx >= _frames.size() )
+            return false;
+
+        if( memory.getAllElementsSize() != _frameSize )
+        {
+            osg::notify(osg::WARN)
+                << "osgCuda::SequencePlayer::readFrame(): \"" << memory.getName()
+                << "\" does not match the frame size of the sequence."
+                << std::endl;
+            return false;
+        }
+
+        if( frameIdx != _currentFrame )
+        {
+            // Continue from the current frame if possible or
+            // restart at the preceding key frame otherwise
+            unsigned int start = frameIdx;
+            while( start > 0 && !(_frames[start]._flags & SEQUENCE_KEYFRAME) )
+                --start;
+            if( _currentFrame != UINT_MAX && _currentFrame < frameIdx && _currentFrame >= start )
+                start = _currentFrame + 1;
+
+            for( unsigned int f = start; f <= frameIdx; ++f )
+            {
+                if( !decodeFrame( f ) )
+                {
+                    osg::notify(osg::WARN)
+                        << "osgCuda::SequencePlayer::readFrame(): frame " << f << " is corrupt."
+                        << std::endl;
+                    _currentFrame = UINT_MAX;
+                    return false;
+                }
+                _currentFrame = f;
+            }
+        }
+
+        char* data = static_cast<char*>( memory.map( osgCompute::MAP_HOST_TARGET ) );
+        if( data == NULL )
+            return false;
+
+        memcpy( data, &_decoded.front(), _frameSize );
+        memory.unmap();
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    bool SequencePlayer::readNextFrame( osgCompute::Memory& memory )
+    {
+        unsigned int nextFrame = (_currentFrame == UINT_MAX)? 0 : _currentFrame + 1;
+        return readFrame( nextFrame, memory );
+    }
+
+    //------------------------------------------------------------------------------
+    void SequencePlayer::clear()
+    {
+        close();
+        osgCompute::Resource::clear();
+    }
+
+    //------------------------------------------------------------------------------
+    void SequencePlayer::releaseObjects()
+    {
+        close();
+        osgCompute::Resource::releaseObjects();
+    }
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+	// PROTECTED FUNCTIONS //////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    SequencePlayer::~SequencePlayer()
+    {
+        close();
+    }
+
+    //------------------------------------------------------------------------------
+    void SequencePlayer::clearLocal()
+    {
+        _frames.clear();
+        _dimensions.clear();
+        _elementSize = 0;
+        _frameSize = 0;
+        _currentFrame = UINT_MAX;
+        _decoded.clear();
+        _stored.clear();
+        _unpacked.clear();
+    }
+
+    //------------------------------------------------------------------------------
+    bool SequencePlayer::decodeFrame( unsigned int frameIdx )
+    {
+        const FrameEntry& entry = _frames[frameIdx];
+        if( _frameSize == 0 )
+            return true;
+
+        _stored.resize( osg::maximum( entry._storedSize, 1u ) );
+        _file.seekg( entry._offset, std::ios::beg );
+        _file.read( &_stored.front(), entry._storedSize );
+        if( !_file.good() )
+        {
+            _file.clear();
+            return false;
+        }
+
+        // Undo compression
+        std::vector<char> raw;
+        const char* data = &_stored.front();
+        if( entry._flags & SEQUENCE_COMPRESSED )
+        {
+            raw.resize( _frameSize );
+            if( !decompressZeroRuns( data, entry._storedSize, &raw.front(), _frameSize ) )
+                return false;
+            data = &raw.front();
+        }
+        else if( entry._storedSize != _frameSize )
+        {
+            return false;
+        }
+
+        // Undo byte shuffling
+        if( entry._flags & SEQUENCE_SHUFFLED )
+        {
+            unshuffleBytes( data, &_unpacked.front(), _frameSize );
+            data = &_unpacked.front();
+        }
+
+        // Undo delta encoding
+        if( entry._flags & SEQUENCE_KEYFRAME )
+            memcpy( &_decoded.front(), data, _frameSize );
+        else
+            xorFrames( data, &_decoded.front(), &_decoded.front(), _frameSize );
+
+        return true;
+    }
+}
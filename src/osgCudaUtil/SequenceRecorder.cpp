@@ -0,0 +1,363 @@
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <osg/Notify>
+#include <OpenThreads/Thread>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Condition>
+#include <OpenThreads/ScopedLock>
+#include <osgCudaUtil/SequenceRecorder>
+#include "SequenceCodec.h"
+
+namespace osgCuda
+{
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // SEQUENCE WRITER //////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    class SequenceWriter : public osg::Referenced, public OpenThreads::Thread
+    {
+    public:
+        SequenceWriter( unsigned int frameSize, unsigned int keyFrameInterval, unsigned int maxQueuedFrames )
+            : _frameSize(frameSize),
+              _keyFrameInterval(keyFrameInterval),
+              _maxQueuedFrames(maxQueuedFrames),
+              _numWrittenFrames(0),
+              _done(false),
+              _failed(false)
+        {
+        }
+
+        //------------------------------------------------------------------------------
+        bool open( const std::string& filename, const SequenceHeader& header )
+        {
+            _file.open( filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+            if( !_file.is_open() )
+                return false;
+
+            return writeSequenceHeader( _file, header );
+        }
+
+        //------------------------------------------------------------------------------
+        void push( std::vector<char>* frame )
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+            while( _frames.size() >= _maxQueuedFrames && !_failed )
+                _spaceAvailable.wait( &_mutex );
+
+            if( _failed )
+            {
+                delete frame;
+                return;
+            }
+
+            _frames.push_back( frame );
+            _frameAvailable.signal();
+        }
+
+        //------------------------------------------------------------------------------
+        void finish()
+        {
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+                _done = true;
+                _frameAvailable.signal();
+            }
+            join();
+            _file.close();
+        }
+
+        //------------------------------------------------------------------------------
+        virtual void run()
+        {
+            std::vector<char> previous( _frameSize );
+            std::vector<char> delta( _frameSize );
+            std::vector<char> shuffled( _frameSize );
+            std::vector<char> compressed;
+
+            while( true )
+            {
+                std::vector<char>* frame = NULL;
+                {
+                    OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+                    while( _frames.empty() && !_done )
+                        _frameAvailable.wait( &_mutex );
+
+                    if( _frames.empty() )
+                        return;
+
+                    frame = _frames.front();
+                }
+
+                bool success = encodeAndWrite( *frame, previous, delta, shuffled, compressed );
+                previous.swap( *frame );
+                delete frame;
+
+                {
+                    OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+                    _frames.pop_front();
+                    if( !success && !_failed )
+                    {
+                        osg::notify(osg::WARN)
+                            << "osgCuda::SequenceRecorder: writing of frame " << _numWrittenFrames << " failed. "
+                            << "Recording is stopped."
+                            << std::endl;
+
+                        // discard all remaining frames
+                        _failed = true;
+                        while( !_frames.empty() )
+                        {
+                            delete _frames.front();
+                            _frames.pop_front();
+                        }
+                    }
+                    _spaceAvailable.broadcast();
+                }
+            }
+        }
+
+    protected:
+        virtual ~SequenceWriter() {}
+
+        //------------------------------------------------------------------------------
+        bool encodeAndWrite( const std::vector<char>& frame, const std::vector<char>& previous,
+            std::vector<char>& delta, std::vector<char>& shuffled, std::vector<char>& compressed )
+        {
+            if( _frameSize == 0 )
+                return true;
+
+            unsigned int flags = 0;
+            const char* data = &frame.front();
+            if( _keyFrameInterval == 0 || (_numWrittenFrames % _keyFrameInterval) == 0 )
+            {
+                flags |= SEQUENCE_KEYFRAME;
+            }
+            else
+            {
+                xorFrames( &frame.front(), &previous.front(), &delta.front(), _frameSize );
+                data = &delta.front();
+            }
+
+            if( (_frameSize % 4) == 0 )
+            {
+                shuffleBytes( data, &shuffled.front(), _frameSize );
+                data = &shuffled.front();
+                flags |= SEQUENCE_SHUFFLED;
+            }
+
+            unsigned int storedSize = _frameSize;
+            compressZeroRuns( data, _frameSize, compressed );
+            if( compressed.size() < _frameSize )
+            {
+                data = &compressed.front();
+                storedSize = static_cast<unsigned int>( compressed.size() );
+                flags |= SEQUENCE_COMPRESSED;
+            }
+
+            _file.write( reinterpret_cast<const char*>(&flags), sizeof(unsigned int) );
+            _file.write( reinterpret_cast<const char*>(&storedSize), sizeof(unsigned int) );
+            _file.write( data, storedSize );
+
+            _numWrittenFrames++;
+            return _file.good();
+        }
+
+        std::ofstream                   _file;
+        unsigned int                    _frameSize;
+        unsigned int                    _keyFrameInterval;
+        unsigned int                    _maxQueuedFrames;
+        unsigned int                    _numWrittenFrames;
+        OpenThreads::Mutex              _mutex;
+        OpenThreads::Condition          _frameAvailable;
+        OpenThreads::Condition          _spaceAvailable;
+        std::list< std::vector<char>* > _frames;
+        bool                            _done;
+        bool                            _failed;
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // SWAP CALLBACK ////////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    class SequenceSwapCallback : public SwapCallback
+    {
+    public:
+        SequenceSwapCallback( SequenceRecorder& recorder ) : _recorder(&recorder) {}
+
+        //------------------------------------------------------------------------------
+        virtual void operator()( PingPongBuffer& buffer, unsigned int prevIdx )
+        {
+            if( _recorder == NULL )
+                return;
+
+            osgCompute::Memory* completed = buffer.getBufferAt( prevIdx );
+            if( completed != NULL )
+                _recorder->record( *completed );
+        }
+
+        SequenceRecorder* _recorder;
+
+    protected:
+        virtual ~SequenceSwapCallback() {}
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PUBLIC FUNCTIONS /////////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    SequenceRecorder::SequenceRecorder()
+        : osgCompute::Resource(),
+          _keyFrameInterval(60),
+          _maxQueuedFrames(4)
+    {
+        clearLocal();
+        osgCompute::ResourceObserver::instance()->observeResource( *this );
+    }
+
+    //------------------------------------------------------------------------------
+    bool SequenceRecorder::open( const std::string& filename, PingPongBuffer& buffer )
+    {
+        close();
+
+        SequenceHeader header;
+        header._elementSize = buffer.getElementSize();
+        for( unsigned int d=0; d<buffer.getNumDimensions(); ++d )
+            header._dimensions.push_back( buffer.getDimension(d) );
+        header._frameSize = buffer.getAllElementsSize();
+
+        if( header._frameSize == 0 )
+        {
+            osg::notify(osg::WARN)
+                << "osgCuda::SequenceRecorder::open(): \"" << buffer.getName() << "\" has no size."
+                << std::endl;
+            return false;
+        }
+
+        _writer = new SequenceWriter( header._frameSize, _keyFrameInterval, _maxQueuedFrames );
+        if( !_writer->open( filename, header ) )
+        {
+            osg::notify(osg::WARN)
+                << "osgCuda::SequenceRecorder::open(): cannot create \"" << filename << "\"."
+                << std::endl;
+            _writer = NULL;
+            return false;
+        }
+        _writer->start();
+
+        _frameSize = header._frameSize;
+        _buffer = &buffer;
+        _swapCallback = new SequenceSwapCallback( *this );
+        buffer.addSwapCallback( *_swapCallback );
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    void SequenceRecorder::close()
+    {
+        if( _swapCallback.valid() )
+        {
+            _swapCallback->_recorder = NULL;
+            if( _buffer.valid() )
+                _buffer->removeSwapCallback( *_swapCallback );
+        }
+
+        if( _writer.valid() )
+            _writer->finish();
+
+        clearLocal();
+    }
+
+    //------------------------------------------------------------------------------
+    bool SequenceRecorder::isOpen() const
+    {
+        return _writer.valid();
+    }
+
+    //------------------------------------------------------------------------------
+    bool SequenceRecorder::record( osgCompute::Memory& memory )
+    {
+        if( !_writer.valid() )
+            return false;
+
+        if( memory.getAllElementsSize() != _frameSize )
+        {
+            osg::notify(osg::WARN)
+                << "osgCuda::SequenceRecorder::record(): \"" << memory.getName()
+                << "\" does not match the frame size of the sequence."
+                << std::endl;
+            return false;
+        }
+
+        const char* data = static_cast<const char*>( memory.map( osgCompute::MAP_HOST_SOURCE ) );
+        if( data == NULL )
+            return false;
+
+        std::vector<char>* frame = new std::vector<char>( data, data + _frameSize );
+        memory.unmap();
+
+        _writer->push( frame );
+        _numRecordedFrames++;
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    void SequenceRecorder::setKeyFrameInterval( unsigned int interval )
+    {
+        _keyFrameInterval = interval;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int SequenceRecorder::getKeyFrameInterval() const
+    {
+        return _keyFrameInterval;
+    }
+
+    //------------------------------------------------------------------------------
+    void SequenceRecorder::setMaxQueuedFrames( unsigned int maxFrames )
+    {
+        _maxQueuedFrames = (maxFrames == 0)? 1 : maxFrames;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int SequenceRecorder::getMaxQueuedFrames() const
+    {
+        return _maxQueuedFrames;
+    }
+
+    //------------------------------------------------------------------------------
+    unsigned int SequenceRecorder::getNumRecordedFrames() const
+    {
+        return _numRecordedFrames;
+    }
+
+    //------------------------------------------------------------------------------
+    void SequenceRecorder::clear()
+    {
+        close();
+        osgCompute::Resource::clear();
+    }
+
+    //------------------------------------------------------------------------------
+    void SequenceRecorder::releaseObjects()
+    {
+        close();
+        osgCompute::Resource::releaseObjects();
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    // PROTECTED FUNCTIONS //////////////////////////////////////////////////////////////////////////
+    /////////////////////////////////////////////////////////////////////////////////////////////////
+    //------------------------------------------------------------------------------
+    SequenceRecorder::~SequenceRecorder()
+    {
+        close();
+    }
+
+    //------------------------------------------------------------------------------
+    void SequenceRecorder::clearLocal()
+    {
+        _writer = NULL;
+        _swapCallback = NULL;
+        _buffer = NULL;
+        _frameSize = 0;
+        _numRecordedFrames = 0;
+    }
+}
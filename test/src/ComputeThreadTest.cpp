@@ -0,0 +1,179 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <vector>
+#include <iostream>
+#include <OpenThreads/Thread>
+#include <osgCompute/Computation>
+#include <osgCompute/ComputeThread>
+
+static unsigned int s_numFailures = 0;
+
+#define CHECK( condition )                                                          \
+    if( !(condition) )                                                              \
+    {                                                                               \
+        std::cerr << __FILE__ << "(" << __LINE__ << "): check failed: "             \
+                  << #condition << std::endl;                                       \
+        ++s_numFailures;                                                            \
+    }
+
+//------------------------------------------------------------------------------
+class TestComputation : public osgCompute::Computation
+{
+public:
+    TestComputation() : osgCompute::Computation() {}
+
+    META_Computation( osgComputeTest, TestComputation, osgCompute, ComputationBin );
+
+protected:
+    virtual ~TestComputation() {}
+
+private:
+    // copy constructor and operator should not be called
+    TestComputation( const TestComputation&, const osg::CopyOp& ) {}
+    TestComputation &operator=( const TestComputation& ) { return *this; }
+};
+
+//------------------------------------------------------------------------------
+// A program which takes some time and records the order of its launches.
+// The launches are read after a fence has been waited for.
+class TestProgram : public osgCompute::Program
+{
+public:
+    TestProgram( unsigned int id, std::vector<unsigned int>& launches ) 
+        : _id(id), _launches(&launches) {}
+
+    virtual void launch()
+    {
+        OpenThreads::Thread::microSleep( 20000 );
+        _launches->push_back( _id );
+    }
+
+protected:
+    virtual ~TestProgram() {}
+
+    unsigned int                _id;
+    std::vector<unsigned int>*  _launches;
+};
+
+//------------------------------------------------------------------------------
+static osg::ref_ptr<TestComputation> createComputation( unsigned int id, std::vector<unsigned int>& launches )
+{
+    osg::ref_ptr<TestComputation> computation = new TestComputation;
+    computation->addProgram( *new TestProgram( id, launches ) );
+    return computation;
+}
+
+//------------------------------------------------------------------------------
+static void testSubmitAndWait()
+{
+    std::vector<unsigned int> launches;
+    osg::ref_ptr<TestComputation> computation = createComputation( 1, launches );
+    osg::ref_ptr<osgCompute::ComputeThread> computeThread = new osgCompute::ComputeThread;
+
+    // Fence 0 is always finished
+    CHECK( computeThread->isFinished( 0 ) );
+    computeThread->wait( 0 );
+
+    // Fences increase with each launch
+    unsigned int first = computeThread->submit( *computation );
+    unsigned int second = computeThread->submit( *computation );
+    CHECK( first == 1 );
+    CHECK( second == 2 );
+
+    // A fence is signaled after the launch has finished
+    computeThread->wait( first );
+    CHECK( computeThread->isFinished( first ) );
+    CHECK( launches.size() >= 1 );
+
+    computeThread->waitForAll();
+    CHECK( computeThread->isFinished( second ) );
+    CHECK( launches.size() == 2 );
+
+    computeThread->stop();
+}
+
+//------------------------------------------------------------------------------
+static void testLaunchOrder()
+{
+    std::vector<unsigned int> launches;
+    osg::ref_ptr<TestComputation> a = createComputation( 1, launches );
+    osg::ref_ptr<TestComputation> b = createComputation( 2, launches );
+    osg::ref_ptr<osgCompute::ComputeThread> computeThread = new osgCompute::ComputeThread;
+
+    // Launches are executed in the order they have been queued
+    computeThread->submit( *a );
+    computeThread->submit( *b );
+    unsigned int last = computeThread->submit( *a );
+
+    // Waiting for a fence waits for all launches queued before
+    computeThread->wait( last );
+    CHECK( launches.size() == 3 );
+    if( launches.size() == 3 )
+    {
+        CHECK( launches[0] == 1 );
+        CHECK( launches[1] == 2 );
+        CHECK( launches[2] == 1 );
+    }
+
+    computeThread->stop();
+}
+
+//------------------------------------------------------------------------------
+static void testStopAndRestart()
+{
+    std::vector<unsigned int> launches;
+    osg::ref_ptr<TestComputation> computation = createComputation( 1, launches );
+    osg::ref_ptr<osgCompute::ComputeThread> computeThread = new osgCompute::ComputeThread;
+
+    // A thread which has not been started can be stopped
+    computeThread->stop();
+
+    // Queued launches are finished before the thread exits
+    computeThread->submit( *computation );
+    computeThread->submit( *computation );
+    unsigned int fence = computeThread->submit( *computation );
+    computeThread->stop();
+    CHECK( computeThread->isFinished( fence ) );
+    CHECK( launches.size() == 3 );
+
+    // The next submit starts the thread again
+    fence = computeThread->submit( *computation );
+    CHECK( fence == 4 );
+    computeThread->wait( fence );
+    CHECK( launches.size() == 4 );
+
+    // The destructor stops the thread
+    computeThread->submit( *computation );
+    computeThread = NULL;
+    CHECK( launches.size() == 5 );
+}
+
+//------------------------------------------------------------------------------
+int main( int, char** )
+{
+    testSubmitAndWait();
+    testLaunchOrder();
+    testStopAndRestart();
+
+    if( s_numFailures != 0 )
+    {
+        std::cerr << s_numFailures << " check(s) failed." << std::endl;
+        return 1;
+    }
+
+    std::cout << "All checks passed." << std::endl;
+    return 0;
+}
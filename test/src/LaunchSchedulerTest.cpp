@@ -0,0 +1,241 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <map>
+#include <iostream>
+#include <osg/FrameStamp>
+#include <osgCompute/Computation>
+#include <osgCompute/LaunchScheduler>
+
+static unsigned int s_numFailures = 0;
+
+#define CHECK( condition )                                                          \
+    if( !(condition) )                                                              \
+    {                                                                               \
+        std::cerr << __FILE__ << "(" << __LINE__ << "): check failed: "             \
+                  << #condition << std::endl;                                       \
+        ++s_numFailures;                                                            \
+    }
+
+//------------------------------------------------------------------------------
+// A computation without programs which is due in every frame.
+class TestComputation : public osgCompute::Computation
+{
+public:
+    TestComputation() : osgCompute::Computation() {}
+
+    META_Computation( osgComputeTest, TestComputation, osgCompute, ComputationBin );
+
+protected:
+    virtual ~TestComputation() {}
+
+private:
+    // copy constructor and operator should not be called
+    TestComputation( const TestComputation&, const osg::CopyOp& ) {}
+    TestComputation &operator=( const TestComputation& ) { return *this; }
+};
+
+//------------------------------------------------------------------------------
+// Synthetic costs so that the schedule does not depend on measured times.
+class TestCostModel : public osgCompute::LaunchCostModel
+{
+public:
+    void setCost( const osgCompute::Computation& computation, double cost ) { _costs[&computation] = cost; }
+
+    virtual double getCost( const osgCompute::Computation& computation ) const
+    {
+        std::map<const osgCompute::Computation*, double>::const_iterator itr = _costs.find( &computation );
+        return (itr != _costs.end())? (*itr).second : 0.0;
+    }
+
+protected:
+    virtual ~TestCostModel() {}
+
+    std::map<const osgCompute::Computation*, double> _costs;
+};
+
+//------------------------------------------------------------------------------
+struct Schedule
+{
+    Schedule()
+    {
+        _a = new TestComputation;
+        _b = new TestComputation;
+        _c = new TestComputation;
+        _d = new TestComputation;
+
+        // A must be launched in each frame. The optional computations do not
+        // fit into the budget at the same time.
+        _costModel = new TestCostModel;
+        _costModel->setCost( *_a, 4.0 );
+        _costModel->setCost( *_b, 5.0 );
+        _costModel->setCost( *_c, 5.0 );
+        _costModel->setCost( *_d, 7.0 );
+
+        _scheduler = new osgCompute::LaunchScheduler;
+        _scheduler->setHostTiming( false );
+        _scheduler->setCostModel( _costModel.get() );
+        _scheduler->setBudget( 10.0 );
+        _scheduler->setMaxDeferredFrames( 3 );
+        _scheduler->addComputation( *_a, 0, false );
+        _scheduler->addComputation( *_b, 2 );
+        _scheduler->addComputation( *_c, 1 );
+        _scheduler->addComputation( *_d, 0 );
+
+        _frameStamp = new osg::FrameStamp;
+    }
+
+    void nextFrame( unsigned int frameNumber )
+    {
+        _frameStamp->setFrameNumber( frameNumber );
+        _frameStamp->setSimulationTime( static_cast<double>(frameNumber) / 60.0 );
+    }
+
+    bool isAdmitted( osgCompute::Computation* computation )
+    {
+        return _scheduler->isAdmitted( *computation, *_frameStamp );
+    }
+
+    osg::ref_ptr<TestComputation>               _a;
+    osg::ref_ptr<TestComputation>               _b;
+    osg::ref_ptr<TestComputation>               _c;
+    osg::ref_ptr<TestComputation>               _d;
+    osg::ref_ptr<TestCostModel>                 _costModel;
+    osg::ref_ptr<osgCompute::LaunchScheduler>   _scheduler;
+    osg::ref_ptr<osg::FrameStamp>               _frameStamp;
+};
+
+//------------------------------------------------------------------------------
+static void testBudgetFitting()
+{
+    Schedule schedule;
+
+    // Frame 0: A is mandatory and B has the highest priority. C and D do not
+    // fit into the remaining budget.
+    schedule.nextFrame( 0 );
+    CHECK( schedule.isAdmitted( schedule._a.get() ) );
+    CHECK( schedule.isAdmitted( schedule._b.get() ) );
+    CHECK( !schedule.isAdmitted( schedule._c.get() ) );
+    CHECK( !schedule.isAdmitted( schedule._d.get() ) );
+    CHECK( schedule._scheduler->getPlannedCost() == 9.0 );
+    CHECK( schedule._scheduler->getNumDeferred() == 2 );
+
+    // Frame 1: C has aged to the priority of B. B wins as it was added first.
+    schedule.nextFrame( 1 );
+    CHECK( schedule.isAdmitted( schedule._b.get() ) );
+    CHECK( !schedule.isAdmitted( schedule._c.get() ) );
+    CHECK( !schedule.isAdmitted( schedule._d.get() ) );
+
+    // Frame 2: C has aged above B and replaces it.
+    schedule.nextFrame( 2 );
+    CHECK( schedule.isAdmitted( schedule._a.get() ) );
+    CHECK( !schedule.isAdmitted( schedule._b.get() ) );
+    CHECK( schedule.isAdmitted( schedule._c.get() ) );
+    CHECK( !schedule.isAdmitted( schedule._d.get() ) );
+    CHECK( schedule._scheduler->getPlannedCost() <= schedule._scheduler->getBudget() );
+}
+
+//------------------------------------------------------------------------------
+static void testStarvation()
+{
+    Schedule schedule;
+    unsigned int maxDeferred = schedule._scheduler->getMaxDeferredFrames();
+
+    osgCompute::Computation* computations[] = { schedule._a.get(), schedule._b.get(), schedule._c.get(), schedule._d.get() };
+    unsigned int deferredFrames[] = { 0, 0, 0, 0 };
+
+    for( unsigned int frame=0; frame<20; ++frame )
+    {
+        schedule.nextFrame( frame );
+
+        bool starvingAdmitted = false;
+        for( unsigned int c=0; c<4; ++c )
+        {
+            if( schedule.isAdmitted( computations[c] ) )
+            {
+                if( deferredFrames[c] >= maxDeferred )
+                    starvingAdmitted = true;
+                deferredFrames[c] = 0;
+            }
+            else
+            {
+                deferredFrames[c]++;
+            }
+
+            // No computation waits longer than the maximum number of deferred frames
+            CHECK( deferredFrames[c] <= maxDeferred );
+        }
+
+        // A computation which must be launched is never deferred
+        CHECK( deferredFrames[0] == 0 );
+
+        // Only a starving computation may exceed the budget
+        CHECK( starvingAdmitted || schedule._scheduler->getPlannedCost() <= schedule._scheduler->getBudget() );
+
+        // Frame 3: D has been deferred 3 times and is launched although the
+        // frame exceeds the budget.
+        if( frame == 3 )
+        {
+            CHECK( schedule.isAdmitted( schedule._d.get() ) );
+            CHECK( schedule._scheduler->getPlannedCost() > schedule._scheduler->getBudget() );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+static void testNoBudget()
+{
+    Schedule schedule;
+    schedule._scheduler->setBudget( 0.0 );
+
+    // A budget of 0 launches all due computations
+    schedule.nextFrame( 0 );
+    CHECK( schedule.isAdmitted( schedule._a.get() ) );
+    CHECK( schedule.isAdmitted( schedule._b.get() ) );
+    CHECK( schedule.isAdmitted( schedule._c.get() ) );
+    CHECK( schedule.isAdmitted( schedule._d.get() ) );
+    CHECK( schedule._scheduler->getNumDeferred() == 0 );
+}
+
+//------------------------------------------------------------------------------
+static void testDeletedComputation()
+{
+    Schedule schedule;
+    CHECK( schedule._scheduler->getNumComputations() == 4 );
+
+    // Deleted computations are removed with the next plan
+    schedule._d = NULL;
+    schedule.nextFrame( 0 );
+    CHECK( schedule.isAdmitted( schedule._a.get() ) );
+    CHECK( schedule._scheduler->getNumComputations() == 3 );
+}
+
+//------------------------------------------------------------------------------
+int main( int, char** )
+{
+    testBudgetFitting();
+    testStarvation();
+    testNoBudget();
+    testDeletedComputation();
+
+    if( s_numFailures != 0 )
+    {
+        std::cerr << s_numFailures << " check(s) failed." << std::endl;
+        return 1;
+    }
+
+    std::cout << "All checks passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,193 @@
+/* osgCompute - Copyright (C) 2008-2009 SVT Group
+*
+* This library is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of
+* the License, or (at your option) any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesse General Public License for more details.
+*
+* The full license is in LICENSE file included with this distribution.
+*/
+
+#include <cstdio>
+#include <sstream>
+#include <iostream>
+#include <osgDB/Registry>
+#include <osgDB/ReaderWriter>
+#include <osgDB/ReadFile>
+#include <osgDB/WriteFile>
+#include <osgCompute/Serializer>
+#include <osgCuda/Buffer>
+#include <osgCuda/Computation>
+
+static unsigned int s_numFailures = 0;
+
+#define CHECK( condition )                                                          \
+    if( !(condition) )                                                              \
+    {                                                                               \
+        std::cerr << __FILE__ << "(" << __LINE__ << "): check failed: "             \
+                  << #condition << std::endl;                                       \
+        ++s_numFailures;                                                            \
+    }
+
+static const unsigned int s_numElements = 1024;
+
+//------------------------------------------------------------------------------
+static osg::ref_ptr<osgCuda::Buffer> createBuffer()
+{
+    osg::ref_ptr<osgCuda::Buffer> buffer = new osgCuda::Buffer;
+    buffer->setName( "TestBuffer" );
+    buffer->setElementSize( sizeof(unsigned int) );
+    buffer->setDimension( 0, s_numElements );
+
+    unsigned int* data = static_cast<unsigned int*>( buffer->map( osgCompute::MAP_HOST_TARGET ) );
+    if( data == NULL )
+        return NULL;
+
+    for( unsigned int e=0; e<s_numElements; ++e )
+        data[e] = e * 2654435761u;
+    buffer->unmap();
+
+    return buffer;
+}
+
+//------------------------------------------------------------------------------
+static bool hasContents( osg::Object* object )
+{
+    osgCompute::Memory* memory = dynamic_cast<osgCompute::Memory*>( object );
+    if( memory == NULL || memory->getNumElements() != s_numElements )
+        return false;
+
+    const unsigned int* data = static_cast<const unsigned int*>( memory->map( osgCompute::MAP_HOST_SOURCE ) );
+    if( data == NULL )
+        return false;
+
+    bool equal = true;
+    for( unsigned int e=0; e<s_numElements && equal; ++e )
+        equal = (data[e] == e * 2654435761u);
+    memory->unmap();
+
+    return equal;
+}
+
+//------------------------------------------------------------------------------
+static void testDomainRegistration()
+{
+    // The libraries register their domains for the default write options
+    CHECK( osgCompute::getSerializerDomainVersion( "osgCompute" ) == OSGCOMPUTE_SERIALIZER_VERSION );
+    CHECK( osgCompute::getSerializerDomainVersion( "osgCuda" ) == OSGCUDA_SERIALIZER_VERSION );
+
+    const osgDB::Options* defaultOptions = osgDB::Registry::instance()->getOptions();
+    CHECK( defaultOptions != NULL );
+    if( defaultOptions != NULL )
+    {
+        CHECK( defaultOptions->getOptionString().find( "osgCompute:" ) != std::string::npos );
+        CHECK( defaultOptions->getOptionString().find( "osgCuda:" ) != std::string::npos );
+    }
+
+    // Listed domains keep their version
+    osg::ref_ptr<osgDB::Options> options = new osgDB::Options( "Compressor=zlib CustomDomains=osgCompute:0" );
+    osgCompute::addSerializerDomains( *options );
+    CHECK( options->getOptionString().find( "Compressor=zlib" ) != std::string::npos );
+    CHECK( options->getOptionString().find( "osgCompute:0" ) != std::string::npos );
+}
+
+//------------------------------------------------------------------------------
+static void testMemoryDataDefaultOptions()
+{
+    osg::ref_ptr<osgCuda::Buffer> buffer = createBuffer();
+    CHECK( buffer.valid() );
+    if( !buffer.valid() )
+        return;
+
+    // osgDB::writeObjectFile() uses the default options of the registry
+    const std::string fileName = "osgcompute_test_serializer.osgb";
+    CHECK( osgDB::writeObjectFile( *buffer, fileName ) );
+
+    osg::ref_ptr<osg::Object> object = osgDB::readObjectFile( fileName );
+    CHECK( hasContents( object.get() ) );
+
+    remove( fileName.c_str() );
+}
+
+//------------------------------------------------------------------------------
+static void testMemoryDataOwnOptions()
+{
+    osg::ref_ptr<osgDB::ReaderWriter> rw = osgDB::Registry::instance()->getReaderWriterForExtension( "osgb" );
+    CHECK( rw.valid() );
+    if( !rw.valid() )
+        return;
+
+    osg::ref_ptr<osgCuda::Buffer> buffer = createBuffer();
+    CHECK( buffer.valid() );
+    if( !buffer.valid() )
+        return;
+
+    osg::ref_ptr<osgDB::Options> options = new osgDB::Options( "WriteImageHint=IncludeData" );
+    osgCompute::addSerializerDomains( *options );
+
+    std::stringstream stream;
+    osgDB::ReaderWriter::WriteResult wr = rw->writeObject( *buffer, stream, options.get() );
+    CHECK( wr.success() );
+
+    osgDB::ReaderWriter::ReadResult rr = rw->readObject( stream, options.get() );
+    CHECK( hasContents( rr.getObject() ) );
+}
+
+//------------------------------------------------------------------------------
+static void testLaunchRate( const std::string& extension )
+{
+    osg::ref_ptr<osgDB::ReaderWriter> rw = osgDB::Registry::instance()->getReaderWriterForExtension( extension );
+    CHECK( rw.valid() );
+    if( !rw.valid() )
+        return;
+
+    osg::ref_ptr<osgCuda::Computation> computation = new osgCuda::Computation;
+    computation->setLaunchInterval( 3 );
+    computation->setLaunchFrequency( 30.0 );
+    computation->setLaunchPhase( 0.25 );
+
+    osg::ref_ptr<osgDB::Options> options = new osgDB::Options;
+    osgCompute::addSerializerDomains( *options );
+
+    std::stringstream stream;
+    osgDB::ReaderWriter::WriteResult wr = rw->writeNode( *computation, stream, options.get() );
+    CHECK( wr.success() );
+
+    osgDB::ReaderWriter::ReadResult rr = rw->readNode( stream, options.get() );
+    osgCompute::Computation* loaded = dynamic_cast<osgCompute::Computation*>( rr.getNode() );
+    CHECK( loaded != NULL );
+    if( loaded == NULL )
+        return;
+
+    CHECK( loaded->getLaunchInterval() == 3 );
+    CHECK( loaded->getLaunchFrequency() == 30.0 );
+    CHECK( loaded->getLaunchPhase() == 0.25 );
+}
+
+//------------------------------------------------------------------------------
+int main( int argc, char** argv )
+{
+    // The directory of the osgCuda serializer plugin
+    if( argc > 1 )
+        osgDB::Registry::instance()->getLibraryFilePathList().push_front( argv[1] );
+
+    testDomainRegistration();
+    testMemoryDataDefaultOptions();
+    testMemoryDataOwnOptions();
+    testLaunchRate( "osgb" );
+    testLaunchRate( "osgt" );
+
+    if( s_numFailures != 0 )
+    {
+        std::cerr << s_numFailures << " check(s) failed." << std::endl;
+        return 1;
+    }
+
+    std::cout << "All checks passed." << std::endl;
+    return 0;
+}